@@ -1,6 +1,25 @@
 #include "haversine_common.h"
 #include "haversine_perf.h"
+#include "haversine_math.h"
+#include "haversine_float.h"
 #include "haversine_ref0.h"
+#include "haversine_fileio.h"
+#include "haversine_ref1.h"
+#include "haversine_binary.h"
+#include "haversine_quantized.h"
+#include "haversine_stream.h"
+#include "haversine_threads.h"
+#include "haversine_generate.h"
+#include "haversine_pipeline.h"
+#include "haversine_jsonsimd.h"
+#include "haversine_jsondom.h"
+#include "haversine_schema.h"
+#include "haversine_parallel.h"
+#include "haversine_validate.h"
+#include "haversine_jsonwriter.h"
+#include "haversine_jsonquery.h"
+#include "haversine_reptest.h"
+#include "haversine_roofline.h"
 
 #ifndef UNITY_BUILD
 #define UNITY_BUILD (0)
@@ -8,7 +27,26 @@
 
 #if UNITY_BUILD
 #include "haversine_perf.cpp"
+#include "haversine_math.cpp"
+#include "haversine_float.cpp"
 #include "haversine_ref0.cpp"
+#include "haversine_fileio.cpp"
+#include "haversine_ref1.cpp"
+#include "haversine_binary.cpp"
+#include "haversine_quantized.cpp"
+#include "haversine_stream.cpp"
+#include "haversine_threads.cpp"
+#include "haversine_generate.cpp"
+#include "haversine_pipeline.cpp"
+#include "haversine_jsonsimd.cpp"
+#include "haversine_jsondom.cpp"
+#include "haversine_schema.cpp"
+#include "haversine_parallel.cpp"
+#include "haversine_validate.cpp"
+#include "haversine_jsonwriter.cpp"
+#include "haversine_jsonquery.cpp"
+#include "haversine_reptest.cpp"
+#include "haversine_roofline.cpp"
 #endif // UNITY_BUILD
 
 constexpr int DefaultCount = 10000;
@@ -21,6 +59,28 @@ int main(int ArgCount, const char* ArgValues[])
     MainExecParams ExecParams = ParseCmdLine(ArgCount, ArgValues);
     if (ExecParams.Type != MainExecType::Error)
     {
+        if (ExecParams.TraceFileName && !Perf::EnableTracing(ExecParams.TraceFileName))
+        {
+            fprintf(stdout, "ERROR: -trace needs a build with ENABLE_PROFILER!\n");
+        }
+        if (ExecParams.Counters != Perf::CounterSet::None && !Perf::EnableCounters(ExecParams.Counters))
+        {
+            fprintf(stdout, "ERROR: -counters needs a Linux build with ENABLE_PROFILER!\n");
+        }
+        if (ExecParams.bTrackAllocs && !Perf::EnableAllocTracking())
+        {
+            fprintf(stdout, "ERROR: -allocs needs a build with ENABLE_PROFILER!\n");
+        }
+        if (ExecParams.bRoofline && !ENABLE_PROFILER)
+        {
+            fprintf(stdout, "ERROR: -roofline needs a build with ENABLE_PROFILER!\n");
+        }
+        else if (ExecParams.bRoofline)
+        {
+            Perf::RooflineCeilings Ceilings = {};
+            Haversine_Roofline::GetCeilings(Haversine_Roofline::DefaultCacheFileName, &Ceilings);
+            Perf::EnableRoofline(Ceilings);
+        }
         PROFILING_BEGIN();
         Main_Exec(&ExecParams);
         PROFILING_END();
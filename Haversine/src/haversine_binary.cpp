@@ -0,0 +1,312 @@
+#include "haversine_binary.h"
+#include "haversine_perf.h"
+
+// C stdlib headers:
+#include <string.h>
+
+namespace Haversine_Binary
+{
+    static constexpr u64 ChecksumPrime1 = 0x9E3779B185EBCA87ull;
+    static constexpr u64 ChecksumPrime2 = 0xC2B2AE3D27D4EB4Full;
+    static constexpr int ChecksumBlockSize = 32;
+    // Pairs gathered per column write, 64KB
+    static constexpr int WriteBlockCount = 8 * 1024;
+
+    static const char* EncodingNames[] = { "f64", "fixed32", "cluster16" };
+    static_assert(sizeof(EncodingNames) / sizeof(EncodingNames[0]) == (u32)Encoding::Count, "Missing encoding name");
+
+    inline u64 RotateLeft(u64 Value, int Bits)
+    {
+        return (Value << Bits) | (Value >> (64 - Bits));
+    }
+
+    bool WriteChecked(FILE* FileHandle, Checksum* Sum, const void* Data, u64 Size)
+    {
+        UpdateChecksum(Sum, (const u8*)Data, Size);
+        return fwrite(Data, 1, Size, FileHandle) == Size;
+    }
+}
+
+const char* Haversine_Binary::GetEncodingName(Encoding ColumnEncoding)
+{
+    return (u32)ColumnEncoding < (u32)Encoding::Count ? EncodingNames[(u32)ColumnEncoding] : "unknown";
+}
+
+bool Haversine_Binary::ParseEncoding(const char* Name, Encoding* OutEncoding)
+{
+    for (u32 EncodingIdx = 0; EncodingIdx < (u32)Encoding::Count; EncodingIdx++)
+    {
+        if (strcmp(Name, EncodingNames[EncodingIdx]) == 0)
+        {
+            *OutEncoding = (Encoding)EncodingIdx;
+            return true;
+        }
+    }
+    return false;
+}
+
+u64 Haversine_Binary::PadToColumn(u64 Size)
+{
+    return (Size + ColumnAlignment - 1) / ColumnAlignment * ColumnAlignment;
+}
+
+Haversine_Binary::Layout Haversine_Binary::GetLayout(Encoding ColumnEncoding, u64 Count, u32 ClusterCount)
+{
+    Layout Result = {};
+    u64 Offset = sizeof(FileHeader);
+    u64 ValueSize = sizeof(f64);
+    if (ColumnEncoding == Encoding::Fixed32) { ValueSize = sizeof(s32); }
+    else if (ColumnEncoding == Encoding::Cluster16)
+    {
+        ValueSize = sizeof(s16);
+        Result.BaseOffset = Offset;
+        Result.BaseStride = PadToColumn(ClusterCount * sizeof(f64));
+        Offset += 4 * Result.BaseStride;
+        Result.ClusterOffset = Offset;
+        Offset += PadToColumn(Count * sizeof(u8));
+    }
+    Result.ColumnOffset = Offset;
+    Result.ColumnStride = PadToColumn(Count * ValueSize);
+    Result.ChecksumOffset = Offset + 4 * Result.ColumnStride;
+    Result.FileSize = Result.ChecksumOffset + sizeof(u64);
+    return Result;
+}
+
+u64 Haversine_Binary::GetFileSize(u64 Count)
+{
+    return GetLayout(Encoding::F64, Count, 0).FileSize;
+}
+
+Haversine_Binary::Checksum Haversine_Binary::NewChecksum()
+{
+    return Checksum{ { ChecksumPrime1 + ChecksumPrime2, ChecksumPrime2, 0, 0 - ChecksumPrime1 }, 0 };
+}
+
+void Haversine_Binary::UpdateChecksum(Checksum* Sum, const u8* Data, u64 Size)
+{
+    for (u64 Offset = 0; Offset + ChecksumBlockSize <= Size; Offset += ChecksumBlockSize)
+    {
+        u64 Words[4];
+        memcpy(Words, Data + Offset, sizeof(Words));
+        for (int LaneIdx = 0; LaneIdx < 4; LaneIdx++)
+        {
+            Sum->Lanes[LaneIdx] = RotateLeft(Sum->Lanes[LaneIdx] + Words[LaneIdx] * ChecksumPrime2, 31) * ChecksumPrime1;
+        }
+    }
+    Sum->Size += Size;
+}
+
+u64 Haversine_Binary::FinishChecksum(const Checksum& Sum)
+{
+    u64 Result = RotateLeft(Sum.Lanes[0], 1) + RotateLeft(Sum.Lanes[1], 7) +
+        RotateLeft(Sum.Lanes[2], 12) + RotateLeft(Sum.Lanes[3], 18) + Sum.Size;
+    Result ^= Result >> 33;
+    Result *= ChecksumPrime2;
+    Result ^= Result >> 29;
+    Result *= ChecksumPrime1;
+    Result ^= Result >> 32;
+    return Result;
+}
+
+bool Haversine_Binary::WriteColumn(FILE* FileHandle, Checksum* Sum, const void* Data, u64 Size)
+{
+    u64 WholeSize = Size / ColumnAlignment * ColumnAlignment;
+    bool bWritten = WriteChecked(FileHandle, Sum, Data, WholeSize);
+
+    u8 Tail[ColumnAlignment] = {};
+    if (bWritten && WholeSize < Size)
+    {
+        memcpy(Tail, (const u8*)Data + WholeSize, Size - WholeSize);
+        bWritten = WriteChecked(FileHandle, Sum, Tail, ColumnAlignment);
+    }
+    return bWritten;
+}
+
+void Haversine_Binary::PairFile::Release()
+{
+    File.Release();
+    *this = {};
+}
+
+bool Haversine_Binary::WriteFile(HList List, const char* FileName)
+{
+    TIME_FUNC_DATA(GetFileSize(List.Count > 0 ? List.Count : 0));
+
+    FILE* FileHandle = nullptr;
+    fopen_s(&FileHandle, FileName, "wb");
+    if (!FileHandle)
+    {
+        fprintf(stdout, "ERROR: Could not open file %s for write!\n", FileName);
+        return false;
+    }
+
+    u64 Count = List.Count > 0 ? (u64)List.Count : 0;
+    FileHeader Header = {};
+    Header.Magic = Magic;
+    Header.Version = Version;
+    Header.HeaderSize = sizeof(FileHeader);
+    Header.Count = Count;
+    Header.ColumnStride = GetLayout(Encoding::F64, Count, 0).ColumnStride;
+    Header.ColumnEncoding = Encoding::F64;
+
+    Checksum Sum = NewChecksum();
+    bool bWritten = WriteChecked(FileHandle, &Sum, &Header, sizeof(Header));
+
+    // Gathered in blocks of whole cache lines, the zeroed tail of the last one is the column padding
+    f64* Block = new f64[WriteBlockCount];
+    for (int ColumnIdx = 0; ColumnIdx < 4 && bWritten; ColumnIdx++)
+    {
+        for (u64 BlockBegin = 0; BlockBegin < Count && bWritten; BlockBegin += WriteBlockCount)
+        {
+            u64 BlockCount = Count - BlockBegin < WriteBlockCount ? Count - BlockBegin : WriteBlockCount;
+            const HPair* Src = List.Data + BlockBegin;
+            for (u64 PairIdx = 0; PairIdx < BlockCount; PairIdx++)
+            {
+                const f64* Coords = &Src[PairIdx].X0;
+                Block[PairIdx] = Coords[ColumnIdx];
+            }
+            bWritten = WriteColumn(FileHandle, &Sum, Block, BlockCount * sizeof(f64));
+        }
+    }
+    delete[] Block;
+
+    u64 Result = FinishChecksum(Sum);
+    bWritten = bWritten && fwrite(&Result, sizeof(Result), 1, FileHandle) == 1;
+    fclose(FileHandle);
+
+    if (!bWritten) { fprintf(stdout, "ERROR: Failed to write %s!\n", FileName); }
+    return bWritten;
+}
+
+bool Haversine_Binary::OpenMapped(const char* FileName, PairFile* OutFile)
+{
+    TIME_FUNC();
+
+    // Only the mapped modes are zero copy, -load read would copy the whole file first
+    Haversine_FileIO::LoadMode Mode = Haversine_FileIO::DefaultLoadMode;
+    if (Mode == Haversine_FileIO::LoadMode::Read) { Mode = Haversine_FileIO::LoadMode::Map; }
+
+    PairFile Result = {};
+    Result.File = Haversine_FileIO::Load(FileName, Mode);
+    const u8* Data = Result.File.Contents.Data;
+    // Load appends a null, which isn't part of the file
+    u64 Size = Result.File.Contents.Size > 0 ? (u64)Result.File.Contents.Size - 1 : 0;
+    if (!Data)
+    {
+        Result.Release();
+        return false;
+    }
+
+    FileHeader& Header = Result.Header;
+    if (Size >= sizeof(Header)) { memcpy(&Header, Data, sizeof(Header)); }
+
+    const char* Problem = nullptr;
+    Layout FileLayout = {};
+    if (Size < sizeof(Header) || Header.Magic != Magic) { Problem = "not a binary pairs file"; }
+    else if (Header.Version != Version) { Problem = "unsupported version"; }
+    else if (Header.HeaderSize != sizeof(FileHeader)) { Problem = "unexpected header size"; }
+    else if ((u32)Header.ColumnEncoding >= (u32)Encoding::Count) { Problem = "unknown encoding"; }
+    else if (Header.Count > INT32_MAX) { Problem = "too many pairs"; }
+    else if (Header.ColumnEncoding == Encoding::Cluster16 &&
+            (Header.ClusterCount > MaxClusterCount || (Header.ClusterCount == 0 && Header.Count > 0)))
+    {
+        Problem = "unexpected cluster count";
+    }
+    else
+    {
+        FileLayout = GetLayout(Header.ColumnEncoding, Header.Count, Header.ClusterCount);
+        if (Header.ColumnStride != FileLayout.ColumnStride) { Problem = "unexpected column stride"; }
+        else if (Size != FileLayout.FileSize) { Problem = "size doesn't match the pair count"; }
+    }
+    if (!Problem)
+    {
+        TIME_BLOCK_DATA(Binary_Checksum, Size);
+
+        Checksum Sum = NewChecksum();
+        UpdateChecksum(&Sum, Data, FileLayout.ChecksumOffset);
+        u64 Expected = 0;
+        memcpy(&Expected, Data + FileLayout.ChecksumOffset, sizeof(Expected));
+        if (FinishChecksum(Sum) != Expected) { Problem = "checksum mismatch"; }
+    }
+    if (Problem)
+    {
+        fprintf(stdout, "ERROR: When reading file %s, %s!\n", FileName, Problem);
+        Result.Release();
+        return false;
+    }
+
+    if (Header.ColumnEncoding == Encoding::F64)
+    {
+        // Loads in the kernels are unaligned, so this also works if Load fell back to a new[] buffer
+        f64* Columns = (f64*)(Result.File.Contents.Data + FileLayout.ColumnOffset);
+        u64 StrideCount = FileLayout.ColumnStride / sizeof(f64);
+        Result.Columns.Count = (int)Header.Count;
+        Result.Columns.X0 = Columns;
+        Result.Columns.Y0 = Columns + StrideCount;
+        Result.Columns.X1 = Columns + 2 * StrideCount;
+        Result.Columns.Y1 = Columns + 3 * StrideCount;
+    }
+
+    *OutFile = Result;
+    return true;
+}
+
+bool Haversine_Binary::Open(const char* FileName, PairFile* OutFile)
+{
+    if (!OpenMapped(FileName, OutFile)) { return false; }
+    if (OutFile->Header.ColumnEncoding != Encoding::F64)
+    {
+        fprintf(stdout, "ERROR: File %s is %s encoded, not f64!\n",
+                FileName, GetEncodingName(OutFile->Header.ColumnEncoding));
+        OutFile->Release();
+        return false;
+    }
+    return true;
+}
+
+bool Haversine_Binary::ReadHeader(const char* FileName, FileHeader* OutHeader)
+{
+    FILE* FileHandle = nullptr;
+    fopen_s(&FileHandle, FileName, "rb");
+    if (!FileHandle) { return false; }
+
+    FileHeader Header = {};
+    bool bResult = fread(&Header, 1, sizeof(Header), FileHandle) >= sizeof(Header.Magic) && Header.Magic == Magic;
+    fclose(FileHandle);
+    if (bResult) { *OutHeader = Header; }
+    return bResult;
+}
+
+void Haversine_Binary::Convert(const char* FileNameJSON, const char* FileNameBinary, ReadFileFuncT ReadFile)
+{
+    TIME_FUNC();
+
+    HList PairList = ReadFile(FileNameJSON);
+    if (WriteFile(PairList, FileNameBinary))
+    {
+        fprintf(stdout, "Wrote binary data to file %s (%d pairs, %llu bytes)\n",
+                FileNameBinary, PairList.Count, GetFileSize(PairList.Count));
+    }
+    TRACK_FREE(sizeof(HPair) * PairList.Count);
+    delete[] PairList.Data;
+}
+
+void Haversine_Binary::Calc(const char* FileName, int ThreadCount)
+{
+    TIME_FUNC();
+
+    PairFile Input = {};
+    if (!Open(FileName, &Input)) { return; }
+
+    f64 HvAvg = 0.0;
+    if (Input.Columns.Count > 0)
+    {
+        HvAvg = ThreadCount > 0 ?
+            Haversine_Ref1::CalculateAverageThreaded(Input.Columns, ThreadCount) :
+            Haversine_Ref1::CalculateAverage(Input.Columns);
+    }
+    fprintf(stdout, "\tAverage: %f\n", HvAvg);
+
+    Input.Release();
+}
+
@@ -0,0 +1,114 @@
+#ifndef HAVERSINE_BINARY_H
+#define HAVERSINE_BINARY_H
+
+/*
+ * NOTE:
+ *      Versioned binary pair format (v2), replacing the raw CoordPair dump of
+ *      Haversine_Ref0::WriteDataAsBinary for anything that wants to skip JSON:
+ *          FileHeader (64 bytes)
+ *          Columns, each zero padded to a multiple of 64 bytes (see Layout)
+ *          u64 checksum of everything before it
+ *      Every column starts 64-byte aligned relative to the file start, so a
+ *      mapped file is used by the kernels as is, without copies
+ *      Encoding::F64 stores X0/Y0/X1/Y1 as f64 columns (a Haversine_Ref1::HListSoA),
+ *      the quantized encodings are decoded by Haversine_Quantized
+ *      All fields are little endian, like every target this builds for
+ */
+
+#include "haversine_common.h"
+#include "haversine_fileio.h"
+#include "haversine_ref1.h"
+
+namespace Haversine_Binary
+{
+    static constexpr u32 Magic = 0x32425648; // "HVB2"
+    static constexpr u16 Version = 2;
+    static constexpr int ColumnAlignment = 64;
+    // Cluster bases are looked up with register permutes (Lookup8), gathers are much slower
+    static constexpr u32 MaxClusterCount = 8;
+
+    enum struct Encoding : u32
+    {
+        F64, // 4 f64 columns
+        Fixed32, // 4 s32 columns, Coord = Value * Step
+        Cluster16, // Cluster base table, u8 cluster column, 4 s16 columns, Coord = Base[Cluster] + Value * Step
+        Count
+    };
+
+    const char* GetEncodingName(Encoding ColumnEncoding);
+    bool ParseEncoding(const char* Name, Encoding* OutEncoding);
+
+    struct FileHeader
+    {
+        u32 Magic;
+        u16 Version;
+        u16 HeaderSize; // sizeof(FileHeader), columns start right after it
+        u64 Count;
+        u64 ColumnStride; // Bytes from one coordinate column to the next
+        Encoding ColumnEncoding; // 0 (F64) in files written before there were others
+        u32 ClusterCount; // Cluster16 only
+        f64 StepX; // Fixed32/Cluster16 only, degrees per unit
+        f64 StepY;
+        u64 Reserved[2];
+    };
+    static_assert(sizeof(FileHeader) == ColumnAlignment, "Columns must stay aligned");
+
+    // Byte offsets of everything after the header
+    struct Layout
+    {
+        u64 BaseOffset; // Cluster16: 4 f64 columns of ClusterCount bases (X0, Y0, X1, Y1)
+        u64 BaseStride;
+        u64 ClusterOffset; // Cluster16: u8 cluster index per pair
+        u64 ColumnOffset; // X0 column, Y0/X1/Y1 follow ColumnStride apart
+        u64 ColumnStride;
+        u64 ChecksumOffset;
+        u64 FileSize;
+    };
+
+    Layout GetLayout(Encoding ColumnEncoding, u64 Count, u32 ClusterCount);
+    u64 GetFileSize(u64 Count);
+    u64 PadToColumn(u64 Size);
+
+    // NOTE:
+    //      Four independent multiply-rotate lanes over 32 byte blocks, so the
+    //      checksum isn't bound by the latency of a single multiply chain
+    //      Every section of the file is a multiple of 32 bytes, so writers can
+    //      feed it section by section and get the same result as one pass
+    struct Checksum
+    {
+        u64 Lanes[4];
+        u64 Size;
+    };
+
+    Checksum NewChecksum();
+    void UpdateChecksum(Checksum* Sum, const u8* Data, u64 Size);
+    u64 FinishChecksum(const Checksum& Sum);
+    // Writes Size bytes then zeros up to PadToColumn(Size), adding both to Sum
+    bool WriteColumn(FILE* FileHandle, Checksum* Sum, const void* Data, u64 Size);
+
+    struct PairFile
+    {
+        Haversine_FileIO::MappedFile File;
+        FileHeader Header;
+        // F64 only, points into File, nothing to release on its own
+        Haversine_Ref1::HListSoA Columns;
+
+        void Release();
+    };
+
+    bool WriteFile(HList List, const char* FileName);
+    // Checks the header, size and checksum for any encoding, prints why and returns false if any are off
+    bool OpenMapped(const char* FileName, PairFile* OutFile);
+    // OpenMapped + fails for anything but Encoding::F64
+    bool Open(const char* FileName, PairFile* OutFile);
+    // Only reads the header, for telling v2 files apart from JSON
+    bool ReadHeader(const char* FileName, FileHeader* OutHeader);
+
+    // JSON (any layout ReadFile understands) to v2
+    void Convert(const char* FileNameJSON, const char* FileNameBinary, ReadFileFuncT ReadFile);
+    // ThreadCount 0 => single threaded Haversine_Ref1::CalculateAverage
+    void Calc(const char* FileName, int ThreadCount);
+}
+
+#endif // HAVERSINE_BINARY_H
+
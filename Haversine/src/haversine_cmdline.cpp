@@ -5,6 +5,22 @@ enum struct MainExecType : u32
     Gen,
     Calc,
     Full,
+    Compare,
+    MathTest,
+    ParseBench,
+    DomBench,
+    SchemaBench,
+    ParallelBench,
+    QueryBench,
+    LoadBench,
+    Convert,
+    QuantBench,
+    WriteBench,
+    GenBench,
+    FloatTest,
+    Validate,
+    RepTest,
+    Roofline,
     Error
 };
 
@@ -14,9 +30,31 @@ struct MainExecParams
     u64 Seed;
     u64 Count;
     const char* InputFileName;
+    const char* OutputFileName; // convert only, or the answers file for validate
+    Haversine_Binary::Encoding ColumnEncoding; // convert only
     bool bClustered;
+    int ThreadCount; // 0 => single threaded Ref0 path
+    bool bStream;
+    ReadFileFuncT ReadFile; // nullptr => Ref0 parser
+    Haversine_FileIO::LoadMode LoadMode; // Used by the non-Ref0 parsers
+    bool bCold;
+    int ChunkSize; // Stream block / pipeline chunk size
+    int QueueDepth; // 0 => synchronous reads
+    bool bAnswers; // gen only
+    Haversine_Validate::Kernel PairKernel; // validate only
+    const char* TraceFileName; // nullptr => no timeline
+    Perf::CounterSet Counters; // None => no hardware counters on the profiler anchors
+    bool bTrackAllocs;
+    bool bRoofline; // Compare the profiler anchors against Haversine_Roofline's ceilings
 };
 
+// Size of the generated document for querybench, 2GB is the most a FileContentsT/int size can describe
+constexpr u64 DefaultQueryBenchMB = 100;
+constexpr u64 MaxQueryBenchMB = 2000;
+// -chunk is in KB, the size in bytes has to fit an int
+constexpr int MaxChunkKB = 1024 * 1024;
+constexpr u64 MaxRepTestSeconds = 3600;
+
 MainExecType ParseExecType(const char* ArgV)
 {
     MainExecType Result = MainExecType::Error;
@@ -32,12 +70,161 @@ MainExecType ParseExecType(const char* ArgV)
     {
         Result = MainExecType::Full;
     }
+    else if (strcmp(ArgV, "compare") == 0)
+    {
+        Result = MainExecType::Compare;
+    }
+    else if (strcmp(ArgV, "mathtest") == 0)
+    {
+        Result = MainExecType::MathTest;
+    }
+    else if (strcmp(ArgV, "parsebench") == 0)
+    {
+        Result = MainExecType::ParseBench;
+    }
+    else if (strcmp(ArgV, "dombench") == 0)
+    {
+        Result = MainExecType::DomBench;
+    }
+    else if (strcmp(ArgV, "schemabench") == 0)
+    {
+        Result = MainExecType::SchemaBench;
+    }
+    else if (strcmp(ArgV, "parallelbench") == 0)
+    {
+        Result = MainExecType::ParallelBench;
+    }
+    else if (strcmp(ArgV, "querybench") == 0)
+    {
+        Result = MainExecType::QueryBench;
+    }
+    else if (strcmp(ArgV, "loadbench") == 0)
+    {
+        Result = MainExecType::LoadBench;
+    }
+    else if (strcmp(ArgV, "convert") == 0)
+    {
+        Result = MainExecType::Convert;
+    }
+    else if (strcmp(ArgV, "quantbench") == 0)
+    {
+        Result = MainExecType::QuantBench;
+    }
+    else if (strcmp(ArgV, "writebench") == 0)
+    {
+        Result = MainExecType::WriteBench;
+    }
+    else if (strcmp(ArgV, "genbench") == 0)
+    {
+        Result = MainExecType::GenBench;
+    }
+    else if (strcmp(ArgV, "floattest") == 0)
+    {
+        Result = MainExecType::FloatTest;
+    }
+    else if (strcmp(ArgV, "validate") == 0)
+    {
+        Result = MainExecType::Validate;
+    }
+    else if (strcmp(ArgV, "reptest") == 0)
+    {
+        Result = MainExecType::RepTest;
+    }
+    else if (strcmp(ArgV, "roofline") == 0)
+    {
+        Result = MainExecType::Roofline;
+    }
     return Result;
 }
 
 MainExecParams ParseCmdLine(int ArgCount, const char** ArgValues)
 {
-    MainExecParams Result = { MainExecType::Error, 0, 0, nullptr, true };
+    MainExecParams Result = { MainExecType::Error, 0, 0, nullptr, nullptr, Haversine_Binary::Encoding::F64, true, 0, false, nullptr,
+        Haversine_FileIO::LoadMode::Read, false, Haversine_Pipeline::DefaultChunkSize, 0, false, Haversine_Validate::Kernel::Ref1, nullptr,
+        Perf::CounterSet::None, false, false };
+
+    // Pull out option flags first (e.g. -threads N), everything else is positional
+    static constexpr int MaxPositionalArgs = 8;
+    const char* PositionalArgs[MaxPositionalArgs] = {};
+    int PositionalCount = 0;
+    for (int ArgIdx = 0; ArgIdx < ArgCount; ArgIdx++)
+    {
+        if (strcmp(ArgValues[ArgIdx], "-threads") == 0)
+        {
+            int ThreadCount = ArgIdx + 1 < ArgCount ? atoi(ArgValues[++ArgIdx]) : 0;
+            if (ThreadCount < 1 || ThreadCount > Haversine_Threads::MaxThreadCount) { return Result; }
+            Result.ThreadCount = ThreadCount;
+        }
+        else if (strcmp(ArgValues[ArgIdx], "-stream") == 0)
+        {
+            Result.bStream = true;
+        }
+        else if (strcmp(ArgValues[ArgIdx], "-parser") == 0)
+        {
+            const char* ParserName = ArgIdx + 1 < ArgCount ? ArgValues[++ArgIdx] : "";
+            if (strcmp(ParserName, "ref0") == 0) { Result.ReadFile = Haversine_Ref0::ReadFileAsJSON; }
+            else if (strcmp(ParserName, "simd") == 0) { Result.ReadFile = Haversine_JsonSimd::ReadFileAsJSON; }
+            else if (strcmp(ParserName, "dom") == 0) { Result.ReadFile = Haversine_JsonDom::ReadFileAsJSON; }
+            else if (strcmp(ParserName, "schema") == 0) { Result.ReadFile = Haversine_Schema::ReadFileAsJSON; }
+            else if (strcmp(ParserName, "parallel") == 0) { Result.ReadFile = Haversine_Parallel::ReadFileAsJSON; }
+            else { return Result; }
+        }
+        else if (strcmp(ArgValues[ArgIdx], "-load") == 0)
+        {
+            const char* ModeName = ArgIdx + 1 < ArgCount ? ArgValues[++ArgIdx] : "";
+            if (!Haversine_FileIO::ParseLoadMode(ModeName, &Result.LoadMode)) { return Result; }
+        }
+        else if (strcmp(ArgValues[ArgIdx], "-encoding") == 0)
+        {
+            const char* EncodingName = ArgIdx + 1 < ArgCount ? ArgValues[++ArgIdx] : "";
+            if (!Haversine_Binary::ParseEncoding(EncodingName, &Result.ColumnEncoding)) { return Result; }
+        }
+        else if (strcmp(ArgValues[ArgIdx], "-chunk") == 0)
+        {
+            int ChunkKB = ArgIdx + 1 < ArgCount ? atoi(ArgValues[++ArgIdx]) : 0;
+            if (ChunkKB < 1 || ChunkKB > MaxChunkKB) { return Result; }
+            Result.ChunkSize = ChunkKB * 1024;
+        }
+        else if (strcmp(ArgValues[ArgIdx], "-answers") == 0)
+        {
+            Result.bAnswers = true;
+        }
+        else if (strcmp(ArgValues[ArgIdx], "-kernel") == 0)
+        {
+            const char* KernelName = ArgIdx + 1 < ArgCount ? ArgValues[++ArgIdx] : "";
+            if (!Haversine_Validate::ParseKernel(KernelName, &Result.PairKernel)) { return Result; }
+        }
+        else if (strcmp(ArgValues[ArgIdx], "-trace") == 0)
+        {
+            if (ArgIdx + 1 >= ArgCount) { return Result; }
+            Result.TraceFileName = ArgValues[++ArgIdx];
+        }
+        else if (strcmp(ArgValues[ArgIdx], "-allocs") == 0)
+        {
+            Result.bTrackAllocs = true;
+        }
+        else if (strcmp(ArgValues[ArgIdx], "-roofline") == 0)
+        {
+            Result.bRoofline = true;
+        }
+        else if (strcmp(ArgValues[ArgIdx], "-counters") == 0)
+        {
+            const char* SetName = ArgIdx + 1 < ArgCount ? ArgValues[++ArgIdx] : "";
+            if (!Perf::ParseCounterSet(SetName, &Result.Counters)) { return Result; }
+        }
+        else if (strcmp(ArgValues[ArgIdx], "-queue") == 0)
+        {
+            int QueueDepth = ArgIdx + 1 < ArgCount ? atoi(ArgValues[++ArgIdx]) : -1;
+            if (QueueDepth < 0 || QueueDepth > Haversine_Pipeline::MaxQueueDepth) { return Result; }
+            Result.QueueDepth = QueueDepth;
+        }
+        else if (PositionalCount < MaxPositionalArgs)
+        {
+            PositionalArgs[PositionalCount++] = ArgValues[ArgIdx];
+        }
+    }
+    ArgCount = PositionalCount;
+    ArgValues = PositionalArgs;
 
     // Try default format: haversine.exe default [gen/calc/all]
     if ((ArgCount == 2 || ArgCount == 3) && strcmp(ArgValues[1], "default") == 0)
@@ -48,6 +235,40 @@ MainExecParams ParseCmdLine(int ArgCount, const char** ArgValues)
         Result.Count = DefaultCount;
         Result.bClustered = true;
     }
+    // Try convert/validate/reptest/loadbench/parallelbench first, their (optional) second argument would make them look like the format below
+    else if (ArgCount == 4 && ParseExecType(ArgValues[1]) == MainExecType::Convert)
+    {
+        Result.Type = MainExecType::Convert;
+        Result.InputFileName = ArgValues[2];
+        Result.OutputFileName = ArgValues[3];
+    }
+    else if ((ArgCount == 3 || ArgCount == 4) && ParseExecType(ArgValues[1]) == MainExecType::Validate)
+    {
+        Result.Type = MainExecType::Validate;
+        Result.InputFileName = ArgValues[2];
+        Result.OutputFileName = ArgCount == 4 ? ArgValues[3] : nullptr;
+    }
+    else if ((ArgCount == 3 || ArgCount == 4) && ParseExecType(ArgValues[1]) == MainExecType::RepTest)
+    {
+        Result.Type = MainExecType::RepTest;
+        Result.InputFileName = ArgValues[2];
+        Result.Count = ArgCount == 4 ? strtoull(ArgValues[3], nullptr, 10) : Haversine_RepTest::DefaultSecondsToTry;
+        if (Result.Count < 1 || Result.Count > MaxRepTestSeconds) { Result.Type = MainExecType::Error; }
+    }
+    else if ((ArgCount == 3 || ArgCount == 4) && ParseExecType(ArgValues[1]) == MainExecType::LoadBench)
+    {
+        Result.Type = MainExecType::LoadBench;
+        Result.InputFileName = ArgValues[2];
+        Result.bCold = ArgCount == 4 && strcmp(ArgValues[3], "cold") == 0;
+        if (ArgCount == 4 && !Result.bCold) { Result.Type = MainExecType::Error; }
+    }
+    else if ((ArgCount == 3 || ArgCount == 4) && ParseExecType(ArgValues[1]) == MainExecType::ParallelBench)
+    {
+        Result.Type = MainExecType::ParallelBench;
+        Result.InputFileName = ArgValues[2];
+        Result.Count = ArgCount == 4 ? strtoull(ArgValues[3], nullptr, 10) : Haversine_Threads::GetHardwareThreadCount();
+        if (Result.Count < 1 || Result.Count > Haversine_Threads::MaxThreadCount) { Result.Type = MainExecType::Error; }
+    }
     // Try argument format: haversine.exe [gen/calc/all] [Seed] [Count]
     else if (ArgCount == 4)
     {
@@ -56,11 +277,42 @@ MainExecParams ParseCmdLine(int ArgCount, const char** ArgValues)
         {
             Result.Seed = strtoull(ArgValues[2], nullptr, 10);
             Result.Count = strtoull(ArgValues[3], nullptr, 10);
+            // gen -stream never holds the pairs, only the generator's counters (5 per pair) have to fit a u64
             constexpr u64 MaxCount = UINT32_MAX;
-            if (Result.Count > MaxCount) { Result.Count = MaxCount; }
+            constexpr u64 MaxStreamCount = 1ull << 60;
+            u64 CountLimit = Result.Type == MainExecType::Gen && Result.bStream ? MaxStreamCount : MaxCount;
+            if (Result.Count > CountLimit) { Result.Count = CountLimit; }
             Result.bClustered = true;
         }
     }
+    else if (ArgCount == 2 && ParseExecType(ArgValues[1]) == MainExecType::MathTest)
+    {
+        Result.Type = MainExecType::MathTest;
+    }
+    else if (ArgCount == 2 && ParseExecType(ArgValues[1]) == MainExecType::Roofline)
+    {
+        Result.Type = MainExecType::Roofline;
+    }
+    else if (ArgCount == 2 && ParseExecType(ArgValues[1]) == MainExecType::FloatTest)
+    {
+        Result.Type = MainExecType::FloatTest;
+        Result.Seed = DefaultSeed;
+        Result.Count = DefaultCount;
+    }
+    else if ((ArgCount == 2 || ArgCount == 3) && ParseExecType(ArgValues[1]) == MainExecType::QueryBench)
+    {
+        Result.Type = MainExecType::QueryBench;
+        Result.Count = ArgCount == 3 ? strtoull(ArgValues[2], nullptr, 10) : DefaultQueryBenchMB;
+        if (Result.Count < 1 || Result.Count > MaxQueryBenchMB) { Result.Type = MainExecType::Error; }
+    }
+    else if (ArgCount == 3 && (ParseExecType(ArgValues[1]) == MainExecType::ParseBench ||
+                ParseExecType(ArgValues[1]) == MainExecType::DomBench ||
+                ParseExecType(ArgValues[1]) == MainExecType::SchemaBench ||
+                ParseExecType(ArgValues[1]) == MainExecType::QuantBench))
+    {
+        Result.Type = ParseExecType(ArgValues[1]);
+        Result.InputFileName = ArgValues[2];
+    }
     else if (ArgCount == 2)
     {
         Result.Type = MainExecType::Calc;
@@ -73,28 +325,150 @@ MainExecParams ParseCmdLine(int ArgCount, const char** ArgValues)
 void Main_Exec(MainExecParams* ExecParams)
 {
     if (ExecParams)
+    {
+        Haversine_FileIO::DefaultLoadMode = ExecParams->LoadMode;
+        Haversine_Pipeline::DefaultChunkSize = ExecParams->ChunkSize;
+        Haversine_Pipeline::DefaultQueueDepth = ExecParams->QueueDepth;
+        Haversine_Parallel::DefaultThreadCount = ExecParams->ThreadCount;
+    }
+
+    if (ExecParams && ExecParams->Type == MainExecType::MathTest)
+    {
+        Haversine_Math::RunHarness();
+    }
+    else if (ExecParams && ExecParams->Type == MainExecType::Roofline)
+    {
+        Haversine_Roofline::Run(Haversine_Roofline::DefaultCacheFileName);
+    }
+    else if (ExecParams && ExecParams->Type == MainExecType::ParseBench)
+    {
+        Haversine_JsonSimd::Benchmark(ExecParams->InputFileName);
+    }
+    else if (ExecParams && ExecParams->Type == MainExecType::DomBench)
+    {
+        Haversine_JsonDom::Benchmark(ExecParams->InputFileName);
+    }
+    else if (ExecParams && ExecParams->Type == MainExecType::SchemaBench)
+    {
+        Haversine_Schema::Benchmark(ExecParams->InputFileName);
+    }
+    else if (ExecParams && ExecParams->Type == MainExecType::ParallelBench)
+    {
+        Haversine_Parallel::Benchmark(ExecParams->InputFileName, (int)ExecParams->Count);
+    }
+    else if (ExecParams && ExecParams->Type == MainExecType::QueryBench)
+    {
+        Haversine_JsonQuery::Benchmark((int)ExecParams->Count);
+    }
+    else if (ExecParams && ExecParams->Type == MainExecType::Convert)
+    {
+        ReadFileFuncT ReadFile = ExecParams->ReadFile ? ExecParams->ReadFile : Haversine_Schema::ReadFileAsJSON;
+        if (ExecParams->ColumnEncoding == Haversine_Binary::Encoding::F64)
+        {
+            Haversine_Binary::Convert(ExecParams->InputFileName, ExecParams->OutputFileName, ReadFile);
+        }
+        else
+        {
+            Haversine_Quantized::Convert(ExecParams->InputFileName, ExecParams->OutputFileName, ReadFile, ExecParams->ColumnEncoding);
+        }
+    }
+    else if (ExecParams && ExecParams->Type == MainExecType::QuantBench)
+    {
+        Haversine_Quantized::Benchmark(ExecParams->InputFileName);
+    }
+    else if (ExecParams && ExecParams->Type == MainExecType::Validate)
+    {
+        ReadFileFuncT ReadFile = ExecParams->ReadFile ? ExecParams->ReadFile : Haversine_Schema::ReadFileAsJSON;
+        static constexpr int FileNameMaxSize = 512;
+        char AnswersFileName[FileNameMaxSize];
+        if (ExecParams->OutputFileName) { (void)sprintf_s(AnswersFileName, FileNameMaxSize, "%s", ExecParams->OutputFileName); }
+        else { Haversine_Validate::GetAnswersFileName(AnswersFileName, FileNameMaxSize, ExecParams->InputFileName); }
+        Haversine_Validate::Validate(ExecParams->InputFileName, AnswersFileName, ExecParams->PairKernel, ReadFile);
+    }
+    else if (ExecParams && ExecParams->Type == MainExecType::RepTest)
+    {
+        ReadFileFuncT ReadFile = ExecParams->ReadFile ? ExecParams->ReadFile : Haversine_Schema::ReadFileAsJSON;
+        Haversine_RepTest::Run(ExecParams->InputFileName, ReadFile, (u32)ExecParams->Count);
+    }
+    else if (ExecParams && ExecParams->Type == MainExecType::LoadBench)
+    {
+        Haversine_FileIO::Benchmark(ExecParams->InputFileName, ExecParams->bCold);
+    }
+    else if (ExecParams)
     {
         u64 Seed = ExecParams->Seed;
         u64 Count = ExecParams->Count;
         const char* InputFileName = ExecParams->InputFileName;
         bool bClustered = ExecParams->bClustered;
+        int ThreadCount = ExecParams->ThreadCount;
+        bool bStream = ExecParams->bStream;
+        bool bAnswers = ExecParams->bAnswers;
+        ReadFileFuncT ReadFile = ExecParams->ReadFile;
         if (InputFileName || (Seed && Count))
         {
             switch (ExecParams->Type)
             {
                 case MainExecType::Gen:
                 {
-                    Haversine_Ref0::Gen(Seed, Count, bClustered);
+                    if (bStream) { Haversine_JsonWriter::GenStream(Seed, Count, bClustered, ThreadCount, bAnswers); }
+                    else if (Count > INT32_MAX)
+                    {
+                        fprintf(stdout, "ERROR: gen holds all %llu pairs in one list, use -stream for more than %d!\n", Count, INT32_MAX);
+                    }
+                    else { Haversine_JsonWriter::Gen((int)Seed, (int)Count, bClustered, ThreadCount, bAnswers); }
                 } break;
                 case MainExecType::Calc:
                 {
-                    if (InputFileName) { Haversine_Ref0::Calc(InputFileName); }
-                    else { Haversine_Ref0::Calc(Seed, Count, bClustered); }
+                    Haversine_Binary::FileHeader Header = {};
+                    if (InputFileName && Haversine_Binary::ReadHeader(InputFileName, &Header))
+                    {
+                        if (Header.ColumnEncoding == Haversine_Binary::Encoding::F64) { Haversine_Binary::Calc(InputFileName, ThreadCount); }
+                        else { Haversine_Quantized::Calc(InputFileName, ThreadCount); }
+                    }
+                    else if (bStream)
+                    {
+                        if (InputFileName) { Haversine_Stream::Calc(InputFileName); }
+                        else { Haversine_Stream::Calc(Seed, Count, bClustered); }
+                    }
+                    else if (ThreadCount > 0 || ReadFile)
+                    {
+                        if (!ReadFile) { ReadFile = Haversine_Ref0::ReadFileAsJSON; }
+                        if (InputFileName) { Haversine_Ref1::Calc(InputFileName, ThreadCount, ReadFile); }
+                        else { Haversine_Ref1::Calc(Seed, Count, bClustered, ThreadCount, ReadFile); }
+                    }
+                    else
+                    {
+                        if (InputFileName) { Haversine_Ref0::Calc(InputFileName); }
+                        else { Haversine_Ref0::Calc(Seed, Count, bClustered); }
+                    }
                 } break;
                 case MainExecType::Full:
                 {
                     Haversine_Ref0::Full(Seed, Count, bClustered);
                 } break;
+                case MainExecType::Compare:
+                {
+                    Haversine_Ref1::Compare(Seed, Count, bClustered, ThreadCount);
+                } break;
+                case MainExecType::WriteBench:
+                {
+                    int MaxThreadCount = ThreadCount > 0 ? ThreadCount : Haversine_Threads::GetHardwareThreadCount();
+                    Haversine_JsonWriter::Benchmark((int)Seed, (int)Count, MaxThreadCount);
+                } break;
+                case MainExecType::GenBench:
+                {
+                    int MaxThreadCount = ThreadCount > 0 ? ThreadCount : Haversine_Threads::GetHardwareThreadCount();
+                    Haversine_Generate::Benchmark((int)Seed, (int)Count, MaxThreadCount);
+                } break;
+                case MainExecType::FloatTest:
+                {
+                    Haversine_Float::RunHarness((int)Seed, (int)Count);
+                } break;
+                // The commands without a Seed/Count form are handled above
+                default:
+                {
+                    fprintf(stdout, "ERROR: Unhandled command type %u!\n", (u32)ExecParams->Type);
+                } break;
             }
         }
     }
@@ -102,11 +476,65 @@ void Main_Exec(MainExecParams* ExecParams)
 
 void PrintProgramUsage(const char* ProgramName)
 {
-    fprintf(stdout, "\tUsage: %s [gen/calc/all] [Seed] [PairCount]\n",
+    fprintf(stdout, "\tUsage: %s [gen/calc/all/compare] [Seed] [PairCount]\n",
             ProgramName);
     fprintf(stdout, "\tExample: %s all %d %d \n",
             ProgramName, DefaultSeed, DefaultCount);
-    fprintf(stdout, "\tOr: %s default [gen/calc/all]\n", ProgramName);
+    fprintf(stdout, "\tOr: %s default [gen/calc/all/compare]\n", ProgramName);
     fprintf(stdout, "\t To use the above specified default values\n");
+    fprintf(stdout, "\tOr: %s mathtest\n", ProgramName);
+    fprintf(stdout, "\t To measure accuracy and cycles/call of Haversine_Math against the CRT\n");
+    fprintf(stdout, "\tOr: %s roofline\n", ProgramName);
+    fprintf(stdout, "\t To measure single core L1/L2/L3/DRAM read bandwidth and scalar/SIMD FLOP rates, and cache them in %s\n",
+            Haversine_Roofline::DefaultCacheFileName);
+    fprintf(stdout, "\tOr: %s writebench [Seed] [PairCount]\n", ProgramName);
+    fprintf(stdout, "\t To compare the Ref0 fprintf JSON writer against the buffered shortest round-trip writer (gen) on 1 to -threads threads\n");
+    fprintf(stdout, "\tOr: %s genbench [Seed] [PairCount]\n", ProgramName);
+    fprintf(stdout, "\t To compare pairs/s of the Ref0 generator against the counter-based one (gen) on 1 to -threads threads\n");
+    fprintf(stdout, "\tOr: %s floattest [Seed] [PairCount]\n", ProgramName);
+    fprintf(stdout, "\t To check ParseF64 round-trips generated coordinates and compare its speed to strtod\n");
+    fprintf(stdout, "\tOr: %s parsebench [file.json]\n", ProgramName);
+    fprintf(stdout, "\t To compare parse speed and output of the Ref0 and SIMD JSON parsers\n");
+    fprintf(stdout, "\tOr: %s dombench [file.json]\n", ProgramName);
+    fprintf(stdout, "\t To compare parse+release time and peak memory of the Ref0 tree and the flat DOM\n");
+    fprintf(stdout, "\tOr: %s schemabench [file.json]\n", ProgramName);
+    fprintf(stdout, "\t To compare the pairs layout reader against plain reads and the generic parsers\n");
+    fprintf(stdout, "\tOr: %s parallelbench [file.json] [MaxThreads]\n", ProgramName);
+    fprintf(stdout, "\t To measure how the multi-threaded pairs reader scales from 1 to MaxThreads threads (default: all hardware threads)\n");
+    fprintf(stdout, "\tOr: %s querybench [MB]\n", ProgramName);
+    fprintf(stdout, "\t To compare Ref0 Query against the key index and compiled paths on a generated nested document (default %llu MB)\n",
+            DefaultQueryBenchMB);
+    fprintf(stdout, "\tOr: %s convert [file.json] [file.bin]\n", ProgramName);
+    fprintf(stdout, "\t To write the pairs of a JSON file in the v2 binary format, which calc detects and reads mapped\n");
+    fprintf(stdout, "\tOr: %s quantbench [file.json]\n", ProgramName);
+    fprintf(stdout, "\t To compare size, decode speed, kernel speed and distance error of the -encoding options\n");
+    fprintf(stdout, "\tOr: %s validate [file.json/file.bin] [answers.f64]\n", ProgramName);
+    fprintf(stdout, "\t To compare every distance of -kernel against the answers of gen -answers (default file.json's), with the worst error and speed\n");
+    fprintf(stdout, "\tOr: %s reptest [file.json] [Seconds]\n", ProgramName);
+    fprintf(stdout, "\t To repeat each read/load/parse/compute/write stage until Seconds (default %u) pass without a new fastest run\n",
+            Haversine_RepTest::DefaultSecondsToTry);
+    fprintf(stdout, "\tOr: %s loadbench [file.json] [cold]\n", ProgramName);
+    fprintf(stdout, "\t To compare GB/s and page faults of the -load modes, cold evicts the file from the page cache first\n");
+    fprintf(stdout, "\tOptions:\n");
+    fprintf(stdout, "\t -threads N: Calculate (and parse with -parser parallel) on N threads (calc), or also compare against N threads (compare),\n"
+            "\t             or generate and format the JSON on N threads (gen, writebench, genbench, default all hardware threads)\n"
+            "\t             gen -threads uses the counter-based generator, its pairs differ from plain gen's and all's for the same seed\n");
+    fprintf(stdout, "\t -stream: Parse and sum pairs block by block without building a JSON tree (calc),\n"
+            "\t          or generate (counter-based, like gen -threads), write and sum them block by block in constant memory,\n"
+            "\t          for any 64-bit count (gen)\n");
+    fprintf(stdout, "\t -parser [ref0/simd/dom/schema/parallel]: JSON parser used to read the input (calc, convert, validate, reptest)\n");
+    fprintf(stdout, "\t -answers: Also write every pair's reference distance and their sum to file_answers.f64 (gen)\n");
+    fprintf(stdout, "\t -kernel [ref0/ref1]: Distance implementation to check (validate, default ref1)\n");
+    fprintf(stdout, "\t -load [read/map/mapseq/populate/huge]: How the simd/dom/schema/parallel parsers and v2 binary files (default map) load the input (calc, reptest)\n");
+    fprintf(stdout, "\t -encoding [f64/fixed32/cluster16]: Column encoding of the binary file (convert, default f64)\n");
+    fprintf(stdout, "\t -trace file.json: Also write a Chrome trace / Perfetto timeline of every profiler scope (profiler builds only)\n");
+    fprintf(stdout, "\t -counters [none/default/branch/cache]: Hardware counters on every profiler scope, reported as IPC and per byte\n"
+            "\t                                        (default: branch/LLC misses, page faults, Linux profiler builds only)\n");
+    fprintf(stdout, "\t -allocs: Also report bytes allocated, allocation count and peak live bytes of every profiler scope (profiler builds only)\n");
+    fprintf(stdout, "\t -roofline: Also print every profiler scope's gb/s as a percent of this machine's read bandwidth ceiling,\n"
+            "\t            measured once and cached in %s (profiler builds only)\n", Haversine_Roofline::DefaultCacheFileName);
+    fprintf(stdout, "\t -queue N: Read N chunks ahead on a background thread for -stream and -parser simd (calc)\n");
+    fprintf(stdout, "\t -chunk KB: Chunk size for -queue, or the block size of -stream without it (calc, default %d)\n",
+            Haversine_Pipeline::DefaultChunkSize / 1024);
 }
 
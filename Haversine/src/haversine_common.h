@@ -37,6 +37,15 @@ struct CoordPairList
 
 using HPair = CoordPair;
 using HList = CoordPairList;
+// Any of the JSON readers (Haversine_Ref0::ReadFileAsJSON, Haversine_JsonSimd::ReadFileAsJSON, ...)
+using ReadFileFuncT = HList(*)(const char* FileName);
+
+constexpr f64 CoordXMin = -180.0;
+constexpr f64 CoordXMax = +180.0;
+constexpr double CoordYMin = -90.0;
+constexpr double CoordYMax = +90.0;
+constexpr f64 DegreesPerRadian = 0.01745329251994329577;
+constexpr f64 EarthRadius = 6372.8;
 
 struct PerfTiming
 {
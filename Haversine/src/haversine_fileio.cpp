@@ -0,0 +1,391 @@
+#include "haversine_fileio.h"
+#include "haversine_perf.h"
+#include "haversine_schema.h"
+
+// C stdlib headers:
+#include <limits.h>
+#include <string.h>
+
+#if _WIN32
+#include <windows.h>
+#else // NOT _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // _WIN32
+
+namespace Haversine_FileIO
+{
+    using namespace Haversine_Ref0;
+
+    LoadMode DefaultLoadMode = LoadMode::Read;
+
+    static constexpr size_t HugePageSize = 2 * 1024 * 1024;
+
+    static const char* LoadModeNames[(u32)LoadMode::Count] =
+    {
+        "read",
+        "map",
+        "mapseq",
+        "populate",
+        "huge",
+    };
+
+    size_t RoundUp(size_t Value, size_t Alignment)
+    {
+        return (Value + Alignment - 1) / Alignment * Alignment;
+    }
+
+#if _WIN32
+    bool MapFile(MappedFile* File, const char* FileName, LoadMode Mode)
+    {
+        DWORD Flags = Mode == LoadMode::MapSequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_ATTRIBUTE_NORMAL;
+        HANDLE FileHandle = CreateFileA(FileName, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, Flags, nullptr);
+        if (FileHandle == INVALID_HANDLE_VALUE) { return false; }
+
+        SYSTEM_INFO SystemInfo = {};
+        GetSystemInfo(&SystemInfo);
+
+        bool bMapped = false;
+        LARGE_INTEGER FileSize = {};
+        // NOTE: A view can't be extended with a zeroed page, files ending on a page boundary
+        //       have no room for the appended null and are left to FileContentsT::Read
+        if (GetFileSizeEx(FileHandle, &FileSize) && FileSize.QuadPart > 0 && FileSize.QuadPart < INT_MAX &&
+                (FileSize.QuadPart % SystemInfo.dwPageSize) != 0)
+        {
+            TIME_BLOCK_DATA(MapFile, FileSize.QuadPart);
+            HANDLE Mapping = CreateFileMappingA(FileHandle, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+            void* View = Mapping ? MapViewOfFile(Mapping, FILE_MAP_COPY, 0, 0, 0) : nullptr;
+            if (Mapping) { CloseHandle(Mapping); } // The view keeps the mapping alive
+            if (View)
+            {
+                if (Mode == LoadMode::MapPopulate)
+                {
+                    WIN32_MEMORY_RANGE_ENTRY Range = { View, (SIZE_T)FileSize.QuadPart };
+                    PrefetchVirtualMemory(GetCurrentProcess(), 1, &Range, 0);
+                }
+                File->Base = View;
+                File->ReservedSize = (size_t)FileSize.QuadPart;
+                File->Contents = { (int)FileSize.QuadPart + 1, (u8*)View };
+                bMapped = true;
+            }
+        }
+        CloseHandle(FileHandle);
+        return bMapped;
+    }
+
+    bool ReadIntoHugePages(MappedFile* File, const char* FileName)
+    {
+        HANDLE FileHandle = CreateFileA(FileName, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (FileHandle == INVALID_HANDLE_VALUE) { return false; }
+
+        bool bRead = false;
+        LARGE_INTEGER FileSize = {};
+        if (GetFileSizeEx(FileHandle, &FileSize) && FileSize.QuadPart > 0 && FileSize.QuadPart < INT_MAX)
+        {
+            TIME_BLOCK_DATA(ReadIntoHugePages, FileSize.QuadPart);
+            // Large pages need SeLockMemoryPrivilege, without it this is a regular allocation
+            size_t LargePageSize = GetLargePageMinimum();
+            size_t ReservedSize = RoundUp((size_t)FileSize.QuadPart + 1, LargePageSize ? LargePageSize : HugePageSize);
+            void* Base = LargePageSize ?
+                VirtualAlloc(nullptr, ReservedSize, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE) : nullptr;
+            if (!Base) { Base = VirtualAlloc(nullptr, ReservedSize, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE); }
+            if (Base)
+            {
+                u8* Data = (u8*)Base;
+                size_t BytesLeft = (size_t)FileSize.QuadPart;
+                DWORD BytesRead = 0;
+                while (BytesLeft > 0 && ReadFile(FileHandle, Data, (DWORD)(BytesLeft < INT_MAX ? BytesLeft : INT_MAX),
+                            &BytesRead, nullptr) && BytesRead > 0)
+                {
+                    Data += BytesRead;
+                    BytesLeft -= BytesRead;
+                }
+                if (BytesLeft == 0)
+                {
+                    File->Base = Base;
+                    File->ReservedSize = ReservedSize;
+                    File->Contents = { (int)FileSize.QuadPart + 1, (u8*)Base };
+                    File->Contents.Data[FileSize.QuadPart] = '\0';
+                    bRead = true;
+                }
+                else { VirtualFree(Base, 0, MEM_RELEASE); }
+            }
+        }
+        CloseHandle(FileHandle);
+        return bRead;
+    }
+
+    void ReleaseMapping(MappedFile* File)
+    {
+        if (File->Mode == LoadMode::HugePages) { VirtualFree(File->Base, 0, MEM_RELEASE); }
+        else { UnmapViewOfFile(File->Base); }
+    }
+
+    bool EvictFromPageCache(const char* FileName)
+    {
+        (void)FileName;
+        return false;
+    }
+#else // NOT _WIN32
+    bool MapFile(MappedFile* File, const char* FileName, LoadMode Mode)
+    {
+        int FileDesc = open(FileName, O_RDONLY);
+        if (FileDesc < 0) { return false; }
+
+        bool bMapped = false;
+        struct stat FileStat = {};
+        if (fstat(FileDesc, &FileStat) == 0 && FileStat.st_size > 0 && FileStat.st_size < INT_MAX)
+        {
+            size_t FileSize = (size_t)FileStat.st_size;
+            TIME_BLOCK_DATA(MapFile, FileSize);
+            // Reserve the file size plus a zeroed anonymous byte (the appended null), then map the file over it
+            size_t ReservedSize = RoundUp(FileSize + 1, (size_t)sysconf(_SC_PAGESIZE));
+            void* Base = mmap(nullptr, ReservedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (Base != MAP_FAILED)
+            {
+                // NOTE: Populating a writable private mapping faults every page in for write, copying
+                //       the whole file, so it is mapped read-only first and made writable after
+                int Flags = MAP_PRIVATE | MAP_FIXED | (Mode == LoadMode::MapPopulate ? MAP_POPULATE : 0);
+                if (mmap(Base, FileSize, PROT_READ, Flags, FileDesc, 0) != MAP_FAILED &&
+                        mprotect(Base, FileSize, PROT_READ | PROT_WRITE) == 0)
+                {
+                    if (Mode == LoadMode::MapSequential) { madvise(Base, FileSize, MADV_SEQUENTIAL); }
+                    File->Base = Base;
+                    File->ReservedSize = ReservedSize;
+                    File->Contents = { (int)FileSize + 1, (u8*)Base };
+                    bMapped = true;
+                }
+                else { munmap(Base, ReservedSize); }
+            }
+        }
+        close(FileDesc);
+        return bMapped;
+    }
+
+    bool ReadIntoHugePages(MappedFile* File, const char* FileName)
+    {
+        int FileDesc = open(FileName, O_RDONLY);
+        if (FileDesc < 0) { return false; }
+
+        bool bRead = false;
+        struct stat FileStat = {};
+        if (fstat(FileDesc, &FileStat) == 0 && FileStat.st_size > 0 && FileStat.st_size < INT_MAX)
+        {
+            size_t FileSize = (size_t)FileStat.st_size;
+            TIME_BLOCK_DATA(ReadIntoHugePages, FileSize);
+            size_t ReservedSize = RoundUp(FileSize + 1, HugePageSize);
+            u8* Data = nullptr;
+            void* Base = mmap(nullptr, ReservedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (Base != MAP_FAILED) { Data = (u8*)Base; }
+            else
+            {
+                // No hugetlbfs pages reserved, ask for transparent huge pages on a 2MB aligned range instead
+                ReservedSize += HugePageSize;
+                Base = mmap(nullptr, ReservedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if (Base != MAP_FAILED)
+                {
+                    Data = (u8*)RoundUp((size_t)Base, HugePageSize);
+                    madvise(Data, RoundUp(FileSize + 1, HugePageSize), MADV_HUGEPAGE);
+                }
+            }
+
+            if (Data)
+            {
+                size_t BytesRead = 0;
+                while (BytesRead < FileSize)
+                {
+                    ssize_t ReadResult = pread(FileDesc, Data + BytesRead, FileSize - BytesRead, (off_t)BytesRead);
+                    if (ReadResult <= 0) { break; }
+                    BytesRead += (size_t)ReadResult;
+                }
+                if (BytesRead == FileSize)
+                {
+                    File->Base = Base;
+                    File->ReservedSize = ReservedSize;
+                    File->Contents = { (int)FileSize + 1, Data };
+                    Data[FileSize] = '\0';
+                    bRead = true;
+                }
+                else { munmap(Base, ReservedSize); }
+            }
+        }
+        close(FileDesc);
+        return bRead;
+    }
+
+    void ReleaseMapping(MappedFile* File)
+    {
+        munmap(File->Base, File->ReservedSize);
+    }
+
+    bool EvictFromPageCache(const char* FileName)
+    {
+        int FileDesc = open(FileName, O_RDONLY);
+        if (FileDesc < 0) { return false; }
+        bool bEvicted = posix_fadvise(FileDesc, 0, 0, POSIX_FADV_DONTNEED) == 0;
+        close(FileDesc);
+        return bEvicted;
+    }
+#endif // _WIN32
+
+    u64 SumWords(const u8* Data, int Size)
+    {
+        u64 Sum = 0;
+        int WordCount = Size / (int)sizeof(u64);
+        for (int WordIdx = 0; WordIdx < WordCount; WordIdx++)
+        {
+            u64 Word;
+            memcpy(&Word, Data + WordIdx * sizeof(u64), sizeof(u64));
+            Sum += Word;
+        }
+        for (int ByteIdx = WordCount * (int)sizeof(u64); ByteIdx < Size; ByteIdx++) { Sum += Data[ByteIdx]; }
+        return Sum;
+    }
+
+    struct LoadRun
+    {
+        u64 LoadCycles;
+        u64 TouchCycles;
+        Perf::PageFaultCounts LoadFaults;
+        Perf::PageFaultCounts TouchFaults;
+    };
+}
+
+const char* Haversine_FileIO::GetLoadModeName(LoadMode Mode)
+{
+    return Mode < LoadMode::Count ? LoadModeNames[(u32)Mode] : "unknown";
+}
+
+bool Haversine_FileIO::ParseLoadMode(const char* Name, LoadMode* OutMode)
+{
+    for (u32 ModeIdx = 0; ModeIdx < (u32)LoadMode::Count; ModeIdx++)
+    {
+        if (strcmp(Name, LoadModeNames[ModeIdx]) == 0)
+        {
+            *OutMode = (LoadMode)ModeIdx;
+            return true;
+        }
+    }
+    return false;
+}
+
+void Haversine_FileIO::MappedFile::Release()
+{
+    if (Mode == LoadMode::Read) { Contents.Release(); }
+    else if (Base) { ReleaseMapping(this); }
+    *this = {};
+}
+
+Haversine_FileIO::MappedFile Haversine_FileIO::Load(const char* FileName, LoadMode Mode)
+{
+    TIME_FUNC();
+
+    MappedFile Result = {};
+    Result.Mode = Mode;
+    bool bLoaded = false;
+    switch (Mode)
+    {
+        case LoadMode::Map:
+        case LoadMode::MapSequential:
+        case LoadMode::MapPopulate:
+        {
+            bLoaded = MapFile(&Result, FileName, Mode);
+        } break;
+        case LoadMode::HugePages:
+        {
+            bLoaded = ReadIntoHugePages(&Result, FileName);
+        } break;
+        default: break;
+    }
+
+    // Anything that couldn't be mapped (or empty files) goes through the regular path
+    if (!bLoaded)
+    {
+        Result = {};
+        Result.Mode = LoadMode::Read;
+        Result.Contents.Read(FileName, true);
+    }
+    return Result;
+}
+
+void Haversine_FileIO::Benchmark(const char* FileName, bool bCold)
+{
+    TIME_FUNC();
+
+    static constexpr int RepeatCount = 5;
+    u64 CPUFreq = Perf::EstimateCPUFreq();
+    if (bCold && !EvictFromPageCache(FileName))
+    {
+        fprintf(stdout, "ERROR: Can't evict %s from the page cache, runs will be warm\n", FileName);
+        bCold = false;
+    }
+
+    int FileSize = 0;
+    for (u32 ModeIdx = 0; ModeIdx < (u32)LoadMode::Count; ModeIdx++)
+    {
+        LoadMode Mode = (LoadMode)ModeIdx;
+        LoadMode ActualMode = Mode;
+        LoadRun Best = {};
+        Best.LoadCycles = UINT64_MAX;
+        u64 Checksum = 0;
+        for (int RepeatIdx = 0; RepeatIdx < RepeatCount; RepeatIdx++)
+        {
+            if (bCold) { EvictFromPageCache(FileName); }
+
+            LoadRun Run = {};
+            Perf::PageFaultCounts FaultsBegin = Perf::ReadPageFaults();
+            u64 Begin = Perf::ReadCPUTimer();
+            MappedFile File = Load(FileName, Mode);
+            Run.LoadCycles = Perf::ReadCPUTimer() - Begin;
+            Perf::PageFaultCounts FaultsLoaded = Perf::ReadPageFaults();
+
+            Begin = Perf::ReadCPUTimer();
+            Checksum = SumWords(File.Contents.Data, File.Contents.Size);
+            Run.TouchCycles = Perf::ReadCPUTimer() - Begin;
+            Perf::PageFaultCounts FaultsTouched = Perf::ReadPageFaults();
+
+            Run.LoadFaults = { FaultsLoaded.Minor - FaultsBegin.Minor, FaultsLoaded.Major - FaultsBegin.Major };
+            Run.TouchFaults = { FaultsTouched.Minor - FaultsLoaded.Minor, FaultsTouched.Major - FaultsLoaded.Major };
+            if (Run.LoadCycles + Run.TouchCycles < Best.LoadCycles + Best.TouchCycles) { Best = Run; }
+
+            FileSize = File.Contents.Size - 1;
+            ActualMode = File.Mode;
+            File.Release();
+        }
+        if (FileSize <= 0) { return; }
+
+        u64 ParseBest = UINT64_MAX;
+        for (int RepeatIdx = 0; RepeatIdx < RepeatCount; RepeatIdx++)
+        {
+            if (bCold) { EvictFromPageCache(FileName); }
+
+            u64 Begin = Perf::ReadCPUTimer();
+            MappedFile File = Load(FileName, Mode);
+            HList Pairs = Haversine_Schema::ParseJSON(File.Contents);
+            u64 Elapsed = Perf::ReadCPUTimer() - Begin;
+            if (Elapsed < ParseBest) { ParseBest = Elapsed; }
+
+            TRACK_FREE(sizeof(HPair) * Pairs.Count);
+            delete[] Pairs.Data;
+            File.Release();
+        }
+
+        f64 Gigabyte = 1024.0 * 1024.0 * 1024.0;
+        f64 LoadSeconds = (f64)(Best.LoadCycles + Best.TouchCycles) / (f64)CPUFreq;
+        f64 ParseSeconds = (f64)ParseBest / (f64)CPUFreq;
+        if (ModeIdx == 0)
+        {
+            fprintf(stdout, "%s (%d bytes, %s page cache, best of %d):\n", FileName, FileSize, bCold ? "cold" : "warm", RepeatCount);
+        }
+        fprintf(stdout, "\t%-8s load %8.3f ms + first pass %8.3f ms = %6.2f GB/s, faults %llu/%llu + %llu/%llu (minor/major), "
+                "load+parse %6.2f GB/s%s (checksum %llu)\n",
+                GetLoadModeName(Mode), 1000.0 * (f64)Best.LoadCycles / (f64)CPUFreq,
+                1000.0 * (f64)Best.TouchCycles / (f64)CPUFreq, (f64)FileSize / LoadSeconds / Gigabyte,
+                Best.LoadFaults.Minor, Best.LoadFaults.Major, Best.TouchFaults.Minor, Best.TouchFaults.Major,
+                (f64)FileSize / ParseSeconds / Gigabyte, ActualMode != Mode ? " [fell back to read]" : "", Checksum);
+    }
+}
+
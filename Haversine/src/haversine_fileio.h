@@ -0,0 +1,58 @@
+#ifndef HAVERSINE_FILEIO_H
+#define HAVERSINE_FILEIO_H
+
+/*
+ * NOTE:
+ *      Alternative ways of getting an input file into memory, all of them give
+ *      the same FileContentsT view FileContentsT::Read(FileName, true) does
+ *      (Data/Size with a null appended, writable) so the parsers don't change:
+ *          - Read: FileContentsT::Read, fread into a new[] buffer
+ *          - Map: private (copy on write) file mapping, pages fault in on first touch
+ *          - MapSequential: Map + MADV_SEQUENTIAL (FILE_FLAG_SEQUENTIAL_SCAN on Windows)
+ *          - MapPopulate: Map + MAP_POPULATE (PrefetchVirtualMemory on Windows)
+ *          - HugePages: read into an anonymous buffer backed by huge pages, file
+ *            mappings can't use them without hugetlbfs, so this still copies but
+ *            takes ~1/512th of the page faults and TLB entries
+ *      Writing to a mapped file (the in-place parsers do) only touches private copies
+ */
+
+#include "haversine_common.h"
+#include "haversine_ref0.h"
+
+namespace Haversine_FileIO
+{
+    enum struct LoadMode : u32
+    {
+        Read,
+        Map,
+        MapSequential,
+        MapPopulate,
+        HugePages,
+        Count
+    };
+
+    const char* GetLoadModeName(LoadMode Mode);
+    bool ParseLoadMode(const char* Name, LoadMode* OutMode);
+
+    struct MappedFile
+    {
+        Haversine_Ref0::FileContentsT Contents;
+        LoadMode Mode; // Can differ from the requested mode if that one wasn't available
+        void* Base;
+        size_t ReservedSize;
+
+        void Release();
+    };
+
+    MappedFile Load(const char* FileName, LoadMode Mode);
+
+    // Used by the Haversine_JsonSimd/JsonDom/Schema readers, set by -load
+    extern LoadMode DefaultLoadMode;
+
+    // Load + first pass over the bytes, then load + schema parse, for every mode
+    // bCold evicts the file from the page cache before each run (Linux only)
+    void Benchmark(const char* FileName, bool bCold);
+}
+
+#endif // HAVERSINE_FILEIO_H
+
@@ -0,0 +1,921 @@
+#include "haversine_float.h"
+#include "haversine_ref0.h"
+#include "haversine_perf.h"
+
+// C stdlib headers:
+#include <string.h>
+// Intrinsics:
+#if _MSC_VER
+#include <intrin.h>
+#endif // _MSC_VER
+
+namespace Haversine_Float
+{
+    static constexpr int MaxMantissaDigits = 19;
+    static constexpr int FastPathMaxPower10 = 22;
+    static constexpr u64 FastPathMaxMantissa = 1ull << 53;
+    // NOTE: In this range the truncated 128-bit powers of 5 never need the extra precision check
+    static constexpr int EiselLemireMinPower10 = -27;
+    static constexpr int EiselLemireMaxPower10 = 55;
+    static constexpr int MantissaBits = 52;
+    static constexpr int MinExponent = -1023;
+    static constexpr int InfinitePower = 0x7FF;
+    static constexpr int MaxNumberLength = 64;
+
+    static constexpr f64 ExactPowersOf10[FastPathMaxPower10 + 1] =
+    {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+    };
+
+    struct U128
+    {
+        u64 Hi;
+        u64 Lo;
+    };
+
+    U128 Mul64(u64 A, u64 B)
+    {
+#if _MSC_VER
+        U128 Result = {};
+        Result.Lo = _umul128(A, B, &Result.Hi);
+        return Result;
+#else
+        unsigned __int128 Product = (unsigned __int128)A * B;
+        return { (u64)(Product >> 64), (u64)Product };
+#endif // _MSC_VER
+    }
+
+    U128 ShiftLeft(U128 X, int Shift)
+    {
+        if (Shift == 0) { return X; }
+        if (Shift >= 64) { return { X.Lo << (Shift - 64), 0 }; }
+        return { (X.Hi << Shift) | (X.Lo >> (64 - Shift)), X.Lo << Shift };
+    }
+
+    int CountLeadingZeros(u64 X)
+    {
+#if _MSC_VER
+        unsigned long BitIdx = 0;
+        _BitScanReverse64(&BitIdx, X);
+        return 63 - (int)BitIdx;
+#else
+        return __builtin_clzll(X);
+#endif // _MSC_VER
+    }
+
+    struct PowersOf5Table
+    {
+        U128 Entries[EiselLemireMaxPower10 - EiselLemireMinPower10 + 1];
+    };
+
+    // The 128 most significant bits of 5^Q, normalized so the top bit is set
+    // Negative powers are 2^B / 5^-Q rounded up (same as the fast_float tables)
+    PowersOf5Table BuildPowersOf5()
+    {
+        PowersOf5Table Table = {};
+        for (int Q = EiselLemireMinPower10; Q < 0; Q++)
+        {
+            u64 Divisor = 1;
+            for (int Idx = 0; Idx < -Q; Idx++) { Divisor *= 5; }
+            int DivisorBits = 0;
+            while ((1ull << DivisorBits) < Divisor) { DivisorBits++; }
+
+            // Binary long division of 2^(DivisorBits + 127), the quotient has exactly 128 bits
+            U128 Quotient = {};
+            u64 Remainder = 1;
+            for (int BitIdx = 0; BitIdx < DivisorBits + 127; BitIdx++)
+            {
+                Remainder *= 2;
+                u64 QuotientBit = Remainder >= Divisor ? 1 : 0;
+                if (QuotientBit) { Remainder -= Divisor; }
+                Quotient = ShiftLeft(Quotient, 1);
+                Quotient.Lo |= QuotientBit;
+            }
+            Quotient.Lo++;
+            if (Quotient.Lo == 0 && ++Quotient.Hi == 0) { Quotient = { 1ull << 63, 0 }; }
+            Table.Entries[Q - EiselLemireMinPower10] = Quotient;
+        }
+        U128 Power = { 0, 1 };
+        for (int Q = 0; Q <= EiselLemireMaxPower10; Q++)
+        {
+            int LeadingZeros = Power.Hi ? CountLeadingZeros(Power.Hi) : 64 + CountLeadingZeros(Power.Lo);
+            Table.Entries[Q - EiselLemireMinPower10] = ShiftLeft(Power, LeadingZeros);
+
+            U128 LoTimes5 = Mul64(Power.Lo, 5);
+            Power = { Power.Hi * 5 + LoTimes5.Hi, LoTimes5.Lo };
+        }
+        return Table;
+    }
+
+    static const PowersOf5Table PowersOf5 = BuildPowersOf5();
+
+    // W * 10^Q as the bits of a normal double, false if undecided or out of range (use strtod)
+    bool EiselLemire(u64 W, int Q, u64* OutBits)
+    {
+        int LeadingZeros = CountLeadingZeros(W);
+        W <<= LeadingZeros;
+
+        U128 Power = PowersOf5.Entries[Q - EiselLemireMinPower10];
+        U128 Product = Mul64(W, Power.Hi);
+        constexpr u64 PrecisionMask = UINT64_MAX >> (MantissaBits + 3);
+        if ((Product.Hi & PrecisionMask) == PrecisionMask)
+        {
+            // Bits below the mantissa are all ones, the low half of 5^Q can still carry into them
+            U128 LowProduct = Mul64(W, Power.Lo);
+            Product.Lo += LowProduct.Hi;
+            if (LowProduct.Hi > Product.Lo) { Product.Hi++; }
+        }
+
+        int UpperBit = (int)(Product.Hi >> 63);
+        int Shift = UpperBit + 64 - MantissaBits - 3;
+        u64 Mantissa = Product.Hi >> Shift;
+        // ((152170 + 65536) * Q) >> 16 == floor(Q * log2(10))
+        int Power2 = (((152170 + 65536) * Q) >> 16) + 63 + UpperBit - LeadingZeros - MinExponent;
+        if (Power2 <= 0) { return false; }
+
+        if (Product.Lo <= 1 && Q >= -4 && Q <= 23 && (Mantissa & 3) == 1)
+        {
+            // Exactly halfway between two doubles: round to even rather than up
+            if ((Mantissa << Shift) == Product.Hi) { Mantissa &= ~1ull; }
+        }
+        Mantissa += Mantissa & 1;
+        Mantissa >>= 1;
+        if (Mantissa >= (2ull << MantissaBits))
+        {
+            Mantissa = 1ull << MantissaBits;
+            Power2++;
+        }
+        Mantissa &= ~(1ull << MantissaBits);
+        if (Power2 >= InfinitePower) { return false; }
+
+        *OutBits = Mantissa | ((u64)Power2 << MantissaBits);
+        return true;
+    }
+
+    f64 ParseFallback(const char* Begin, const char* End)
+    {
+        // strtod needs a terminated string, the input buffer may not have one right after the number
+        char Buffer[MaxNumberLength + 1];
+        int Length = (int)(End - Begin);
+        char* Number = Length <= MaxNumberLength ? Buffer : new char[Length + 1];
+        memcpy(Number, Begin, Length);
+        Number[Length] = '\0';
+        f64 Result = strtod(Number, nullptr);
+        if (Number != Buffer) { delete[] Number; }
+        return Result;
+    }
+
+    bool CharIsDigit(char C)
+    {
+        return '0' <= C && C <= '9';
+    }
+}
+
+const char* Haversine_Float::ParseF64(const char* Begin, const char* End, f64* OutValue, bool* bOutInteger)
+{
+    const char* At = Begin;
+    bool bNegative = At < End && *At == '-';
+    if (bNegative) { At++; }
+
+    u64 Mantissa = 0;
+    const char* DigitsBegin = At;
+    while (At < End && CharIsDigit(*At))
+    {
+        Mantissa = Mantissa * 10 + (*At - '0');
+        At++;
+    }
+    int DigitCount = (int)(At - DigitsBegin);
+    if (DigitCount == 0) { return nullptr; }
+
+    s64 Power10 = 0;
+    bool bInteger = true;
+    if (At < End && *At == '.')
+    {
+        At++;
+        const char* FractionBegin = At;
+        while (At < End && CharIsDigit(*At))
+        {
+            Mantissa = Mantissa * 10 + (*At - '0');
+            At++;
+        }
+        int FractionCount = (int)(At - FractionBegin);
+        if (FractionCount == 0) { return nullptr; }
+        DigitCount += FractionCount;
+        Power10 = -FractionCount;
+        bInteger = false;
+    }
+    if (At < End && (*At == 'e' || *At == 'E'))
+    {
+        At++;
+        bool bNegativeExponent = false;
+        if (At < End && (*At == '-' || *At == '+'))
+        {
+            bNegativeExponent = *At == '-';
+            At++;
+        }
+        const char* ExponentBegin = At;
+        s64 Exponent = 0;
+        while (At < End && CharIsDigit(*At))
+        {
+            // Anything this large is 0 or inf anyway, strtod sorts those out
+            if (Exponent < 100000) { Exponent = Exponent * 10 + (*At - '0'); }
+            At++;
+        }
+        if (At == ExponentBegin) { return nullptr; }
+        Power10 += bNegativeExponent ? -Exponent : Exponent;
+        bInteger = false;
+    }
+    if (bOutInteger) { *bOutInteger = bInteger; }
+
+    // Leading zeros (0.000123) don't count towards the 19 digits that fit in Mantissa
+    if (DigitCount > MaxMantissaDigits)
+    {
+        for (const char* Digit = DigitsBegin; Digit < At && (*Digit == '0' || *Digit == '.'); Digit++)
+        {
+            if (*Digit == '0') { DigitCount--; }
+        }
+    }
+
+    f64 Value = 0.0;
+    bool bDone = false;
+    if (DigitCount <= MaxMantissaDigits)
+    {
+        if (Mantissa == 0)
+        {
+            bDone = true;
+        }
+        else if (Mantissa <= FastPathMaxMantissa && -FastPathMaxPower10 <= Power10 && Power10 <= FastPathMaxPower10)
+        {
+            // Both operands are exact doubles, so the single rounding of * or / is correct
+            Value = (f64)Mantissa;
+            if (Power10 < 0) { Value /= ExactPowersOf10[-Power10]; }
+            else { Value *= ExactPowersOf10[Power10]; }
+            bDone = true;
+        }
+        else if (EiselLemireMinPower10 <= Power10 && Power10 <= EiselLemireMaxPower10)
+        {
+            u64 Bits = 0;
+            if (EiselLemire(Mantissa, (int)Power10, &Bits))
+            {
+                memcpy(&Value, &Bits, sizeof(f64));
+                bDone = true;
+            }
+        }
+    }
+
+    if (bDone) { *OutValue = bNegative ? -Value : Value; }
+    else { *OutValue = ParseFallback(Begin, At); }
+    return At;
+}
+
+namespace Haversine_Float
+{
+    static constexpr int Pow5Bits = 125;
+    // Indexed by q <= floor(log10(2^969)) for exponents >= 0, by -e2 - q <= 325 for the rest
+    static constexpr int Pow5InvTableSize = 292;
+    static constexpr int Pow5TableSize = 326;
+    static constexpr int ExponentBias = 1023;
+    // 5^325 has 755 bits, plus room for the remainder doubling during the divisions
+    static constexpr int BigIntLimbCount = 26;
+    // Plain digits for 1e-24 <= |Value| < 1e21
+    static constexpr int MaxIntegerDigits = 21;
+    static constexpr int MaxFractionZeros = 23;
+
+    struct BigInt
+    {
+        u32 Limbs[BigIntLimbCount]; // Least significant first
+    };
+
+    void BigMul5(BigInt* X)
+    {
+        u64 Carry = 0;
+        for (int LimbIdx = 0; LimbIdx < BigIntLimbCount; LimbIdx++)
+        {
+            u64 Product = (u64)X->Limbs[LimbIdx] * 5 + Carry;
+            X->Limbs[LimbIdx] = (u32)Product;
+            Carry = Product >> 32;
+        }
+    }
+
+    void BigShiftLeft1(BigInt* X)
+    {
+        for (int LimbIdx = BigIntLimbCount - 1; LimbIdx > 0; LimbIdx--)
+        {
+            X->Limbs[LimbIdx] = (X->Limbs[LimbIdx] << 1) | (X->Limbs[LimbIdx - 1] >> 31);
+        }
+        X->Limbs[0] <<= 1;
+    }
+
+    // A -= B if A >= B, returns whether it did
+    bool BigSubIfGreaterEqual(BigInt* A, const BigInt& B)
+    {
+        for (int LimbIdx = BigIntLimbCount - 1; LimbIdx >= 0; LimbIdx--)
+        {
+            if (A->Limbs[LimbIdx] != B.Limbs[LimbIdx])
+            {
+                if (A->Limbs[LimbIdx] < B.Limbs[LimbIdx]) { return false; }
+                break;
+            }
+        }
+        u64 Borrow = 0;
+        for (int LimbIdx = 0; LimbIdx < BigIntLimbCount; LimbIdx++)
+        {
+            u64 Difference = (u64)A->Limbs[LimbIdx] - B.Limbs[LimbIdx] - Borrow;
+            A->Limbs[LimbIdx] = (u32)Difference;
+            Borrow = (Difference >> 32) & 1;
+        }
+        return true;
+    }
+
+    int BigBitLength(const BigInt& X)
+    {
+        for (int LimbIdx = BigIntLimbCount - 1; LimbIdx >= 0; LimbIdx--)
+        {
+            if (X.Limbs[LimbIdx]) { return LimbIdx * 32 + 64 - CountLeadingZeros(X.Limbs[LimbIdx]); }
+        }
+        return 0;
+    }
+
+    // 128 bits of X starting at bit Shift
+    U128 BigGetBits(const BigInt& X, int Shift)
+    {
+        U128 Result = {};
+        for (int BitIdx = 127; BitIdx >= 0; BitIdx--)
+        {
+            int SrcBit = Shift + BitIdx;
+            u64 Bit = SrcBit < BigIntLimbCount * 32 ? (X.Limbs[SrcBit / 32] >> (SrcBit % 32)) & 1 : 0;
+            Result = ShiftLeft(Result, 1);
+            Result.Lo |= Bit;
+        }
+        return Result;
+    }
+
+    struct RyuTables
+    {
+        U128 Pow5[Pow5TableSize]; // Top 125 bits of 5^i
+        U128 Pow5Inv[Pow5InvTableSize]; // floor(2^(bits(5^q) - 1 + 125) / 5^q) + 1
+    };
+
+    RyuTables* BuildRyuTables()
+    {
+        RyuTables* Tables = new RyuTables;
+        BigInt Power = {};
+        Power.Limbs[0] = 1;
+        for (int Idx = 0; Idx < Pow5TableSize; Idx++)
+        {
+            int BitLength = BigBitLength(Power);
+            if (BitLength >= Pow5Bits) { Tables->Pow5[Idx] = BigGetBits(Power, BitLength - Pow5Bits); }
+            else { Tables->Pow5[Idx] = ShiftLeft(BigGetBits(Power, 0), Pow5Bits - BitLength); }
+
+            if (Idx < Pow5InvTableSize)
+            {
+                // Binary long division, the quotient bits above 2^125 are all zero
+                BigInt Remainder = {};
+                int TopBit = BitLength - 1;
+                Remainder.Limbs[TopBit / 32] = 1u << (TopBit % 32);
+                U128 Quotient = {};
+                for (int BitIdx = Pow5Bits; BitIdx >= 0; BitIdx--)
+                {
+                    if (BitIdx < Pow5Bits) { BigShiftLeft1(&Remainder); }
+                    Quotient = ShiftLeft(Quotient, 1);
+                    Quotient.Lo |= BigSubIfGreaterEqual(&Remainder, Power) ? 1 : 0;
+                }
+                Quotient.Lo++;
+                if (Quotient.Lo == 0) { Quotient.Hi++; }
+                Tables->Pow5Inv[Idx] = Quotient;
+            }
+            BigMul5(&Power);
+        }
+        return Tables;
+    }
+
+    const RyuTables& GetRyuTables()
+    {
+        static const RyuTables* Tables = BuildRyuTables();
+        return *Tables;
+    }
+
+    // Bit length of 5^E, for 0 <= E <= 3528
+    int Pow5BitLength(int E) { return (int)(((u32)E * 1217359) >> 19) + 1; }
+    // floor(log10(2^E)), for 0 <= E <= 1650
+    int Log10Pow2(int E) { return (int)(((u32)E * 78913) >> 18); }
+    // floor(log10(5^E)), for 0 <= E <= 2620
+    int Log10Pow5(int E) { return (int)(((u32)E * 732923) >> 20); }
+
+    int Pow5Factor(u64 Value)
+    {
+        int Count = 0;
+        while (Value % 5 == 0)
+        {
+            Value /= 5;
+            Count++;
+        }
+        return Count;
+    }
+
+    bool IsMultipleOfPow5(u64 Value, int Power) { return Pow5Factor(Value) >= Power; }
+    bool IsMultipleOfPow2(u64 Value, int Power) { return (Value & ((1ull << Power) - 1)) == 0; }
+
+    // (M * Mul) >> J, M has at most 55 bits and J >= 115
+    u64 MulShift(u64 M, U128 Mul, int J)
+    {
+        U128 Low = Mul64(M, Mul.Lo);
+        U128 High = Mul64(M, Mul.Hi);
+        u64 SumLo = High.Lo + Low.Hi;
+        u64 SumHi = High.Hi + (SumLo < High.Lo ? 1 : 0);
+        int Shift = J - 64;
+        if (Shift >= 64) { return SumHi >> (Shift - 64); }
+        return (SumLo >> Shift) | (SumHi << (64 - Shift));
+    }
+
+    struct Decimal
+    {
+        u64 Digits;
+        int Exponent; // Value = Digits * 10^Exponent
+    };
+
+    // Ryu's d2d: the shortest Digits in the rounding interval of the double, closest to it
+    Decimal ShortestDecimal(u64 IeeeMantissa, int IeeeExponent)
+    {
+        const RyuTables& Tables = GetRyuTables();
+
+        int E2 = 0;
+        u64 M2 = 0;
+        if (IeeeExponent == 0)
+        {
+            E2 = 1 - ExponentBias - MantissaBits - 2;
+            M2 = IeeeMantissa;
+        }
+        else
+        {
+            E2 = IeeeExponent - ExponentBias - MantissaBits - 2;
+            M2 = (1ull << MantissaBits) | IeeeMantissa;
+        }
+        bool bAcceptBounds = (M2 & 1) == 0;
+
+        // Interval [Vm, Vp] around 4 * M2 * 2^E2, the lower bound is closer at powers of 2
+        u64 Mv = 4 * M2;
+        u64 MmShift = IeeeMantissa != 0 || IeeeExponent <= 1 ? 1 : 0;
+
+        u64 Vr = 0;
+        u64 Vp = 0;
+        u64 Vm = 0;
+        int E10 = 0;
+        bool bVmIsTrailingZeros = false;
+        bool bVrIsTrailingZeros = false;
+        if (E2 >= 0)
+        {
+            int Q = Log10Pow2(E2) - (E2 > 3 ? 1 : 0);
+            E10 = Q;
+            int K = Pow5Bits + Pow5BitLength(Q) - 1;
+            int J = -E2 + Q + K;
+            Vr = MulShift(4 * M2, Tables.Pow5Inv[Q], J);
+            Vp = MulShift(4 * M2 + 2, Tables.Pow5Inv[Q], J);
+            Vm = MulShift(4 * M2 - 1 - MmShift, Tables.Pow5Inv[Q], J);
+            if (Q <= 21)
+            {
+                // Only some of these can be exact, the rest always have nonzero digits removed
+                if (Mv % 5 == 0) { bVrIsTrailingZeros = IsMultipleOfPow5(Mv, Q); }
+                else if (bAcceptBounds) { bVmIsTrailingZeros = IsMultipleOfPow5(Mv - 1 - MmShift, Q); }
+                else { Vp -= IsMultipleOfPow5(Mv + 2, Q) ? 1 : 0; }
+            }
+        }
+        else
+        {
+            int Q = Log10Pow5(-E2) - (-E2 > 1 ? 1 : 0);
+            E10 = Q + E2;
+            int I = -E2 - Q;
+            int K = Pow5BitLength(I) - Pow5Bits;
+            int J = Q - K;
+            Vr = MulShift(4 * M2, Tables.Pow5[I], J);
+            Vp = MulShift(4 * M2 + 2, Tables.Pow5[I], J);
+            Vm = MulShift(4 * M2 - 1 - MmShift, Tables.Pow5[I], J);
+            if (Q <= 1)
+            {
+                bVrIsTrailingZeros = true;
+                if (bAcceptBounds) { bVmIsTrailingZeros = MmShift == 1; }
+                else { Vp--; }
+            }
+            else if (Q < 63)
+            {
+                bVrIsTrailingZeros = IsMultipleOfPow2(Mv, Q);
+            }
+        }
+
+        // Drop digits while the interval still holds a shorter number
+        int Removed = 0;
+        u64 Output = 0;
+        if (bVmIsTrailingZeros || bVrIsTrailingZeros)
+        {
+            // Rare, exact ties and a closed lower bound need the removed digits tracked
+            u64 LastRemovedDigit = 0;
+            while (Vp / 10 > Vm / 10)
+            {
+                bVmIsTrailingZeros &= Vm % 10 == 0;
+                bVrIsTrailingZeros &= LastRemovedDigit == 0;
+                LastRemovedDigit = Vr % 10;
+                Vr /= 10;
+                Vp /= 10;
+                Vm /= 10;
+                Removed++;
+            }
+            if (bVmIsTrailingZeros)
+            {
+                while (Vm % 10 == 0)
+                {
+                    bVrIsTrailingZeros &= LastRemovedDigit == 0;
+                    LastRemovedDigit = Vr % 10;
+                    Vr /= 10;
+                    Vp /= 10;
+                    Vm /= 10;
+                    Removed++;
+                }
+            }
+            // Exactly halfway rounds to even
+            if (bVrIsTrailingZeros && LastRemovedDigit == 5 && Vr % 2 == 0) { LastRemovedDigit = 4; }
+            bool bRoundUp = (Vr == Vm && (!bAcceptBounds || !bVmIsTrailingZeros)) || LastRemovedDigit >= 5;
+            Output = Vr + (bRoundUp ? 1 : 0);
+        }
+        else
+        {
+            bool bRoundUp = false;
+            // Two digits at a time first, most doubles have 15-17 digits out of ~20 computed
+            if (Vp / 100 > Vm / 100)
+            {
+                bRoundUp = Vr % 100 >= 50;
+                Vr /= 100;
+                Vp /= 100;
+                Vm /= 100;
+                Removed += 2;
+            }
+            while (Vp / 10 > Vm / 10)
+            {
+                bRoundUp = Vr % 10 >= 5;
+                Vr /= 10;
+                Vp /= 10;
+                Vm /= 10;
+                Removed++;
+            }
+            Output = Vr + (Vr == Vm || bRoundUp ? 1 : 0);
+        }
+        return { Output, E10 + Removed };
+    }
+
+    static constexpr char DigitPairs[201] =
+        "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+        "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+        "8081828384858687888990919293949596979899";
+
+    // Writes all of Value's digits, returns how many (at most 20)
+    int WriteDigits(u64 Value, char* Out)
+    {
+        char Buffer[20];
+        char* At = Buffer + sizeof(Buffer);
+        while (Value >= 100)
+        {
+            At -= 2;
+            memcpy(At, DigitPairs + (Value % 100) * 2, 2);
+            Value /= 100;
+        }
+        if (Value >= 10)
+        {
+            At -= 2;
+            memcpy(At, DigitPairs + Value * 2, 2);
+        }
+        else
+        {
+            *--At = (char)('0' + Value);
+        }
+        int Count = (int)(Buffer + sizeof(Buffer) - At);
+        memcpy(Out, At, Count);
+        return Count;
+    }
+}
+
+char* Haversine_Float::FormatF64(f64 Value, char* Out)
+{
+    u64 Bits = 0;
+    memcpy(&Bits, &Value, sizeof(f64));
+    u64 IeeeMantissa = Bits & ((1ull << MantissaBits) - 1);
+    int IeeeExponent = (int)((Bits >> MantissaBits) & InfinitePower);
+
+    char* At = Out;
+    if (Bits >> 63) { *At++ = '-'; }
+    if (IeeeExponent == InfinitePower)
+    {
+        const char* Text = IeeeMantissa ? "nan" : "inf";
+        memcpy(At, Text, 3);
+        return At + 3;
+    }
+    if (IeeeExponent == 0 && IeeeMantissa == 0)
+    {
+        memcpy(At, "0.0", 3);
+        return At + 3;
+    }
+
+    Decimal Shortest = ShortestDecimal(IeeeMantissa, IeeeExponent);
+    char Digits[20];
+    int DigitCount = WriteDigits(Shortest.Digits, Digits);
+    // Digits before the decimal point, <= 0 for 0.000ddd
+    int Point = DigitCount + Shortest.Exponent;
+
+    if (0 < Point && Point <= MaxIntegerDigits)
+    {
+        if (Point >= DigitCount)
+        {
+            memcpy(At, Digits, DigitCount);
+            At += DigitCount;
+            memset(At, '0', Point - DigitCount);
+            At += Point - DigitCount;
+            memcpy(At, ".0", 2);
+            At += 2;
+        }
+        else
+        {
+            memcpy(At, Digits, Point);
+            At += Point;
+            *At++ = '.';
+            memcpy(At, Digits + Point, DigitCount - Point);
+            At += DigitCount - Point;
+        }
+    }
+    else if (-MaxFractionZeros <= Point && Point <= 0)
+    {
+        memcpy(At, "0.", 2);
+        At += 2;
+        memset(At, '0', -Point);
+        At += -Point;
+        memcpy(At, Digits, DigitCount);
+        At += DigitCount;
+    }
+    else
+    {
+        *At++ = Digits[0];
+        *At++ = '.';
+        if (DigitCount > 1)
+        {
+            memcpy(At, Digits + 1, DigitCount - 1);
+            At += DigitCount - 1;
+        }
+        else
+        {
+            *At++ = '0';
+        }
+        int Exponent = Point - 1;
+        *At++ = 'e';
+        if (Exponent < 0)
+        {
+            *At++ = '-';
+            Exponent = -Exponent;
+        }
+        At += WriteDigits((u64)Exponent, At);
+    }
+    return At;
+}
+
+namespace Haversine_Float
+{
+    static constexpr int HarnessRepeatCount = 4;
+    static constexpr int NumberStride = 32;
+
+    struct NumberText
+    {
+        int Count;
+        char* Text; // NumberStride chars per number, null terminated
+    };
+
+    NumberText FormatNumbers(const f64* Values, int Count, const char* Format)
+    {
+        NumberText Result = { Count, new char[(size_t)Count * NumberStride] };
+        for (int Idx = 0; Idx < Count; Idx++)
+        {
+            sprintf_s(Result.Text + (size_t)Idx * NumberStride, NumberStride, Format, Values[Idx]);
+        }
+        return Result;
+    }
+
+    // Returns the number of values where ParseF64 disagreed with strtod (or with Expected, if given)
+    int CheckNumbers(NumberText& Numbers, const f64* Expected, const char* Format)
+    {
+        int MismatchCount = 0;
+        for (int Idx = 0; Idx < Numbers.Count; Idx++)
+        {
+            const char* Number = Numbers.Text + (size_t)Idx * NumberStride;
+            const char* NumberEnd = Number + strlen(Number);
+            f64 Parsed = 0.0;
+            const char* ParseEnd = ParseF64(Number, NumberEnd, &Parsed);
+            f64 Reference = Expected ? Expected[Idx] : strtod(Number, nullptr);
+            if (ParseEnd != NumberEnd || memcmp(&Parsed, &Reference, sizeof(f64)) != 0)
+            {
+                if (MismatchCount == 0)
+                {
+                    fprintf(stdout, "\tERROR: \"%s\" parsed as %.17g, expected %.17g\n", Number, Parsed, Reference);
+                }
+                MismatchCount++;
+                continue;
+            }
+            // Writing the parsed value back out has to reproduce the input text
+            char Written[NumberStride];
+            sprintf_s(Written, NumberStride, Format, Parsed);
+            if (strcmp(Written, Number) != 0)
+            {
+                if (MismatchCount == 0)
+                {
+                    fprintf(stdout, "\tERROR: \"%s\" was written back as \"%s\"\n", Number, Written);
+                }
+                MismatchCount++;
+            }
+        }
+        return MismatchCount;
+    }
+
+    void BenchmarkNumbers(NumberText& Numbers, const char* Name)
+    {
+        u64 FastBest = UINT64_MAX;
+        u64 CRTBest = UINT64_MAX;
+        u64 FastOSBest = UINT64_MAX;
+        u64 CRTOSBest = UINT64_MAX;
+        f64 FastSum = 0.0;
+        f64 CRTSum = 0.0;
+        for (int RepeatIdx = 0; RepeatIdx < HarnessRepeatCount; RepeatIdx++)
+        {
+            FastSum = 0.0;
+            u64 OSBegin = Perf::ReadOSTimer();
+            u64 Begin = Perf::ReadCPUTimer();
+            for (int Idx = 0; Idx < Numbers.Count; Idx++)
+            {
+                const char* Number = Numbers.Text + (size_t)Idx * NumberStride;
+                f64 Value = 0.0;
+                ParseF64(Number, Number + NumberStride, &Value);
+                FastSum += Value;
+            }
+            u64 Elapsed = Perf::ReadCPUTimer() - Begin;
+            u64 OSElapsed = Perf::ReadOSTimer() - OSBegin;
+            if (Elapsed < FastBest) { FastBest = Elapsed; FastOSBest = OSElapsed; }
+
+            CRTSum = 0.0;
+            OSBegin = Perf::ReadOSTimer();
+            Begin = Perf::ReadCPUTimer();
+            for (int Idx = 0; Idx < Numbers.Count; Idx++)
+            {
+                CRTSum += strtod(Numbers.Text + (size_t)Idx * NumberStride, nullptr);
+            }
+            Elapsed = Perf::ReadCPUTimer() - Begin;
+            OSElapsed = Perf::ReadOSTimer() - OSBegin;
+            if (Elapsed < CRTBest) { CRTBest = Elapsed; CRTOSBest = OSElapsed; }
+        }
+
+        f64 Count = (f64)Numbers.Count;
+        f64 OSFreq = (f64)Perf::GetOSFreq();
+        fprintf(stdout, "    %s: ParseF64 %.2f cycles/number (%.1fM numbers/s), strtod %.2f cycles/number (%.1fM numbers/s), %.2fx%s\n",
+                Name, (f64)FastBest / Count, Count * OSFreq / ((f64)FastOSBest * 1.0e6),
+                (f64)CRTBest / Count, Count * OSFreq / ((f64)CRTOSBest * 1.0e6),
+                (f64)CRTBest / (f64)FastBest, memcmp(&FastSum, &CRTSum, sizeof(f64)) == 0 ? "" : " (SUMS DIFFER)");
+    }
+
+    // Returns mismatch count, prints a pass/fail line
+    int RunCheck(const f64* Values, int Count, const char* Format, bool bExpectExact, const char* Name)
+    {
+        NumberText Numbers = FormatNumbers(Values, Count, Format);
+        int MismatchCount = CheckNumbers(Numbers, bExpectExact ? Values : nullptr, Format);
+        fprintf(stdout, "    %s (\"%s\", %d values): %s\n", Name, Format, Count,
+                MismatchCount == 0 ? "all round-trip" : "MISMATCH");
+        if (MismatchCount > 0) { fprintf(stdout, "\t%d mismatches\n", MismatchCount); }
+        delete[] Numbers.Text;
+        return MismatchCount;
+    }
+
+    int CountSignificantDigits(const char* Begin, const char* End)
+    {
+        const char* Exponent = (const char*)memchr(Begin, 'e', End - Begin);
+        if (Exponent) { End = Exponent; }
+        while (Begin < End && (*Begin == '-' || *Begin == '0' || *Begin == '.')) { Begin++; }
+        while (End > Begin && (End[-1] == '0' || End[-1] == '.')) { End--; }
+        int Count = 0;
+        for (const char* At = Begin; At < End; At++) { Count += CharIsDigit(*At) ? 1 : 0; }
+        return Count;
+    }
+
+    // FormatF64 has to read back bit-identical and use no more digits than the shortest "%.Ng" that does
+    int CheckFormat(const f64* Values, int Count, const char* Name)
+    {
+        int MismatchCount = 0;
+        int LongerCount = 0;
+        for (int Idx = 0; Idx < Count; Idx++)
+        {
+            char Number[MaxFormattedLength + 1];
+            char* NumberEnd = FormatF64(Values[Idx], Number);
+            *NumberEnd = '\0';
+            f64 Parsed = 0.0;
+            const char* ParseEnd = ParseF64(Number, NumberEnd, &Parsed);
+            f64 Reference = strtod(Number, nullptr);
+            if (ParseEnd != NumberEnd || memcmp(&Parsed, Values + Idx, sizeof(f64)) != 0 ||
+                    memcmp(&Reference, Values + Idx, sizeof(f64)) != 0)
+            {
+                if (MismatchCount == 0)
+                {
+                    fprintf(stdout, "\tERROR: %.17g was formatted as \"%s\", which reads back as %.17g\n", Values[Idx], Number, Reference);
+                }
+                MismatchCount++;
+                continue;
+            }
+
+            // If N correctly rounded digits read back, so do N+1, so checking one digit less is enough
+            int DigitCount = CountSignificantDigits(Number, NumberEnd);
+            char Shorter[NumberStride];
+            sprintf_s(Shorter, NumberStride, "%.*g", DigitCount - 1, Values[Idx]);
+            if (DigitCount > 1 && strtod(Shorter, nullptr) == Values[Idx])
+            {
+                if (LongerCount == 0)
+                {
+                    fprintf(stdout, "\tERROR: %.17g was formatted as \"%s\", \"%s\" is shorter\n", Values[Idx], Number, Shorter);
+                }
+                LongerCount++;
+            }
+        }
+        fprintf(stdout, "    %s (FormatF64, %d values): %s\n", Name, Count,
+                MismatchCount + LongerCount == 0 ? "all round-trip, all shortest" : "MISMATCH");
+        if (MismatchCount > 0) { fprintf(stdout, "\t%d don't round-trip\n", MismatchCount); }
+        if (LongerCount > 0) { fprintf(stdout, "\t%d aren't the shortest\n", LongerCount); }
+        return MismatchCount + LongerCount;
+    }
+
+    void BenchmarkFormat(const f64* Values, int Count, const char* Format, const char* Name)
+    {
+        char* Text = new char[(size_t)Count * NumberStride];
+        u64 FastBest = UINT64_MAX;
+        u64 CRTBest = UINT64_MAX;
+        for (int RepeatIdx = 0; RepeatIdx < HarnessRepeatCount; RepeatIdx++)
+        {
+            u64 Begin = Perf::ReadCPUTimer();
+            char* At = Text;
+            for (int Idx = 0; Idx < Count; Idx++) { At = FormatF64(Values[Idx], At); }
+            u64 Elapsed = Perf::ReadCPUTimer() - Begin;
+            if (Elapsed < FastBest) { FastBest = Elapsed; }
+
+            Begin = Perf::ReadCPUTimer();
+            for (int Idx = 0; Idx < Count; Idx++) { sprintf_s(Text + (size_t)Idx * NumberStride, NumberStride, Format, Values[Idx]); }
+            Elapsed = Perf::ReadCPUTimer() - Begin;
+            if (Elapsed < CRTBest) { CRTBest = Elapsed; }
+        }
+        delete[] Text;
+
+        f64 CountF = (f64)Count;
+        fprintf(stdout, "    %s: FormatF64 %.2f cycles/number, sprintf \"%s\" %.2f cycles/number, %.2fx\n",
+                Name, (f64)FastBest / CountF, Format, (f64)CRTBest / CountF, (f64)CRTBest / (f64)FastBest);
+    }
+}
+
+void Haversine_Float::RunHarness(int Seed, int Count)
+{
+    TIME_FUNC();
+
+    fprintf(stdout, "Haversine_Float harness: seed %d, %d pairs\n", Seed, Count);
+
+    // Every coordinate the generator produces for this seed/count
+    // NOTE: GenerateDataUniform prints its whole list, and gen always writes clustered data anyway
+    int ValueCount = Count * 4;
+    HList Clustered = Haversine_Ref0::GenerateDataClustered(Seed, Count);
+    f64* Values = (f64*)Clustered.Data;
+
+    // Arbitrary finite doubles to exercise Eisel-Lemire and the strtod fallback
+    int RandomCount = 1 << 20;
+    f64* RandomValues = new f64[RandomCount];
+    std::mt19937_64 RandomEngine(Seed);
+    for (int Idx = 0; Idx < RandomCount; Idx++)
+    {
+        u64 Bits = RandomEngine();
+        if (((Bits >> 52) & 0x7FF) == 0x7FF) { Bits ^= 1ull << 62; } // No inf/nan
+        memcpy(RandomValues + Idx, &Bits, sizeof(f64));
+    }
+
+    int MismatchCount = 0;
+    // NOTE: "%f" is what WriteDataAsJSON emits, "%.17g" round-trips every double exactly
+    MismatchCount += RunCheck(Values, ValueCount, "%f", false, "Generated coordinates");
+    MismatchCount += RunCheck(Values, ValueCount, "%.17g", true, "Generated coordinates");
+    MismatchCount += RunCheck(RandomValues, RandomCount, "%.17g", true, "Random doubles");
+    MismatchCount += RunCheck(RandomValues, RandomCount, "%.6e", false, "Random doubles");
+    MismatchCount += CheckFormat(Values, ValueCount, "Generated coordinates");
+    MismatchCount += CheckFormat(RandomValues, RandomCount, "Random doubles");
+    fprintf(stdout, "    %s\n", MismatchCount == 0 ? "PASSED" : "FAILED");
+
+    fprintf(stdout, "Throughput, best of %d runs:\n", HarnessRepeatCount);
+    NumberText Numbers = FormatNumbers(Values, ValueCount, "%f");
+    BenchmarkNumbers(Numbers, "Coordinates \"%f\"");
+    delete[] Numbers.Text;
+    Numbers = FormatNumbers(Values, ValueCount, "%.17g");
+    BenchmarkNumbers(Numbers, "Coordinates \"%.17g\"");
+    delete[] Numbers.Text;
+    Numbers = FormatNumbers(RandomValues, RandomCount, "%.17g");
+    BenchmarkNumbers(Numbers, "Random \"%.17g\"");
+    delete[] Numbers.Text;
+    BenchmarkFormat(Values, ValueCount, "%f", "Coordinates");
+    BenchmarkFormat(Values, ValueCount, "%.17g", "Coordinates");
+    BenchmarkFormat(RandomValues, RandomCount, "%.17g", "Random");
+
+    delete[] RandomValues;
+    TRACK_FREE(sizeof(HPair) * Clustered.Count);
+    delete[] Clustered.Data;
+}
+
@@ -0,0 +1,38 @@
+#ifndef HAVERSINE_FLOAT_H
+#define HAVERSINE_FLOAT_H
+
+/*
+ * NOTE:
+ *      Single pass decimal to double conversion, replacing the scan + strtod
+ *      the JSON readers did before (exponents are accepted too)
+ *      Up to 19 significant digits are accumulated into a u64, then:
+ *          - Clinger's fast path when mantissa and power of 10 are both exact doubles
+ *          - Eisel-Lemire (128-bit truncated powers of 5) for 10^-27..10^55
+ *          - strtod for anything else (more digits, huge/tiny exponents,
+ *            subnormals, or an Eisel-Lemire result that can't be decided)
+ *      so the result is always the correctly rounded double
+ *      FormatF64 goes the other way: the shortest decimal that parses back to the
+ *      same double (Ryu, Ulf Adams 2018), with Ryu's two tables of 125-bit powers
+ *      of 5 built with a small bignum on first use instead of compiled in
+ */
+
+#include "haversine_common.h"
+
+namespace Haversine_Float
+{
+    // Returns the char after the number, or nullptr if [Begin, End) doesn't start with one
+    // bOutInteger is set when there was no fraction or exponent
+    const char* ParseF64(const char* Begin, const char* End, f64* OutValue, bool* bOutInteger = nullptr);
+
+    // Most chars FormatF64 writes (no null terminator)
+    static constexpr int MaxFormattedLength = 48;
+    // Writes the shortest decimal that ParseF64/strtod read back as exactly Value, returns the char after it
+    // Always has a '.' (12.0, not 12) so readers see a float, plain digits unless the magnitude is
+    // below 1e-24 or at least 1e21, where it switches to d.ddde+-N; inf/nan (not JSON) are written as strtod reads them
+    char* FormatF64(f64 Value, char* Out);
+
+    void RunHarness(int Seed, int Count);
+}
+
+#endif // HAVERSINE_FLOAT_H
+
@@ -0,0 +1,195 @@
+#include "haversine_generate.h"
+#include "haversine_perf.h"
+#include "haversine_ref0.h"
+
+// C stdlib headers:
+#include <string.h>
+
+namespace Haversine_Generate
+{
+    static constexpr u64 Gamma = 0x9E3779B97F4A7C15ull;
+    static constexpr u64 ValuesPerPair = 5;
+    static constexpr f64 UnitScale = 1.0 / 9007199254740992.0; // 2^-53
+    static constexpr f64 ClusterOffsetX = CoordXMax / (ClusterCount * 2);
+    static constexpr f64 ClusterOffsetY = CoordYMax / (ClusterCount * 2);
+
+    struct GenerateContext
+    {
+        const Generator* Gen;
+        u64 FirstPairIdx;
+        int Count;
+        HPair* Pairs;
+    };
+
+    // SplitMix64's output function
+    u64 Mix64(u64 Z)
+    {
+        Z = (Z ^ (Z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        Z = (Z ^ (Z >> 27)) * 0x94D049BB133111EBull;
+        return Z ^ (Z >> 31);
+    }
+
+    u64 Random(u64 Key, u64 Counter)
+    {
+        return Mix64(Key + (Counter + 1) * Gamma);
+    }
+
+    // Top 53 bits as [0, 1) scaled to [Min, Max), like uniform_real_distribution
+    f64 RandomRange(u64 Bits, f64 Min, f64 Max)
+    {
+        return Min + (f64)(Bits >> 11) * UnitScale * (Max - Min);
+    }
+
+    template <bool bClustered>
+    void GeneratePairsT(const Generator& Gen, u64 FirstPairIdx, int Count, HPair* OutPairs)
+    {
+        for (int Idx = 0; Idx < Count; Idx++)
+        {
+            u64 Counter = (FirstPairIdx + Idx) * ValuesPerPair;
+            HPair Pair = {};
+            if (bClustered)
+            {
+                // Multiply-shift instead of %, ClusterCount doesn't have to be a power of 2
+                u64 ClusterIdx = ((Random(Gen.Key, Counter) >> 32) * ClusterCount) >> 32;
+                const HPair& Cluster = Gen.Clusters[ClusterIdx];
+                Pair.X0 = Cluster.X0 + RandomRange(Random(Gen.Key, Counter + 1), -ClusterOffsetX, +ClusterOffsetX);
+                Pair.Y0 = Cluster.Y0 + RandomRange(Random(Gen.Key, Counter + 2), -ClusterOffsetY, +ClusterOffsetY);
+                Pair.X1 = Cluster.X1 + RandomRange(Random(Gen.Key, Counter + 3), -ClusterOffsetX, +ClusterOffsetX);
+                Pair.Y1 = Cluster.Y1 + RandomRange(Random(Gen.Key, Counter + 4), -ClusterOffsetY, +ClusterOffsetY);
+            }
+            else
+            {
+                Pair.X0 = RandomRange(Random(Gen.Key, Counter + 1), CoordXMin, CoordXMax);
+                Pair.Y0 = RandomRange(Random(Gen.Key, Counter + 2), CoordYMin, CoordYMax);
+                Pair.X1 = RandomRange(Random(Gen.Key, Counter + 3), CoordXMin, CoordXMax);
+                Pair.Y1 = RandomRange(Random(Gen.Key, Counter + 4), CoordYMin, CoordYMax);
+            }
+            OutPairs[Idx] = Pair;
+        }
+    }
+
+    void GenerateTask(void* Context, int TaskIdx, int ThreadIdx)
+    {
+        (void)ThreadIdx;
+        GenerateContext* Generate = (GenerateContext*)Context;
+        int BeginIdx = TaskIdx * PairsPerTask;
+        int Count = Generate->Count - BeginIdx < PairsPerTask ? Generate->Count - BeginIdx : PairsPerTask;
+        TIME_FUNC_DATA((u64)Count * sizeof(HPair));
+        GeneratePairs(*Generate->Gen, Generate->FirstPairIdx + BeginIdx, Count, Generate->Pairs + BeginIdx);
+    }
+}
+
+Haversine_Generate::Generator Haversine_Generate::MakeGenerator(u64 Seed, bool bClustered)
+{
+    Generator Result = {};
+    Result.Key = Mix64(Seed);
+    Result.bClustered = bClustered;
+
+    u64 ClusterKey = Mix64(Result.Key ^ Gamma);
+    for (int ClusterIdx = 0; ClusterIdx < ClusterCount; ClusterIdx++)
+    {
+        u64 Counter = (u64)ClusterIdx * 4;
+        Result.Clusters[ClusterIdx].X0 = RandomRange(Random(ClusterKey, Counter + 0), CoordXMin, CoordXMax);
+        Result.Clusters[ClusterIdx].Y0 = RandomRange(Random(ClusterKey, Counter + 1), CoordYMin, CoordYMax);
+        Result.Clusters[ClusterIdx].X1 = RandomRange(Random(ClusterKey, Counter + 2), CoordXMin, CoordXMax);
+        Result.Clusters[ClusterIdx].Y1 = RandomRange(Random(ClusterKey, Counter + 3), CoordYMin, CoordYMax);
+    }
+    return Result;
+}
+
+void Haversine_Generate::GeneratePairs(const Generator& Gen, u64 FirstPairIdx, int Count, HPair* OutPairs)
+{
+    if (Gen.bClustered) { GeneratePairsT<true>(Gen, FirstPairIdx, Count, OutPairs); }
+    else { GeneratePairsT<false>(Gen, FirstPairIdx, Count, OutPairs); }
+}
+
+void Haversine_Generate::GeneratePairs(const Generator& Gen, u64 FirstPairIdx, int Count, HPair* OutPairs,
+        Haversine_Threads::WorkerPool& Pool)
+{
+    GenerateContext Context = { &Gen, FirstPairIdx, Count, OutPairs };
+    Pool.Run((Count + PairsPerTask - 1) / PairsPerTask, GenerateTask, &Context);
+}
+
+HList Haversine_Generate::GenerateData(u64 Seed, int Count, bool bClustered, int ThreadCount)
+{
+    TIME_FUNC_DATA((u64)Count * sizeof(HPair));
+
+    Generator Gen = MakeGenerator(Seed, bClustered);
+    HList Result = { Count, new HPair[Count] };
+    TRACK_ALLOC(sizeof(HPair) * Count);
+
+    int TaskCount = (Count + PairsPerTask - 1) / PairsPerTask;
+    if (ThreadCount < 1) { ThreadCount = Haversine_Threads::GetHardwareThreadCount(); }
+    if (ThreadCount > TaskCount) { ThreadCount = TaskCount > 1 ? TaskCount : 1; }
+
+    if (ThreadCount == 1)
+    {
+        GeneratePairs(Gen, 0, Count, Result.Data);
+    }
+    else
+    {
+        Haversine_Threads::WorkerPool& Pool = Haversine_Threads::AcquirePool(ThreadCount);
+        GeneratePairs(Gen, 0, Count, Result.Data, Pool);
+    }
+    return Result;
+}
+
+void Haversine_Generate::Benchmark(int Seed, int Count, int MaxThreadCount)
+{
+    TIME_FUNC();
+
+    static constexpr int RepeatCount = 5;
+    u64 CPUFreq = Perf::EstimateCPUFreq();
+    fprintf(stdout, "Generating %d clustered pairs (seed %d), best of %d:\n", Count, Seed, RepeatCount);
+
+    u64 Ref0Best = UINT64_MAX;
+    for (int RepeatIdx = 0; RepeatIdx < RepeatCount; RepeatIdx++)
+    {
+        u64 Begin = Perf::ReadCPUTimer();
+        HList Ref0List = Haversine_Ref0::GenerateDataClustered(Seed, Count);
+        u64 Elapsed = Perf::ReadCPUTimer() - Begin;
+        if (Elapsed < Ref0Best) { Ref0Best = Elapsed; }
+        TRACK_FREE(sizeof(HPair) * Ref0List.Count);
+        delete[] Ref0List.Data;
+    }
+    fprintf(stdout, "\tRef0 default_random_engine: %8.2f cycles/pair, %8.2fM pairs/s\n",
+            (f64)Ref0Best / (f64)Count, (f64)Count / ((f64)Ref0Best / (f64)CPUFreq) / 1.0e6);
+
+    // The same buffers for every run, so page faults on fresh allocations don't count
+    Generator Gen = MakeGenerator(Seed, true);
+    HPair* Reference = new HPair[Count];
+    HPair* Pairs = new HPair[Count];
+    GeneratePairs(Gen, 0, Count, Reference);
+
+    u64 OneThreadBest = 0;
+    int ThreadCount = 1;
+    for (;;)
+    {
+        Haversine_Threads::WorkerPool& Pool = Haversine_Threads::AcquirePool(ThreadCount);
+
+        u64 Best = UINT64_MAX;
+        for (int RepeatIdx = 0; RepeatIdx < RepeatCount; RepeatIdx++)
+        {
+            memset(Pairs, 0, sizeof(HPair) * Count);
+            u64 Begin = Perf::ReadCPUTimer();
+            GeneratePairs(Gen, 0, Count, Pairs, Pool);
+            u64 Elapsed = Perf::ReadCPUTimer() - Begin;
+            if (Elapsed < Best) { Best = Elapsed; }
+        }
+        if (ThreadCount == 1) { OneThreadBest = Best; }
+
+        fprintf(stdout, "\tCounter-based %3d threads:  %8.2f cycles/pair, %8.2fM pairs/s, %.2fx of 1 thread, %.2fx of Ref0, pairs %s\n",
+                ThreadCount, (f64)Best / (f64)Count, (f64)Count / ((f64)Best / (f64)CPUFreq) / 1.0e6,
+                (f64)OneThreadBest / (f64)Best, (f64)Ref0Best / (f64)Best,
+                memcmp(Pairs, Reference, sizeof(HPair) * Count) == 0 ? "match 1 thread" : "DO NOT MATCH 1 thread");
+
+        if (ThreadCount >= MaxThreadCount) { break; }
+        ThreadCount = ThreadCount * 2 < MaxThreadCount ? ThreadCount * 2 : MaxThreadCount;
+    }
+
+    HList List = { Count, Reference };
+    fprintf(stdout, "\tAverage of the counter-based pairs: %f\n", Haversine_Ref0::CalculateAverage(List));
+
+    delete[] Pairs;
+    delete[] Reference;
+}
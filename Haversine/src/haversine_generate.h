@@ -0,0 +1,45 @@
+#ifndef HAVERSINE_GENERATE_H
+#define HAVERSINE_GENERATE_H
+
+/*
+ * NOTE:
+ *      Counter-based replacement for Haversine_Ref0::GenerateDataUniform/Clustered,
+ *      which draw everything from one std::default_random_engine in sequence
+ *      Every random value is SplitMix64's output function applied to
+ *      Key + Counter * Gamma, with Key from the seed and Counter = PairIdx * 5 + n
+ *      (n = cluster pick, X0, Y0, X1, Y1), so pair i depends on (Seed, i) only:
+ *      any range of pairs can be generated on its own, on any thread, and a seed
+ *      gives the same pairs (and files) for every thread count
+ *      Same distributions as Ref0 (8 clusters, offsets up to 1/16 of the range),
+ *      but not the same values for a given seed
+ */
+
+#include "haversine_common.h"
+#include "haversine_threads.h"
+
+namespace Haversine_Generate
+{
+    static constexpr int ClusterCount = 8;
+    // Pairs per WorkerPool task
+    static constexpr int PairsPerTask = 64 * 1024;
+
+    struct Generator
+    {
+        u64 Key;
+        bool bClustered;
+        HPair Clusters[ClusterCount]; // Drawn from their own stream, so pairs don't shift with ClusterCount
+    };
+
+    Generator MakeGenerator(u64 Seed, bool bClustered);
+    // Pairs [FirstPairIdx, FirstPairIdx + Count)
+    void GeneratePairs(const Generator& Gen, u64 FirstPairIdx, int Count, HPair* OutPairs);
+    void GeneratePairs(const Generator& Gen, u64 FirstPairIdx, int Count, HPair* OutPairs, Haversine_Threads::WorkerPool& Pool);
+
+    // ThreadCount 0 => GetHardwareThreadCount()
+    HList GenerateData(u64 Seed, int Count, bool bClustered, int ThreadCount);
+
+    // Pairs/s of Ref0's generator against this one on 1, 2, 4, ... MaxThreadCount threads
+    void Benchmark(int Seed, int Count, int MaxThreadCount);
+}
+
+#endif // HAVERSINE_GENERATE_H
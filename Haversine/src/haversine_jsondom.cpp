@@ -0,0 +1,503 @@
+#include "haversine_jsondom.h"
+#include "haversine_fileio.h"
+#include "haversine_jsonsimd.h"
+#include "haversine_perf.h"
+
+// C stdlib headers:
+#include <string.h>
+
+namespace Haversine_JsonDom
+{
+    using namespace Haversine_Ref0;
+
+    static constexpr int MaxDepth = 1024;
+
+    struct BuildFrame
+    {
+        u32 NodeIdx;
+        u32 LastChildIdx;
+    };
+
+    enum ExpectState
+    {
+        Expect_Value,
+        Expect_ValueOrClose,
+        Expect_Key,
+        Expect_KeyOrClose,
+        Expect_Colon,
+        Expect_CommaOrClose,
+    };
+
+    u32 AppendNode(Document* Doc, BuildFrame* Frame)
+    {
+        if (Doc->NodeCount >= Doc->NodeCapacity)
+        {
+            Doc->NodeCapacity *= 2;
+            Doc->Nodes = (DomNode*)realloc(Doc->Nodes, sizeof(DomNode) * Doc->NodeCapacity);
+        }
+        u32 NodeIdx = Doc->NodeCount++;
+        DomNode* Node = Doc->Nodes + NodeIdx;
+        *Node = {};
+        Node->Parent = Frame ? Frame->NodeIdx : InvalidIdx;
+        Node->FirstChild = InvalidIdx;
+        Node->NextSibling = InvalidIdx;
+        if (Frame)
+        {
+            DomNode* Parent = Doc->Nodes + Frame->NodeIdx;
+            if (Frame->LastChildIdx == InvalidIdx) { Parent->FirstChild = NodeIdx; }
+            else { Doc->Nodes[Frame->LastChildIdx].NextSibling = NodeIdx; }
+            Parent->ChildCount++;
+            Frame->LastChildIdx = NodeIdx;
+        }
+        return NodeIdx;
+    }
+
+    u32 NewValueSlot(Document* Doc, BuildFrame* Frame)
+    {
+        if (Doc->Nodes[Frame->NodeIdx].Value.Type == JsonType_Array)
+        {
+            return AppendNode(Doc, Frame);
+        }
+        // Objects: the member node was added when its key was read
+        return Frame->LastChildIdx;
+    }
+
+    bool ReadHex4(const char* Src, const char* End, u32* OutValue)
+    {
+        if (End - Src < 4) { return false; }
+        u32 Value = 0;
+        for (int DigitIdx = 0; DigitIdx < 4; DigitIdx++)
+        {
+            char C = Src[DigitIdx];
+            u32 Digit = 0;
+            if ('0' <= C && C <= '9') { Digit = C - '0'; }
+            else if ('a' <= C && C <= 'f') { Digit = C - 'a' + 10; }
+            else if ('A' <= C && C <= 'F') { Digit = C - 'A' + 10; }
+            else { return false; }
+            Value = (Value << 4) | Digit;
+        }
+        *OutValue = Value;
+        return true;
+    }
+
+    char* WriteUTF8(char* Dst, u32 CodePoint)
+    {
+        if (CodePoint < 0x80)
+        {
+            *Dst++ = (char)CodePoint;
+        }
+        else if (CodePoint < 0x800)
+        {
+            *Dst++ = (char)(0xC0 | (CodePoint >> 6));
+            *Dst++ = (char)(0x80 | (CodePoint & 0x3F));
+        }
+        else if (CodePoint < 0x10000)
+        {
+            *Dst++ = (char)(0xE0 | (CodePoint >> 12));
+            *Dst++ = (char)(0x80 | ((CodePoint >> 6) & 0x3F));
+            *Dst++ = (char)(0x80 | (CodePoint & 0x3F));
+        }
+        else
+        {
+            *Dst++ = (char)(0xF0 | (CodePoint >> 18));
+            *Dst++ = (char)(0x80 | ((CodePoint >> 12) & 0x3F));
+            *Dst++ = (char)(0x80 | ((CodePoint >> 6) & 0x3F));
+            *Dst++ = (char)(0x80 | (CodePoint & 0x3F));
+        }
+        return Dst;
+    }
+
+    // NOTE:
+    //      An escape sequence is never shorter than what it decodes to, so the
+    //      string can be unescaped over itself and null terminated where the
+    //      closing quote (or earlier) was
+    bool ReadStringInPlace(char* JsonData, int Size, u32 Pos, char** OutString)
+    {
+        char* Read = JsonData + Pos + 1;
+        char* End = JsonData + Size;
+        char* Write = Read;
+        *OutString = Read;
+        while (Read < End && *Read != '"')
+        {
+            if (*Read != '\\')
+            {
+                *Write++ = *Read++;
+                continue;
+            }
+            if (End - Read < 2) { return false; }
+            char Escape = Read[1];
+            Read += 2;
+            switch (Escape)
+            {
+                case '"':
+                case '\\':
+                case '/': { *Write++ = Escape; } break;
+                case 'b': { *Write++ = '\b'; } break;
+                case 'f': { *Write++ = '\f'; } break;
+                case 'n': { *Write++ = '\n'; } break;
+                case 'r': { *Write++ = '\r'; } break;
+                case 't': { *Write++ = '\t'; } break;
+                case 'u':
+                {
+                    u32 CodePoint = 0;
+                    if (!ReadHex4(Read, End, &CodePoint)) { return false; }
+                    Read += 4;
+                    u32 LowSurrogate = 0;
+                    if (0xD800 <= CodePoint && CodePoint < 0xDC00 &&
+                            End - Read >= 6 && Read[0] == '\\' && Read[1] == 'u' &&
+                            ReadHex4(Read + 2, End, &LowSurrogate) &&
+                            0xDC00 <= LowSurrogate && LowSurrogate < 0xE000)
+                    {
+                        CodePoint = 0x10000 + ((CodePoint - 0xD800) << 10) + (LowSurrogate - 0xDC00);
+                        Read += 6;
+                    }
+                    Write = WriteUTF8(Write, CodePoint);
+                } break;
+                default: { return false; }
+            }
+        }
+        if (Read >= End) { return false; }
+        *Write = '\0';
+        return true;
+    }
+
+    bool BuildDocument(char* JsonData, int Size, Haversine_JsonSimd::StructuralIndex& Index, Document* Doc)
+    {
+        TIME_FUNC_DATA(Size);
+
+        // Pair data has one node per 3.6 index entries, grow from there if needed
+        Doc->NodeCapacity = Index.Count / 3 + 1;
+        Doc->Nodes = (DomNode*)malloc(sizeof(DomNode) * Doc->NodeCapacity);
+
+        u32 RootIdx = AppendNode(Doc, nullptr);
+        Doc->Nodes[RootIdx].Value.Type = JsonType_Object;
+        // NOTE: Like Ref0, the document root has to be an object
+        if (Index.Count == 0 || JsonData[Index.Positions[0]] != '{') { return false; }
+
+        BuildFrame* Stack = new BuildFrame[MaxDepth];
+        int Depth = 0;
+        Stack[Depth++] = { RootIdx, InvalidIdx };
+        ExpectState Expect = Expect_KeyOrClose;
+
+        bool bError = false;
+        int IndexIdx = 1;
+        for (; !bError && Depth > 0 && IndexIdx < Index.Count; IndexIdx++)
+        {
+            u32 Pos = Index.Positions[IndexIdx];
+            char C = JsonData[Pos];
+            BuildFrame* Top = Stack + (Depth - 1);
+            bool bTopIsObject = Doc->Nodes[Top->NodeIdx].Value.Type == JsonType_Object;
+            bool bExpectValue = Expect == Expect_Value || Expect == Expect_ValueOrClose;
+            switch (C)
+            {
+                case '{':
+                case '[':
+                {
+                    if (!bExpectValue || Depth >= MaxDepth) { bError = true; break; }
+                    u32 SlotIdx = NewValueSlot(Doc, Top);
+                    Doc->Nodes[SlotIdx].Value.Type = C == '{' ? JsonType_Object : JsonType_Array;
+                    Stack[Depth++] = { SlotIdx, InvalidIdx };
+                    Expect = C == '{' ? Expect_KeyOrClose : Expect_ValueOrClose;
+                } break;
+                case '}':
+                case ']':
+                {
+                    bool bCloseObject = C == '}';
+                    ExpectState EmptyExpect = bCloseObject ? Expect_KeyOrClose : Expect_ValueOrClose;
+                    if (bCloseObject != bTopIsObject || (Expect != Expect_CommaOrClose && Expect != EmptyExpect))
+                    {
+                        bError = true;
+                        break;
+                    }
+                    Depth--;
+                    Expect = Expect_CommaOrClose;
+                } break;
+                case ':':
+                {
+                    if (Expect != Expect_Colon) { bError = true; break; }
+                    Expect = Expect_Value;
+                } break;
+                case ',':
+                {
+                    if (Expect != Expect_CommaOrClose) { bError = true; break; }
+                    Expect = bTopIsObject ? Expect_Key : Expect_Value;
+                } break;
+                case '"':
+                {
+                    char* String = nullptr;
+                    if (!ReadStringInPlace(JsonData, Size, Pos, &String)) { bError = true; break; }
+                    if (Expect == Expect_Key || Expect == Expect_KeyOrClose)
+                    {
+                        u32 MemberIdx = AppendNode(Doc, Top);
+                        Doc->Nodes[MemberIdx].Key = String;
+                        Expect = Expect_Colon;
+                    }
+                    else if (bExpectValue)
+                    {
+                        u32 SlotIdx = NewValueSlot(Doc, Top);
+                        Doc->Nodes[SlotIdx].Value.Type = JsonType_String;
+                        Doc->Nodes[SlotIdx].Value.String = String;
+                        Expect = Expect_CommaOrClose;
+                    }
+                    else { bError = true; }
+                } break;
+                default:
+                {
+                    if (!bExpectValue) { bError = true; break; }
+                    u32 SlotIdx = NewValueSlot(Doc, Top);
+                    if (!Haversine_JsonSimd::ReadScalar(JsonData, Size, Pos, &Doc->Nodes[SlotIdx].Value))
+                    {
+                        bError = true;
+                        break;
+                    }
+                    Expect = Expect_CommaOrClose;
+                } break;
+            }
+        }
+        if (Depth != 0 || IndexIdx != Index.Count) { bError = true; }
+
+        delete[] Stack;
+        return !bError;
+    }
+
+    // Heap footprint of a Ref0 tree, to compare against Document::NodeCapacity
+    void MeasureTree(JsonObject* Object, u64* OutBytes, u64* OutAllocations)
+    {
+        if (Object->Key)
+        {
+            *OutBytes += strlen(Object->Key) + 1;
+            *OutAllocations += 1;
+        }
+        switch (Object->Value.Type)
+        {
+            case JsonType_String:
+            {
+                if (Object->Value.String)
+                {
+                    *OutBytes += strlen(Object->Value.String) + 1;
+                    *OutAllocations += 1;
+                }
+            } break;
+            case JsonType_Object:
+            case JsonType_Array:
+            {
+                DynamicArray<JsonObject*>* List = Object->Value.List;
+                *OutBytes += sizeof(DynamicArray<JsonObject*>) + sizeof(JsonObject*) * List->Capacity;
+                *OutAllocations += 2;
+                for (int ItemIdx = 0; ItemIdx < List->Num; ItemIdx++)
+                {
+                    *OutBytes += sizeof(JsonObject);
+                    *OutAllocations += 1;
+                    MeasureTree((*List)[ItemIdx], OutBytes, OutAllocations);
+                }
+            } break;
+            default: { } break;
+        }
+    }
+}
+
+u32 Haversine_JsonDom::Document::FindMember(u32 ObjectIdx, const char* Key)
+{
+    if (ObjectIdx >= (u32)NodeCount || Nodes[ObjectIdx].Value.Type != JsonType_Object) { return InvalidIdx; }
+
+    for (u32 ChildIdx = Nodes[ObjectIdx].FirstChild; ChildIdx != InvalidIdx; ChildIdx = Nodes[ChildIdx].NextSibling)
+    {
+        if (strcmp(Nodes[ChildIdx].Key, Key) == 0) { return ChildIdx; }
+    }
+    return InvalidIdx;
+}
+
+void Haversine_JsonDom::Document::Release()
+{
+    free(Nodes);
+    Nodes = nullptr;
+    NodeCount = 0;
+    NodeCapacity = 0;
+}
+
+Haversine_JsonDom::Document Haversine_JsonDom::Parse(char* JsonData, int Size)
+{
+    TIME_FUNC();
+
+    while (Size > 0 && JsonData[Size - 1] == '\0') { Size--; }
+
+    Haversine_JsonSimd::StructuralIndex Index = Haversine_JsonSimd::BuildStructuralIndex((u8*)JsonData, Size);
+    Document Result = {};
+    if (!BuildDocument(JsonData, Size, Index, &Result))
+    {
+        fprintf(stdout, "ERROR: Failed to parse JSON input (%d structural entries)\n", Index.Count);
+        Result.bError = true;
+        // Keep just the empty root so lookups on a failed parse find nothing
+        Result.NodeCount = 1;
+        Result.Nodes[0].FirstChild = InvalidIdx;
+        Result.Nodes[0].ChildCount = 0;
+    }
+    Index.Release();
+
+    if (Result.NodeCount < Result.NodeCapacity)
+    {
+        Result.NodeCapacity = Result.NodeCount;
+        Result.Nodes = (DomNode*)realloc(Result.Nodes, sizeof(DomNode) * Result.NodeCapacity);
+    }
+    return Result;
+}
+
+HList Haversine_JsonDom::ParsePairsArray(Document& Doc, u32 PairsIdx)
+{
+    if (PairsIdx == InvalidIdx || Doc.Nodes[PairsIdx].Value.Type != JsonType_Array) { return HList{}; }
+
+    DomNode* Nodes = Doc.Nodes;
+    int ListSize = (int)Nodes[PairsIdx].ChildCount;
+    if (ListSize == 0) { return HList{}; }
+    HList Result = { ListSize, new CoordPair[ListSize] };
+    TRACK_ALLOC(sizeof(CoordPair) * ListSize);
+
+    int PairIdx = 0;
+    bool bError = false;
+    for (u32 ChildIdx = Nodes[PairsIdx].FirstChild; ChildIdx != InvalidIdx; ChildIdx = Nodes[ChildIdx].NextSibling)
+    {
+        u32 X0 = Doc.FindMember(ChildIdx, "X0");
+        u32 Y0 = Doc.FindMember(ChildIdx, "Y0");
+        u32 X1 = Doc.FindMember(ChildIdx, "X1");
+        u32 Y1 = Doc.FindMember(ChildIdx, "Y1");
+        if (X0 == InvalidIdx || Nodes[X0].Value.Type != JsonType_NumberFloat ||
+                Y0 == InvalidIdx || Nodes[Y0].Value.Type != JsonType_NumberFloat ||
+                X1 == InvalidIdx || Nodes[X1].Value.Type != JsonType_NumberFloat ||
+                Y1 == InvalidIdx || Nodes[Y1].Value.Type != JsonType_NumberFloat)
+        {
+            bError = true;
+            break;
+        }
+        Result.Data[PairIdx].X0 = Nodes[X0].Value.NumberFloat;
+        Result.Data[PairIdx].Y0 = Nodes[Y0].Value.NumberFloat;
+        Result.Data[PairIdx].X1 = Nodes[X1].Value.NumberFloat;
+        Result.Data[PairIdx].Y1 = Nodes[Y1].Value.NumberFloat;
+        PairIdx++;
+    }
+    if (bError)
+    {
+        fprintf(stdout, "ERROR encounted at Idx: %d (Size: %d) in ParsePairsArray\n", PairIdx, ListSize);
+        TRACK_FREE(sizeof(HPair) * Result.Count);
+        delete[] Result.Data;
+        return HList{};
+    }
+    return Result;
+}
+
+HList Haversine_JsonDom::ParseJSON(FileContentsT& InputFile)
+{
+    HList Result = {};
+    if (nullptr == InputFile.Data) { return Result; }
+
+    Document Doc = Parse((char*)InputFile.Data, InputFile.Size);
+    Result = ParsePairsArray(Doc, Doc.FindMember(0, "pairs"));
+    Doc.Release();
+    return Result;
+}
+
+HList Haversine_JsonDom::ReadFileAsJSON(const char* FileName)
+{
+    TIME_FUNC();
+
+    Haversine_FileIO::MappedFile Input = Haversine_FileIO::Load(FileName, Haversine_FileIO::DefaultLoadMode);
+    HList Result = Haversine_JsonDom::ParseJSON(Input.Contents);
+    Input.Release();
+
+    return Result;
+}
+
+void Haversine_JsonDom::Benchmark(const char* FileName)
+{
+    TIME_FUNC();
+
+    FileContentsT Input = {};
+    Input.Read(FileName, true);
+    if (!Input.Data) { return; }
+
+    // Parse writes into its input, so every run gets a fresh copy
+    char* WorkingCopy = new char[Input.Size];
+
+    static constexpr int RepeatCount = 5;
+    u64 TreeParseBest = UINT64_MAX;
+    u64 TreeReleaseBest = UINT64_MAX;
+    u64 DomParseBest = UINT64_MAX;
+    u64 DomReleaseBest = UINT64_MAX;
+    u64 TreeBytes = 0;
+    u64 TreeAllocations = 0;
+    u64 DomBytes = 0;
+    int DomNodeCount = 0;
+    bool bMatch = true;
+    HList Pairs = {};
+    for (int RepeatIdx = 0; RepeatIdx < RepeatCount; RepeatIdx++)
+    {
+        bool bLast = RepeatIdx == RepeatCount - 1;
+
+        u64 Begin = Perf::ReadCPUTimer();
+        JsonObject Root = Haversine_Ref0::Parse((char*)Input.Data, Input.Size);
+        u64 Elapsed = Perf::ReadCPUTimer() - Begin;
+        if (Elapsed < TreeParseBest) { TreeParseBest = Elapsed; }
+
+        HList TreePairs = {};
+        if (bLast)
+        {
+            MeasureTree(&Root, &TreeBytes, &TreeAllocations);
+            JsonObject* PairsObject = Query(&Root, "pairs");
+            if (PairsObject) { TreePairs = Haversine_Ref0::ParsePairsArray(PairsObject); }
+        }
+
+        Begin = Perf::ReadCPUTimer();
+        Haversine_Ref0::Release(&Root, true);
+        Elapsed = Perf::ReadCPUTimer() - Begin;
+        if (Elapsed < TreeReleaseBest) { TreeReleaseBest = Elapsed; }
+
+        memcpy(WorkingCopy, Input.Data, Input.Size);
+        Begin = Perf::ReadCPUTimer();
+        Document Doc = Parse(WorkingCopy, Input.Size);
+        Elapsed = Perf::ReadCPUTimer() - Begin;
+        if (Elapsed < DomParseBest) { DomParseBest = Elapsed; }
+
+        if (bLast)
+        {
+            DomBytes = sizeof(DomNode) * (u64)Doc.NodeCapacity;
+            DomNodeCount = Doc.NodeCount;
+            Pairs = ParsePairsArray(Doc, Doc.FindMember(0, "pairs"));
+            bMatch = Pairs.Count == TreePairs.Count &&
+                (Pairs.Count == 0 || memcmp(Pairs.Data, TreePairs.Data, sizeof(HPair) * Pairs.Count) == 0);
+            TRACK_FREE(sizeof(HPair) * TreePairs.Count);
+            delete[] TreePairs.Data;
+        }
+
+        Begin = Perf::ReadCPUTimer();
+        Doc.Release();
+        Elapsed = Perf::ReadCPUTimer() - Begin;
+        if (Elapsed < DomReleaseBest) { DomReleaseBest = Elapsed; }
+    }
+
+    // NOTE:
+    //      The structural index only lives inside Parse, but it is allocated for the
+    //      worst case (u32 per input byte plus one), so that is what it costs in memory
+    //      however few of the entries get written
+    Haversine_JsonSimd::StructuralIndex Index = Haversine_JsonSimd::BuildStructuralIndex(Input.Data, Input.Size);
+    u64 IndexBytes = sizeof(u32) * ((u64)Input.Size + 1);
+    int IndexCount = Index.Count;
+    Index.Release();
+
+    f64 Bytes = (f64)Input.Size;
+    f64 MB = 1024.0 * 1024.0;
+    fprintf(stdout, "%s (%d bytes, %d pairs):\n", FileName, Input.Size, Pairs.Count);
+    fprintf(stdout, "\tRef0 tree: parse %.2f + release %.2f = %.2f cycles/byte, peak %.2f MB in %llu allocations\n",
+            (f64)TreeParseBest / Bytes, (f64)TreeReleaseBest / Bytes,
+            (f64)(TreeParseBest + TreeReleaseBest) / Bytes, (f64)TreeBytes / MB, TreeAllocations);
+    fprintf(stdout, "\tFlat DOM:  parse %.2f + release %.2f = %.2f cycles/byte, peak %.2f MB (%d nodes) + %.2f MB transient index (%d entries used)\n",
+            (f64)DomParseBest / Bytes, (f64)DomReleaseBest / Bytes,
+            (f64)(DomParseBest + DomReleaseBest) / Bytes, (f64)DomBytes / MB, DomNodeCount, (f64)IndexBytes / MB, IndexCount);
+    fprintf(stdout, "\tSpeedup: %.2fx, pairs %s\n",
+            (f64)(TreeParseBest + TreeReleaseBest) / (f64)(DomParseBest + DomReleaseBest),
+            bMatch ? "match" : "DO NOT MATCH");
+
+    TRACK_FREE(sizeof(HPair) * Pairs.Count);
+    delete[] Pairs.Data;
+    delete[] WorkingCopy;
+    Input.Release();
+}
+
@@ -0,0 +1,52 @@
+#ifndef HAVERSINE_JSONDOM_H
+#define HAVERSINE_JSONDOM_H
+
+/*
+ * NOTE:
+ *      Flat alternative to the Ref0 JsonObject pointer tree
+ *      Every value is a DomNode in one growable array and links to its
+ *      parent/first child/next sibling by index, strings (keys included)
+ *      are unescaped in place and point into the input buffer, so the
+ *      input has to outlive the Document and is modified by Parse
+ *      Releasing a Document is a single free of the node array
+ *      Uses the Haversine_JsonSimd structural index to find tokens
+ */
+
+#include "haversine_common.h"
+#include "haversine_ref0.h"
+
+namespace Haversine_JsonDom
+{
+    static constexpr u32 InvalidIdx = UINT32_MAX;
+
+    struct DomNode
+    {
+        char* Key; // nullptr for the root and array elements
+        Haversine_Ref0::JsonValue Value; // Value.List is unused, containers use the indices below
+        u32 Parent;
+        u32 FirstChild;
+        u32 NextSibling;
+        u32 ChildCount;
+    };
+
+    struct Document
+    {
+        int NodeCount;
+        int NodeCapacity;
+        DomNode* Nodes; // Nodes[0] is the root object
+        bool bError;
+
+        u32 FindMember(u32 ObjectIdx, const char* Key);
+        void Release();
+    };
+
+    Document Parse(char* JsonData, int Size);
+    HList ParsePairsArray(Document& Doc, u32 PairsIdx);
+    HList ParseJSON(Haversine_Ref0::FileContentsT& InputFile);
+    HList ReadFileAsJSON(const char* FileName);
+
+    void Benchmark(const char* FileName);
+}
+
+#endif // HAVERSINE_JSONDOM_H
+
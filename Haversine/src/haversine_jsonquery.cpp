@@ -0,0 +1,504 @@
+#include "haversine_jsonquery.h"
+#include "haversine_jsonsimd.h"
+#include "haversine_perf.h"
+
+// C stdlib headers:
+#include <string.h>
+
+namespace Haversine_JsonQuery
+{
+    using namespace Haversine_Ref0;
+
+    static constexpr int InitialKeyCapacity = 64;
+    static constexpr int InitialNodeCapacity = 1024;
+
+    u64 HashKey(const char* Key, size_t Length)
+    {
+        // FNV-1a
+        u64 Hash = 0xcbf29ce484222325ull;
+        for (size_t CharIdx = 0; CharIdx < Length; CharIdx++)
+        {
+            Hash = (Hash ^ (u8)Key[CharIdx]) * 0x100000001b3ull;
+        }
+        return Hash;
+    }
+
+    u32 HashKeyId(u32 KeyId)
+    {
+        // Odd multiplier, so consecutive KeyIds still spread over the low bits
+        return KeyId * 2654435761u;
+    }
+
+    bool KeyEquals(const char* Stored, const char* Key, size_t Length)
+    {
+        return strncmp(Stored, Key, Length) == 0 && Stored[Length] == '\0';
+    }
+
+    void GrowKeyTable(KeyTable* Keys)
+    {
+        int OldCapacity = Keys->Capacity;
+        KeyTable::Entry* OldEntries = Keys->Entries;
+
+        Keys->Capacity = OldCapacity ? OldCapacity * 2 : InitialKeyCapacity;
+        Keys->Entries = (KeyTable::Entry*)calloc(Keys->Capacity, sizeof(KeyTable::Entry));
+        u64 Mask = (u64)Keys->Capacity - 1;
+        for (int EntryIdx = 0; EntryIdx < OldCapacity; EntryIdx++)
+        {
+            if (!OldEntries[EntryIdx].Key) { continue; }
+            u64 SlotIdx = OldEntries[EntryIdx].Hash & Mask;
+            while (Keys->Entries[SlotIdx].Key) { SlotIdx = (SlotIdx + 1) & Mask; }
+            Keys->Entries[SlotIdx] = OldEntries[EntryIdx];
+        }
+        free(OldEntries);
+    }
+
+    u32 AppendNode(Index* Idx, JsonObject* Object, u32 KeyId)
+    {
+        if (Idx->NodeCount >= Idx->NodeCapacity)
+        {
+            Idx->NodeCapacity *= 2;
+            Idx->Nodes = (IndexNode*)realloc(Idx->Nodes, sizeof(IndexNode) * Idx->NodeCapacity);
+        }
+        u32 NodeIdx = Idx->NodeCount++;
+        Idx->Nodes[NodeIdx] = { Object, Object->Value.Type, KeyId, InvalidIdx, 0, InvalidIdx, 0 };
+        return NodeIdx;
+    }
+
+    void BuildMemberTable(Index* Idx, u32 ObjectIdx)
+    {
+        u32 FirstChild = Idx->Nodes[ObjectIdx].FirstChild;
+        u32 ChildCount = Idx->Nodes[ObjectIdx].ChildCount;
+
+        // At most half full, so probe runs stay short
+        u32 TableSize = 16;
+        while (TableSize < ChildCount * 2) { TableSize *= 2; }
+        if (Idx->SlotCount + (int)TableSize > Idx->SlotCapacity)
+        {
+            while (Idx->SlotCount + (int)TableSize > Idx->SlotCapacity) { Idx->SlotCapacity *= 2; }
+            Idx->Slots = (u32*)realloc(Idx->Slots, sizeof(u32) * Idx->SlotCapacity);
+        }
+        u32* Table = Idx->Slots + Idx->SlotCount;
+        memset(Table, 0xFF, sizeof(u32) * TableSize);
+
+        u32 Mask = TableSize - 1;
+        for (u32 ChildIdx = FirstChild; ChildIdx < FirstChild + ChildCount; ChildIdx++)
+        {
+            u32 KeyId = Idx->Nodes[ChildIdx].KeyId;
+            u32 SlotIdx = HashKeyId(KeyId) & Mask;
+            // Duplicate keys keep the first member, same as Haversine_Ref0::Query
+            while (Table[SlotIdx] != InvalidIdx && Idx->Nodes[Table[SlotIdx]].KeyId != KeyId)
+            {
+                SlotIdx = (SlotIdx + 1) & Mask;
+            }
+            if (Table[SlotIdx] == InvalidIdx) { Table[SlotIdx] = ChildIdx; }
+        }
+
+        Idx->Nodes[ObjectIdx].SlotBegin = (u32)Idx->SlotCount;
+        Idx->Nodes[ObjectIdx].SlotMask = Mask;
+        Idx->SlotCount += TableSize;
+    }
+
+    u32 MatchMember(const Index& Idx, u32 NodeIdx, PathStep& Step)
+    {
+        if (Step.KeyId == InvalidIdx) { return InvalidIdx; }
+
+        const IndexNode& Node = Idx.Nodes[NodeIdx];
+        if (Step.LastMatch < Node.ChildCount && Idx.Nodes[Node.FirstChild + Step.LastMatch].KeyId == Step.KeyId)
+        {
+            // NOTE: With duplicate keys this can pick a later duplicate, FindMember always picks the first
+            return Node.FirstChild + Step.LastMatch;
+        }
+        u32 Result = Idx.FindMember(NodeIdx, Step.KeyId);
+        if (Result != InvalidIdx) { Step.LastMatch = Result - Node.FirstChild; }
+        return Result;
+    }
+
+    int EvaluateStep(const Index& Idx, Path& QueryPath, int StepIdx, u32 NodeIdx, DynamicArray<u32>& OutNodes)
+    {
+        if (StepIdx == QueryPath.StepCount)
+        {
+            OutNodes.Add(NodeIdx);
+            return 1;
+        }
+
+        PathStep& Step = QueryPath.Steps[StepIdx];
+        const IndexNode& Node = Idx.Nodes[NodeIdx];
+        int Result = 0;
+        switch (Step.Type)
+        {
+            case Step_Member:
+            {
+                u32 MemberIdx = MatchMember(Idx, NodeIdx, Step);
+                if (MemberIdx != InvalidIdx) { Result = EvaluateStep(Idx, QueryPath, StepIdx + 1, MemberIdx, OutNodes); }
+            } break;
+            case Step_Element:
+            {
+                if (Node.Type == JsonType_Array)
+                {
+                    if (Step.ElementIdx < Node.ChildCount)
+                    {
+                        Result = EvaluateStep(Idx, QueryPath, StepIdx + 1, Node.FirstChild + Step.ElementIdx, OutNodes);
+                    }
+                }
+                else
+                {
+                    // Digits are a member name when applied to an object
+                    u32 MemberIdx = MatchMember(Idx, NodeIdx, Step);
+                    if (MemberIdx != InvalidIdx) { Result = EvaluateStep(Idx, QueryPath, StepIdx + 1, MemberIdx, OutNodes); }
+                }
+            } break;
+            case Step_AnyChild:
+            {
+                for (u32 ChildIdx = Node.FirstChild; ChildIdx < Node.FirstChild + Node.ChildCount; ChildIdx++)
+                {
+                    Result += EvaluateStep(Idx, QueryPath, StepIdx + 1, ChildIdx, OutNodes);
+                }
+            } break;
+        }
+        return Result;
+    }
+
+    // nested-arrays.json as one element, plus a wide "meta" object with a deep tail
+    const char* BenchElementFormat =
+        "        { \"id\": %d, \"key0\": [1, 2],\n"
+        "          \"key1\" :[\n"
+        "            { \"nest-key0\": { } },\n"
+        "            { \"nest-key1\": [ 3, 4, 56.0 ] },\n"
+        "            { \"nest-key2\": [ \"\", \"aosijfe\", \"aoweigfao\"] },\n"
+        "            \"str-val0\",\n"
+        "            1,\n"
+        "            23,\n"
+        "            \"str-val1\" ],\n"
+        "          \"meta\": { \"m00\": 0, \"m01\": 1, \"m02\": 2, \"m03\": 3, \"m04\": 4, \"m05\": 5,\n"
+        "                    \"m06\": 6, \"m07\": 7, \"m08\": 8, \"m09\": 9, \"m10\": 10, \"m11\": 11,\n"
+        "                    \"deep\": { \"deeper\": { \"value\": %d.5 } } } }";
+
+    char* GenerateBenchDocument(int TargetMB, int* OutSize, int* OutElementCount)
+    {
+        static constexpr int MaxElementSize = 1024;
+        size_t TargetSize = (size_t)TargetMB * 1024 * 1024;
+        size_t Capacity = TargetSize + 2 * MaxElementSize;
+        char* Result = new char[Capacity];
+
+        size_t Size = (size_t)sprintf_s(Result, Capacity, "{\n    \"groups\": [\n");
+        int ElementCount = 0;
+        while (Size < TargetSize)
+        {
+            if (ElementCount > 0) { Result[Size++] = ','; Result[Size++] = '\n'; }
+            Size += (size_t)sprintf_s(Result + Size, Capacity - Size, BenchElementFormat, ElementCount, ElementCount);
+            ElementCount++;
+        }
+        Size += (size_t)sprintf_s(Result + Size, Capacity - Size, "\n    ],\n    \"tail\": { \"value\": 42.5 }\n}\n");
+
+        *OutSize = (int)Size;
+        *OutElementCount = ElementCount;
+        return Result;
+    }
+
+    JsonObject* ElementAt(JsonObject* Object, int ElementIdx)
+    {
+        if (!Object || Object->Value.Type != JsonType_Array || ElementIdx >= Object->Value.List->Num) { return nullptr; }
+        return (*Object->Value.List)[ElementIdx];
+    }
+
+    f64 NumberOf(JsonObject* Object)
+    {
+        if (!Object) { return 0.0; }
+        if (Object->Value.Type == JsonType_NumberFloat) { return Object->Value.NumberFloat; }
+        if (Object->Value.Type == JsonType_NumberInt) { return (f64)Object->Value.NumberInt; }
+        return 0.0;
+    }
+
+    enum BenchQuery
+    {
+        BenchQuery_Tail,
+        BenchQuery_DeepValue,
+        BenchQuery_NestedElement,
+        BenchQuery_Count,
+    };
+
+    const char* BenchQueryPaths[BenchQuery_Count] =
+    {
+        "/tail/value",
+        "/groups/*/meta/deep/deeper/value",
+        "/groups/*/key1/1/nest-key1/2",
+    };
+
+    // The same lookups written against Haversine_Ref0::Query, the way ParsePairsArray uses it
+    int RunRef0Query(JsonObject* Root, BenchQuery Query, f64* OutSum)
+    {
+        int Result = 0;
+        f64 Sum = 0.0;
+        if (Query == BenchQuery_Tail)
+        {
+            JsonObject* Value = Haversine_Ref0::Query(Haversine_Ref0::Query(Root, "tail"), "value");
+            if (Value) { Sum += NumberOf(Value); Result++; }
+        }
+        else
+        {
+            JsonObject* Groups = Haversine_Ref0::Query(Root, "groups");
+            int GroupCount = Groups && Groups->Value.Type == JsonType_Array ? Groups->Value.List->Num : 0;
+            for (int GroupIdx = 0; GroupIdx < GroupCount; GroupIdx++)
+            {
+                JsonObject* Group = (*Groups->Value.List)[GroupIdx];
+                JsonObject* Value = nullptr;
+                if (Query == BenchQuery_DeepValue)
+                {
+                    JsonObject* Meta = Haversine_Ref0::Query(Group, "meta");
+                    Value = Haversine_Ref0::Query(Haversine_Ref0::Query(Haversine_Ref0::Query(Meta, "deep"), "deeper"), "value");
+                }
+                else
+                {
+                    JsonObject* Nested = ElementAt(Haversine_Ref0::Query(Group, "key1"), 1);
+                    Value = ElementAt(Haversine_Ref0::Query(Nested, "nest-key1"), 2);
+                }
+                if (Value) { Sum += NumberOf(Value); Result++; }
+            }
+        }
+        *OutSum = Sum;
+        return Result;
+    }
+}
+
+u32 Haversine_JsonQuery::KeyTable::Intern(const char* Key)
+{
+    size_t Length = strlen(Key);
+    u64 Hash = HashKey(Key, Length);
+    if ((Count + 1) * 2 > Capacity) { GrowKeyTable(this); }
+
+    u64 Mask = (u64)Capacity - 1;
+    u64 SlotIdx = Hash & Mask;
+    while (Entries[SlotIdx].Key)
+    {
+        if (Entries[SlotIdx].Hash == Hash && KeyEquals(Entries[SlotIdx].Key, Key, Length)) { return Entries[SlotIdx].KeyId; }
+        SlotIdx = (SlotIdx + 1) & Mask;
+    }
+    Entries[SlotIdx] = { Hash, Key, (u32)Count };
+    return (u32)Count++;
+}
+
+u32 Haversine_JsonQuery::KeyTable::Find(const char* Key, size_t Length) const
+{
+    if (Capacity == 0) { return InvalidIdx; }
+
+    u64 Hash = HashKey(Key, Length);
+    u64 Mask = (u64)Capacity - 1;
+    u64 SlotIdx = Hash & Mask;
+    while (Entries[SlotIdx].Key)
+    {
+        if (Entries[SlotIdx].Hash == Hash && KeyEquals(Entries[SlotIdx].Key, Key, Length)) { return Entries[SlotIdx].KeyId; }
+        SlotIdx = (SlotIdx + 1) & Mask;
+    }
+    return InvalidIdx;
+}
+
+void Haversine_JsonQuery::KeyTable::Release()
+{
+    free(Entries);
+    *this = {};
+}
+
+u32 Haversine_JsonQuery::Index::FindMember(u32 ObjectIdx, u32 KeyId) const
+{
+    if (ObjectIdx >= (u32)NodeCount || KeyId == InvalidIdx) { return InvalidIdx; }
+
+    const IndexNode& Object = Nodes[ObjectIdx];
+    if (Object.SlotBegin == InvalidIdx)
+    {
+        for (u32 ChildIdx = Object.FirstChild; ChildIdx < Object.FirstChild + Object.ChildCount; ChildIdx++)
+        {
+            if (Nodes[ChildIdx].KeyId == KeyId) { return ChildIdx; }
+        }
+        return InvalidIdx;
+    }
+
+    const u32* Table = Slots + Object.SlotBegin;
+    u32 SlotIdx = HashKeyId(KeyId) & Object.SlotMask;
+    while (Table[SlotIdx] != InvalidIdx)
+    {
+        if (Nodes[Table[SlotIdx]].KeyId == KeyId) { return Table[SlotIdx]; }
+        SlotIdx = (SlotIdx + 1) & Object.SlotMask;
+    }
+    return InvalidIdx;
+}
+
+u32 Haversine_JsonQuery::Index::FindMember(u32 ObjectIdx, const char* Key) const
+{
+    return FindMember(ObjectIdx, Keys.Find(Key, strlen(Key)));
+}
+
+void Haversine_JsonQuery::Index::Release()
+{
+    Keys.Release();
+    free(Nodes);
+    free(Slots);
+    *this = {};
+}
+
+Haversine_JsonQuery::Index Haversine_JsonQuery::Build(JsonObject* Root)
+{
+    TIME_FUNC();
+
+    Index Result = {};
+    if (!Root) { return Result; }
+
+    Result.NodeCapacity = InitialNodeCapacity;
+    Result.Nodes = (IndexNode*)malloc(sizeof(IndexNode) * Result.NodeCapacity);
+    Result.SlotCapacity = InitialNodeCapacity;
+    Result.Slots = (u32*)malloc(sizeof(u32) * Result.SlotCapacity);
+    AppendNode(&Result, Root, InvalidIdx);
+
+    // NOTE:
+    //      Each container's children are appended as one contiguous block, and blocks are
+    //      laid out depth first (the next container expanded is the first unexpanded child
+    //      of the last block), so a subtree like one array element stays close together
+    DynamicArray<u32> Pending;
+    Pending.Add(0);
+    while (Pending.Num > 0)
+    {
+        u32 NodeIdx = Pending.Last();
+        Pending.RemoveLast();
+
+        JsonObject* Object = Result.Nodes[NodeIdx].Object;
+        bool bObject = Object->Value.Type == JsonType_Object;
+        if ((!bObject && Object->Value.Type != JsonType_Array) || !Object->Value.List) { continue; }
+
+        DynamicArray<JsonObject*>* List = Object->Value.List;
+        u32 FirstChild = (u32)Result.NodeCount;
+        for (int ItemIdx = 0; ItemIdx < List->Num; ItemIdx++)
+        {
+            JsonObject* Child = (*List)[ItemIdx];
+            AppendNode(&Result, Child, bObject && Child->Key ? Result.Keys.Intern(Child->Key) : InvalidIdx);
+        }
+        Result.Nodes[NodeIdx].FirstChild = FirstChild;
+        Result.Nodes[NodeIdx].ChildCount = (u32)List->Num;
+
+        if (bObject && (u32)List->Num > LinearMemberMax) { BuildMemberTable(&Result, NodeIdx); }
+
+        for (u32 ChildIdx = FirstChild + (u32)List->Num; ChildIdx > FirstChild; ChildIdx--)
+        {
+            JsonType ChildType = Result.Nodes[ChildIdx - 1].Type;
+            if (ChildType == JsonType_Object || ChildType == JsonType_Array) { Pending.Add(ChildIdx - 1); }
+        }
+    }
+
+    Result.Nodes = (IndexNode*)realloc(Result.Nodes, sizeof(IndexNode) * Result.NodeCount);
+    Result.NodeCapacity = Result.NodeCount;
+    return Result;
+}
+
+Haversine_JsonQuery::Path Haversine_JsonQuery::Compile(const Index& Idx, const char* PathText)
+{
+    Path Result = {};
+    if (!PathText || (PathText[0] != '\0' && PathText[0] != '/')) { return Result; }
+
+    const char* At = PathText;
+    while (*At == '/')
+    {
+        At++;
+        const char* SegmentEnd = strchr(At, '/');
+        if (!SegmentEnd) { SegmentEnd = At + strlen(At); }
+        size_t Length = SegmentEnd - At;
+        if (Result.StepCount == MaxPathSteps) { return Path{}; }
+
+        bool bDigits = Length > 0 && Length < 10;
+        for (size_t CharIdx = 0; CharIdx < Length; CharIdx++) { bDigits = bDigits && At[CharIdx] >= '0' && At[CharIdx] <= '9'; }
+
+        PathStep& Step = Result.Steps[Result.StepCount++];
+        Step = {};
+        if (Length == 1 && At[0] == '*') { Step.Type = Step_AnyChild; }
+        else
+        {
+            // A key nobody interned can't match, it stays InvalidIdx and the step finds nothing
+            Step.Type = bDigits ? Step_Element : Step_Member;
+            Step.KeyId = Idx.Keys.Find(At, Length);
+            Step.ElementIdx = bDigits ? (u32)strtoul(At, nullptr, 10) : 0;
+        }
+        At = SegmentEnd;
+    }
+
+    Result.bValid = true;
+    return Result;
+}
+
+int Haversine_JsonQuery::Evaluate(const Index& Idx, Path& QueryPath, u32 StartIdx, DynamicArray<u32>& OutNodes)
+{
+    if (!QueryPath.bValid || StartIdx >= (u32)Idx.NodeCount) { return 0; }
+    return EvaluateStep(Idx, QueryPath, 0, StartIdx, OutNodes);
+}
+
+void Haversine_JsonQuery::Benchmark(int TargetMB)
+{
+    TIME_FUNC();
+
+    int Size = 0;
+    int ElementCount = 0;
+    char* JsonData = GenerateBenchDocument(TargetMB, &Size, &ElementCount);
+    f64 Bytes = (f64)Size;
+
+    u64 Begin = Perf::ReadCPUTimer();
+    JsonObject Root = Haversine_JsonSimd::Parse(JsonData, Size);
+    u64 ParseCycles = Perf::ReadCPUTimer() - Begin;
+
+    static constexpr int RepeatCount = 5;
+    u64 BuildBest = UINT64_MAX;
+    Index Idx = {};
+    for (int RepeatIdx = 0; RepeatIdx < RepeatCount; RepeatIdx++)
+    {
+        Idx.Release();
+        Begin = Perf::ReadCPUTimer();
+        Idx = Build(&Root);
+        u64 Elapsed = Perf::ReadCPUTimer() - Begin;
+        if (Elapsed < BuildBest) { BuildBest = Elapsed; }
+    }
+
+    u64 IndexBytes = sizeof(IndexNode) * (u64)Idx.NodeCount + sizeof(u32) * (u64)Idx.SlotCount +
+        sizeof(KeyTable::Entry) * (u64)Idx.Keys.Capacity;
+    fprintf(stdout, "Generated %d bytes (%d nested-arrays elements)\n", Size, ElementCount);
+    fprintf(stdout, "\tJsonSimd parse: %.2f cycles/byte\n", (f64)ParseCycles / Bytes);
+    fprintf(stdout, "\tIndex build:    %.2f cycles/byte (%d nodes, %d keys, %d member slots, %.1f MB)\n",
+            (f64)BuildBest / Bytes, Idx.NodeCount, Idx.Keys.Count, Idx.SlotCount, (f64)IndexBytes / (1024.0 * 1024.0));
+
+    DynamicArray<u32> Matches;
+    for (int QueryIdx = 0; QueryIdx < BenchQuery_Count; QueryIdx++)
+    {
+        u64 Ref0Best = UINT64_MAX;
+        u64 CompileBest = UINT64_MAX;
+        u64 PathBest = UINT64_MAX;
+        int Ref0Count = 0;
+        int PathCount = 0;
+        f64 Ref0Sum = 0.0;
+        f64 PathSum = 0.0;
+        for (int RepeatIdx = 0; RepeatIdx < RepeatCount; RepeatIdx++)
+        {
+            Begin = Perf::ReadCPUTimer();
+            Ref0Count = RunRef0Query(&Root, (BenchQuery)QueryIdx, &Ref0Sum);
+            u64 Elapsed = Perf::ReadCPUTimer() - Begin;
+            if (Elapsed < Ref0Best) { Ref0Best = Elapsed; }
+
+            Matches.Num = 0;
+            Begin = Perf::ReadCPUTimer();
+            Path QueryPath = Compile(Idx, BenchQueryPaths[QueryIdx]);
+            u64 CompileEnd = Perf::ReadCPUTimer();
+            PathCount = Evaluate(Idx, QueryPath, 0, Matches);
+            PathSum = 0.0;
+            for (int MatchIdx = 0; MatchIdx < Matches.Num; MatchIdx++) { PathSum += NumberOf(Idx.Nodes[Matches[MatchIdx]].Object); }
+            Elapsed = Perf::ReadCPUTimer() - Begin;
+            if (CompileEnd - Begin < CompileBest) { CompileBest = CompileEnd - Begin; }
+            if (Elapsed < PathBest) { PathBest = Elapsed; }
+        }
+
+        bool bMatch = Ref0Count == PathCount && Ref0Sum == PathSum;
+        fprintf(stdout, "\t%s: %d matches, %s\n", BenchQueryPaths[QueryIdx], PathCount,
+                bMatch ? "same results as Ref0 Query" : "DOES NOT MATCH Ref0 Query");
+        fprintf(stdout, "\t\tRef0 Query:    %llu cycles (%.1f cycles/match)\n",
+                Ref0Best, (f64)Ref0Best / (f64)(Ref0Count ? Ref0Count : 1));
+        fprintf(stdout, "\t\tCompiled path: %llu cycles (%.1f cycles/match, %llu to compile), %.1fx faster\n",
+                PathBest, (f64)PathBest / (f64)(PathCount ? PathCount : 1), CompileBest, (f64)Ref0Best / (f64)PathBest);
+    }
+
+    Idx.Release();
+    Haversine_Ref0::Release(&Root, true);
+    delete[] JsonData;
+}
+
@@ -0,0 +1,108 @@
+#ifndef HAVERSINE_JSONQUERY_H
+#define HAVERSINE_JSONQUERY_H
+
+/*
+ * NOTE:
+ *      Lookup index over a JsonObject tree (from Haversine_Ref0 or Haversine_JsonSimd)
+ *      Haversine_Ref0::Query is a depth-first strcmp over the whole subtree, here:
+ *          - every key is interned once into a KeyTable and compared as a u32 after that
+ *          - the tree is mirrored breadth-first into a flat node array, so the children
+ *            of a container are contiguous and array elements are found by index
+ *          - objects with more than LinearMemberMax members get an open addressing
+ *            member table, smaller ones are scanned by KeyId
+ *      Paths like "/tail/value" or "/pairs/N/X0" are compiled once (keys resolved
+ *      to KeyIds) and then evaluated without any string compares, each member step
+ *      remembers where it matched last so same-shaped array elements are usually
+ *      resolved by a single compare
+ *      Path segments: "name" (object member), "*" (every child), "N" (array element N)
+ *      The tree has to outlive the Index, the Index points at its nodes and keys
+ */
+
+#include "haversine_common.h"
+#include "haversine_ref0.h"
+
+namespace Haversine_JsonQuery
+{
+    static constexpr u32 InvalidIdx = UINT32_MAX;
+    static constexpr u32 LinearMemberMax = 8;
+    static constexpr int MaxPathSteps = 16;
+
+    struct KeyTable
+    {
+        struct Entry
+        {
+            u64 Hash;
+            const char* Key; // nullptr for empty entries
+            u32 KeyId;
+        };
+
+        int Count;
+        int Capacity; // Power of two
+        Entry* Entries;
+
+        u32 Intern(const char* Key); // Adds Key if it isn't in the table yet
+        u32 Find(const char* Key, size_t Length) const; // InvalidIdx if Key isn't in the table
+        void Release();
+    };
+
+    struct IndexNode
+    {
+        Haversine_Ref0::JsonObject* Object;
+        Haversine_Ref0::JsonType Type;
+        u32 KeyId; // InvalidIdx for the root and array elements
+        u32 FirstChild;
+        u32 ChildCount;
+        u32 SlotBegin; // Member table in Index::Slots, InvalidIdx if members are scanned
+        u32 SlotMask;
+    };
+
+    struct Index
+    {
+        KeyTable Keys;
+        int NodeCount;
+        int NodeCapacity;
+        IndexNode* Nodes; // Nodes[0] is the root
+        int SlotCount;
+        int SlotCapacity;
+        u32* Slots; // Node indices, InvalidIdx for empty slots
+
+        u32 FindMember(u32 ObjectIdx, u32 KeyId) const;
+        u32 FindMember(u32 ObjectIdx, const char* Key) const;
+        void Release();
+    };
+
+    Index Build(Haversine_Ref0::JsonObject* Root);
+
+    enum StepType
+    {
+        Step_Member,
+        Step_Element,
+        Step_AnyChild,
+    };
+
+    struct PathStep
+    {
+        StepType Type;
+        u32 KeyId; // Step_Member
+        u32 ElementIdx; // Step_Element
+        u32 LastMatch; // Step_Member, child position of the previous match
+    };
+
+    struct Path
+    {
+        int StepCount;
+        PathStep Steps[MaxPathSteps];
+        bool bValid;
+    };
+
+    Path Compile(const Index& Idx, const char* PathText);
+    // Appends the index of every node the path reaches from StartIdx, returns the number appended
+    int Evaluate(const Index& Idx, Path& QueryPath, u32 StartIdx, Haversine_Ref0::DynamicArray<u32>& OutNodes);
+
+    // Builds a nested-arrays.json style document of about TargetMB megabytes and
+    // times Haversine_Ref0::Query chains against compiled paths on it
+    void Benchmark(int TargetMB);
+}
+
+#endif // HAVERSINE_JSONQUERY_H
+
@@ -0,0 +1,622 @@
+#include "haversine_jsonsimd.h"
+#include "haversine_fileio.h"
+#include "haversine_float.h"
+#include "haversine_perf.h"
+#include "haversine_pipeline.h"
+
+// C stdlib headers:
+#include <string.h>
+// Intrinsics:
+#include <immintrin.h>
+#if _MSC_VER
+#include <intrin.h>
+#endif // _MSC_VER
+
+namespace Haversine_JsonSimd
+{
+    using namespace Haversine_Ref0;
+
+    static constexpr int MaxDepth = 1024;
+
+    struct BlockMasks
+    {
+        u64 Quote;
+        u64 Backslash;
+        u64 Structural;
+        u64 WhiteSpace;
+    };
+
+    int CountTrailingZeros(u64 X)
+    {
+#if _MSC_VER
+        unsigned long Result = 0;
+        _BitScanForward64(&Result, X);
+        return (int)Result;
+#else
+        return __builtin_ctzll(X);
+#endif // _MSC_VER
+    }
+
+    // NOTE:
+    //      '{' and '[' (and '}' and ']') only differ in bit 5, so OR-ing 0x20
+    //      into every byte lets one compare match both brackets of a kind
+#if __AVX512BW__
+    BlockMasks ClassifyBlock(const u8* Src)
+    {
+        __m512i Chars = _mm512_loadu_si512((const void*)Src);
+        __m512i Folded = _mm512_or_si512(Chars, _mm512_set1_epi8(0x20));
+
+        BlockMasks Result = {};
+        Result.Quote = _mm512_cmpeq_epi8_mask(Chars, _mm512_set1_epi8('"'));
+        Result.Backslash = _mm512_cmpeq_epi8_mask(Chars, _mm512_set1_epi8('\\'));
+        Result.Structural = _mm512_cmpeq_epi8_mask(Folded, _mm512_set1_epi8('{')) |
+            _mm512_cmpeq_epi8_mask(Folded, _mm512_set1_epi8('}')) |
+            _mm512_cmpeq_epi8_mask(Chars, _mm512_set1_epi8(':')) |
+            _mm512_cmpeq_epi8_mask(Chars, _mm512_set1_epi8(','));
+        Result.WhiteSpace = _mm512_cmpeq_epi8_mask(Chars, _mm512_set1_epi8(' ')) |
+            _mm512_cmpeq_epi8_mask(Chars, _mm512_set1_epi8('\n')) |
+            _mm512_cmpeq_epi8_mask(Chars, _mm512_set1_epi8('\r')) |
+            _mm512_cmpeq_epi8_mask(Chars, _mm512_set1_epi8('\t'));
+        return Result;
+    }
+#elif __AVX2__
+    u64 MatchMask32(__m256i Chars, char C)
+    {
+        return (u32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(Chars, _mm256_set1_epi8(C)));
+    }
+
+    BlockMasks ClassifyBlock(const u8* Src)
+    {
+        BlockMasks Result = {};
+        for (int HalfIdx = 0; HalfIdx < 2; HalfIdx++)
+        {
+            __m256i Chars = _mm256_loadu_si256((const __m256i*)(Src + 32 * HalfIdx));
+            __m256i Folded = _mm256_or_si256(Chars, _mm256_set1_epi8(0x20));
+            int Shift = 32 * HalfIdx;
+
+            Result.Quote |= MatchMask32(Chars, '"') << Shift;
+            Result.Backslash |= MatchMask32(Chars, '\\') << Shift;
+            Result.Structural |= (MatchMask32(Folded, '{') | MatchMask32(Folded, '}') |
+                    MatchMask32(Chars, ':') | MatchMask32(Chars, ',')) << Shift;
+            Result.WhiteSpace |= (MatchMask32(Chars, ' ') | MatchMask32(Chars, '\n') |
+                    MatchMask32(Chars, '\r') | MatchMask32(Chars, '\t')) << Shift;
+        }
+        return Result;
+    }
+#else
+    BlockMasks ClassifyBlock(const u8* Src)
+    {
+        BlockMasks Result = {};
+        for (int ByteIdx = 0; ByteIdx < BlockSize; ByteIdx++)
+        {
+            u64 Bit = 1ull << ByteIdx;
+            u8 C = Src[ByteIdx];
+            u8 Folded = C | 0x20;
+            if (C == '"') { Result.Quote |= Bit; }
+            if (C == '\\') { Result.Backslash |= Bit; }
+            if (Folded == '{' || Folded == '}' || C == ':' || C == ',') { Result.Structural |= Bit; }
+            if (C == ' ' || C == '\n' || C == '\r' || C == '\t') { Result.WhiteSpace |= Bit; }
+        }
+        return Result;
+    }
+#endif // __AVX512BW__
+
+    // Returns the bits of characters escaped by a preceding backslash
+    // Backslashes are rare in our inputs, so this walks them one by one
+    u64 FindEscaped(u64 Backslash, u64* EscapeCarry)
+    {
+        u64 Escaped = 0;
+        if (*EscapeCarry)
+        {
+            Escaped = 1;
+            Backslash &= ~1ull;
+        }
+        *EscapeCarry = 0;
+        while (Backslash)
+        {
+            int BitIdx = CountTrailingZeros(Backslash);
+            if (BitIdx == 63)
+            {
+                *EscapeCarry = 1;
+                Backslash = 0;
+            }
+            else
+            {
+                Escaped |= 2ull << BitIdx;
+                Backslash &= ~(3ull << BitIdx);
+            }
+        }
+        return Escaped;
+    }
+
+    // Bit N of the result is the XOR of bits 0..N of X
+    u64 PrefixXor(u64 X)
+    {
+        X ^= X << 1;
+        X ^= X << 2;
+        X ^= X << 4;
+        X ^= X << 8;
+        X ^= X << 16;
+        X ^= X << 32;
+        return X;
+    }
+
+    bool CharEndsScalar(char C)
+    {
+        return C == ' ' || C == '\n' || C == '\r' || C == '\t' ||
+            C == ',' || C == ':' || C == ']' || C == '}';
+    }
+
+    bool ReadString(char* JsonData, int Size, u32 Pos, char** OutString)
+    {
+        int ReadIdx = Pos + 1;
+        while (ReadIdx < Size && JsonData[ReadIdx] != '"')
+        {
+            ReadIdx += JsonData[ReadIdx] == '\\' ? 2 : 1;
+        }
+        if (ReadIdx >= Size) { return false; }
+
+        // NOTE: Matches Ref0 TryReadString, escapes are kept as-is and "" reads as nullptr
+        int Length = ReadIdx - (Pos + 1);
+        *OutString = nullptr;
+        if (Length > 0)
+        {
+            *OutString = new char[Length + 1];
+            TRACK_ALLOC(Length + 1);
+            memcpy(*OutString, JsonData + Pos + 1, Length);
+            (*OutString)[Length] = '\0';
+        }
+        return true;
+    }
+
+    bool ReadScalar(char* JsonData, int Size, u32 Pos, JsonValue* OutValue)
+    {
+        char* Begin = JsonData + Pos;
+        int Remaining = Size - Pos;
+        int Length = 0;
+        switch (Begin[0])
+        {
+            case 't':
+            {
+                OutValue->Type = JsonType_Bool;
+                OutValue->Bool = true;
+                Length = Remaining >= 4 && memcmp(Begin, "true", 4) == 0 ? 4 : 0;
+            } break;
+            case 'f':
+            {
+                OutValue->Type = JsonType_Bool;
+                OutValue->Bool = false;
+                Length = Remaining >= 5 && memcmp(Begin, "false", 5) == 0 ? 5 : 0;
+            } break;
+            case 'n':
+            {
+                OutValue->Type = JsonType_Null;
+                Length = Remaining >= 4 && memcmp(Begin, "null", 4) == 0 ? 4 : 0;
+            } break;
+            default:
+            {
+                f64 Number = 0.0;
+                bool bInteger = false;
+                const char* NumberEnd = Haversine_Float::ParseF64(Begin, Begin + Remaining, &Number, &bInteger);
+                if (!NumberEnd) { return false; }
+                Length = (int)(NumberEnd - Begin);
+                if (bInteger)
+                {
+                    OutValue->Type = JsonType_NumberInt;
+                    OutValue->NumberInt = strtoll(Begin, nullptr, 10);
+                }
+                else
+                {
+                    OutValue->Type = JsonType_NumberFloat;
+                    OutValue->NumberFloat = Number;
+                }
+            } break;
+        }
+        if (Length == 0) { return false; }
+        return Length == Remaining || CharEndsScalar(Begin[Length]);
+    }
+
+    enum ExpectState
+    {
+        Expect_Value,
+        Expect_ValueOrClose,
+        Expect_Key,
+        Expect_KeyOrClose,
+        Expect_Colon,
+        Expect_CommaOrClose,
+    };
+
+    // Stage 1 state carried from one 64 byte block to the next
+    struct StructuralScanner
+    {
+        u64 EscapeCarry;
+        u64 InStringCarry;
+        u64 SeparatorCarry;
+    };
+
+    StructuralScanner NewStructuralScanner()
+    {
+        // Start of input counts as a separator
+        return StructuralScanner{ 0, 0, 1 };
+    }
+
+    // Appends the index entries for Data[Begin, End), Begin has to be a multiple of BlockSize
+    // and only the last call for an input may end in a partial block
+    void ScanStructural(StructuralScanner* Scanner, const u8* Data, int Begin, int End, StructuralIndex* Index)
+    {
+        u32* Positions = Index->Positions;
+        int Count = Index->Count;
+
+        alignas(64) u8 TailBlock[BlockSize];
+        for (int BlockBegin = Begin; BlockBegin < End; BlockBegin += BlockSize)
+        {
+            const u8* Src = Data + BlockBegin;
+            if (End - BlockBegin < BlockSize)
+            {
+                memset(TailBlock, ' ', BlockSize);
+                memcpy(TailBlock, Src, End - BlockBegin);
+                Src = TailBlock;
+            }
+
+            BlockMasks Masks = ClassifyBlock(Src);
+            u64 Escaped = FindEscaped(Masks.Backslash, &Scanner->EscapeCarry);
+            u64 Quote = Masks.Quote & ~Escaped;
+
+            // Set from an opening quote up to (not including) its closing quote
+            u64 InString = PrefixXor(Quote) ^ Scanner->InStringCarry;
+            Scanner->InStringCarry = (u64)((s64)InString >> 63);
+
+            u64 Structural = Masks.Structural & ~InString;
+            u64 OpenQuote = Quote & InString;
+
+            // Scalars (numbers, true/false/null) start at a non-separator right after a separator
+            u64 Separator = Masks.WhiteSpace | Masks.Structural | Quote;
+            u64 Other = ~(Separator | InString);
+            u64 ScalarStart = Other & ((Separator << 1) | Scanner->SeparatorCarry);
+            Scanner->SeparatorCarry = Separator >> 63;
+
+            u64 IndexBits = Structural | OpenQuote | ScalarStart;
+            while (IndexBits)
+            {
+                Positions[Count++] = BlockBegin + CountTrailingZeros(IndexBits);
+                IndexBits &= IndexBits - 1;
+            }
+        }
+        Index->Count = Count;
+    }
+
+    JsonObject* NewValueSlot(JsonObject* Container)
+    {
+        if (Container->Value.Type == JsonType_Array)
+        {
+            return *Container->Value.List->Add_RetPtr(NewJsonObject());
+        }
+        // Objects: the key was added when it was read, the value goes in the same node
+        return Container->Value.List->Last();
+    }
+
+    JsonObject BuildTreeOrEmpty(char* JsonData, int Size, StructuralIndex& Index)
+    {
+        JsonObject Root = {};
+        if (!BuildTree(JsonData, Size, Index, &Root))
+        {
+            fprintf(stdout, "ERROR: Failed to parse JSON input (%d structural entries)\n", Index.Count);
+            Haversine_Ref0::Release(&Root, true);
+            Root = {};
+            Root.Value.Type = JsonType_Object;
+            Root.Value.List = NewJsonList();
+        }
+        return Root;
+    }
+
+    HList ParsePairs(JsonObject* Root)
+    {
+        JsonObject* Pairs = Query(Root, "pairs");
+        return Pairs ? ParsePairsArray(Pairs) : HList{};
+    }
+
+    bool TreesMatch(JsonObject* A, JsonObject* B)
+    {
+        if ((A->Key == nullptr) != (B->Key == nullptr)) { return false; }
+        if (A->Key && strcmp(A->Key, B->Key) != 0) { return false; }
+        if (A->Value.Type != B->Value.Type) { return false; }
+        switch (A->Value.Type)
+        {
+            case JsonType_Null: { return true; }
+            case JsonType_NumberInt: { return A->Value.NumberInt == B->Value.NumberInt; }
+            case JsonType_NumberFloat: { return memcmp(&A->Value.NumberFloat, &B->Value.NumberFloat, sizeof(f64)) == 0; }
+            case JsonType_Bool: { return A->Value.Bool == B->Value.Bool; }
+            case JsonType_String:
+            {
+                if ((A->Value.String == nullptr) != (B->Value.String == nullptr)) { return false; }
+                return !A->Value.String || strcmp(A->Value.String, B->Value.String) == 0;
+            }
+            case JsonType_Object:
+            case JsonType_Array:
+            {
+                DynamicArray<JsonObject*>* ListA = A->Value.List;
+                DynamicArray<JsonObject*>* ListB = B->Value.List;
+                if (ListA->Num != ListB->Num) { return false; }
+                for (int ItemIdx = 0; ItemIdx < ListA->Num; ItemIdx++)
+                {
+                    if (!TreesMatch((*ListA)[ItemIdx], (*ListB)[ItemIdx])) { return false; }
+                }
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+void Haversine_JsonSimd::StructuralIndex::Release()
+{
+    delete[] Positions;
+    Positions = nullptr;
+    Count = 0;
+}
+
+Haversine_JsonSimd::StructuralIndex Haversine_JsonSimd::BuildStructuralIndex(const u8* Data, int Size)
+{
+    TIME_FUNC_DATA(Size);
+
+    StructuralIndex Result = {};
+    Result.Positions = new u32[Size + 1];
+
+    StructuralScanner Scanner = NewStructuralScanner();
+    ScanStructural(&Scanner, Data, 0, Size, &Result);
+    if (Scanner.InStringCarry)
+    {
+        // Unterminated string: let stage 2 fail on the last string start
+        fprintf(stdout, "ERROR: Unterminated string in JSON input!\n");
+    }
+    return Result;
+}
+
+bool Haversine_JsonSimd::BuildTree(char* JsonData, int Size, StructuralIndex& Index, JsonObject* OutRoot)
+{
+    TIME_FUNC_DATA(Size);
+
+    *OutRoot = {};
+    OutRoot->Value.Type = JsonType_Object;
+    OutRoot->Value.List = NewJsonList();
+
+    // NOTE: Like Ref0, the document root has to be an object
+    if (Index.Count == 0 || JsonData[Index.Positions[0]] != '{') { return false; }
+
+    JsonObject** Stack = new JsonObject*[MaxDepth];
+    int Depth = 0;
+    Stack[Depth++] = OutRoot;
+    ExpectState Expect = Expect_KeyOrClose;
+
+    bool bError = false;
+    int IndexIdx = 1;
+    for (; !bError && Depth > 0 && IndexIdx < Index.Count; IndexIdx++)
+    {
+        u32 Pos = Index.Positions[IndexIdx];
+        char C = JsonData[Pos];
+        JsonObject* Top = Stack[Depth - 1];
+        bool bTopIsObject = Top->Value.Type == JsonType_Object;
+        bool bExpectValue = Expect == Expect_Value || Expect == Expect_ValueOrClose;
+        switch (C)
+        {
+            case '{':
+            case '[':
+            {
+                if (!bExpectValue || Depth >= MaxDepth) { bError = true; break; }
+                JsonObject* Slot = NewValueSlot(Top);
+                Slot->Value.Type = C == '{' ? JsonType_Object : JsonType_Array;
+                Slot->Value.List = NewJsonList();
+                Stack[Depth++] = Slot;
+                Expect = C == '{' ? Expect_KeyOrClose : Expect_ValueOrClose;
+            } break;
+            case '}':
+            case ']':
+            {
+                bool bCloseObject = C == '}';
+                ExpectState EmptyExpect = bCloseObject ? Expect_KeyOrClose : Expect_ValueOrClose;
+                if (bCloseObject != bTopIsObject || (Expect != Expect_CommaOrClose && Expect != EmptyExpect))
+                {
+                    bError = true;
+                    break;
+                }
+                Depth--;
+                Expect = Expect_CommaOrClose;
+            } break;
+            case ':':
+            {
+                if (Expect != Expect_Colon) { bError = true; break; }
+                Expect = Expect_Value;
+            } break;
+            case ',':
+            {
+                if (Expect != Expect_CommaOrClose) { bError = true; break; }
+                Expect = bTopIsObject ? Expect_Key : Expect_Value;
+            } break;
+            case '"':
+            {
+                char* String = nullptr;
+                if (!ReadString(JsonData, Size, Pos, &String)) { bError = true; break; }
+                if (Expect == Expect_Key || Expect == Expect_KeyOrClose)
+                {
+                    JsonObject* Member = *Top->Value.List->Add_RetPtr(NewJsonObject());
+                    Member->Key = String;
+                    Expect = Expect_Colon;
+                }
+                else if (bExpectValue)
+                {
+                    JsonObject* Slot = NewValueSlot(Top);
+                    Slot->Value.Type = JsonType_String;
+                    Slot->Value.String = String;
+                    Expect = Expect_CommaOrClose;
+                }
+                else
+                {
+                    if (String) { TRACK_FREE(strlen(String) + 1); }
+                    delete[] String;
+                    bError = true;
+                }
+            } break;
+            default:
+            {
+                if (!bExpectValue) { bError = true; break; }
+                JsonObject* Slot = NewValueSlot(Top);
+                if (!ReadScalar(JsonData, Size, Pos, &Slot->Value)) { bError = true; break; }
+                Expect = Expect_CommaOrClose;
+            } break;
+        }
+    }
+    // Anything left over after the root object closed is an error too
+    if (Depth != 0 || IndexIdx != Index.Count) { bError = true; }
+
+    delete[] Stack;
+    return !bError;
+}
+
+Haversine_Ref0::JsonObject Haversine_JsonSimd::Parse(char* JsonData, int Size)
+{
+    // Input is usually read with a null appended for Ref0, that is not part of the document
+    while (Size > 0 && JsonData[Size - 1] == '\0') { Size--; }
+
+    StructuralIndex Index = BuildStructuralIndex((u8*)JsonData, Size);
+    JsonObject Root = BuildTreeOrEmpty(JsonData, Size, Index);
+    Index.Release();
+    return Root;
+}
+
+HList Haversine_JsonSimd::ParseJSON(FileContentsT& InputFile)
+{
+    HList Result = {};
+    if (nullptr == InputFile.Data) { return Result; }
+
+    JsonObject Root = Parse((char*)InputFile.Data, InputFile.Size);
+    Result = ParsePairs(&Root);
+    Haversine_Ref0::Release(&Root, true);
+    return Result;
+}
+
+HList Haversine_JsonSimd::ReadFileAsJSON(const char* FileName)
+{
+    TIME_FUNC();
+
+    if (Haversine_Pipeline::DefaultQueueDepth > 0)
+    {
+        return ReadFileAsJSONPipelined(FileName, Haversine_Pipeline::DefaultChunkSize, Haversine_Pipeline::DefaultQueueDepth);
+    }
+
+    Haversine_FileIO::MappedFile Input = Haversine_FileIO::Load(FileName, Haversine_FileIO::DefaultLoadMode);
+    HList Result = Haversine_JsonSimd::ParseJSON(Input.Contents);
+    Input.Release();
+
+    return Result;
+}
+
+HList Haversine_JsonSimd::ReadFileAsJSONPipelined(const char* FileName, int ChunkSize, int QueueDepth)
+{
+    TIME_FUNC();
+
+    Haversine_Pipeline::ChunkReader Reader = {};
+    if (!Reader.Open(FileName, ChunkSize, QueueDepth)) { return HList{}; }
+    // The whole document is kept for stage 2, and it is int sized like FileContentsT
+    if (Reader.FileSize >= INT32_MAX)
+    {
+        fprintf(stdout, "ERROR: Can't read %s (%llu bytes), use -stream for files over 2GB!\n", FileName, Reader.FileSize);
+        Reader.Close();
+        return HList{};
+    }
+
+    int Size = (int)Reader.FileSize;
+    FileContentsT Input = { Size + 1, new u8[Size + 1] };
+    TRACK_ALLOC(Size + 1);
+    Input.Data[Size] = '\0';
+    StructuralIndex Index = { 0, new u32[Size + 1] };
+    StructuralScanner Scanner = NewStructuralScanner();
+
+    // Stage 1 runs on each chunk while the reader fills the next ones, stage 2 needs all of it
+    Reader.Start(Input.Data);
+    Haversine_Pipeline::Chunk Chunk = {};
+    while (Reader.Acquire(&Chunk))
+    {
+        TIME_BLOCK_DATA(Pipeline_Stage1, Chunk.Size);
+        ScanStructural(&Scanner, Input.Data, (int)Chunk.Offset, (int)Chunk.Offset + Chunk.Size, &Index);
+        Reader.Recycle();
+    }
+
+    HList Result = {};
+    if (Reader.Close())
+    {
+        if (Scanner.InStringCarry) { fprintf(stdout, "ERROR: Unterminated string in JSON input!\n"); }
+        JsonObject Root = BuildTreeOrEmpty((char*)Input.Data, Size, Index);
+        Result = ParsePairs(&Root);
+        Haversine_Ref0::Release(&Root, true);
+    }
+    else
+    {
+        fprintf(stdout, "ERROR: Failed to read all of %s!\n", FileName);
+    }
+
+    Index.Release();
+    Input.Release();
+    return Result;
+}
+
+void Haversine_JsonSimd::Benchmark(const char* FileName)
+{
+    TIME_FUNC();
+
+    FileContentsT Input = {};
+    Input.Read(FileName, true);
+    if (!Input.Data) { return; }
+
+    static constexpr int RepeatCount = 5;
+    u64 Ref0Best = UINT64_MAX;
+    u64 SimdBest = UINT64_MAX;
+    u64 IndexBest = UINT64_MAX;
+    int IndexCount = 0;
+    JsonObject Ref0Root = {};
+    JsonObject SimdRoot = {};
+    for (int RepeatIdx = 0; RepeatIdx < RepeatCount; RepeatIdx++)
+    {
+        bool bLast = RepeatIdx == RepeatCount - 1;
+
+        u64 Begin = Perf::ReadCPUTimer();
+        JsonObject Root = Haversine_Ref0::Parse((char*)Input.Data, Input.Size);
+        u64 Elapsed = Perf::ReadCPUTimer() - Begin;
+        if (Elapsed < Ref0Best) { Ref0Best = Elapsed; }
+        if (bLast) { Ref0Root = Root; }
+        else { Haversine_Ref0::Release(&Root, true); }
+
+        Begin = Perf::ReadCPUTimer();
+        Root = Parse((char*)Input.Data, Input.Size);
+        Elapsed = Perf::ReadCPUTimer() - Begin;
+        if (Elapsed < SimdBest) { SimdBest = Elapsed; }
+        if (bLast) { SimdRoot = Root; }
+        else { Haversine_Ref0::Release(&Root, true); }
+
+        // Stage 1 on its own, the rest of the Simd time is building the tree
+        Begin = Perf::ReadCPUTimer();
+        StructuralIndex Index = BuildStructuralIndex(Input.Data, Input.Size);
+        Elapsed = Perf::ReadCPUTimer() - Begin;
+        if (Elapsed < IndexBest) { IndexBest = Elapsed; }
+        IndexCount = Index.Count;
+        Index.Release();
+    }
+
+    bool bMatch = TreesMatch(&Ref0Root, &SimdRoot);
+    HList Pairs = {};
+    JsonObject* PairsObject = Query(&SimdRoot, "pairs");
+    if (PairsObject) { Pairs = ParsePairsArray(PairsObject); }
+
+    f64 Bytes = (f64)Input.Size;
+    fprintf(stdout, "%s (%d bytes, %d pairs):\n", FileName, Input.Size, Pairs.Count);
+    fprintf(stdout, "\tRef0 Parse: %.2f cycles/byte\n", (f64)Ref0Best / Bytes);
+    fprintf(stdout, "\tSimd Parse: %.2f cycles/byte (%.2fx), trees %s\n",
+            (f64)SimdBest / Bytes, (f64)Ref0Best / (f64)SimdBest, bMatch ? "match" : "DO NOT MATCH");
+    fprintf(stdout, "\t    Stage 1: %.2f cycles/byte, %d index entries\n", (f64)IndexBest / Bytes, IndexCount);
+
+    TRACK_FREE(sizeof(HPair) * Pairs.Count);
+    delete[] Pairs.Data;
+    Haversine_Ref0::Release(&Ref0Root, true);
+    Haversine_Ref0::Release(&SimdRoot, true);
+    Input.Release();
+}
+
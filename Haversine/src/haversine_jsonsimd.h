@@ -0,0 +1,47 @@
+#ifndef HAVERSINE_JSONSIMD_H
+#define HAVERSINE_JSONSIMD_H
+
+/*
+ * NOTE:
+ *      Two-stage replacement for Haversine_Ref0::Parse
+ *      Stage 1 classifies the input 64 bytes at a time with SIMD compares,
+ *      turns the results into bitmasks (quotes, backslashes, structural
+ *      characters, whitespace), resolves escapes and in-string regions with
+ *      bit tricks, and writes the offset of every structural character,
+ *      string start and scalar start into a flat index
+ *      Stage 2 walks that index and builds the same JsonObject tree Ref0
+ *      does, so Query/ParsePairsArray work on either unchanged
+ */
+
+#include "haversine_common.h"
+#include "haversine_ref0.h"
+
+namespace Haversine_JsonSimd
+{
+    static constexpr int BlockSize = 64;
+
+    struct StructuralIndex
+    {
+        int Count;
+        u32* Positions;
+
+        void Release();
+    };
+
+    StructuralIndex BuildStructuralIndex(const u8* Data, int Size);
+    bool BuildTree(char* JsonData, int Size, StructuralIndex& Index, Haversine_Ref0::JsonObject* OutRoot);
+
+    // Reads the number/true/false/null starting at JsonData[Pos], shared with Haversine_JsonDom
+    bool ReadScalar(char* JsonData, int Size, u32 Pos, Haversine_Ref0::JsonValue* OutValue);
+
+    Haversine_Ref0::JsonObject Parse(char* JsonData, int Size);
+    HList ParseJSON(Haversine_Ref0::FileContentsT& InputFile);
+    HList ReadFileAsJSON(const char* FileName);
+    // Reads on a background thread (Haversine_Pipeline) and runs stage 1 on each chunk as it arrives
+    HList ReadFileAsJSONPipelined(const char* FileName, int ChunkSize, int QueueDepth);
+
+    void Benchmark(const char* FileName);
+}
+
+#endif // HAVERSINE_JSONSIMD_H
+
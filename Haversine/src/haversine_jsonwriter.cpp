@@ -0,0 +1,402 @@
+#include "haversine_jsonwriter.h"
+#include "haversine_perf.h"
+#include "haversine_float.h"
+#include "haversine_ref0.h"
+#include "haversine_threads.h"
+#include "haversine_generate.h"
+#include "haversine_schema.h"
+#include "haversine_validate.h"
+
+// C stdlib headers:
+#include <string.h>
+// C++ stdlib headers:
+#include <thread>
+
+namespace Haversine_JsonWriter
+{
+    // Everything around the 4 numbers of the last (longest) line: 8 spaces, the keys, " } ]\n"
+    static constexpr int MaxPairLength = 4 * Haversine_Float::MaxFormattedLength + 64;
+    static constexpr int MaxBlockSize = PairsPerBlock * MaxPairLength;
+
+    // Smallest round, so with one thread the writer thread still gets a few blocks at a time
+    static constexpr int MinRoundBlockCount = 8;
+
+    struct BlockBuffer
+    {
+        char* Data;
+        size_t Size;
+        int Count;
+        HPair* Pairs; // Generated pairs, GenStream only
+        f64* Distances; // Reference distance of each pair, -answers only
+        f64 Sum; // Of the pairs' distances, GenStream and -answers only
+    };
+
+    struct FormatContext
+    {
+        const HPair* Pairs; // nullptr => every block generates its pairs with Gen
+        const Haversine_Generate::Generator* Gen;
+        u64 Count;
+        u64 FirstBlockIdx;
+        BlockBuffer* Buffers; // One per block of the round
+    };
+
+    template <int Length>
+    char* AppendText(char* At, const char (&Text)[Length])
+    {
+        memcpy(At, Text, Length - 1);
+        return At + Length - 1;
+    }
+
+    // Laid out exactly like Haversine_Ref0::WriteDataAsJSON, bLast closes the array after the last pair
+    char* FormatPairs(const HPair* Pairs, int Count, bool bLast, char* Out)
+    {
+        char* At = Out;
+        for (int PairIdx = 0; PairIdx < Count; PairIdx++)
+        {
+            const HPair& Pair = Pairs[PairIdx];
+            At = AppendText(At, "        { \"X0\": ");
+            At = Haversine_Float::FormatF64(Pair.X0, At);
+            At = AppendText(At, ", \"Y0\": ");
+            At = Haversine_Float::FormatF64(Pair.Y0, At);
+            At = AppendText(At, ", \"X1\": ");
+            At = Haversine_Float::FormatF64(Pair.X1, At);
+            At = AppendText(At, ", \"Y1\": ");
+            At = Haversine_Float::FormatF64(Pair.Y1, At);
+            if (bLast && PairIdx == Count - 1) { At = AppendText(At, " } ]\n"); }
+            else { At = AppendText(At, " },\n"); }
+        }
+        return At;
+    }
+
+    void FormatBlockTask(void* Context, int TaskIdx, int ThreadIdx)
+    {
+        (void)ThreadIdx;
+        FormatContext* Format = (FormatContext*)Context;
+        BlockBuffer* Buffer = Format->Buffers + TaskIdx;
+
+        u64 BeginIdx = (Format->FirstBlockIdx + TaskIdx) * PairsPerBlock;
+        int Count = Format->Count - BeginIdx > PairsPerBlock ? PairsPerBlock : (int)(Format->Count - BeginIdx);
+        TIME_FUNC_DATA((u64)Count * sizeof(HPair));
+        const HPair* Pairs = nullptr;
+        if (Format->Pairs)
+        {
+            Pairs = Format->Pairs + BeginIdx;
+        }
+        else
+        {
+            Haversine_Generate::GeneratePairs(*Format->Gen, BeginIdx, Count, Buffer->Pairs);
+            Pairs = Buffer->Pairs;
+        }
+        if (!Format->Pairs || Buffer->Distances)
+        {
+            f64 Sum = 0.0;
+            for (int PairIdx = 0; PairIdx < Count; PairIdx++)
+            {
+                f64 Distance = Haversine_Ref0::CalculateHaversine(Pairs[PairIdx]);
+                if (Buffer->Distances) { Buffer->Distances[PairIdx] = Distance; }
+                Sum += Distance;
+            }
+            Buffer->Sum = Sum;
+        }
+        Buffer->Count = Count;
+        Buffer->Size = FormatPairs(Pairs, Count, BeginIdx + Count == Format->Count, Buffer->Data) - Buffer->Data;
+    }
+
+    void WriteBuffers(FILE* FileHandle, FILE* AnswersHandle, const BlockBuffer* Buffers, int BlockCount, bool* bOutOk)
+    {
+        for (int BlockIdx = 0; BlockIdx < BlockCount && *bOutOk; BlockIdx++)
+        {
+            const BlockBuffer& Buffer = Buffers[BlockIdx];
+            *bOutOk = fwrite(Buffer.Data, 1, Buffer.Size, FileHandle) == Buffer.Size &&
+                (!AnswersHandle || Haversine_Validate::WriteAnswers(AnswersHandle, Buffer.Distances, Buffer.Count));
+        }
+    }
+
+    // Formats every block of Pairs (or generated by Gen) on ThreadCount threads, written in order by a writer thread
+    // Memory is 2 rounds of blocks whatever Count is, OutSum gets the generated distances summed block by block
+    // AnswersHandle (optional) gets every pair's distance, in the same blocks
+    bool WritePairs(FILE* FileHandle, FILE* AnswersHandle, const HPair* Pairs, const Haversine_Generate::Generator* Gen, u64 Count,
+            int ThreadCount, f64* OutSum)
+    {
+        u64 BlockCount = (Count + PairsPerBlock - 1) / PairsPerBlock;
+        if (ThreadCount < 1) { ThreadCount = Haversine_Threads::GetHardwareThreadCount(); }
+        int RoundBlockCount = ThreadCount < MinRoundBlockCount ? MinRoundBlockCount : ThreadCount;
+        if ((u64)RoundBlockCount > BlockCount) { RoundBlockCount = BlockCount > 1 ? (int)BlockCount : 1; }
+        if (ThreadCount > RoundBlockCount) { ThreadCount = RoundBlockCount; }
+
+        // Two sets of buffers, a round is formatted into one while the other is written
+        BlockBuffer* Buffers = new BlockBuffer[2 * RoundBlockCount];
+        for (int BufferIdx = 0; BufferIdx < 2 * RoundBlockCount; BufferIdx++)
+        {
+            Buffers[BufferIdx] = { new char[MaxBlockSize], 0, 0, Pairs ? nullptr : new HPair[PairsPerBlock],
+                AnswersHandle ? new f64[PairsPerBlock] : nullptr, 0.0 };
+        }
+
+        Haversine_Threads::WorkerPool& Pool = Haversine_Threads::AcquirePool(ThreadCount);
+        std::thread Writer;
+        bool bWriteOk = true; // Only touched by the writer thread while it runs
+        f64 Sum = 0.0;
+        u64 RoundIdx = 0;
+        for (u64 FirstBlockIdx = 0; FirstBlockIdx < BlockCount; FirstBlockIdx += RoundBlockCount, RoundIdx++)
+        {
+            BlockBuffer* RoundBuffers = Buffers + (RoundIdx & 1) * RoundBlockCount;
+            int TaskCount = BlockCount - FirstBlockIdx < (u64)RoundBlockCount ? (int)(BlockCount - FirstBlockIdx) : RoundBlockCount;
+            FormatContext Context = { Pairs, Gen, Count, FirstBlockIdx, RoundBuffers };
+            Pool.Run(TaskCount, FormatBlockTask, &Context);
+            for (int BlockIdx = 0; BlockIdx < TaskCount; BlockIdx++) { Sum += RoundBuffers[BlockIdx].Sum; }
+
+            // The previous round's writes have to finish before these start (order) and before its buffers are reused
+            if (Writer.joinable()) { Writer.join(); }
+            if (!bWriteOk) { break; }
+            Writer = std::thread(WriteBuffers, FileHandle, AnswersHandle, RoundBuffers, TaskCount, &bWriteOk);
+        }
+        if (Writer.joinable()) { Writer.join(); }
+
+        for (int BufferIdx = 0; BufferIdx < 2 * RoundBlockCount; BufferIdx++)
+        {
+            delete[] Buffers[BufferIdx].Data;
+            delete[] Buffers[BufferIdx].Pairs;
+            delete[] Buffers[BufferIdx].Distances;
+        }
+        delete[] Buffers;
+
+        if (OutSum) { *OutSum = Sum; }
+        return bWriteOk;
+    }
+
+    // AnswersFileName (optional) gets the Haversine_Validate answers for the same pairs
+    bool WriteDocument(const char* FileName, const char* AnswersFileName, const HPair* Pairs, const Haversine_Generate::Generator* Gen,
+            u64 Count, int ThreadCount, f64* OutSum)
+    {
+        FILE* FileHandle = nullptr;
+        fopen_s(&FileHandle, FileName, "wb");
+        if (!FileHandle)
+        {
+            fprintf(stdout, "ERROR: Could not open file %s for write!\n", FileName);
+            return false;
+        }
+        FILE* AnswersHandle = nullptr;
+        if (AnswersFileName)
+        {
+            AnswersHandle = Haversine_Validate::BeginAnswers(AnswersFileName, Count);
+            if (!AnswersHandle)
+            {
+                fclose(FileHandle);
+                return false;
+            }
+            // Whole blocks of distances too
+            setvbuf(AnswersHandle, nullptr, _IONBF, 0);
+        }
+        // Every fwrite is a whole block, the CRT buffer would only add a copy
+        setvbuf(FileHandle, nullptr, _IONBF, 0);
+
+        static constexpr char Header[] = "{\n    \"pairs\": [\n";
+        static constexpr char EmptyPairs[] = "    ]\n";
+        static constexpr char Footer[] = "}\n";
+        bool bOk = fwrite(Header, 1, sizeof(Header) - 1, FileHandle) == sizeof(Header) - 1;
+        if (Count == 0) { bOk = bOk && fwrite(EmptyPairs, 1, sizeof(EmptyPairs) - 1, FileHandle) == sizeof(EmptyPairs) - 1; }
+        f64 Sum = 0.0;
+        bOk = bOk && WritePairs(FileHandle, AnswersHandle, Pairs, Gen, Count, ThreadCount, &Sum);
+        bOk = bOk && fwrite(Footer, 1, sizeof(Footer) - 1, FileHandle) == sizeof(Footer) - 1;
+        bOk = fclose(FileHandle) == 0 && bOk;
+        if (!bOk) { fprintf(stdout, "ERROR: Failed writing to file %s!\n", FileName); }
+        if (AnswersHandle && !Haversine_Validate::FinishAnswers(AnswersHandle, Count, Sum, bOk))
+        {
+            if (bOk) { fprintf(stdout, "ERROR: Failed writing to file %s!\n", AnswersFileName); }
+            bOk = false;
+        }
+        if (OutSum) { *OutSum = Sum; }
+        return bOk;
+    }
+
+    // How many of the coordinates in B differ from A, or -1 if the counts don't match
+    s64 CountMismatches(HList A, HList B)
+    {
+        if (A.Count != B.Count) { return -1; }
+        const f64* ValuesA = (const f64*)A.Data;
+        const f64* ValuesB = (const f64*)B.Data;
+        s64 Result = 0;
+        for (s64 Idx = 0; Idx < (s64)A.Count * 4; Idx++)
+        {
+            Result += memcmp(ValuesA + Idx, ValuesB + Idx, sizeof(f64)) != 0 ? 1 : 0;
+        }
+        return Result;
+    }
+
+    struct ReadBackResult
+    {
+        int Size;
+        s64 MismatchCount; // -1 => pair count differs
+    };
+
+    ReadBackResult ReadBack(HList List, const char* FileName)
+    {
+        Haversine_Ref0::FileContentsT Input = {};
+        Input.Read(FileName, true);
+        HList ReadList = {};
+        ReadBackResult Result = { Input.Size - 1, -1 };
+        if (Input.Data && Haversine_Schema::TryParsePairs((const char*)Input.Data, Input.Size, &ReadList))
+        {
+            Result.MismatchCount = CountMismatches(List, ReadList);
+        }
+        TRACK_FREE(sizeof(HPair) * ReadList.Count);
+        delete[] ReadList.Data;
+        Input.Release();
+        return Result;
+    }
+
+    void PrintReadBack(s64 MismatchCount, int Count)
+    {
+        if (MismatchCount == 0) { fprintf(stdout, "reads back bit-identical\n"); }
+        else if (MismatchCount < 0) { fprintf(stdout, "DOES NOT read back as %d pairs\n", Count); }
+        else { fprintf(stdout, "%lld of %lld coordinates read back different\n", MismatchCount, (s64)Count * 4); }
+    }
+}
+
+bool Haversine_JsonWriter::WriteDataAsJSON(HList List, const char* FileName, int ThreadCount)
+{
+    TIME_FUNC();
+
+    return WriteDocument(FileName, nullptr, List.Data, nullptr, (u64)List.Count, ThreadCount, nullptr);
+}
+
+// NOTE:
+//      Timed writes go to a new file every run: truncating the last one instead can make
+//      the write wait on its writeback (e.g. ext4 auto_da_alloc), which is the file system's
+//      cost, not the writer's
+void Haversine_JsonWriter::PrepareRewrite(const char* FileName)
+{
+    remove(FileName);
+}
+
+void Haversine_JsonWriter::Gen(int Seed, int Count, bool bClustered, int ThreadCount, bool bAnswers)
+{
+    TIME_FUNC();
+
+    static constexpr int FileNameMaxSize = 96;
+    char JSONFileName[FileNameMaxSize];
+    char AnswersFileName[FileNameMaxSize];
+    Haversine_Ref0::GetInputDataFileName(JSONFileName, FileNameMaxSize, Seed, Count, bClustered);
+    Haversine_Validate::GetAnswersFileName(AnswersFileName, FileNameMaxSize, JSONFileName);
+
+    // Ref0's sequential engine unless -threads asks for the counter-based generator
+    HList PairList = {};
+    if (ThreadCount > 0)
+    {
+        PairList = Haversine_Generate::GenerateData(Seed, Count, bClustered, ThreadCount);
+        fprintf(stdout, "Generated with the counter-based generator, pairs differ from Ref0's for the same seed\n");
+    }
+    else if (bClustered) { PairList = Haversine_Ref0::GenerateDataClustered(Seed, Count); }
+    else { PairList = Haversine_Ref0::GenerateDataUniform(Seed, Count); }
+
+    if (WriteDocument(JSONFileName, bAnswers ? AnswersFileName : nullptr, PairList.Data, nullptr, (u64)Count, ThreadCount, nullptr))
+    {
+        fprintf(stdout, "Wrote JSON data to file %s\n", JSONFileName);
+        if (bAnswers) { fprintf(stdout, "Wrote reference answers to file %s\n", AnswersFileName); }
+    }
+
+    f64 HvAvg = Haversine_Ref0::CalculateAverage(PairList);
+    fprintf(stdout, "\tAverage for generated data: %f\n", HvAvg);
+
+    {
+        TIME_BLOCK(Gen_Cleanup);
+        TRACK_FREE(sizeof(HPair) * PairList.Count);
+        delete[] PairList.Data;
+    }
+}
+
+void Haversine_JsonWriter::GenStream(u64 Seed, u64 Count, bool bClustered, int ThreadCount, bool bAnswers)
+{
+    TIME_FUNC();
+
+    static constexpr int FileNameMaxSize = 96;
+    char JSONFileName[FileNameMaxSize];
+    char AnswersFileName[FileNameMaxSize];
+    (void)sprintf_s(JSONFileName, FileNameMaxSize, "hvpairs_seed%llu_count%llu_%s.json", Seed, Count, bClustered ? "clustered" : "uniform");
+    Haversine_Validate::GetAnswersFileName(AnswersFileName, FileNameMaxSize, JSONFileName);
+
+    Haversine_Generate::Generator Gen = Haversine_Generate::MakeGenerator(Seed, bClustered);
+    f64 Sum = 0.0;
+    if (WriteDocument(JSONFileName, bAnswers ? AnswersFileName : nullptr, nullptr, &Gen, Count, ThreadCount, &Sum))
+    {
+        fprintf(stdout, "Wrote JSON data to file %s (streamed %llu pairs)\n", JSONFileName, Count);
+        if (bAnswers) { fprintf(stdout, "Wrote reference answers to file %s\n", AnswersFileName); }
+    }
+
+    f64 HvAvg = Count ? Sum / (f64)Count : 0.0;
+    fprintf(stdout, "\tAverage for generated data: %f\n", HvAvg);
+}
+
+void Haversine_JsonWriter::Benchmark(int Seed, int Count, int MaxThreadCount)
+{
+    TIME_FUNC();
+
+    static constexpr int RepeatCount = 3;
+    static constexpr const char* FileName = "hvwritebench.json";
+    u64 CPUFreq = Perf::EstimateCPUFreq();
+    f64 Megabyte = 1024.0 * 1024.0;
+
+    HList List = Haversine_Ref0::GenerateDataClustered(Seed, Count);
+    int BlockCount = (Count + PairsPerBlock - 1) / PairsPerBlock;
+    fprintf(stdout, "Writing %d generated pairs (seed %d) to %s, best of %d:\n", Count, Seed, FileName, RepeatCount);
+
+    // Ref0 is slow enough that one run says enough
+    PrepareRewrite(FileName);
+    u64 Begin = Perf::ReadCPUTimer();
+    Haversine_Ref0::WriteDataAsJSON(List, FileName);
+    u64 Ref0Elapsed = Perf::ReadCPUTimer() - Begin;
+    ReadBackResult Ref0Result = ReadBack(List, FileName);
+    fprintf(stdout, "\tRef0 fprintf:          %8.2f cycles/pair, %7.1f MB/s, %.1f MB, ",
+            (f64)Ref0Elapsed / (f64)Count, (f64)Ref0Result.Size / Megabyte / ((f64)Ref0Elapsed / (f64)CPUFreq),
+            (f64)Ref0Result.Size / Megabyte);
+    PrintReadBack(Ref0Result.MismatchCount, Count);
+
+    int ThreadCount = 1;
+    for (;;)
+    {
+        // Formatting alone, into one buffer per thread, to tell it apart from the file system
+        Haversine_Threads::WorkerPool& Pool = Haversine_Threads::AcquirePool(ThreadCount);
+        BlockBuffer* Buffers = new BlockBuffer[ThreadCount];
+        for (int BufferIdx = 0; BufferIdx < ThreadCount; BufferIdx++) { Buffers[BufferIdx] = { new char[MaxBlockSize], 0, 0, nullptr, nullptr, 0.0 }; }
+        u64 FormatBest = UINT64_MAX;
+        for (int RepeatIdx = 0; RepeatIdx < RepeatCount; RepeatIdx++)
+        {
+            Begin = Perf::ReadCPUTimer();
+            for (int FirstBlockIdx = 0; FirstBlockIdx < BlockCount; FirstBlockIdx += ThreadCount)
+            {
+                FormatContext Context = { List.Data, nullptr, (u64)Count, (u64)FirstBlockIdx, Buffers };
+                Pool.Run(BlockCount - FirstBlockIdx < ThreadCount ? BlockCount - FirstBlockIdx : ThreadCount, FormatBlockTask, &Context);
+            }
+            u64 Elapsed = Perf::ReadCPUTimer() - Begin;
+            if (Elapsed < FormatBest) { FormatBest = Elapsed; }
+        }
+        for (int BufferIdx = 0; BufferIdx < ThreadCount; BufferIdx++) { delete[] Buffers[BufferIdx].Data; }
+        delete[] Buffers;
+
+        u64 Best = UINT64_MAX;
+        bool bOk = true;
+        for (int RepeatIdx = 0; RepeatIdx < RepeatCount && bOk; RepeatIdx++)
+        {
+            PrepareRewrite(FileName);
+            Begin = Perf::ReadCPUTimer();
+            bOk = WriteDataAsJSON(List, FileName, ThreadCount);
+            u64 Elapsed = Perf::ReadCPUTimer() - Begin;
+            if (Elapsed < Best) { Best = Elapsed; }
+        }
+        if (!bOk) { break; }
+
+        ReadBackResult Result = ReadBack(List, FileName);
+        f64 Size = (f64)Result.Size;
+        fprintf(stdout, "\tJsonWriter %3d threads: %8.2f cycles/pair, %7.1f MB/s, %.1f MB, %.2fx of Ref0 (format only %.2f cycles/pair, %.1f MB/s), ",
+                ThreadCount, (f64)Best / (f64)Count, Size / Megabyte / ((f64)Best / (f64)CPUFreq), Size / Megabyte,
+                (f64)Ref0Elapsed / (f64)Best, (f64)FormatBest / (f64)Count, Size / Megabyte / ((f64)FormatBest / (f64)CPUFreq));
+        PrintReadBack(Result.MismatchCount, Count);
+
+        if (ThreadCount >= MaxThreadCount) { break; }
+        ThreadCount = ThreadCount * 2 < MaxThreadCount ? ThreadCount * 2 : MaxThreadCount;
+    }
+
+    remove(FileName);
+    TRACK_FREE(sizeof(HPair) * List.Count);
+    delete[] List.Data;
+}
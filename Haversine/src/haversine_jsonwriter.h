@@ -0,0 +1,46 @@
+#ifndef HAVERSINE_JSONWRITER_H
+#define HAVERSINE_JSONWRITER_H
+
+/*
+ * NOTE:
+ *      Replacement for Haversine_Ref0::WriteDataAsJSON, which spends nearly all of
+ *      its time in one fprintf("%f") per pair through a text mode FILE*
+ *      Same layout (so Haversine_Schema's canonical path still matches), but:
+ *          - Coordinates come from Haversine_Float::FormatF64, the shortest text
+ *            that reads back as the same double, where "%f" rounds to 6 digits
+ *          - Pairs are formatted in blocks of PairsPerBlock into reusable buffers,
+ *            each written with one fwrite on an unbuffered FILE*, so a block is one
+ *            write call instead of going through the CRT's 4KB buffer
+ *          - Blocks are formatted in rounds on a WorkerPool of ThreadCount threads,
+ *            one buffer each, and written in block order by a writer thread while
+ *            the next round is formatted into the other set of buffers
+ *      GenStream does the same with each block generating its own pairs first
+ *      (Haversine_Generate, by pair index) and summing their distances, so nothing
+ *      but the two rounds of buffers is ever in memory: 64-bit counts, one pass
+ *      bAnswers also writes each block's reference distances to a Haversine_Validate
+ *      answers file by the writer thread, in the same pass
+ *      The file is opened in binary mode, lines end in \n on every platform
+ */
+
+#include "haversine_common.h"
+
+namespace Haversine_JsonWriter
+{
+    static constexpr int PairsPerBlock = 4096;
+
+    // ThreadCount 0 => GetHardwareThreadCount(), returns false if the file couldn't be written
+    bool WriteDataAsJSON(HList List, const char* FileName, int ThreadCount);
+    // Removes FileName ahead of a timed WriteDataAsJSON to it (Benchmark, reptest)
+    void PrepareRewrite(const char* FileName);
+    // Haversine_Ref0::Gen written with WriteDataAsJSON above, so the file holds the same pairs as all/Ref0::Gen's
+    // ThreadCount > 0 => Haversine_Generate's pairs instead (different values for the same seed), generated on ThreadCount threads
+    // bAnswers => also Haversine_Validate answers, named by GetAnswersFileName
+    void Gen(int Seed, int Count, bool bClustered, int ThreadCount, bool bAnswers);
+    // Gen without the HList, for counts past int and RAM (gen -stream), always Haversine_Generate's pairs
+    // The average is summed block by block, so it can differ from calc's in the last digits
+    void GenStream(u64 Seed, u64 Count, bool bClustered, int ThreadCount, bool bAnswers);
+    // Ref0 writer against this one on 1, 2, 4, ... MaxThreadCount threads, and whether each file reads back bit-identical
+    void Benchmark(int Seed, int Count, int MaxThreadCount);
+}
+
+#endif // HAVERSINE_JSONWRITER_H
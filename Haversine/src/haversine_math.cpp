@@ -0,0 +1,167 @@
+#include "haversine_math.h"
+#include "haversine_perf.h"
+
+// C stdlib headers:
+#include <string.h>
+
+namespace Haversine_Math
+{
+    static constexpr int HarnessSampleCount = 1 << 20;
+    static constexpr int HarnessRepeatCount = 4;
+
+    struct CRTSin { static f64 Eval(f64 X) { return sin(X); } };
+    struct CRTCos { static f64 Eval(f64 X) { return cos(X); } };
+    struct CRTAsin { static f64 Eval(f64 X) { return asin(X); } };
+    struct CRTSqrt { static f64 Eval(f64 X) { return sqrt(X); } };
+
+    struct ApproxSin { template <typename T> static T Eval(T X) { return Sin(X); } };
+    struct ApproxCos { template <typename T> static T Eval(T X) { return Cos(X); } };
+    struct ApproxAsin { template <typename T> static T Eval(T X) { return Asin(X); } };
+    struct ApproxSqrt { template <typename T> static T Eval(T X) { return Sqrt(X); } };
+
+    struct HarnessResult
+    {
+        u64 CRTCycles;
+        u64 ScalarCycles;
+        u64 WideCycles;
+        u64 MaxULPScalar;
+        u64 MaxULPWide;
+        f64 MaxAbsError;
+        f64 MaxRelError;
+        f64 WorstInput;
+    };
+
+    // Distance between two doubles in units in the last place
+    u64 ULPDistance(f64 A, f64 B)
+    {
+        s64 IntA = 0;
+        s64 IntB = 0;
+        memcpy(&IntA, &A, sizeof(f64));
+        memcpy(&IntB, &B, sizeof(f64));
+        // Remap negative values so integer order matches float order
+        if (IntA < 0) { IntA = INT64_MIN - IntA; }
+        if (IntB < 0) { IntB = INT64_MIN - IntB; }
+        return IntA > IntB ? (u64)IntA - (u64)IntB : (u64)IntB - (u64)IntA;
+    }
+
+    template <typename CRTOp>
+    u64 TimeCRT(const f64* Input, f64* Output, int Count)
+    {
+        u64 Begin = Perf::ReadCPUTimer();
+        for (int Idx = 0; Idx < Count; Idx++)
+        {
+            Output[Idx] = CRTOp::Eval(Input[Idx]);
+        }
+        return Perf::ReadCPUTimer() - Begin;
+    }
+
+    template <typename T, typename ApproxOp>
+    u64 TimeApprox(const f64* Input, f64* Output, int Count)
+    {
+        u64 Begin = Perf::ReadCPUTimer();
+        for (int Idx = 0; Idx + T::Width <= Count; Idx += T::Width)
+        {
+            ApproxOp::Eval(T::Load(Input + Idx)).Store(Output + Idx);
+        }
+        return Perf::ReadCPUTimer() - Begin;
+    }
+
+    template <typename CRTOp, typename ApproxOp>
+    HarnessResult RunDomain(f64 Min, f64 Max, f64* Input, f64* Expected, f64* Scalar, f64* Wide)
+    {
+        int Count = HarnessSampleCount;
+        for (int Idx = 0; Idx < Count; Idx++)
+        {
+            Input[Idx] = Min + (Max - Min) * ((f64)Idx / (f64)(Count - 1));
+        }
+
+        HarnessResult Result = {};
+        Result.CRTCycles = UINT64_MAX;
+        Result.ScalarCycles = UINT64_MAX;
+        Result.WideCycles = UINT64_MAX;
+        for (int RepeatIdx = 0; RepeatIdx < HarnessRepeatCount; RepeatIdx++)
+        {
+            u64 CRTCycles = TimeCRT<CRTOp>(Input, Expected, Count);
+            u64 ScalarCycles = TimeApprox<f64x1, ApproxOp>(Input, Scalar, Count);
+            u64 WideCycles = TimeApprox<WideLane, ApproxOp>(Input, Wide, Count);
+            if (CRTCycles < Result.CRTCycles) { Result.CRTCycles = CRTCycles; }
+            if (ScalarCycles < Result.ScalarCycles) { Result.ScalarCycles = ScalarCycles; }
+            if (WideCycles < Result.WideCycles) { Result.WideCycles = WideCycles; }
+        }
+
+        for (int Idx = 0; Idx < Count; Idx++)
+        {
+            u64 ULPScalar = ULPDistance(Scalar[Idx], Expected[Idx]);
+            u64 ULPWide = ULPDistance(Wide[Idx], Expected[Idx]);
+            if (ULPScalar > Result.MaxULPScalar) { Result.MaxULPScalar = ULPScalar; }
+            if (ULPWide > Result.MaxULPWide) { Result.MaxULPWide = ULPWide; }
+
+            f64 AbsError = fabs(Wide[Idx] - Expected[Idx]);
+            if (AbsError > Result.MaxAbsError)
+            {
+                Result.MaxAbsError = AbsError;
+                Result.WorstInput = Input[Idx];
+            }
+            if (Expected[Idx] != 0.0)
+            {
+                f64 RelError = AbsError / fabs(Expected[Idx]);
+                if (RelError > Result.MaxRelError) { Result.MaxRelError = RelError; }
+            }
+        }
+        return Result;
+    }
+
+    void PrintHarnessResult(const char* FuncName, const char* DomainName, f64 Min, f64 Max, HarnessResult& Result)
+    {
+        f64 Count = (f64)HarnessSampleCount;
+        fprintf(stdout, "    %s over %s [%.6f, %.6f]:\n", FuncName, DomainName, Min, Max);
+        fprintf(stdout, "        max ULP: %llu scalar / %llu %d-wide, max abs error: %.3e (at %.9f), max rel error: %.3e\n",
+                Result.MaxULPScalar, Result.MaxULPWide, WideLane::Width,
+                Result.MaxAbsError, Result.WorstInput, Result.MaxRelError);
+        fprintf(stdout, "        cycles/call: CRT %.2f, scalar %.2f, %d-wide %.2f\n",
+                (f64)Result.CRTCycles / Count, (f64)Result.ScalarCycles / Count,
+                WideLane::Width, (f64)Result.WideCycles / Count);
+    }
+}
+
+void Haversine_Math::RunHarness()
+{
+    TIME_FUNC();
+
+    f64* Input = new f64[HarnessSampleCount];
+    f64* Expected = new f64[HarnessSampleCount];
+    f64* Scalar = new f64[HarnessSampleCount];
+    f64* Wide = new f64[HarnessSampleCount];
+
+    // NOTE:
+    //      Domains are the arguments the Haversine formula actually passes
+    //      for coordinates in CoordXMin..CoordXMax / CoordYMin..CoordYMax
+    f64 HalfDLatMax = 0.5 * (CoordYMax - CoordYMin) * DegreesPerRadian;
+    f64 HalfDLonMax = 0.5 * (CoordXMax - CoordXMin) * DegreesPerRadian;
+    f64 LatMin = CoordYMin * DegreesPerRadian;
+    f64 LatMax = CoordYMax * DegreesPerRadian;
+
+    fprintf(stdout, "Haversine_Math harness: %d samples per domain, best of %d runs\n",
+            HarnessSampleCount, HarnessRepeatCount);
+
+    HarnessResult Result = RunDomain<CRTSin, ApproxSin>(-HalfDLatMax, +HalfDLatMax, Input, Expected, Scalar, Wide);
+    PrintHarnessResult("sin", "dLat/2", -HalfDLatMax, +HalfDLatMax, Result);
+
+    Result = RunDomain<CRTSin, ApproxSin>(-HalfDLonMax, +HalfDLonMax, Input, Expected, Scalar, Wide);
+    PrintHarnessResult("sin", "dLon/2", -HalfDLonMax, +HalfDLonMax, Result);
+
+    Result = RunDomain<CRTCos, ApproxCos>(LatMin, LatMax, Input, Expected, Scalar, Wide);
+    PrintHarnessResult("cos", "Lat", LatMin, LatMax, Result);
+
+    Result = RunDomain<CRTAsin, ApproxAsin>(0.0, 1.0, Input, Expected, Scalar, Wide);
+    PrintHarnessResult("asin", "sqrt(a)", 0.0, 1.0, Result);
+
+    Result = RunDomain<CRTSqrt, ApproxSqrt>(0.0, 1.0, Input, Expected, Scalar, Wide);
+    PrintHarnessResult("sqrt", "a", 0.0, 1.0, Result);
+
+    delete[] Input;
+    delete[] Expected;
+    delete[] Scalar;
+    delete[] Wide;
+}
+
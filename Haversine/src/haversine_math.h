@@ -0,0 +1,268 @@
+#ifndef HAVERSINE_MATH_H
+#define HAVERSINE_MATH_H
+
+/*
+ * NOTE:
+ *      Range-reduced polynomial approximations of sin/cos/asin/sqrt used by
+ *      the Haversine kernels in place of the CRT versions
+ *      Every function is written once against the lane wrappers below, so the
+ *      scalar (f64x1) and SIMD (f64x4/f64x8) forms run the same arithmetic
+ *      RunHarness() measures max ULP error and cycles/call against the CRT
+ */
+
+#include "haversine_common.h"
+
+// C stdlib headers:
+#include <math.h>
+// Intrinsics:
+#include <immintrin.h>
+
+namespace Haversine_Math
+{
+    // LoadS32/LoadS16 widen packed integers and Lookup8 picks from an 8 entry table, for kernels that decode quantized pairs
+    struct f64x1
+    {
+        static constexpr int Width = 1;
+        f64 V;
+
+        static f64x1 Set(f64 A) { return { A }; }
+        static f64x1 Load(const f64* Src) { return { *Src }; }
+        static f64x1 LoadS32(const s32* Src) { return { (f64)*Src }; }
+        static f64x1 LoadS16(const s16* Src) { return { (f64)*Src }; }
+        static f64x1 Lookup8(const f64* Table, const u8* Indices) { return { Table[*Indices & 7] }; }
+        void Store(f64* Dst) { *Dst = V; }
+    };
+
+    inline f64x1 Add(f64x1 A, f64x1 B) { return { A.V + B.V }; }
+    inline f64x1 Sub(f64x1 A, f64x1 B) { return { A.V - B.V }; }
+    inline f64x1 Mul(f64x1 A, f64x1 B) { return { A.V * B.V }; }
+    inline f64x1 Div(f64x1 A, f64x1 B) { return { A.V / B.V }; }
+    inline f64x1 MulAdd(f64x1 A, f64x1 B, f64x1 C) { return { A.V * B.V + C.V }; }
+    inline f64x1 Sqrt(f64x1 A) { return { sqrt(A.V) }; }
+    inline f64x1 Floor(f64x1 A) { return { floor(A.V) }; }
+    inline f64x1 Min(f64x1 A, f64x1 B) { return { A.V < B.V ? A.V : B.V }; }
+    inline f64x1 Max(f64x1 A, f64x1 B) { return { A.V > B.V ? A.V : B.V }; }
+    inline bool Lt(f64x1 A, f64x1 B) { return A.V < B.V; }
+    inline f64x1 Select(bool Mask, f64x1 IfTrue, f64x1 IfFalse) { return Mask ? IfTrue : IfFalse; }
+    inline f64 HorizontalSum(f64x1 A) { return A.V; }
+
+#if __AVX2__
+    struct f64x4
+    {
+        static constexpr int Width = 4;
+        __m256d V;
+
+        static f64x4 Set(f64 A) { return { _mm256_set1_pd(A) }; }
+        static f64x4 Load(const f64* Src) { return { _mm256_loadu_pd(Src) }; }
+        static f64x4 LoadS32(const s32* Src) { return { _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i*)Src)) }; }
+        static f64x4 LoadS16(const s16* Src) { return { _mm256_cvtepi32_pd(_mm_cvtepi16_epi32(_mm_loadl_epi64((const __m128i*)Src))) }; }
+        static f64x4 Lookup8(const f64* Table, const u8* Indices)
+        {
+            // Each half of the table is 8 u32s, entry I&3 is u32s 2*(I&3) and 2*(I&3)+1, bit 2 picks the half
+            __m256i Idx = _mm256_cvtepu8_epi64(_mm_loadu_si32(Indices));
+            __m256i Low = _mm256_slli_epi64(_mm256_and_si256(Idx, _mm256_set1_epi64x(3)), 1);
+            __m256i Pairs = _mm256_or_si256(Low, _mm256_slli_epi64(_mm256_add_epi64(Low, _mm256_set1_epi64x(1)), 32));
+            __m256d Lo = _mm256_castps_pd(_mm256_permutevar8x32_ps(_mm256_castpd_ps(_mm256_loadu_pd(Table)), Pairs));
+            __m256d Hi = _mm256_castps_pd(_mm256_permutevar8x32_ps(_mm256_castpd_ps(_mm256_loadu_pd(Table + 4)), Pairs));
+            return { _mm256_blendv_pd(Lo, Hi, _mm256_castsi256_pd(_mm256_slli_epi64(Idx, 61))) };
+        }
+        void Store(f64* Dst) { _mm256_storeu_pd(Dst, V); }
+    };
+
+    inline f64x4 Add(f64x4 A, f64x4 B) { return { _mm256_add_pd(A.V, B.V) }; }
+    inline f64x4 Sub(f64x4 A, f64x4 B) { return { _mm256_sub_pd(A.V, B.V) }; }
+    inline f64x4 Mul(f64x4 A, f64x4 B) { return { _mm256_mul_pd(A.V, B.V) }; }
+    inline f64x4 Div(f64x4 A, f64x4 B) { return { _mm256_div_pd(A.V, B.V) }; }
+#if __FMA__ || _MSC_VER
+    inline f64x4 MulAdd(f64x4 A, f64x4 B, f64x4 C) { return { _mm256_fmadd_pd(A.V, B.V, C.V) }; }
+#else
+    inline f64x4 MulAdd(f64x4 A, f64x4 B, f64x4 C) { return { _mm256_add_pd(_mm256_mul_pd(A.V, B.V), C.V) }; }
+#endif // __FMA__ || _MSC_VER
+    inline f64x4 Sqrt(f64x4 A) { return { _mm256_sqrt_pd(A.V) }; }
+    inline f64x4 Floor(f64x4 A) { return { _mm256_floor_pd(A.V) }; }
+    inline f64x4 Min(f64x4 A, f64x4 B) { return { _mm256_min_pd(A.V, B.V) }; }
+    inline f64x4 Max(f64x4 A, f64x4 B) { return { _mm256_max_pd(A.V, B.V) }; }
+    inline __m256d Lt(f64x4 A, f64x4 B) { return _mm256_cmp_pd(A.V, B.V, _CMP_LT_OQ); }
+    inline f64x4 Select(__m256d Mask, f64x4 IfTrue, f64x4 IfFalse) { return { _mm256_blendv_pd(IfFalse.V, IfTrue.V, Mask) }; }
+    inline f64 HorizontalSum(f64x4 A)
+    {
+        alignas(32) f64 Lanes[4];
+        _mm256_store_pd(Lanes, A.V);
+        return (Lanes[0] + Lanes[1]) + (Lanes[2] + Lanes[3]);
+    }
+#endif // __AVX2__
+
+#if __AVX512F__
+    struct f64x8
+    {
+        static constexpr int Width = 8;
+        __m512d V;
+
+        static f64x8 Set(f64 A) { return { _mm512_set1_pd(A) }; }
+        static f64x8 Load(const f64* Src) { return { _mm512_loadu_pd(Src) }; }
+        static f64x8 LoadS32(const s32* Src) { return { _mm512_cvtepi32_pd(_mm256_loadu_si256((const __m256i*)Src)) }; }
+        static f64x8 LoadS16(const s16* Src) { return { _mm512_cvtepi32_pd(_mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)Src))) }; }
+        static f64x8 Lookup8(const f64* Table, const u8* Indices)
+        {
+            return { _mm512_permutexvar_pd(_mm512_cvtepu8_epi64(_mm_loadl_epi64((const __m128i*)Indices)), _mm512_loadu_pd(Table)) };
+        }
+        void Store(f64* Dst) { _mm512_storeu_pd(Dst, V); }
+    };
+
+    inline f64x8 Add(f64x8 A, f64x8 B) { return { _mm512_add_pd(A.V, B.V) }; }
+    inline f64x8 Sub(f64x8 A, f64x8 B) { return { _mm512_sub_pd(A.V, B.V) }; }
+    inline f64x8 Mul(f64x8 A, f64x8 B) { return { _mm512_mul_pd(A.V, B.V) }; }
+    inline f64x8 Div(f64x8 A, f64x8 B) { return { _mm512_div_pd(A.V, B.V) }; }
+    inline f64x8 MulAdd(f64x8 A, f64x8 B, f64x8 C) { return { _mm512_fmadd_pd(A.V, B.V, C.V) }; }
+    inline f64x8 Sqrt(f64x8 A) { return { _mm512_sqrt_pd(A.V) }; }
+    inline f64x8 Floor(f64x8 A) { return { _mm512_roundscale_pd(A.V, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC) }; }
+    inline f64x8 Min(f64x8 A, f64x8 B) { return { _mm512_min_pd(A.V, B.V) }; }
+    inline f64x8 Max(f64x8 A, f64x8 B) { return { _mm512_max_pd(A.V, B.V) }; }
+    inline __mmask8 Lt(f64x8 A, f64x8 B) { return _mm512_cmp_pd_mask(A.V, B.V, _CMP_LT_OQ); }
+    inline f64x8 Select(__mmask8 Mask, f64x8 IfTrue, f64x8 IfFalse) { return { _mm512_mask_blend_pd(Mask, IfFalse.V, IfTrue.V) }; }
+    inline f64 HorizontalSum(f64x8 A)
+    {
+        alignas(64) f64 Lanes[8];
+        _mm512_store_pd(Lanes, A.V);
+        return ((Lanes[0] + Lanes[1]) + (Lanes[2] + Lanes[3])) +
+            ((Lanes[4] + Lanes[5]) + (Lanes[6] + Lanes[7]));
+    }
+#endif // __AVX512F__
+
+    // Widest lane type the current build targets
+#if __AVX512F__
+    using WideLane = f64x8;
+#elif __AVX2__
+    using WideLane = f64x4;
+#else
+    using WideLane = f64x1;
+#endif
+
+    // NOTE:
+    //      sin/cos polynomials on [-pi/4, +pi/4] are the Cephes (sin.c) minimax
+    //      coefficients, asin uses the fdlibm rational approximation
+    static constexpr f64 TwoOverPi = 0.63661977236758134308;
+    static constexpr f64 HalfPi = 1.57079632679489661923;
+    // pi/2 split into three parts for Cody-Waite range reduction
+    static constexpr f64 HalfPi_A = 1.57079632673412561417e+00;
+    static constexpr f64 HalfPi_B = 6.07710050630396597660e-11;
+    static constexpr f64 HalfPi_C = 2.02226624879595063154e-21;
+
+    static constexpr f64 SinCoeffs[] =
+    {
+        1.58962301576546568060E-10,
+        -2.50507477628578072866E-8,
+        2.75573136213857245213E-6,
+        -1.98412698295895385996E-4,
+        8.33333333332211858878E-3,
+        -1.66666666666666307295E-1,
+    };
+    static constexpr f64 CosCoeffs[] =
+    {
+        -1.13585365213876817300E-11,
+        2.08757008419747316778E-9,
+        -2.75573141792967388112E-7,
+        2.48015872888517045348E-5,
+        -1.38888888888730564116E-3,
+        4.16666666666665929218E-2,
+    };
+    static constexpr f64 AsinNumCoeffs[] =
+    {
+        3.47933107596021167570e-05,
+        7.91534994289814532176e-04,
+        -4.00555345006794114027e-02,
+        2.01212532134862925881e-01,
+        -3.25565818622400915405e-01,
+        1.66666666666666657415e-01,
+    };
+    static constexpr f64 AsinDenCoeffs[] =
+    {
+        7.70381505559019352791e-02,
+        -6.88283971605453293030e-01,
+        2.02094576023350569471e+00,
+        -2.40339491173441421878e+00,
+        1.0,
+    };
+
+    template <typename T, int N>
+    T Polynomial(T X, const f64 (&Coeffs)[N])
+    {
+        T Result = T::Set(Coeffs[0]);
+        for (int CoeffIdx = 1; CoeffIdx < N; CoeffIdx++)
+        {
+            Result = MulAdd(Result, X, T::Set(Coeffs[CoeffIdx]));
+        }
+        return Result;
+    }
+
+    // Evaluates sin(X + QuadrantOffset*pi/2), so cos is QuadrantOffset == 1
+    template <typename T>
+    T SinQuadrant(T X, f64 QuadrantOffset)
+    {
+        T K = Floor(MulAdd(X, T::Set(TwoOverPi), T::Set(0.5)));
+        T R = Sub(X, Mul(K, T::Set(HalfPi_A)));
+        R = Sub(R, Mul(K, T::Set(HalfPi_B)));
+        R = Sub(R, Mul(K, T::Set(HalfPi_C)));
+
+        T Quadrant = Add(K, T::Set(QuadrantOffset));
+        Quadrant = Sub(Quadrant, Mul(T::Set(4.0), Floor(Mul(Quadrant, T::Set(0.25)))));
+        T Odd = Sub(Quadrant, Mul(T::Set(2.0), Floor(Mul(Quadrant, T::Set(0.5)))));
+
+        T R2 = Mul(R, R);
+        T SinR = MulAdd(Mul(R, R2), Polynomial(R2, SinCoeffs), R);
+        T CosR = MulAdd(Mul(R2, R2), Polynomial(R2, CosCoeffs), MulAdd(T::Set(-0.5), R2, T::Set(1.0)));
+
+        T Result = Select(Lt(T::Set(0.5), Odd), CosR, SinR);
+        Result = Select(Lt(T::Set(1.5), Quadrant), Sub(T::Set(0.0), Result), Result);
+        return Result;
+    }
+
+    template <typename T>
+    T Sin(T X) { return SinQuadrant(X, 0.0); }
+
+    template <typename T>
+    T Cos(T X) { return SinQuadrant(X, 1.0); }
+
+    // Evaluates asin(X) for X in [0, 1], X2 must be X*X
+    template <typename T>
+    T AsinPositive(T X, T X2)
+    {
+        auto bSmall = Lt(X, T::Set(0.5));
+
+        // For X >= 0.5: asin(X) = pi/2 - 2*asin(sqrt((1 - X)/2))
+        T Z = Select(bSmall, X2, Mul(Sub(T::Set(1.0), X), T::Set(0.5)));
+        T S = Select(bSmall, X, Sqrt(Z));
+
+        T R = Div(Mul(Z, Polynomial(Z, AsinNumCoeffs)), Polynomial(Z, AsinDenCoeffs));
+        T Y = MulAdd(S, R, S);
+        return Select(bSmall, Y, MulAdd(T::Set(-2.0), Y, T::Set(HalfPi)));
+    }
+
+    template <typename T>
+    T Asin(T X)
+    {
+        X = Min(Max(X, T::Set(-1.0)), T::Set(1.0));
+        auto bNegative = Lt(X, T::Set(0.0));
+        T AbsX = Select(bNegative, Sub(T::Set(0.0), X), X);
+        T Result = AsinPositive(AbsX, Mul(AbsX, AbsX));
+        return Select(bNegative, Sub(T::Set(0.0), Result), Result);
+    }
+
+    // Evaluates asin(sqrt(A)) for A in [0, 1] without squaring the root again
+    template <typename T>
+    T AsinSqrt(T A)
+    {
+        A = Min(Max(A, T::Set(0.0)), T::Set(1.0));
+        return AsinPositive(Sqrt(A), A);
+    }
+
+    inline f64 Sin(f64 X) { return Sin(f64x1{ X }).V; }
+    inline f64 Cos(f64 X) { return Cos(f64x1{ X }).V; }
+    inline f64 Asin(f64 X) { return Asin(f64x1{ X }).V; }
+    inline f64 Sqrt(f64 X) { return Sqrt(f64x1{ X }).V; }
+
+    void RunHarness();
+}
+
+#endif // HAVERSINE_MATH_H
+
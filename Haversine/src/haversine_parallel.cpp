@@ -0,0 +1,267 @@
+#include "haversine_parallel.h"
+#include "haversine_perf.h"
+#include "haversine_fileio.h"
+#include "haversine_jsondom.h"
+#include "haversine_schema.h"
+
+namespace Haversine_Parallel
+{
+    int DefaultThreadCount = 0;
+
+    // A few chunks per thread so one slow chunk doesn't hold up the rest,
+    // but not so small that finding the splits and task handoff show up
+    static constexpr int ChunksPerThread = 4;
+    static constexpr int MinChunkSize = 64 * 1024;
+    static constexpr int MaxChunkCount = Haversine_Threads::MaxThreadCount * ChunksPerThread;
+
+    struct RecordChunk
+    {
+        const char* Begin;
+        const char* End;
+        int Count; // '{' in [Begin, End), one per record if the layout matches
+        int Offset; // Index of the chunk's first pair in the output list
+        bool bMatch;
+    };
+
+    struct ParseContext
+    {
+        RecordChunk* Chunks;
+        HPair* Pairs;
+    };
+
+    bool CharIsWhiteSpace(char C)
+    {
+        return C == ' ' || C == '\n' || C == '\r' || C == '\t';
+    }
+
+    // First record boundary ("}" whitespace "," whitespace "{") at or after Target
+    // Returns the '{' starting the next record and the end of the one before it in OutEnd
+    const char* FindSplit(const char* Target, const char* End, const char** OutEnd)
+    {
+        const char* At = Target;
+        while (At < End)
+        {
+            const char* Close = (const char*)memchr(At, '}', End - At);
+            if (!Close) { break; }
+
+            const char* Next = Close + 1;
+            while (Next < End && CharIsWhiteSpace(*Next)) { Next++; }
+            if (Next < End && *Next == ',')
+            {
+                Next++;
+                while (Next < End && CharIsWhiteSpace(*Next)) { Next++; }
+                if (Next < End && *Next == '{')
+                {
+                    *OutEnd = Close + 1;
+                    return Next;
+                }
+            }
+            At = Close + 1;
+        }
+        return nullptr;
+    }
+
+    int SplitIntoChunks(const char* Begin, const char* End, int ThreadCount, RecordChunk* Chunks)
+    {
+        s64 Size = End - Begin;
+        s64 TargetCount = (s64)ThreadCount * ChunksPerThread;
+        if (TargetCount > Size / MinChunkSize) { TargetCount = Size / MinChunkSize; }
+        if (TargetCount > MaxChunkCount) { TargetCount = MaxChunkCount; }
+        if (TargetCount < 1) { TargetCount = 1; }
+
+        int ChunkCount = 0;
+        const char* ChunkBegin = Begin;
+        for (s64 SplitIdx = 1; SplitIdx < TargetCount; SplitIdx++)
+        {
+            const char* Target = Begin + Size * SplitIdx / TargetCount;
+            if (Target <= ChunkBegin) { continue; }
+
+            const char* ChunkEnd = nullptr;
+            const char* NextBegin = FindSplit(Target, End, &ChunkEnd);
+            if (!NextBegin) { break; }
+
+            Chunks[ChunkCount++] = { ChunkBegin, ChunkEnd, 0, 0, false };
+            ChunkBegin = NextBegin;
+        }
+        Chunks[ChunkCount++] = { ChunkBegin, End, 0, 0, false };
+        return ChunkCount;
+    }
+
+    void CountRecordsTask(void* Context, int ChunkIdx, int ThreadIdx)
+    {
+        (void)ThreadIdx;
+        RecordChunk* Chunk = ((ParseContext*)Context)->Chunks + ChunkIdx;
+
+        int Count = 0;
+        for (const char* At = Chunk->Begin; At < Chunk->End; At++)
+        {
+            Count += *At == '{' ? 1 : 0;
+        }
+        Chunk->Count = Count;
+    }
+
+    void ParseRecordsTask(void* Context, int ChunkIdx, int ThreadIdx)
+    {
+        (void)ThreadIdx;
+        ParseContext* Parse = (ParseContext*)Context;
+        RecordChunk* Chunk = Parse->Chunks + ChunkIdx;
+        TIME_FUNC_DATA((u64)(Chunk->End - Chunk->Begin));
+
+        int Count = Haversine_Schema::ParseRecords(Chunk->Begin, Chunk->End, Parse->Pairs + Chunk->Offset, Chunk->Count);
+        Chunk->bMatch = Count == Chunk->Count;
+    }
+
+    bool ListsMatch(HList A, HList B)
+    {
+        return A.Count == B.Count && (A.Count == 0 || memcmp(A.Data, B.Data, sizeof(HPair) * A.Count) == 0);
+    }
+}
+
+bool Haversine_Parallel::TryParsePairs(const char* JsonData, int Size, Haversine_Threads::WorkerPool& Pool, HList* OutList)
+{
+    TIME_FUNC_DATA(Size);
+
+    const char* RecordsBegin = nullptr;
+    const char* RecordsEnd = nullptr;
+    if (!Haversine_Schema::FindRecords(JsonData, Size, &RecordsBegin, &RecordsEnd)) { return false; }
+    if (RecordsBegin == RecordsEnd)
+    {
+        *OutList = HList{};
+        return true;
+    }
+
+    RecordChunk Chunks[MaxChunkCount];
+    int ChunkCount = SplitIntoChunks(RecordsBegin, RecordsEnd, Pool.ThreadCount, Chunks);
+    ParseContext Context = { Chunks, nullptr };
+
+    Pool.Run(ChunkCount, CountRecordsTask, &Context);
+
+    s64 Count = 0;
+    for (int ChunkIdx = 0; ChunkIdx < ChunkCount; ChunkIdx++)
+    {
+        Chunks[ChunkIdx].Offset = (int)Count;
+        Count += Chunks[ChunkIdx].Count;
+    }
+    if (Count > INT32_MAX) { return false; }
+
+    Context.Pairs = new HPair[Count];
+    TRACK_ALLOC(sizeof(HPair) * Count);
+    Pool.Run(ChunkCount, ParseRecordsTask, &Context);
+
+    bool bMatch = true;
+    for (int ChunkIdx = 0; ChunkIdx < ChunkCount; ChunkIdx++) { bMatch = bMatch && Chunks[ChunkIdx].bMatch; }
+    if (bMatch) { *OutList = HList{ (int)Count, Context.Pairs }; }
+    else
+    {
+        TRACK_FREE(sizeof(HPair) * Count);
+        delete[] Context.Pairs;
+    }
+    return bMatch;
+}
+
+HList Haversine_Parallel::ParseJSON(Haversine_Ref0::FileContentsT& InputFile)
+{
+    HList Result = {};
+    if (nullptr == InputFile.Data) { return Result; }
+
+    int ThreadCount = DefaultThreadCount > 0 ? DefaultThreadCount : Haversine_Threads::GetHardwareThreadCount();
+    Haversine_Threads::WorkerPool& Pool = Haversine_Threads::AcquirePool(ThreadCount);
+    bool bMatch = TryParsePairs((const char*)InputFile.Data, InputFile.Size, Pool, &Result);
+
+    // Not the pairs layout, which the single threaded schema reader wouldn't match either
+    if (!bMatch) { Result = Haversine_JsonDom::ParseJSON(InputFile); }
+    return Result;
+}
+
+HList Haversine_Parallel::ReadFileAsJSON(const char* FileName)
+{
+    TIME_FUNC();
+
+    Haversine_FileIO::MappedFile Input = Haversine_FileIO::Load(FileName, Haversine_FileIO::DefaultLoadMode);
+    HList Result = Haversine_Parallel::ParseJSON(Input.Contents);
+    Input.Release();
+
+    return Result;
+}
+
+void Haversine_Parallel::Benchmark(const char* FileName, int MaxThreadCount)
+{
+    TIME_FUNC();
+
+    Haversine_Ref0::FileContentsT Input = {};
+    Input.Read(FileName, true);
+    if (!Input.Data) { return; }
+
+    static constexpr int RepeatCount = 5;
+    f64 Bytes = (f64)Input.Size;
+
+    u64 SchemaBest = UINT64_MAX;
+    HList SchemaList = {};
+    for (int RepeatIdx = 0; RepeatIdx < RepeatCount; RepeatIdx++)
+    {
+        TRACK_FREE(sizeof(HPair) * SchemaList.Count);
+        delete[] SchemaList.Data;
+        SchemaList = {};
+        u64 Begin = Perf::ReadCPUTimer();
+        Haversine_Schema::TryParsePairs((const char*)Input.Data, Input.Size, &SchemaList);
+        u64 Elapsed = Perf::ReadCPUTimer() - Begin;
+        if (Elapsed < SchemaBest) { SchemaBest = Elapsed; }
+    }
+
+    // The DOM reader parses in place, so it gets a copy
+    Haversine_Ref0::FileContentsT WorkingCopy = { Input.Size, new u8[Input.Size] };
+    memcpy(WorkingCopy.Data, Input.Data, Input.Size);
+    HList DomList = Haversine_JsonDom::ParseJSON(WorkingCopy);
+    WorkingCopy.Release();
+
+    fprintf(stdout, "%s (%d bytes, %d pairs, %d hardware threads):\n",
+            FileName, Input.Size, DomList.Count, Haversine_Threads::GetHardwareThreadCount());
+    fprintf(stdout, "\tSchema (1 thread):  %.2f cycles/byte\n", (f64)SchemaBest / Bytes);
+
+    u64 OneThreadBest = 0;
+    int ThreadCount = 1;
+    for (;;)
+    {
+        Haversine_Threads::WorkerPool& Pool = Haversine_Threads::AcquirePool(ThreadCount);
+
+        u64 Best = UINT64_MAX;
+        bool bMatched = false;
+        HList ParallelList = {};
+        for (int RepeatIdx = 0; RepeatIdx < RepeatCount; RepeatIdx++)
+        {
+            TRACK_FREE(sizeof(HPair) * ParallelList.Count);
+            delete[] ParallelList.Data;
+            ParallelList = {};
+            u64 Begin = Perf::ReadCPUTimer();
+            bMatched = TryParsePairs((const char*)Input.Data, Input.Size, Pool, &ParallelList);
+            u64 Elapsed = Perf::ReadCPUTimer() - Begin;
+            if (Elapsed < Best) { Best = Elapsed; }
+        }
+        if (ThreadCount == 1) { OneThreadBest = Best; }
+
+        if (bMatched)
+        {
+            fprintf(stdout, "\tParallel %3d threads: %.2f cycles/byte, %.2fx of 1 thread, %.2fx of schema, list %s\n",
+                    ThreadCount, (f64)Best / Bytes, (f64)OneThreadBest / (f64)Best, (f64)SchemaBest / (f64)Best,
+                    ListsMatch(ParallelList, SchemaList) && ListsMatch(ParallelList, DomList) ? "matches" : "DOES NOT MATCH");
+        }
+        else
+        {
+            fprintf(stdout, "\tParallel %3d threads: layout not matched after %.2f cycles/byte, falls back to the DOM reader\n",
+                    ThreadCount, (f64)Best / Bytes);
+        }
+        if (ThreadCount >= MaxThreadCount) { Pool.PrintThreadTimings(); }
+
+        TRACK_FREE(sizeof(HPair) * ParallelList.Count);
+        delete[] ParallelList.Data;
+        if (ThreadCount >= MaxThreadCount) { break; }
+        ThreadCount = ThreadCount * 2 < MaxThreadCount ? ThreadCount * 2 : MaxThreadCount;
+    }
+
+    TRACK_FREE(sizeof(HPair) * SchemaList.Count);
+    delete[] SchemaList.Data;
+    TRACK_FREE(sizeof(HPair) * DomList.Count);
+    delete[] DomList.Data;
+    Input.Release();
+}
+
@@ -0,0 +1,39 @@
+#ifndef HAVERSINE_PARALLEL_H
+#define HAVERSINE_PARALLEL_H
+
+/*
+ * NOTE:
+ *      Multi-threaded version of the Haversine_Schema pairs reader
+ *      The records between "pairs": [ and ] are cut into chunks at "}, {"
+ *      boundaries, then two passes run on a WorkerPool:
+ *          1. Count the records ('{') in every chunk
+ *          2. Parse every chunk straight into its slice of one exactly sized
+ *             CoordPair array, at the offset the counts before it add up to
+ *      Records only hold numbers, so a "}, {" can't be inside a string unless the
+ *      document isn't in the pairs layout, and then a chunk fails to parse and
+ *      the whole input goes to the generic reader like Haversine_Schema does
+ *      Chunks are joined in input order, so the list is identical to the single
+ *      threaded one for any thread count
+ */
+
+#include "haversine_common.h"
+#include "haversine_ref0.h"
+#include "haversine_threads.h"
+
+namespace Haversine_Parallel
+{
+    // Set by -threads, 0 => GetHardwareThreadCount()
+    extern int DefaultThreadCount;
+
+    // False if the input doesn't have the pairs layout, OutList is untouched then
+    bool TryParsePairs(const char* JsonData, int Size, Haversine_Threads::WorkerPool& Pool, HList* OutList);
+
+    HList ParseJSON(Haversine_Ref0::FileContentsT& InputFile);
+    HList ReadFileAsJSON(const char* FileName);
+
+    // Parse time for 1, 2, 4, ... MaxThreadCount threads against the single threaded schema reader
+    void Benchmark(const char* FileName, int MaxThreadCount);
+}
+
+#endif // HAVERSINE_PARALLEL_H
+
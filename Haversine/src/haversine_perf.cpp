@@ -1,10 +1,31 @@
 #include "haversine_perf.h"
 
-namespace Perf
-{
+// C stdlib headers:
+#include <errno.h>
+#include <string.h>
+// C++ stdlib headers:
+#include <atomic>
+#include <mutex>
+
 #if _WIN32
 #include <intrin.h>
 #include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else // NOT _WIN32
+#include <cpuid.h>
+#include <x86intrin.h>
+#include <linux/perf_event.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif // _WIN32
+
+namespace Perf
+{
+#if _WIN32
     u64 ReadOSTimer()
     {
         LARGE_INTEGER PerfCount;
@@ -17,28 +38,115 @@ namespace Perf
         QueryPerformanceFrequency(&Freq);
         return Freq.QuadPart;
     }
+    PageFaultCounts ReadPageFaults()
+    {
+        // NOTE: Windows only reports one count (soft + hard faults), it shows up as Minor
+        PROCESS_MEMORY_COUNTERS Counters = {};
+        GetProcessMemoryInfo(GetCurrentProcess(), &Counters, sizeof(Counters));
+        return PageFaultCounts{ Counters.PageFaultCount, 0 };
+    }
+    u64 ReadPeakRSS()
+    {
+        PROCESS_MEMORY_COUNTERS Counters = {};
+        GetProcessMemoryInfo(GetCurrentProcess(), &Counters, sizeof(Counters));
+        return Counters.PeakWorkingSetSize;
+    }
+    void ReadCPUID(u32 Leaf, u32 SubLeaf, u32* OutRegs)
+    {
+        int Regs[4];
+        __cpuidex(Regs, (int)Leaf, (int)SubLeaf);
+        for (int RegIdx = 0; RegIdx < 4; RegIdx++) { OutRegs[RegIdx] = (u32)Regs[RegIdx]; }
+    }
+    u64 ReadKernelTSCFreq() { return 0; }
 #else // NOT _WIN32
-#include <x86intrin.h>
-#include <sys/time.h>
-    // TODO: These are untested currently until I build/run these on non-Windows platforms!!
+    // Nanoseconds, MONOTONIC_RAW isn't slewed by NTP, so it's a steady reference for the TSC
     u64 ReadOSTimer()
     {
-        timeval tval;
-        gettimeofday(&tval, 0);
-        u64 Result = GetOSTimerFreq()*(u64)tval.tv_sex + (u64)tval.tv_usec;
+        timespec Time;
+        clock_gettime(CLOCK_MONOTONIC_RAW, &Time);
+        return 1000000000ull * (u64)Time.tv_sec + (u64)Time.tv_nsec;
+    }
+    u64 GetOSFreq() { return 1000000000u; }
+    PageFaultCounts ReadPageFaults()
+    {
+        rusage Usage = {};
+        getrusage(RUSAGE_SELF, &Usage);
+        return PageFaultCounts{ (u64)Usage.ru_minflt, (u64)Usage.ru_majflt };
+    }
+    u64 ReadPeakRSS()
+    {
+        rusage Usage = {};
+        getrusage(RUSAGE_SELF, &Usage);
+        return (u64)Usage.ru_maxrss * 1024; // KB on Linux
+    }
+    void ReadCPUID(u32 Leaf, u32 SubLeaf, u32* OutRegs)
+    {
+        __cpuid_count(Leaf, SubLeaf, OutRegs[0], OutRegs[1], OutRegs[2], OutRegs[3]);
+    }
+    // The kernel's own TSC calibration: perf_event mmap pages convert TSC to ns as
+    // (Cycles * time_mult) >> time_shift when cap_user_time is set (stable TSC, tsc clocksource)
+    u64 ReadKernelTSCFreq()
+    {
+        perf_event_attr Attr = {};
+        Attr.size = sizeof(Attr);
+        Attr.type = PERF_TYPE_SOFTWARE;
+        Attr.config = PERF_COUNT_SW_DUMMY;
+        Attr.exclude_kernel = 1;
+        Attr.exclude_hv = 1;
+        int Fd = (int)syscall(SYS_perf_event_open, &Attr, 0, -1, -1, 0);
+        if (Fd < 0) { return 0; }
+
+        u64 Result = 0;
+        long PageSize = sysconf(_SC_PAGESIZE);
+        void* Mapping = mmap(nullptr, PageSize, PROT_READ, MAP_SHARED, Fd, 0);
+        if (Mapping != MAP_FAILED)
+        {
+            const volatile perf_event_mmap_page* Page = (const volatile perf_event_mmap_page*)Mapping;
+            u32 Sequence = 0;
+            do
+            {
+                Sequence = Page->lock;
+                std::atomic_signal_fence(std::memory_order_seq_cst);
+                if (Page->cap_user_time && Page->time_mult)
+                {
+                    Result = (u64)(1.0e9 * (f64)(1ull << Page->time_shift) / (f64)Page->time_mult + 0.5);
+                }
+                std::atomic_signal_fence(std::memory_order_seq_cst);
+            } while (Page->lock != Sequence);
+            munmap(Mapping, PageSize);
+        }
+        close(Fd);
         return Result;
     }
-    u64 GetOSFreq() { return 1000000u; }
 #endif // _WIN32
     u64 ReadCPUTimer()
     {
         return __rdtsc();
     }
 
-    u64 EstimateCPUFreq()
+    // CPUID leaf 0x15 (Intel): TSC = crystal clock * EBX / EAX, leaf 0x16's base MHz when the crystal isn't enumerated
+    u64 ReadCPUIDTSCFreq()
     {
-        constexpr u64 ms_to_wait = 1000;
+        u32 Regs[4];
+        ReadCPUID(0, 0, Regs);
+        u32 MaxLeaf = Regs[0];
+        if (MaxLeaf < 0x15) { return 0; }
+
+        ReadCPUID(0x15, 0, Regs);
+        u32 Denominator = Regs[0];
+        u32 Numerator = Regs[1];
+        u32 CrystalHz = Regs[2];
+        if (!Denominator || !Numerator) { return 0; }
+        if (CrystalHz) { return (u64)CrystalHz * Numerator / Denominator; }
+        if (MaxLeaf < 0x16) { return 0; }
 
+        ReadCPUID(0x16, 0, Regs);
+        return (u64)(Regs[0] & 0xFFFF) * 1000000;
+    }
+
+    // Last resort, TSC against the OS timer for MSToWait
+    u64 MeasureCPUFreq(u64 MSToWait)
+    {
         u64 OSFreq = GetOSFreq();
 
         u64 CPUStart = ReadCPUTimer();
@@ -46,7 +154,7 @@ namespace Perf
 
         u64 OSEnd = 0;
         u64 OSElapsed = 0;
-        u64 OSWaitTime = OSFreq * ms_to_wait / 1000;
+        u64 OSWaitTime = OSFreq * MSToWait / 1000;
         while (OSElapsed < OSWaitTime)
         {
             OSEnd = ReadOSTimer();
@@ -61,6 +169,34 @@ namespace Perf
         return CPUFreq;
     }
 
+    struct CPUFreqInfo
+    {
+        u64 Freq;
+        const char* Source;
+    };
+
+    CPUFreqInfo DetectCPUFreq()
+    {
+        // Long enough that the OS timer's resolution and the reads' jitter stay under ~0.01%
+        constexpr u64 CalibrationMS = 10;
+
+        if (u64 Freq = ReadCPUIDTSCFreq()) { return CPUFreqInfo{ Freq, "cpuid" }; }
+        if (u64 Freq = ReadKernelTSCFreq()) { return CPUFreqInfo{ Freq, "kernel" }; }
+        return CPUFreqInfo{ MeasureCPUFreq(CalibrationMS), "measured" };
+    }
+
+    // Detected once per process, the first caller pays for it (at most CalibrationMS)
+    const CPUFreqInfo& GetCPUFreqInfo()
+    {
+        static const CPUFreqInfo Info = DetectCPUFreq();
+        return Info;
+    }
+
+    u64 EstimateCPUFreq()
+    {
+        return GetCPUFreqInfo().Freq;
+    }
+
     f64 GetElapsedTimeSeconds(u64 Delta, u64 Freq)
     {
         return (f64)Delta / (f64)Freq;
@@ -68,30 +204,452 @@ namespace Perf
 
     static u64 TotalBegin = 0;
     static u64 TotalEnd = 0;
+    static PageFaultCounts FaultsBegin = {};
 
 #if ENABLE_PROFILER
     static constexpr int MaxAnchors = 4096;
-    static ProfileAnchor Anchors[MaxAnchors] = {};
-    static u32 GlobalParentIndex = 0;
+    // 1.5MB per thread, power of 2 so the ring index is a mask
+    static constexpr u32 TraceEventCount = 64 * 1024;
+
+    struct TraceEvent
+    {
+        u64 Begin;
+        u64 End;
+        u64 Index;
+    };
+
+    struct CounterAnchor
+    {
+        u64 Inclusive[MaxCounters];
+        u64 Exclusive[MaxCounters];
+    };
+
+    struct AllocAnchor
+    {
+        u64 Bytes; // Allocated while this was the innermost scope
+        u64 Count;
+        u64 PeakLive; // Children included
+    };
+
+    // How a thread's scopes read its counters: 0 => no counters, else 1 + a mask of the counters
+    // that need a read() syscall every time (software counters, or rdpmc disabled), the others use rdpmc
+    // Scope overhead is measured and reported per read set, one extra syscall changes it a lot
+    static constexpr u32 ReadSetCount = 1 + (1u << MaxCounters);
+
+    struct ThreadProfile
+    {
+        ProfileAnchor Anchors[MaxAnchors];
+        u32 ParentIndex;
+        u32 ThreadIdx; // In order of first use, the thread calling BeginProfiling is 0, a reused table keeps its own
+        ThreadProfile* Next;
+        ThreadProfile* NextFree; // Only while its thread has exited and no other took it yet
+        bool bFree;
+        TraceEvent* Events; // nullptr => not tracing
+        u64 EventCount; // Ever recorded, the ring holds the last TraceEventCount
+        u64 OverheadCycles; // Profiler cost of every scope closed on this thread, see MeasureScopeOverhead
+        // Cycles an empty scope measures itself (between its timer reads), and what it adds around that, for this thread's ReadSet
+        u64 ScopeOverheadInside;
+        u64 ScopeOverheadOutside;
+        CounterAnchor* Counters; // nullptr => no hardware counters (not enabled, or they couldn't be opened)
+        AllocAnchor* Allocs; // nullptr => not tracking allocations
+        u64 PeakLive; // Of the innermost open scope (or the whole thread, with none open)
+        int CounterFds[MaxCounters];
+        void* CounterPages[MaxCounters]; // perf_event_mmap_page of each counter, nullptr => read()
+        u32 ReadSet;
+    };
+
+    struct CounterDesc
+    {
+        const char* Name;
+        u32 Type;
+        u64 Config;
+    };
+
+    static const CounterDesc* ActiveCounters = nullptr;
+    static int ActiveCounterCount = 0;
+
+#if !_WIN32
+    constexpr u64 CacheConfig(u64 Cache, u64 Op, u64 Result) { return Cache | (Op << 8) | (Result << 16); }
+
+    static const CounterDesc CycleCounters[] =
+    {
+        { "cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+        { "instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    };
+    static const CounterDesc DefaultCounters[] =
+    {
+        CycleCounters[0], CycleCounters[1],
+        { "branch misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+        { "LLC misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+        { "page faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS },
+    };
+    static const CounterDesc BranchCounters[] =
+    {
+        CycleCounters[0], CycleCounters[1],
+        { "branches", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_INSTRUCTIONS },
+        { "branch misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+    };
+    static const CounterDesc CacheCounters[] =
+    {
+        CycleCounters[0], CycleCounters[1],
+        { "L1D read misses", PERF_TYPE_HW_CACHE,
+            CacheConfig(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS) },
+        { "LLC references", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES },
+        { "LLC misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+    };
+    static_assert(sizeof(DefaultCounters) / sizeof(CounterDesc) <= MaxCounters, "Too many counters");
+    static_assert(sizeof(BranchCounters) / sizeof(CounterDesc) <= MaxCounters, "Too many counters");
+    static_assert(sizeof(CacheCounters) / sizeof(CounterDesc) <= MaxCounters, "Too many counters");
+
+    void CloseCounters(ThreadProfile* Profile, int OpenCount)
+    {
+        for (int CounterIdx = 0; CounterIdx < OpenCount; CounterIdx++)
+        {
+            if (Profile->CounterPages[CounterIdx]) { munmap(Profile->CounterPages[CounterIdx], sysconf(_SC_PAGESIZE)); }
+            close(Profile->CounterFds[CounterIdx]);
+            Profile->CounterPages[CounterIdx] = nullptr;
+        }
+    }
+
+    // Opens ActiveCounters for the calling thread, cycles leads the group so they're all scheduled together
+    bool OpenCounters(ThreadProfile* Profile)
+    {
+        int GroupFd = -1;
+        for (int CounterIdx = 0; CounterIdx < ActiveCounterCount; CounterIdx++)
+        {
+            perf_event_attr Attr = {};
+            Attr.size = sizeof(Attr);
+            Attr.type = ActiveCounters[CounterIdx].Type;
+            Attr.config = ActiveCounters[CounterIdx].Config;
+            Attr.exclude_kernel = 1;
+            Attr.exclude_hv = 1;
+            int Fd = (int)syscall(SYS_perf_event_open, &Attr, 0, -1, GroupFd, 0);
+            if (Fd < 0)
+            {
+                static std::atomic<bool> bReported(false);
+                if (!bReported.exchange(true))
+                {
+                    fprintf(stdout, "ERROR: perf_event_open failed for %s (%s), no counters on this thread!\n",
+                            ActiveCounters[CounterIdx].Name, strerror(errno));
+                }
+                CloseCounters(Profile, CounterIdx);
+                return false;
+            }
+            if (GroupFd < 0) { GroupFd = Fd; }
+
+            void* Page = mmap(nullptr, sysconf(_SC_PAGESIZE), PROT_READ, MAP_SHARED, Fd, 0);
+            Profile->CounterFds[CounterIdx] = Fd;
+            Profile->CounterPages[CounterIdx] = Page != MAP_FAILED ? Page : nullptr;
+        }
+        return true;
+    }
+
+    // The kernel's seqlock protocol for user space counter reads (see perf_event_mmap_page)
+    bool ReadUserCounter(const volatile perf_event_mmap_page* Page, u64* OutValue)
+    {
+        u32 Sequence = 0;
+        u64 Value = 0;
+        bool bResult = false;
+        do
+        {
+            Sequence = Page->lock;
+            std::atomic_signal_fence(std::memory_order_seq_cst);
+            u32 Index = Page->index;
+            bResult = Page->cap_user_rdpmc && Index;
+            Value = Page->offset;
+            if (bResult)
+            {
+                int Shift = 64 - Page->pmc_width;
+                s64 Counter = (s64)__rdpmc(Index - 1);
+                Value += (u64)((s64)((u64)Counter << Shift) >> Shift);
+            }
+            std::atomic_signal_fence(std::memory_order_seq_cst);
+        } while (Page->lock != Sequence);
+        *OutValue = Value;
+        return bResult;
+    }
+
+    inline void ReadCounters(const ThreadProfile* Profile, u64* OutValues)
+    {
+        for (int CounterIdx = 0; CounterIdx < ActiveCounterCount; CounterIdx++)
+        {
+            const perf_event_mmap_page* Page = (const perf_event_mmap_page*)Profile->CounterPages[CounterIdx];
+            if (!Page || !ReadUserCounter(Page, OutValues + CounterIdx))
+            {
+                u64 Value = 0;
+                if (read(Profile->CounterFds[CounterIdx], &Value, sizeof(Value)) != sizeof(Value)) { Value = 0; }
+                OutValues[CounterIdx] = Value;
+            }
+        }
+    }
+
+    // Cheapest of a few read() calls on a counter's fd, what a scope pays for it twice
+    u64 MeasureReadCycles(int Fd)
+    {
+        constexpr int ReadSampleCount = 16;
+        u64 MinCycles = ~0ull;
+        for (int SampleIdx = 0; SampleIdx < ReadSampleCount; SampleIdx++)
+        {
+            u64 Value = 0;
+            u64 Begin = ReadCPUTimer();
+            if (read(Fd, &Value, sizeof(Value)) != sizeof(Value)) { return 0; }
+            u64 Cycles = ReadCPUTimer() - Begin;
+            if (Cycles < MinCycles) { MinCycles = Cycles; }
+        }
+        return MinCycles;
+    }
+
+    // Cycles of one read() of each counter, filled in by the first thread that has to use it
+    static u64 CounterReadCycles[MaxCounters] = {};
+
+    // One read of every counter, the ones that can't be read from user space go in the mask
+    // (ReadCounters tries rdpmc first for each counter, so only those make syscalls)
+    u32 DetectReadSet(const ThreadProfile* Profile)
+    {
+        static std::atomic<u32> ReportedMask(0);
+        u32 ReadMask = 0;
+        for (int CounterIdx = 0; CounterIdx < ActiveCounterCount; CounterIdx++)
+        {
+            const perf_event_mmap_page* Page = (const perf_event_mmap_page*)Profile->CounterPages[CounterIdx];
+            u64 Value = 0;
+            if (Page && ReadUserCounter(Page, &Value)) { continue; }
+
+            ReadMask |= 1u << CounterIdx;
+            if (!(ReportedMask.fetch_or(1u << CounterIdx) & (1u << CounterIdx)))
+            {
+                CounterReadCycles[CounterIdx] = MeasureReadCycles(Profile->CounterFds[CounterIdx]);
+                fprintf(stdout, "WARNING: %s can't be read with rdpmc, every scope reads it with two read() syscalls "
+                        "of ~%llu cycles each, and the other counters see their cache/branch pollution!\n",
+                        ActiveCounters[CounterIdx].Name, CounterReadCycles[CounterIdx]);
+            }
+        }
+        return 1 + ReadMask;
+    }
+#else // _WIN32
+    static u64 CounterReadCycles[MaxCounters] = {};
+    u32 DetectReadSet(const ThreadProfile* Profile) { (void)Profile; return 1; }
+    void CloseCounters(ThreadProfile* Profile, int OpenCount) { (void)Profile; (void)OpenCount; }
+    bool OpenCounters(ThreadProfile* Profile) { (void)Profile; return false; }
+    inline void ReadCounters(const ThreadProfile* Profile, u64* OutValues) { (void)Profile; (void)OutValues; }
+#endif // _WIN32
+
+    // Every table handed out so far, in use or free, kept for the trace events of threads that exited
+    static ThreadProfile* FirstProfile = nullptr;
+    static u32 ProfileCount = 0;
+    // Tables of exited threads, their counts already moved to RetiredProfile, the next new thread takes one
+    static ThreadProfile* FreeProfiles = nullptr;
+    // Sum of every exited thread's anchors, nullptr until the first one exits
+    static ThreadProfile* RetiredProfile = nullptr;
+    static u32 RetiredThreadCount = 0;
+    static u32 RetiredReadSetCounts[ReadSetCount] = {};
+    static std::mutex ProfileMutex;
+    static thread_local ThreadProfile* LocalProfile = nullptr;
+    static const char* TraceFileName = nullptr;
+    // ThreadProfile::ScopeOverheadInside/Outside of each ReadSet, measured by the first thread that has it
+    static u64 ScopeOverheadInside[ReadSetCount] = {};
+    static u64 ScopeOverheadOutside[ReadSetCount] = {};
+    static bool bScopeOverheadMeasured[ReadSetCount] = {};
+    static std::mutex OverheadMutex;
+    static bool bTrackAllocs = false;
+    static bool bRoofline = false;
+    static RooflineCeilings Roofline = {};
+    // Tracked bytes allocated minus freed, by every thread (frees often happen on another thread than the allocation)
+    static std::atomic<s64> LiveBytes(0);
+
+    // Adds every count of Src to Dest's, names included so an anchor only retired threads hit still prints
+    void MergeProfile(ThreadProfile* Dest, const ThreadProfile* Src)
+    {
+        if (Src->Counters && !Dest->Counters) { Dest->Counters = new CounterAnchor[MaxAnchors](); }
+        if (Src->Allocs && !Dest->Allocs) { Dest->Allocs = new AllocAnchor[MaxAnchors](); }
+        if (Src->PeakLive > Dest->PeakLive) { Dest->PeakLive = Src->PeakLive; }
+        for (int Idx = 0; Idx < MaxAnchors; Idx++)
+        {
+            const ProfileAnchor& From = Src->Anchors[Idx];
+            ProfileAnchor& To = Dest->Anchors[Idx];
+            if (From.Name) { To.Name = From.Name; }
+            To.HitCount += From.HitCount;
+            To.TimeElapsedExclusive += From.TimeElapsedExclusive;
+            To.TimeElapsedInclusive += From.TimeElapsedInclusive;
+            To.BytesProcessed += From.BytesProcessed;
+            if (Src->Counters)
+            {
+                for (int CounterIdx = 0; CounterIdx < ActiveCounterCount; CounterIdx++)
+                {
+                    Dest->Counters[Idx].Inclusive[CounterIdx] += Src->Counters[Idx].Inclusive[CounterIdx];
+                    Dest->Counters[Idx].Exclusive[CounterIdx] += Src->Counters[Idx].Exclusive[CounterIdx];
+                }
+            }
+            if (Src->Allocs)
+            {
+                Dest->Allocs[Idx].Bytes += Src->Allocs[Idx].Bytes;
+                Dest->Allocs[Idx].Count += Src->Allocs[Idx].Count;
+                if (Src->Allocs[Idx].PeakLive > Dest->Allocs[Idx].PeakLive) { Dest->Allocs[Idx].PeakLive = Src->Allocs[Idx].PeakLive; }
+            }
+        }
+    }
+
+    // NOTE:
+    //      Threads come and go (a writer per gen, a reader per stream), so an exiting
+    //      thread's counts move to RetiredProfile, its counters are closed and its table
+    //      goes on the free list, cleared but for the anchor names and the trace ring
+    //      The next thread to register takes it over, ThreadIdx included, so its trace
+    //      events land on the same row after the old thread's (they never overlap)
+    void RetireThread(ThreadProfile* Profile)
+    {
+        if (Profile->Counters) { CloseCounters(Profile, ActiveCounterCount); }
+        LocalProfile = nullptr;
+
+        std::lock_guard<std::mutex> Lock(ProfileMutex);
+        if (!RetiredProfile) { RetiredProfile = new ThreadProfile(); }
+        MergeProfile(RetiredProfile, Profile);
+        RetiredThreadCount++;
+        RetiredReadSetCounts[Profile->ReadSet]++;
+
+        for (int Idx = 0; Idx < MaxAnchors; Idx++)
+        {
+            ProfileAnchor& Anchor = Profile->Anchors[Idx];
+            Anchor = ProfileAnchor{ Anchor.Name, 0, 0, 0, 0 };
+        }
+        delete[] Profile->Counters;
+        Profile->Counters = nullptr;
+        if (Profile->Allocs) { memset(Profile->Allocs, 0, sizeof(AllocAnchor) * MaxAnchors); }
+        Profile->ParentIndex = 0;
+        Profile->PeakLive = 0;
+        Profile->ReadSet = 0;
+        Profile->bFree = true;
+        Profile->NextFree = FreeProfiles;
+        FreeProfiles = Profile;
+    }
+
+    void MeasureScopeOverhead(ThreadProfile* Profile);
+
+    // Constructed by the first RegisterThread on each thread, so its destructor runs when that thread exits
+    struct ThreadProfileOwner
+    {
+        ThreadProfile* Profile;
+        ~ThreadProfileOwner() { if (Profile) { RetireThread(Profile); } }
+    };
+    static thread_local ThreadProfileOwner LocalOwner = {};
+
+    ThreadProfile* RegisterThread()
+    {
+        ThreadProfile* Profile = nullptr;
+        {
+            std::lock_guard<std::mutex> Lock(ProfileMutex);
+            if (FreeProfiles)
+            {
+                Profile = FreeProfiles;
+                FreeProfiles = Profile->NextFree;
+                Profile->NextFree = nullptr;
+                Profile->bFree = false;
+            }
+            else
+            {
+                Profile = new ThreadProfile();
+                Profile->ThreadIdx = ProfileCount++;
+                Profile->Next = FirstProfile;
+                FirstProfile = Profile;
+            }
+        }
+        if (TraceFileName && !Profile->Events) { Profile->Events = new TraceEvent[TraceEventCount]; }
+        if (ActiveCounterCount && OpenCounters(Profile))
+        {
+            Profile->Counters = new CounterAnchor[MaxAnchors]();
+            Profile->ReadSet = DetectReadSet(Profile);
+        }
+        if (bTrackAllocs && !Profile->Allocs) { Profile->Allocs = new AllocAnchor[MaxAnchors](); }
+        LocalProfile = Profile;
+        LocalOwner.Profile = Profile;
+
+        // Counter reads are most of a scope's cost, a thread can't use another read set's overhead
+        std::lock_guard<std::mutex> Lock(OverheadMutex);
+        u32 ReadSet = Profile->ReadSet;
+        if (!bScopeOverheadMeasured[ReadSet])
+        {
+            MeasureScopeOverhead(Profile);
+            ScopeOverheadInside[ReadSet] = Profile->ScopeOverheadInside;
+            ScopeOverheadOutside[ReadSet] = Profile->ScopeOverheadOutside;
+            bScopeOverheadMeasured[ReadSet] = true;
+        }
+        Profile->ScopeOverheadInside = ScopeOverheadInside[ReadSet];
+        Profile->ScopeOverheadOutside = ScopeOverheadOutside[ReadSet];
+        return Profile;
+    }
+
+    inline ThreadProfile* GetThreadProfile()
+    {
+        ThreadProfile* Profile = LocalProfile;
+        return Profile ? Profile : RegisterThread();
+    }
 
     ScopedTiming::ScopedTiming(const char* Name_, u32 Index_, u64 Bytes_)
     {
-        ParentIndex = GlobalParentIndex;
+        ThreadProfile* Profile = GetThreadProfile();
+        ParentIndex = Profile->ParentIndex;
 
         Index = Index_;
         Name = Name_;
+        Anchors = Profile->Anchors;
 
         ProfileAnchor* Anchor = Anchors + Index;
         OldTimeElapsedInclusive = Anchor->TimeElapsedInclusive;
         Anchor->BytesProcessed += Bytes_;
 
-        GlobalParentIndex = Index;
+        Profile->ParentIndex = Index;
+        OldOverheadCycles = Profile->OverheadCycles;
+        if (Profile->Allocs)
+        {
+            s64 Live = LiveBytes.load(std::memory_order_relaxed);
+            OldPeakLive = Profile->PeakLive;
+            Profile->PeakLive = Live > 0 ? (u64)Live : 0;
+        }
+        if (Profile->Counters)
+        {
+            memcpy(OldCountersInclusive, Profile->Counters[Index].Inclusive, sizeof(OldCountersInclusive));
+            ReadCounters(Profile, CountersBegin);
+        }
         StartTime = ReadCPUTimer();
     }
     ScopedTiming::~ScopedTiming()
     {
-        u64 TimeElapsed = ReadCPUTimer() - StartTime;
-        GlobalParentIndex = ParentIndex;
+        u64 EndTime = ReadCPUTimer();
+        // Same thread as the constructor, so the same table
+        ThreadProfile* Profile = LocalProfile;
+        Profile->ParentIndex = ParentIndex;
+
+        // Raw timestamps for the trace, the anchors get the time without the profiler's own cost
+        u64 Overhead = Profile->ScopeOverheadInside + (Profile->OverheadCycles - OldOverheadCycles);
+        u64 TimeElapsed = EndTime - StartTime;
+        TimeElapsed = TimeElapsed > Overhead ? TimeElapsed - Overhead : 0;
+        Profile->OverheadCycles += Profile->ScopeOverheadInside + Profile->ScopeOverheadOutside;
+        if (Profile->Counters)
+        {
+            u64 CountersEnd[MaxCounters];
+            ReadCounters(Profile, CountersEnd);
+            CounterAnchor* Parent = Profile->Counters + ParentIndex;
+            CounterAnchor* Anchor = Profile->Counters + Index;
+            for (int CounterIdx = 0; CounterIdx < ActiveCounterCount; CounterIdx++)
+            {
+                u64 Elapsed = CountersEnd[CounterIdx] - CountersBegin[CounterIdx];
+                Parent->Exclusive[CounterIdx] -= Elapsed;
+                Anchor->Exclusive[CounterIdx] += Elapsed;
+                Anchor->Inclusive[CounterIdx] = OldCountersInclusive[CounterIdx] + Elapsed;
+            }
+        }
+        if (Profile->Allocs)
+        {
+            AllocAnchor* Anchor = Profile->Allocs + Index;
+            if (Profile->PeakLive > Anchor->PeakLive) { Anchor->PeakLive = Profile->PeakLive; }
+            // Back to the parent's peak, which now includes this scope's
+            if (OldPeakLive > Profile->PeakLive) { Profile->PeakLive = OldPeakLive; }
+        }
+        if (Profile->Events)
+        {
+            TraceEvent* Event = Profile->Events + (Profile->EventCount++ & (TraceEventCount - 1));
+            Event->Begin = StartTime;
+            Event->End = EndTime;
+            Event->Index = Index;
+        }
 
         ProfileAnchor* Parent = Anchors + ParentIndex;
         ProfileAnchor* Anchor = Anchors + Index;
@@ -104,9 +662,94 @@ namespace Perf
         Anchor->Name = Name;
     }
 
-    void PrintAnchor(u64 TotalTime, u64 Freq, ProfileAnchor* Anchor)
+    void RecordTiming(const char* Name, u32 Index, u64 Cycles, u64 Bytes)
+    {
+        ProfileAnchor* Anchor = GetThreadProfile()->Anchors + Index;
+        Anchor->TimeElapsedExclusive += Cycles;
+        Anchor->TimeElapsedInclusive += Cycles;
+        Anchor->BytesProcessed += Bytes;
+        ++Anchor->HitCount;
+
+        Anchor->Name = Name;
+    }
+
+    void RecordAlloc(u64 Bytes)
+    {
+        if (!bTrackAllocs) { return; }
+        ThreadProfile* Profile = GetThreadProfile();
+        s64 Live = LiveBytes.fetch_add((s64)Bytes, std::memory_order_relaxed) + (s64)Bytes;
+        AllocAnchor* Anchor = Profile->Allocs + Profile->ParentIndex;
+        Anchor->Bytes += Bytes;
+        Anchor->Count++;
+        if (Live > 0 && (u64)Live > Profile->PeakLive) { Profile->PeakLive = (u64)Live; }
+    }
+
+    void RecordFree(u64 Bytes)
+    {
+        if (!bTrackAllocs) { return; }
+        LiveBytes.fetch_sub((s64)Bytes, std::memory_order_relaxed);
+    }
+
+    // Bytes per hit picks the level, the smallest that holds what one hit processed
+    void PrintRooflinePercent(const ProfileAnchor* Anchor, f64 BytesPerSecond)
     {
-        fprintf(stdout, "    %s[%llu]: ", Anchor->Name, Anchor->HitCount);
+        u64 BytesPerHit = Anchor->BytesProcessed / (Anchor->HitCount ? Anchor->HitCount : 1);
+        u32 Level = (u32)MemoryLevel::L1;
+        while (Level < (u32)MemoryLevel::DRAM && BytesPerHit > Roofline.CacheSizes[Level]) { Level++; }
+
+        f64 Ceiling = Roofline.ReadBandwidth[Level];
+        if (Ceiling > 0.0)
+        {
+            fprintf(stdout, " (%.0f%% of %s read)", 100.0 * BytesPerSecond / Ceiling, GetMemoryLevelName((MemoryLevel)Level));
+        }
+    }
+
+    void PrintRoofline()
+    {
+        constexpr f64 Gigabyte = 1024.0 * 1024.0 * 1024.0;
+        fprintf(stdout, "Roofline (1 core):");
+        for (u32 Level = 0; Level < (u32)MemoryLevel::Count; Level++)
+        {
+            fprintf(stdout, " %s %.1fgb/s,", GetMemoryLevelName((MemoryLevel)Level), Roofline.ReadBandwidth[Level] / Gigabyte);
+        }
+        fprintf(stdout, " f64 scalar %.1f / x%u %.1f GFLOP/s\n",
+                Roofline.ScalarFlops / 1.0e9, Roofline.SimdWidth, Roofline.SimdFlops / 1.0e9);
+    }
+
+    void PrintAllocs(const AllocAnchor* Allocs)
+    {
+        constexpr f64 Megabyte = 1024.0 * 1024.0;
+        if (Allocs->Count)
+        {
+            fprintf(stdout, "        allocated %.3fmb in %llu allocations, peak live %.3fmb\n",
+                    (f64)Allocs->Bytes / Megabyte, Allocs->Count, (f64)Allocs->PeakLive / Megabyte);
+        }
+        else { fprintf(stdout, "        no allocations, peak live %.3fmb\n", (f64)Allocs->PeakLive / Megabyte); }
+    }
+
+    void PrintCounters(const ProfileAnchor* Anchor, const CounterAnchor* Counters)
+    {
+        const u64* Values = Counters->Inclusive;
+        fprintf(stdout, "        IPC %.2f", Values[0] ? (f64)Values[1] / (f64)Values[0] : 0.0);
+        for (int CounterIdx = 2; CounterIdx < ActiveCounterCount; CounterIdx++)
+        {
+            if (Anchor->BytesProcessed)
+            {
+                fprintf(stdout, ", %s %.5f/byte", ActiveCounters[CounterIdx].Name, (f64)Values[CounterIdx] / (f64)Anchor->BytesProcessed);
+            }
+            else
+            {
+                fprintf(stdout, ", %s %.1f/hit", ActiveCounters[CounterIdx].Name, (f64)Values[CounterIdx] / (f64)Anchor->HitCount);
+            }
+        }
+        fprintf(stdout, "\n");
+    }
+
+    // Counters/Allocs are nullptr without EnableCounters/EnableAllocTracking
+    void PrintAnchor(u64 TotalTime, u64 Freq, const char* Prefix, ProfileAnchor* Anchor,
+                     const CounterAnchor* Counters, const AllocAnchor* Allocs)
+    {
+        fprintf(stdout, "    %s%s[%llu]: ", Prefix, Anchor->Name, Anchor->HitCount);
         constexpr bool bPrintMilliseconds = true;
         if (bPrintMilliseconds)
         {
@@ -140,39 +783,530 @@ namespace Perf
             f64 GigabytesProcessedPerSecond = BytesPerSecond / Gigabyte;
 
             f64 MilliSeconds = (f64)Anchor->TimeElapsedInclusive / (f64)Freq * 1000.0;
-            fprintf(stdout, "    %.3fmb at %.2fgb/s\n", MegabytesProcessed, GigabytesProcessedPerSecond);
+            fprintf(stdout, "    %.3fmb at %.2fgb/s", MegabytesProcessed, GigabytesProcessedPerSecond);
+            if (bRoofline) { PrintRooflinePercent(Anchor, BytesPerSecond); }
+            fprintf(stdout, "\n");
+        }
+        if ((Counters || Allocs) && !Anchor->BytesProcessed) { fprintf(stdout, "\n"); }
+        if (Counters) { PrintCounters(Anchor, Counters); }
+        if (Allocs) { PrintAllocs(Allocs); }
+        fprintf(stdout, "\n");
+    }
+
+    // Totals of every thread's table first, then each thread's share when there's more than one,
+    // threads that already exited share one line (see RetireThread)
+    // Percentages are of the wall time between Begin/EndProfiling, anchors hit on several threads can add up past 100%
+    void PrintAnchors(u64 TotalTime, u64 Freq)
+    {
+        // Held throughout, a thread exiting now would move its counts mid-print
+        std::lock_guard<std::mutex> Lock(ProfileMutex);
+        u32 TableCount = ProfileCount + (RetiredProfile ? 1 : 0);
+        ThreadProfile** Profiles = new ThreadProfile*[TableCount];
+        for (ThreadProfile* Profile = FirstProfile; Profile; Profile = Profile->Next) { Profiles[Profile->ThreadIdx] = Profile; }
+        if (RetiredProfile) { Profiles[ProfileCount] = RetiredProfile; }
+
+        for (int Idx = 0; Idx < MaxAnchors; Idx++)
+        {
+            ProfileAnchor Total = {};
+            CounterAnchor TotalCounters = {};
+            bool bCounters = false;
+            AllocAnchor TotalAllocs = {};
+            u32 ThreadCount = 0;
+            for (u32 ProfileIdx = 0; ProfileIdx < TableCount; ProfileIdx++)
+            {
+                const ProfileAnchor& Anchor = Profiles[ProfileIdx]->Anchors[Idx];
+                if (!Anchor.TimeElapsedInclusive) { continue; }
+                if (!Total.Name) { Total.Name = Anchor.Name; }
+                Total.HitCount += Anchor.HitCount;
+                Total.TimeElapsedExclusive += Anchor.TimeElapsedExclusive;
+                Total.TimeElapsedInclusive += Anchor.TimeElapsedInclusive;
+                Total.BytesProcessed += Anchor.BytesProcessed;
+                ThreadCount++;
+                if (const CounterAnchor* Counters = Profiles[ProfileIdx]->Counters)
+                {
+                    for (int CounterIdx = 0; CounterIdx < ActiveCounterCount; CounterIdx++)
+                    {
+                        TotalCounters.Inclusive[CounterIdx] += Counters[Idx].Inclusive[CounterIdx];
+                        TotalCounters.Exclusive[CounterIdx] += Counters[Idx].Exclusive[CounterIdx];
+                    }
+                    bCounters = true;
+                }
+                if (const AllocAnchor* Allocs = Profiles[ProfileIdx]->Allocs)
+                {
+                    TotalAllocs.Bytes += Allocs[Idx].Bytes;
+                    TotalAllocs.Count += Allocs[Idx].Count;
+                    // Every thread's peak is of the same process-wide live bytes
+                    if (Allocs[Idx].PeakLive > TotalAllocs.PeakLive) { TotalAllocs.PeakLive = Allocs[Idx].PeakLive; }
+                }
+            }
+            if (!ThreadCount) { continue; }
+
+            PrintAnchor(TotalTime, Freq, "", &Total, bCounters ? &TotalCounters : nullptr, bTrackAllocs ? &TotalAllocs : nullptr);
+            if (ThreadCount < 2) { continue; }
+            for (u32 ProfileIdx = 0; ProfileIdx < TableCount; ProfileIdx++)
+            {
+                ProfileAnchor Anchor = Profiles[ProfileIdx]->Anchors[Idx];
+                if (!Anchor.TimeElapsedInclusive) { continue; }
+                char Prefix[48];
+                if (Profiles[ProfileIdx] == RetiredProfile)
+                {
+                    (void)sprintf_s(Prefix, sizeof(Prefix), "    %u exited threads: ", RetiredThreadCount);
+                }
+                else { (void)sprintf_s(Prefix, sizeof(Prefix), "    thread %u: ", Profiles[ProfileIdx]->ThreadIdx); }
+                const CounterAnchor* Counters = Profiles[ProfileIdx]->Counters;
+                const AllocAnchor* Allocs = Profiles[ProfileIdx]->Allocs;
+                PrintAnchor(TotalTime, Freq, Prefix, &Anchor, Counters ? Counters + Idx : nullptr, Allocs ? Allocs + Idx : nullptr);
+            }
+        }
+
+        delete[] Profiles;
+    }
+
+    void AddAllocTotals(AllocAnchor* Total, const ThreadProfile* Profile)
+    {
+        if (!Profile || !Profile->Allocs) { return; }
+        if (Profile->PeakLive > Total->PeakLive) { Total->PeakLive = Profile->PeakLive; }
+        for (int Idx = 0; Idx < MaxAnchors; Idx++)
+        {
+            const AllocAnchor& Allocs = Profile->Allocs[Idx];
+            Total->Bytes += Allocs.Bytes;
+            Total->Count += Allocs.Count;
+            if (Allocs.PeakLive > Total->PeakLive) { Total->PeakLive = Allocs.PeakLive; }
+        }
+    }
+
+    // Every thread (exited ones too) and anchor, allocations outside any scope included
+    void PrintAllocTotals()
+    {
+        AllocAnchor Total = {};
+        std::lock_guard<std::mutex> Lock(ProfileMutex);
+        for (ThreadProfile* Profile = FirstProfile; Profile; Profile = Profile->Next) { AddAllocTotals(&Total, Profile); }
+        AddAllocTotals(&Total, RetiredProfile);
+
+        constexpr f64 Megabyte = 1024.0 * 1024.0;
+        fprintf(stdout, "Tracked allocations: %.3fmb in %llu allocations, peak live %.3fmb, %.3fmb still live\n",
+                (f64)Total.Bytes / Megabyte, Total.Count, (f64)Total.PeakLive / Megabyte,
+                (f64)LiveBytes.load() / Megabyte);
+    }
+
+    // "none", "rdpmc", "read()", or "rdpmc + read() for page faults"
+    void PrintReadSet(u32 ReadSet)
+    {
+        u32 ReadMask = ReadSet ? ReadSet - 1 : 0;
+        if (!ReadSet) { fprintf(stdout, "none"); }
+        else if (!ReadMask) { fprintf(stdout, "rdpmc"); }
+        else if (ReadMask == (1u << ActiveCounterCount) - 1) { fprintf(stdout, "read()"); }
+        else
+        {
+            const char* Separator = " ";
+            fprintf(stdout, "rdpmc + read() for");
+            for (int CounterIdx = 0; CounterIdx < ActiveCounterCount; CounterIdx++)
+            {
+                if (!(ReadMask & (1u << CounterIdx))) { continue; }
+                fprintf(stdout, "%s%s", Separator, ActiveCounters[CounterIdx].Name);
+                Separator = "/";
+            }
+        }
+    }
+
+    // Live threads by ThreadIdx, then how many exited threads had each read set,
+    // and a warning per counter some thread had to read() with what that costs
+    void PrintCounterReads()
+    {
+        std::lock_guard<std::mutex> Lock(ProfileMutex);
+        ThreadProfile** Profiles = new ThreadProfile*[ProfileCount];
+        for (ThreadProfile* Profile = FirstProfile; Profile; Profile = Profile->Next) { Profiles[Profile->ThreadIdx] = Profile; }
+
+        u32 ReadThreadCounts[MaxCounters] = {};
+        const char* Separator = " ";
+        fprintf(stdout, "Counter reads:");
+        for (u32 ProfileIdx = 0; ProfileIdx < ProfileCount; ProfileIdx++)
+        {
+            if (Profiles[ProfileIdx]->bFree) { continue; }
+            u32 ReadSet = Profiles[ProfileIdx]->ReadSet;
+            fprintf(stdout, "%sthread %u ", Separator, ProfileIdx);
+            PrintReadSet(ReadSet);
+            for (int CounterIdx = 0; ReadSet && CounterIdx < ActiveCounterCount; CounterIdx++)
+            {
+                if ((ReadSet - 1) & (1u << CounterIdx)) { ReadThreadCounts[CounterIdx]++; }
+            }
+            Separator = ", ";
+        }
+        if (RetiredThreadCount)
+        {
+            fprintf(stdout, "%s%u exited threads:", Separator, RetiredThreadCount);
+            Separator = " ";
+            for (u32 ReadSet = 0; ReadSet < ReadSetCount; ReadSet++)
+            {
+                if (!RetiredReadSetCounts[ReadSet]) { continue; }
+                fprintf(stdout, "%s%u ", Separator, RetiredReadSetCounts[ReadSet]);
+                PrintReadSet(ReadSet);
+                for (int CounterIdx = 0; ReadSet && CounterIdx < ActiveCounterCount; CounterIdx++)
+                {
+                    if ((ReadSet - 1) & (1u << CounterIdx)) { ReadThreadCounts[CounterIdx] += RetiredReadSetCounts[ReadSet]; }
+                }
+                Separator = ", ";
+            }
+        }
+        fprintf(stdout, "\n");
+        for (int CounterIdx = 0; CounterIdx < ActiveCounterCount; CounterIdx++)
+        {
+            if (!ReadThreadCounts[CounterIdx]) { continue; }
+            fprintf(stdout, "WARNING: %s read with read() on %u threads, two syscalls of ~%llu cycles per scope "
+                    "(-counters branch/cache have no software counters)!\n",
+                    ActiveCounters[CounterIdx].Name, ReadThreadCounts[CounterIdx], CounterReadCycles[CounterIdx]);
+        }
+        delete[] Profiles;
+    }
+
+    // Times empty scopes on anchor 0 (the root every top level scope subtracts from, never printed)
+    // and puts it back after, the fastest of OverheadSampleCount is taken so noise is never subtracted
+    // Profile is the calling thread's, measured with whatever counters/tracing it has on
+    void MeasureScopeOverhead(ThreadProfile* Profile)
+    {
+        constexpr int OverheadSampleCount = 4096;
+
+        ProfileAnchor SavedRoot = Profile->Anchors[0];
+        CounterAnchor SavedRootCounters = Profile->Counters ? Profile->Counters[0] : CounterAnchor{};
+        u64 SavedEventCount = Profile->EventCount;
+        Profile->ScopeOverheadInside = 0;
+        Profile->ScopeOverheadOutside = 0;
+
+        u64 MinTimerRead = ~0ull;
+        u64 MinInside = ~0ull;
+        u64 MinTotal = ~0ull;
+        for (int SampleIdx = 0; SampleIdx < OverheadSampleCount; SampleIdx++)
+        {
+            u64 Begin = ReadCPUTimer();
+            u64 TimerRead = ReadCPUTimer() - Begin;
+
+            u64 OldInclusive = Profile->Anchors[0].TimeElapsedInclusive;
+            Begin = ReadCPUTimer();
+            {
+                ScopedTiming Empty("", 0, 0);
+            }
+            u64 Total = ReadCPUTimer() - Begin;
+            u64 Inside = Profile->Anchors[0].TimeElapsedInclusive - OldInclusive;
+
+            if (TimerRead < MinTimerRead) { MinTimerRead = TimerRead; }
+            if (Inside < MinInside) { MinInside = Inside; }
+            if (Total < MinTotal) { MinTotal = Total; }
+        }
+
+        Profile->Anchors[0] = SavedRoot;
+        if (Profile->Counters) { Profile->Counters[0] = SavedRootCounters; }
+        Profile->EventCount = SavedEventCount;
+        // Total includes one timer read of the outer pair, like Inside does of the scope's
+        MinTotal = MinTotal > MinTimerRead ? MinTotal - MinTimerRead : 0;
+        Profile->ScopeOverheadInside = MinInside;
+        Profile->ScopeOverheadOutside = MinTotal > MinInside ? MinTotal - MinInside : 0;
+    }
+
+    // One entry per read set some thread had
+    void PrintScopeOverheads()
+    {
+        std::lock_guard<std::mutex> Lock(OverheadMutex);
+        const char* Separator = " ";
+        fprintf(stdout, "Profiler overhead per scope, taken out of every anchor:");
+        for (u32 ReadSet = 0; ReadSet < ReadSetCount; ReadSet++)
+        {
+            if (!bScopeOverheadMeasured[ReadSet]) { continue; }
+            fprintf(stdout, "%s%llu cycles (%llu of them inside it) ", Separator,
+                    ScopeOverheadInside[ReadSet] + ScopeOverheadOutside[ReadSet], ScopeOverheadInside[ReadSet]);
+            if (ReadSet)
+            {
+                fprintf(stdout, "with counters via ");
+                PrintReadSet(ReadSet);
+            }
+            else { fprintf(stdout, "without counters"); }
+            Separator = ", ";
         }
         fprintf(stdout, "\n");
     }
 
+    void WriteTrace(u64 Freq)
+    {
+        FILE* FileHandle = nullptr;
+        fopen_s(&FileHandle, TraceFileName, "wb");
+        if (!FileHandle)
+        {
+            fprintf(stdout, "ERROR: Could not open file %s for write!\n", TraceFileName);
+            return;
+        }
+
+        f64 MicrosecondsPerCycle = Freq ? 1.0e6 / (f64)Freq : 0.0;
+        u64 WrittenCount = 0;
+        u64 DroppedCount = 0;
+        fprintf(FileHandle, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n");
+        fprintf(FileHandle, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"args\": {\"name\": \"haversine\"}}");
+        std::lock_guard<std::mutex> Lock(ProfileMutex);
+        for (ThreadProfile* Profile = FirstProfile; Profile; Profile = Profile->Next)
+        {
+            fprintf(FileHandle, ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %u, \"args\": {\"name\": \"%s %u\"}}",
+                    Profile->ThreadIdx, Profile->ThreadIdx ? "thread" : "main", Profile->ThreadIdx);
+            if (!Profile->Events) { continue; }
+
+            u64 FirstEvent = Profile->EventCount > TraceEventCount ? Profile->EventCount - TraceEventCount : 0;
+            for (u64 EventIdx = FirstEvent; EventIdx < Profile->EventCount; EventIdx++)
+            {
+                const TraceEvent& Event = Profile->Events[EventIdx & (TraceEventCount - 1)];
+                // Scopes opened before BeginProfiling would get negative timestamps
+                f64 Begin = Event.Begin > TotalBegin ? (f64)(Event.Begin - TotalBegin) * MicrosecondsPerCycle : 0.0;
+                fprintf(FileHandle, ",\n{\"name\": \"%s\", \"cat\": \"anchor\", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, \"pid\": 1, \"tid\": %u}",
+                        Profile->Anchors[Event.Index].Name, Begin, (f64)(Event.End - Event.Begin) * MicrosecondsPerCycle, Profile->ThreadIdx);
+            }
+            WrittenCount += Profile->EventCount - FirstEvent;
+            DroppedCount += FirstEvent;
+        }
+        fprintf(FileHandle, "\n]}\n");
+        bool bOk = fclose(FileHandle) == 0;
+
+        if (bOk)
+        {
+            fprintf(stdout, "Wrote %llu trace events to %s", WrittenCount, TraceFileName);
+            if (DroppedCount) { fprintf(stdout, " (%llu older ones were overwritten, %u per thread fit)", DroppedCount, TraceEventCount); }
+            fprintf(stdout, "\n");
+        }
+        else { fprintf(stdout, "ERROR: Failed writing to file %s!\n", TraceFileName); }
+    }
+
+#endif // ENABLE_PROFILER
+
+    bool EnableTracing(const char* FileName)
+    {
+#if ENABLE_PROFILER
+        TraceFileName = FileName;
+        return true;
+#else
+        (void)FileName;
+        return false;
+#endif // ENABLE_PROFILER
+    }
+
+    const char* GetMemoryLevelName(MemoryLevel Level)
+    {
+        static const char* LevelNames[] = { "L1", "L2", "L3", "DRAM" };
+        static_assert(sizeof(LevelNames) / sizeof(LevelNames[0]) == (size_t)MemoryLevel::Count, "Missing memory level name");
+        return (u32)Level < (u32)MemoryLevel::Count ? LevelNames[(u32)Level] : "";
+    }
+
+    void EnableRoofline(const RooflineCeilings& Ceilings)
+    {
+#if ENABLE_PROFILER
+        Roofline = Ceilings;
+        bRoofline = true;
+#else
+        (void)Ceilings;
+#endif // ENABLE_PROFILER
+    }
+
+    bool EnableAllocTracking()
+    {
+#if ENABLE_PROFILER
+        bTrackAllocs = true;
+        return true;
+#else
+        return false;
 #endif // ENABLE_PROFILER
+    }
+
+    bool ParseCounterSet(const char* Name, CounterSet* OutSet)
+    {
+        static const char* SetNames[] = { "none", "default", "branch", "cache" };
+        static_assert(sizeof(SetNames) / sizeof(SetNames[0]) == (size_t)CounterSet::Count, "CounterSet names out of sync");
+        for (u32 Idx = 0; Idx < (u32)CounterSet::Count; Idx++)
+        {
+            if (strcmp(Name, SetNames[Idx]) == 0)
+            {
+                *OutSet = (CounterSet)Idx;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool EnableCounters(CounterSet Set)
+    {
+#if ENABLE_PROFILER && !_WIN32
+        switch (Set)
+        {
+            case CounterSet::Default: { ActiveCounters = DefaultCounters; ActiveCounterCount = sizeof(DefaultCounters) / sizeof(CounterDesc); } break;
+            case CounterSet::Branch: { ActiveCounters = BranchCounters; ActiveCounterCount = sizeof(BranchCounters) / sizeof(CounterDesc); } break;
+            case CounterSet::Cache: { ActiveCounters = CacheCounters; ActiveCounterCount = sizeof(CacheCounters) / sizeof(CounterDesc); } break;
+            default: { ActiveCounters = nullptr; ActiveCounterCount = 0; } break;
+        }
+        return true;
+#else
+        (void)Set;
+        return false;
+#endif // ENABLE_PROFILER && !_WIN32
+    }
 
     void BeginProfiling()
     {
+        EstimateCPUFreq();
+#if ENABLE_PROFILER
+        // Registers the calling thread first, so it's thread 0 (and its scope overhead is measured before TotalBegin)
+        GetThreadProfile();
+#endif // ENABLE_PROFILER
+        FaultsBegin = ReadPageFaults();
         TotalBegin = ReadCPUTimer();
     }
 
     void EndProfiling()
     {
         TotalEnd = ReadCPUTimer();
+        PageFaultCounts FaultsEnd = ReadPageFaults();
 
         u64 CPUFreq = EstimateCPUFreq();
         u64 TotalTime = TotalEnd - TotalBegin;
         if (CPUFreq)
         {
             f64 CPUFreq_GHz = (f64)CPUFreq / (1000.0 * 1000.0 * 1000.0);
-            fprintf(stdout, "\nTotal time: %0.4fms (CPU freq: %llu / ~%.2f GHz)\n", 1000.0 * (f64)TotalTime / (f64)CPUFreq, CPUFreq, CPUFreq_GHz);
+            fprintf(stdout, "\nTotal time: %0.4fms (CPU freq: %llu / ~%.2f GHz, %s)\n", 1000.0 * (f64)TotalTime / (f64)CPUFreq,
+                    CPUFreq, CPUFreq_GHz, GetCPUFreqInfo().Source);
         }
+        fprintf(stdout, "Page faults: %llu minor, %llu major\n",
+                FaultsEnd.Minor - FaultsBegin.Minor, FaultsEnd.Major - FaultsBegin.Major);
+        fprintf(stdout, "Peak RSS: %.3fmb\n", (f64)ReadPeakRSS() / (1024.0 * 1024.0));
 #if ENABLE_PROFILER
-        for (int Idx = 0; Idx < MaxAnchors; Idx++)
+        PrintScopeOverheads();
+        if (ActiveCounterCount) { PrintCounterReads(); }
+        if (bTrackAllocs) { PrintAllocTotals(); }
+        if (bRoofline) { PrintRoofline(); }
+        PrintAnchors(TotalTime, CPUFreq);
+        if (TraceFileName) { WriteTrace(CPUFreq); }
+#endif // ENABLE_PROFILER
+    }
+
+    void PrintRepetitionValue(const char* Label, RepetitionValue Value, u64 CPUFreq)
+    {
+        u64 TestCount = Value.TestCount ? Value.TestCount : 1;
+        f64 CPUTimer = (f64)Value.CPUTimer / (f64)TestCount;
+        f64 ByteCount = (f64)Value.ByteCount / (f64)TestCount;
+        f64 PageFaults = (f64)Value.PageFaults / (f64)TestCount;
+
+        fprintf(stdout, "%s: %.0f cycles", Label, CPUTimer);
+        if (CPUFreq)
         {
-            ProfileAnchor* Anchor = Anchors + Idx;
-            if (Anchor->TimeElapsedInclusive)
+            f64 Seconds = CPUTimer / (f64)CPUFreq;
+            fprintf(stdout, " (%0.4f ms)", 1000.0 * Seconds);
+            if (ByteCount > 0.0)
             {
-                PrintAnchor(TotalTime, CPUFreq, Anchor);
+                constexpr f64 Gigabyte = 1024.0 * 1024.0 * 1024.0;
+                fprintf(stdout, " %.2fgb/s", ByteCount / (Gigabyte * Seconds));
             }
         }
-#endif // ENABLE_PROFILER
+        if (PageFaults > 0.0)
+        {
+            fprintf(stdout, " PF: %0.4f (%0.4fk/fault)", PageFaults, ByteCount / (PageFaults * 1024.0));
+        }
+    }
+}
+
+void Perf::RepetitionTester::NewTestWave(u64 TargetProcessedByteCount_, u64 CPUTimerFreq_, u32 SecondsToTry)
+{
+    if (Mode == TestMode::Uninitialized)
+    {
+        Mode = TestMode::Testing;
+        TargetProcessedByteCount = TargetProcessedByteCount_;
+        CPUTimerFreq = CPUTimerFreq_;
+        bPrintNewMinimums = true;
+        Results.Min.CPUTimer = UINT64_MAX;
+    }
+    else if (Mode == TestMode::Completed)
+    {
+        Mode = TestMode::Testing;
+        if (TargetProcessedByteCount != TargetProcessedByteCount_) { Error("TargetProcessedByteCount changed"); }
+        if (CPUTimerFreq != CPUTimerFreq_) { Error("CPU frequency changed"); }
+    }
+    TryForTime = SecondsToTry * CPUTimerFreq;
+    TestsStartedAt = ReadCPUTimer();
+}
+
+void Perf::RepetitionTester::BeginTime()
+{
+    ++OpenBlockCount;
+    // Page faults first, so reading them isn't part of the timed region
+    PageFaultCounts Faults = ReadPageFaults();
+    Accumulated.PageFaults -= Faults.Minor + Faults.Major;
+    Accumulated.CPUTimer -= ReadCPUTimer();
+}
+
+void Perf::RepetitionTester::EndTime()
+{
+    Accumulated.CPUTimer += ReadCPUTimer();
+    PageFaultCounts Faults = ReadPageFaults();
+    Accumulated.PageFaults += Faults.Minor + Faults.Major;
+    ++CloseBlockCount;
+}
+
+void Perf::RepetitionTester::CountBytes(u64 ByteCount)
+{
+    Accumulated.ByteCount += ByteCount;
+}
+
+void Perf::RepetitionTester::Error(const char* Message)
+{
+    Mode = TestMode::Error;
+    fprintf(stdout, "ERROR: %s!\n", Message);
+}
+
+bool Perf::RepetitionTester::IsTesting()
+{
+    if (Mode == TestMode::Testing)
+    {
+        u64 CurrentTime = ReadCPUTimer();
+        // Nothing timed yet means IsTesting() opens the wave, not the end of a run
+        if (OpenBlockCount)
+        {
+            if (OpenBlockCount != CloseBlockCount) { Error("Unbalanced BeginTime/EndTime"); }
+            if (Accumulated.ByteCount != TargetProcessedByteCount) { Error("Processed byte count mismatch"); }
+
+            if (Mode == TestMode::Testing)
+            {
+                RepetitionValue Value = Accumulated;
+                Value.TestCount = 1;
+                Results.Total.TestCount += 1;
+                Results.Total.CPUTimer += Value.CPUTimer;
+                Results.Total.PageFaults += Value.PageFaults;
+                Results.Total.ByteCount += Value.ByteCount;
+                if (Results.Max.CPUTimer < Value.CPUTimer) { Results.Max = Value; }
+                if (Results.Min.CPUTimer > Value.CPUTimer)
+                {
+                    Results.Min = Value;
+                    // A new minimum restarts the clock
+                    TestsStartedAt = CurrentTime;
+                    if (bPrintNewMinimums)
+                    {
+                        PrintRepetitionValue("Min", Results.Min, CPUTimerFreq);
+                        fprintf(stdout, "               \r");
+                        fflush(stdout);
+                    }
+                }
+
+                OpenBlockCount = 0;
+                CloseBlockCount = 0;
+                Accumulated = {};
+            }
+        }
+
+        if (Mode == TestMode::Testing && CurrentTime - TestsStartedAt > TryForTime)
+        {
+            Mode = TestMode::Completed;
+            PrintResults();
+        }
     }
+    return Mode == TestMode::Testing;
+}
 
+void Perf::RepetitionTester::PrintResults()
+{
+    PrintRepetitionValue("Min", Results.Min, CPUTimerFreq);
+    fprintf(stdout, "                    \n");
+    PrintRepetitionValue("Max", Results.Max, CPUTimerFreq);
+    fprintf(stdout, "\n");
+    PrintRepetitionValue("Avg", Results.Total, CPUTimerFreq);
+    fprintf(stdout, "\n");
+    fprintf(stdout, "Runs: %llu\n", Results.Total.TestCount);
 }
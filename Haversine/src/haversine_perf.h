@@ -12,7 +12,23 @@ namespace Perf
     u64 ReadOSTimer();
     u64 GetOSFreq();
     u64 ReadCPUTimer();
+    // TSC frequency from CPUID leaf 0x15, else the kernel's calibration (Linux), else measured against
+    // the OS timer for 10ms, detected on the first call and cached after that
     u64 EstimateCPUFreq();
+    // OutRegs: EAX, EBX, ECX, EDX
+    void ReadCPUID(u32 Leaf, u32 SubLeaf, u32* OutRegs);
+
+    struct PageFaultCounts
+    {
+        u64 Minor; // Satisfied without I/O (page cache hits, zero pages, copy on write)
+        u64 Major; // Needed I/O
+    };
+    PageFaultCounts ReadPageFaults();
+    // Most resident memory the process has had so far, in bytes
+    u64 ReadPeakRSS();
+
+    // Hardware counters per anchor (see EnableCounters), cycles and instructions are always the first two
+    static constexpr int MaxCounters = 5;
 
     struct ProfileAnchor
     {
@@ -23,20 +39,171 @@ namespace Perf
         u64 BytesProcessed;
     };
 
+    // NOTE:
+    //      Every thread that opens a ScopedTiming gets its own anchor table and
+    //      parent index (registered under a lock the first time, never after), so
+    //      the hot path only touches thread-local memory, no atomics
+    //      EndProfiling merges the tables: each anchor's total over all threads,
+    //      plus a line per thread when more than one thread hit it
+    //      A thread that exits hands its counts to one "exited threads" line and its
+    //      table to the next thread that starts, so short-lived threads don't pile up
+    //      An empty ScopedTiming's cost is measured once per set of counters read
+    //      with read() instead of rdpmc (or none open), by the first thread that
+    //      registers with that set, and every scope
+    //      takes its thread's value out of its own time and its ancestors', so an anchor
+    //      with many small children isn't charged for the timer reads around them
     struct ScopedTiming
     {
         const char* Name;
+        ProfileAnchor* Anchors; // The calling thread's table
         u64 OldTimeElapsedInclusive;
+        u64 OldOverheadCycles; // Thread's overhead so far, the difference at the end is what nested scopes cost
         u64 StartTime;
         u32 ParentIndex;
         u32 Index;
+        // Only used with EnableCounters
+        u64 OldCountersInclusive[MaxCounters];
+        u64 CountersBegin[MaxCounters];
+        // Only used with EnableAllocTracking
+        u64 OldPeakLive;
 
         ScopedTiming(const char* Name_, u32 Index_, u64 Bytes_);
         ~ScopedTiming();
     };
 
+    // Adds time measured outside a ScopedTiming (e.g. by another thread) to an anchor
+    // of the calling thread's table, it isn't subtracted from any parent
+    void RecordTiming(const char* Name, u32 Index, u64 Cycles, u64 Bytes);
+
     void BeginProfiling();
     void EndProfiling();
+
+    // NOTE:
+    //      Optional timeline of every ScopedTiming (ENABLE_PROFILER builds only),
+    //      each scope writes one complete event (begin/end TSC, anchor) into a
+    //      preallocated ring of TraceEventCount per thread, the oldest are
+    //      overwritten when it wraps. EndProfiling writes them as Chrome trace
+    //      JSON (chrome://tracing, ui.perfetto.dev) in microseconds since
+    //      BeginProfiling, one track per profiler thread (tid = thread index)
+    //      Has to be called before BeginProfiling, returns false if tracing isn't compiled in
+    bool EnableTracing(const char* FileName);
+
+    enum struct CounterSet : u32
+    {
+        None,
+        Default, // Branch misses, LLC misses, page faults
+        Branch, // Branches, branch misses
+        Cache, // L1D read misses, LLC references, LLC misses
+        Count
+    };
+
+    bool ParseCounterSet(const char* Name, CounterSet* OutSet);
+
+    // NOTE:
+    //      Optional hardware counters on every anchor (Linux, ENABLE_PROFILER builds only):
+    //      each profiler thread opens the set as one perf_event_open group (user mode
+    //      only) on its first scope and reads it with rdpmc when the kernel allows it
+    //      (read() otherwise, and always for the page fault software counter)
+    //      PrintAnchor adds IPC (core cycles, not TSC) and each counter per byte
+    //      processed (per hit for anchors without a byte count), inclusive like gb/s
+    //      Has to be called before BeginProfiling, returns false if counters aren't available
+    bool EnableCounters(CounterSet Set);
+
+    // NOTE:
+    //      Optional allocation tracker (ENABLE_PROFILER builds only), fed by TRACK_ALLOC /
+    //      TRACK_FREE at the project's own allocation sites (JSON trees, DynamicArray,
+    //      file contents, HLists), not by a global operator new
+    //      Each allocation is charged to the innermost open scope of the calling thread
+    //      (bytes and count, not including children), and every anchor keeps the most live
+    //      tracked bytes (all threads) seen by an allocation while it was open, children included
+    //      Has to be called before BeginProfiling, returns false if the tracker isn't compiled in
+    bool EnableAllocTracking();
+    void RecordAlloc(u64 Bytes);
+    void RecordFree(u64 Bytes);
+
+    enum struct MemoryLevel : u32
+    {
+        L1,
+        L2,
+        L3,
+        DRAM,
+        Count
+    };
+
+    const char* GetMemoryLevelName(MemoryLevel Level);
+
+    // Single core ceilings of this machine, measured by Haversine_Roofline
+    struct RooflineCeilings
+    {
+        u64 CacheSizes[(u32)MemoryLevel::Count]; // Bytes per core (L1 data, L2, L3 slice), DRAM is 0
+        f64 ReadBandwidth[(u32)MemoryLevel::Count]; // Bytes per second
+        f64 ScalarFlops; // f64 multiply-adds, 2 FLOPs each
+        f64 SimdFlops; // The same on Haversine_Math::WideLane
+        u32 SimdWidth;
+    };
+
+    // NOTE:
+    //      Optional roofline report (ENABLE_PROFILER builds only): EndProfiling prints
+    //      the ceilings, and every anchor with a byte count gets its gb/s as a percent
+    //      of the read bandwidth of the smallest level that holds what one hit processed
+    //      (bytes / hits, so a scope over a 20mb file compares against L3 or DRAM)
+    //      Anchors don't count FLOPs, the compute ceilings are printed for reference
+    //      Has to be called before EndProfiling
+    void EnableRoofline(const RooflineCeilings& Ceilings);
+
+    // NOTE:
+    //      Runs one target over and over (while IsTesting()) until a whole
+    //      SecondsToTry pass without a new fastest run, then reports the min/max/mean
+    //      of the runs, so first-run costs (page faults, cold caches) can be told
+    //      apart from the steady state. Works with or without ENABLE_PROFILER
+    //      Each run is BeginTime/EndTime (as many pairs as needed) plus CountBytes,
+    //      which has to add up to TargetProcessedByteCount for the run to count
+    struct RepetitionValue
+    {
+        u64 TestCount;
+        u64 CPUTimer;
+        u64 PageFaults; // Minor + major
+        u64 ByteCount;
+    };
+
+    struct RepetitionTestResults
+    {
+        RepetitionValue Total;
+        RepetitionValue Min;
+        RepetitionValue Max;
+    };
+
+    enum struct TestMode : u32
+    {
+        Uninitialized,
+        Testing,
+        Completed,
+        Error
+    };
+
+    struct RepetitionTester
+    {
+        TestMode Mode;
+        u64 TargetProcessedByteCount;
+        u64 CPUTimerFreq;
+        u64 TryForTime;
+        u64 TestsStartedAt;
+        u32 OpenBlockCount;
+        u32 CloseBlockCount;
+        RepetitionValue Accumulated; // Of the current run
+        RepetitionTestResults Results;
+        bool bPrintNewMinimums;
+
+        // Keeps Results (and the byte count) when called again after Completed, so a wave can continue the last one
+        void NewTestWave(u64 TargetProcessedByteCount_, u64 CPUTimerFreq_, u32 SecondsToTry = 10);
+        void BeginTime();
+        void EndTime();
+        void CountBytes(u64 ByteCount);
+        void Error(const char* Message);
+        // Closes the current run, false once the wave is done (or failed)
+        bool IsTesting();
+        void PrintResults();
+    };
 }
 
 #define PROFILING_BEGIN() Perf::BeginProfiling()
@@ -46,11 +213,17 @@ namespace Perf
 #define TIME_BLOCK(name) Perf::ScopedTiming _ST_##name(#name, __COUNTER__ + 1, 0)
 #define TIME_FUNC_DATA(ByteCount) Perf::ScopedTiming _ST_##__func__(__func__, __COUNTER__ + 1, ByteCount)
 #define TIME_BLOCK_DATA(name, ByteCount) Perf::ScopedTiming _ST_##name(#name, __COUNTER__ + 1, ByteCount)
+#define RECORD_TIMING(name, Cycles, ByteCount) Perf::RecordTiming(#name, __COUNTER__ + 1, Cycles, ByteCount)
+#define TRACK_ALLOC(Bytes) Perf::RecordAlloc(Bytes)
+#define TRACK_FREE(Bytes) Perf::RecordFree(Bytes)
 #else
 #define TIME_FUNC() (void)0
 #define TIME_BLOCK(name) (void)0
 #define TIME_FUNC_DATA(ByteCount) (void)0
 #define TIME_BLOCK_DATA(name, ByteCount) (void)0
+#define RECORD_TIMING(name, Cycles, ByteCount) (void)0
+#define TRACK_ALLOC(Bytes) (void)0
+#define TRACK_FREE(Bytes) (void)0
 #endif // ENABLE_PROFILER
 
 #endif // HAVERSINE_PERF_H
@@ -0,0 +1,203 @@
+#include "haversine_pipeline.h"
+#include "haversine_perf.h"
+
+// C++ stdlib headers:
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace Haversine_Pipeline
+{
+    int DefaultChunkSize = 256 * 1024;
+    int DefaultQueueDepth = 0;
+
+    // Chunks are kept a multiple of this, so SIMD consumers never see a partial block before the last chunk
+    static constexpr int ChunkAlignment = 64;
+
+    struct ReaderState
+    {
+        FILE* FileHandle;
+        std::thread Thread;
+        std::mutex Mutex;
+        std::condition_variable ChunkReady;
+        std::condition_variable ChunkFree;
+
+        u8* Destination; // Either the caller's buffer or RingBuffer
+        u8* RingBuffer; // QueueDepth * ChunkSize bytes
+        u64 ChunkCount;
+        u64 ReadCount; // Chunks the reader has finished
+        u64 RecycledCount; // Chunks the consumer has given back
+        bool bDone;
+        bool bFailed;
+        bool bQuit;
+
+        // Reader thread only, reported from Close()
+        u64 ReadCycles;
+        u64 ReaderStallCycles;
+        u64 BytesRead;
+    };
+
+    s64 GetFileSize(FILE* FileHandle)
+    {
+#if _WIN32
+        _fseeki64(FileHandle, 0, SEEK_END);
+        s64 Size = _ftelli64(FileHandle);
+        _fseeki64(FileHandle, 0, SEEK_SET);
+#else // NOT _WIN32
+        fseeko(FileHandle, 0, SEEK_END);
+        s64 Size = ftello(FileHandle);
+        fseeko(FileHandle, 0, SEEK_SET);
+#endif // _WIN32
+        return Size;
+    }
+
+    u8* GetChunkData(ChunkReader* Reader, u64 ChunkIdx)
+    {
+        ReaderState* State = Reader->State;
+        if (State->RingBuffer) { return State->RingBuffer + (size_t)(ChunkIdx % (u64)Reader->QueueDepth) * Reader->ChunkSize; }
+        return State->Destination + (size_t)ChunkIdx * Reader->ChunkSize;
+    }
+
+    void ReaderThreadProc(ChunkReader* Reader)
+    {
+        ReaderState* State = Reader->State;
+        for (u64 ChunkIdx = 0; ChunkIdx < State->ChunkCount; ChunkIdx++)
+        {
+            {
+                // The consumer never recycles a chunk before it's read, so ChunkIdx >= RecycledCount
+                std::unique_lock<std::mutex> Lock(State->Mutex);
+                if (ChunkIdx - State->RecycledCount >= (u64)Reader->QueueDepth)
+                {
+                    u64 StallBegin = Perf::ReadCPUTimer();
+                    while (!State->bQuit && ChunkIdx - State->RecycledCount >= (u64)Reader->QueueDepth)
+                    {
+                        State->ChunkFree.wait(Lock);
+                    }
+                    State->ReaderStallCycles += Perf::ReadCPUTimer() - StallBegin;
+                }
+                if (State->bQuit) { break; }
+            }
+
+            u64 Offset = ChunkIdx * Reader->ChunkSize;
+            int Size = Reader->FileSize - Offset < (u64)Reader->ChunkSize ? (int)(Reader->FileSize - Offset) : Reader->ChunkSize;
+            u64 ReadBegin = Perf::ReadCPUTimer();
+            size_t BytesRead = fread_s(GetChunkData(Reader, ChunkIdx), Size, 1, Size, State->FileHandle);
+            State->ReadCycles += Perf::ReadCPUTimer() - ReadBegin;
+            State->BytesRead += BytesRead;
+
+            {
+                std::lock_guard<std::mutex> Lock(State->Mutex);
+                if ((int)BytesRead != Size)
+                {
+                    State->bFailed = true;
+                    State->bDone = true;
+                }
+                else
+                {
+                    State->ReadCount = ChunkIdx + 1;
+                    State->bDone = State->ReadCount == State->ChunkCount;
+                }
+            }
+            State->ChunkReady.notify_one();
+            if (State->bFailed) { break; }
+        }
+    }
+}
+
+bool Haversine_Pipeline::ChunkReader::Open(const char* FileName, int InChunkSize, int InQueueDepth)
+{
+    *this = {};
+
+    FILE* FileHandle = nullptr;
+    fopen_s(&FileHandle, FileName, "rb");
+    if (!FileHandle)
+    {
+        fprintf(stdout, "ERROR: Can't open file %s for read!\n", FileName);
+        return false;
+    }
+    s64 Size = GetFileSize(FileHandle);
+    if (Size < 0)
+    {
+        fprintf(stdout, "ERROR: Can't get the size of %s!\n", FileName);
+        fclose(FileHandle);
+        return false;
+    }
+
+    if (InChunkSize < ChunkAlignment) { InChunkSize = ChunkAlignment; }
+    if (InQueueDepth < 1) { InQueueDepth = 1; }
+    if (InQueueDepth > MaxQueueDepth) { InQueueDepth = MaxQueueDepth; }
+
+    FileSize = (u64)Size;
+    ChunkSize = (InChunkSize + ChunkAlignment - 1) / ChunkAlignment * ChunkAlignment;
+    QueueDepth = InQueueDepth;
+    State = new ReaderState{};
+    State->FileHandle = FileHandle;
+    State->ChunkCount = (FileSize + ChunkSize - 1) / ChunkSize;
+    return true;
+}
+
+void Haversine_Pipeline::ChunkReader::Start(u8* Destination)
+{
+    if (!State) { return; }
+
+    if (Destination) { State->Destination = Destination; }
+    else { State->RingBuffer = new u8[(size_t)QueueDepth * ChunkSize]; }
+    State->bDone = State->ChunkCount == 0;
+    State->Thread = std::thread(ReaderThreadProc, this);
+}
+
+bool Haversine_Pipeline::ChunkReader::Acquire(Chunk* OutChunk)
+{
+    if (!State) { return false; }
+
+    std::unique_lock<std::mutex> Lock(State->Mutex);
+    u64 ChunkIdx = State->RecycledCount;
+    if (State->ReadCount <= ChunkIdx && !State->bDone)
+    {
+        TIME_BLOCK(Pipeline_ParserStall);
+        while (State->ReadCount <= ChunkIdx && !State->bDone)
+        {
+            State->ChunkReady.wait(Lock);
+        }
+    }
+    if (State->ReadCount <= ChunkIdx) { return false; }
+
+    OutChunk->Data = GetChunkData(this, ChunkIdx);
+    OutChunk->Offset = ChunkIdx * ChunkSize;
+    OutChunk->Size = FileSize - OutChunk->Offset < (u64)ChunkSize ? (int)(FileSize - OutChunk->Offset) : ChunkSize;
+    return true;
+}
+
+void Haversine_Pipeline::ChunkReader::Recycle()
+{
+    if (!State) { return; }
+
+    {
+        std::lock_guard<std::mutex> Lock(State->Mutex);
+        State->RecycledCount++;
+    }
+    State->ChunkFree.notify_one();
+}
+
+bool Haversine_Pipeline::ChunkReader::Close()
+{
+    if (!State) { return false; }
+
+    {
+        std::lock_guard<std::mutex> Lock(State->Mutex);
+        State->bQuit = true;
+    }
+    State->ChunkFree.notify_one();
+    if (State->Thread.joinable()) { State->Thread.join(); }
+
+    RECORD_TIMING(Pipeline_Read, State->ReadCycles, State->BytesRead);
+    RECORD_TIMING(Pipeline_ReaderStall, State->ReaderStallCycles, 0);
+
+    bool bComplete = !State->bFailed && State->BytesRead == FileSize;
+    fclose(State->FileHandle);
+    delete[] State->RingBuffer;
+    delete State;
+    State = nullptr;
+    return bComplete;
+}
+
@@ -0,0 +1,62 @@
+#ifndef HAVERSINE_PIPELINE_H
+#define HAVERSINE_PIPELINE_H
+
+/*
+ * NOTE:
+ *      Background reader so file I/O overlaps with parsing instead of running
+ *      before it: a reader thread fills up to QueueDepth chunks of ChunkSize
+ *      bytes ahead of the consumer, which takes them in file order
+ *      Chunks either live in a ring of QueueDepth buffers (the stream parser only
+ *      needs one chunk at a time) or are windows into one contiguous destination
+ *      buffer (for parsers that need the whole document, e.g. SIMD stage 1 runs
+ *      on each chunk as it arrives and stage 2 after the last one)
+ *      Time the reader spends blocked on a full queue and the consumer spends
+ *      blocked on an empty one are reported as Pipeline_* profiler anchors
+ */
+
+#include "haversine_common.h"
+
+namespace Haversine_Pipeline
+{
+    static constexpr int MaxQueueDepth = 64;
+
+    // Set by -chunk/-queue, used by the stream parser and the SIMD reader
+    // DefaultQueueDepth 0 keeps their reads synchronous
+    extern int DefaultChunkSize;
+    extern int DefaultQueueDepth;
+
+    // 64-bit size of an open file (ftell's long is 32 bits on Windows), rewound to the start after
+    s64 GetFileSize(FILE* FileHandle);
+
+    struct Chunk
+    {
+        u8* Data;
+        int Size;
+        u64 Offset; // Position of Data[0] in the file
+    };
+
+    struct ReaderState;
+
+    struct ChunkReader
+    {
+        u64 FileSize;
+        int ChunkSize;
+        int QueueDepth;
+        ReaderState* State;
+
+        // Opens FileName and gets its size, nothing is read until Start
+        bool Open(const char* FileName, int InChunkSize, int InQueueDepth);
+        // Destination (FileSize bytes, optional) makes every chunk a window into it
+        // Without one the file can be any size, only QueueDepth chunks are ever held
+        void Start(u8* Destination = nullptr);
+        // Blocks until the next chunk is read, false once the file is done (or failed)
+        bool Acquire(Chunk* OutChunk);
+        // Gives the chunk from the last Acquire back to the reader
+        void Recycle();
+        // Stops the reader thread and reports its read/stall time, true if the whole file was read
+        bool Close();
+    };
+}
+
+#endif // HAVERSINE_PIPELINE_H
+
@@ -0,0 +1,591 @@
+#include "haversine_quantized.h"
+#include "haversine_perf.h"
+#include "haversine_ref1.h"
+#include "haversine_schema.h"
+#include "haversine_threads.h"
+
+// C stdlib headers:
+#include <math.h>
+#include <string.h>
+
+namespace Haversine_Quantized
+{
+    using namespace Haversine_Math;
+    using Haversine_Binary::FileHeader;
+    using Haversine_Binary::Layout;
+
+    // Twice the coordinate range, GenerateDataClustered puts pairs up to a cluster radius past +-180/+-90
+    static constexpr f64 FixedRangeX = 2.0 * CoordXMax;
+    static constexpr f64 FixedRangeY = 2.0 * CoordYMax;
+    static constexpr f64 FixedStepX = FixedRangeX / INT32_MAX;
+    static constexpr f64 FixedStepY = FixedRangeY / INT32_MAX;
+    static constexpr int MaxOffset = INT16_MAX;
+    // Cluster16 tries cluster radii of 360/2^N degrees, from tight to loose, until MaxClusterCount are enough
+    static constexpr int MaxRadiusShift = 12;
+
+    inline bool IsYColumn(int ColumnIdx) { return ColumnIdx & 1; }
+
+    FileHeader NewHeader(Encoding ColumnEncoding, u64 Count, u32 ClusterCount, f64 StepX, f64 StepY)
+    {
+        FileHeader Result = {};
+        Result.Magic = Haversine_Binary::Magic;
+        Result.Version = Haversine_Binary::Version;
+        Result.HeaderSize = sizeof(FileHeader);
+        Result.Count = Count;
+        Result.ColumnStride = Haversine_Binary::GetLayout(ColumnEncoding, Count, ClusterCount).ColumnStride;
+        Result.ColumnEncoding = ColumnEncoding;
+        Result.ClusterCount = ClusterCount;
+        Result.StepX = StepX;
+        Result.StepY = StepY;
+        return Result;
+    }
+
+    bool AllocateStorage(EncodedList* Encoded, const FileHeader& Header)
+    {
+        Layout ListLayout = Haversine_Binary::GetLayout(Header.ColumnEncoding, Header.Count, Header.ClusterCount);
+        Encoded->Header = Header;
+        Encoded->StorageSize = ListLayout.ChecksumOffset - sizeof(FileHeader);
+        // Zeroed, the column padding is part of the checksum
+        Encoded->Storage = (u8*)_mm_malloc(Encoded->StorageSize > 0 ? Encoded->StorageSize : 1, Haversine_Binary::ColumnAlignment);
+        memset(Encoded->Storage, 0, Encoded->StorageSize);
+        Encoded->List = MakeList(Header, Encoded->Storage);
+        return true;
+    }
+
+    bool CoordsInRange(HList List)
+    {
+        for (int PairIdx = 0; PairIdx < List.Count; PairIdx++)
+        {
+            const HPair& Pair = List.Data[PairIdx];
+            if (!(fabs(Pair.X0) <= FixedRangeX && fabs(Pair.X1) <= FixedRangeX &&
+                  fabs(Pair.Y0) <= FixedRangeY && fabs(Pair.Y1) <= FixedRangeY))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool EncodeFixed32(HList List, EncodedList* OutList)
+    {
+        AllocateStorage(OutList, NewHeader(Encoding::Fixed32, List.Count, 0, FixedStepX, FixedStepY));
+        s32* Columns[4];
+        for (int ColumnIdx = 0; ColumnIdx < 4; ColumnIdx++) { Columns[ColumnIdx] = (s32*)OutList->List.Fixed[ColumnIdx]; }
+
+        for (int PairIdx = 0; PairIdx < List.Count; PairIdx++)
+        {
+            const f64* Coords = &List.Data[PairIdx].X0;
+            for (int ColumnIdx = 0; ColumnIdx < 4; ColumnIdx++)
+            {
+                f64 Step = IsYColumn(ColumnIdx) ? FixedStepY : FixedStepX;
+                Columns[ColumnIdx][PairIdx] = (s32)llround(Coords[ColumnIdx] / Step);
+            }
+        }
+        return true;
+    }
+
+    struct ClusterBounds
+    {
+        f64 Min[4];
+        f64 Max[4];
+    };
+
+    // Greedy: a pair joins the first cluster whose first member is within Radius on every coordinate
+    int AssignClusters(HList List, f64 RadiusX, u8* OutClusters, ClusterBounds* OutBounds)
+    {
+        f64 Radius[4] = { RadiusX, 0.5 * RadiusX, RadiusX, 0.5 * RadiusX };
+        HPair Seeds[Haversine_Binary::MaxClusterCount];
+        int ClusterCount = 0;
+        for (int PairIdx = 0; PairIdx < List.Count; PairIdx++)
+        {
+            const f64* Coords = &List.Data[PairIdx].X0;
+            int ClusterIdx = 0;
+            for (; ClusterIdx < ClusterCount; ClusterIdx++)
+            {
+                const f64* Seed = &Seeds[ClusterIdx].X0;
+                if (fabs(Coords[0] - Seed[0]) <= Radius[0] && fabs(Coords[1] - Seed[1]) <= Radius[1] &&
+                    fabs(Coords[2] - Seed[2]) <= Radius[2] && fabs(Coords[3] - Seed[3]) <= Radius[3])
+                {
+                    break;
+                }
+            }
+            if (ClusterIdx == ClusterCount)
+            {
+                if (ClusterCount == (int)Haversine_Binary::MaxClusterCount) { return -1; }
+                Seeds[ClusterCount++] = List.Data[PairIdx];
+                for (int ColumnIdx = 0; ColumnIdx < 4; ColumnIdx++)
+                {
+                    OutBounds[ClusterIdx].Min[ColumnIdx] = Coords[ColumnIdx];
+                    OutBounds[ClusterIdx].Max[ColumnIdx] = Coords[ColumnIdx];
+                }
+            }
+
+            ClusterBounds* Bounds = OutBounds + ClusterIdx;
+            for (int ColumnIdx = 0; ColumnIdx < 4; ColumnIdx++)
+            {
+                if (Coords[ColumnIdx] < Bounds->Min[ColumnIdx]) { Bounds->Min[ColumnIdx] = Coords[ColumnIdx]; }
+                if (Coords[ColumnIdx] > Bounds->Max[ColumnIdx]) { Bounds->Max[ColumnIdx] = Coords[ColumnIdx]; }
+            }
+            OutClusters[PairIdx] = (u8)ClusterIdx;
+        }
+        return ClusterCount;
+    }
+
+    bool EncodeCluster16(HList List, EncodedList* OutList)
+    {
+        u8* Clusters = new u8[List.Count > 0 ? List.Count : 1];
+        ClusterBounds Bounds[Haversine_Binary::MaxClusterCount];
+        int ClusterCount = -1;
+        for (int RadiusShift = MaxRadiusShift; RadiusShift >= 0 && ClusterCount < 0; RadiusShift--)
+        {
+            ClusterCount = AssignClusters(List, 2.0 * CoordXMax / (f64)(1 << RadiusShift), Clusters, Bounds);
+        }
+        if (ClusterCount < 0)
+        {
+            fprintf(stdout, "ERROR: Pairs don't fit in %u clusters, use fixed32 instead!\n", Haversine_Binary::MaxClusterCount);
+            delete[] Clusters;
+            return false;
+        }
+
+        // Bases are re-centered on their members, so Step only has to cover half the widest cluster
+        f64 HalfExtent[2] = {};
+        for (int ClusterIdx = 0; ClusterIdx < ClusterCount; ClusterIdx++)
+        {
+            for (int ColumnIdx = 0; ColumnIdx < 4; ColumnIdx++)
+            {
+                f64 Half = 0.5 * (Bounds[ClusterIdx].Max[ColumnIdx] - Bounds[ClusterIdx].Min[ColumnIdx]);
+                if (Half > HalfExtent[ColumnIdx & 1]) { HalfExtent[ColumnIdx & 1] = Half; }
+            }
+        }
+        // A step slightly above Half/MaxOffset keeps rounding the base from pushing an offset out of range
+        f64 StepX = HalfExtent[0] > 0.0 ? HalfExtent[0] / (MaxOffset - 1) : FixedStepX;
+        f64 StepY = HalfExtent[1] > 0.0 ? HalfExtent[1] / (MaxOffset - 1) : FixedStepY;
+
+        AllocateStorage(OutList, NewHeader(Encoding::Cluster16, List.Count, (u32)ClusterCount, StepX, StepY));
+        QuantizedList& Encoded = OutList->List;
+        memcpy((u8*)Encoded.Clusters, Clusters, List.Count);
+        for (int ClusterIdx = 0; ClusterIdx < ClusterCount; ClusterIdx++)
+        {
+            for (int ColumnIdx = 0; ColumnIdx < 4; ColumnIdx++)
+            {
+                f64 Base = 0.5 * (Bounds[ClusterIdx].Min[ColumnIdx] + Bounds[ClusterIdx].Max[ColumnIdx]);
+                ((f64*)Encoded.Bases[ColumnIdx])[ClusterIdx] = Base;
+            }
+        }
+        for (int PairIdx = 0; PairIdx < List.Count; PairIdx++)
+        {
+            const f64* Coords = &List.Data[PairIdx].X0;
+            for (int ColumnIdx = 0; ColumnIdx < 4; ColumnIdx++)
+            {
+                f64 Step = IsYColumn(ColumnIdx) ? StepY : StepX;
+                f64 Base = Encoded.Bases[ColumnIdx][Clusters[PairIdx]];
+                s64 Offset = llround((Coords[ColumnIdx] - Base) / Step);
+                if (Offset > MaxOffset) { Offset = MaxOffset; }
+                if (Offset < -MaxOffset) { Offset = -MaxOffset; }
+                ((s16*)Encoded.Offsets[ColumnIdx])[PairIdx] = (s16)Offset;
+            }
+        }
+
+        delete[] Clusters;
+        return true;
+    }
+
+    template <typename T, bool bClustered>
+    T DecodeCoord(const QuantizedList& List, int ColumnIdx, int PairIdx, T Step)
+    {
+        if (bClustered)
+        {
+            return MulAdd(T::LoadS16(List.Offsets[ColumnIdx] + PairIdx), Step,
+                    T::Lookup8(List.Bases[ColumnIdx], List.Clusters + PairIdx));
+        }
+        return Mul(T::LoadS32(List.Fixed[ColumnIdx] + PairIdx), Step);
+    }
+
+    // bDecodeOnly sums the decoded coordinates instead of distances, to time decoding on its own
+    template <typename T, bool bClustered, bool bDecodeOnly>
+    T SumLanes(const QuantizedList& List, int* PairIdx, int EndIdx)
+    {
+        using namespace Haversine_Ref1_Helpers;
+
+        T StepX = T::Set(List.StepX);
+        T StepY = T::Set(List.StepY);
+        T Sum = T::Set(0.0);
+        for (; *PairIdx + T::Width <= EndIdx; *PairIdx += T::Width)
+        {
+            T X0 = DecodeCoord<T, bClustered>(List, 0, *PairIdx, StepX);
+            T Y0 = DecodeCoord<T, bClustered>(List, 1, *PairIdx, StepY);
+            T X1 = DecodeCoord<T, bClustered>(List, 2, *PairIdx, StepX);
+            T Y1 = DecodeCoord<T, bClustered>(List, 3, *PairIdx, StepY);
+            if (bDecodeOnly) { Sum = Add(Sum, Add(Add(X0, Y0), Add(X1, Y1))); }
+            else { Sum = Add(Sum, Haversine(X0, Y0, X1, Y1)); }
+        }
+        return Sum;
+    }
+
+    template <bool bClustered, bool bDecodeOnly>
+    f64 SumRange(const QuantizedList& List, int BeginIdx, int EndIdx)
+    {
+        int PairIdx = BeginIdx;
+        f64 Sum = HorizontalSum(SumLanes<WideLane, bClustered, bDecodeOnly>(List, &PairIdx, EndIdx));
+        return Sum + SumLanes<f64x1, bClustered, bDecodeOnly>(List, &PairIdx, EndIdx).V;
+    }
+
+    template <typename T, bool bClustered>
+    void StoreLanes(const QuantizedList& List, int* PairIdx, int BeginIdx, int EndIdx, f64* OutDistances)
+    {
+        using namespace Haversine_Ref1_Helpers;
+
+        T StepX = T::Set(List.StepX);
+        T StepY = T::Set(List.StepY);
+        for (; *PairIdx + T::Width <= EndIdx; *PairIdx += T::Width)
+        {
+            T X0 = DecodeCoord<T, bClustered>(List, 0, *PairIdx, StepX);
+            T Y0 = DecodeCoord<T, bClustered>(List, 1, *PairIdx, StepY);
+            T X1 = DecodeCoord<T, bClustered>(List, 2, *PairIdx, StepX);
+            T Y1 = DecodeCoord<T, bClustered>(List, 3, *PairIdx, StepY);
+            Haversine(X0, Y0, X1, Y1).Store(OutDistances + (*PairIdx - BeginIdx));
+        }
+    }
+
+    template <bool bClustered>
+    void StoreRange(const QuantizedList& List, int BeginIdx, int EndIdx, f64* OutDistances)
+    {
+        int PairIdx = BeginIdx;
+        StoreLanes<WideLane, bClustered>(List, &PairIdx, BeginIdx, EndIdx, OutDistances);
+        StoreLanes<f64x1, bClustered>(List, &PairIdx, BeginIdx, EndIdx, OutDistances);
+    }
+
+    f64 DecodeSum(const QuantizedList& List)
+    {
+        return List.ColumnEncoding == Encoding::Cluster16 ?
+            SumRange<true, true>(List, 0, List.Count) :
+            SumRange<false, true>(List, 0, List.Count);
+    }
+
+    f64 DecodeSum(Haversine_Ref1::HListSoA List)
+    {
+        WideLane Sum = WideLane::Set(0.0);
+        int PairIdx = 0;
+        for (; PairIdx + WideLane::Width <= List.Count; PairIdx += WideLane::Width)
+        {
+            Sum = Add(Sum, Add(Add(WideLane::Load(List.X0 + PairIdx), WideLane::Load(List.Y0 + PairIdx)),
+                        Add(WideLane::Load(List.X1 + PairIdx), WideLane::Load(List.Y1 + PairIdx))));
+        }
+        f64 Result = HorizontalSum(Sum);
+        for (; PairIdx < List.Count; PairIdx++) { Result += (List.X0[PairIdx] + List.Y0[PairIdx]) + (List.X1[PairIdx] + List.Y1[PairIdx]); }
+        return Result;
+    }
+}
+
+void Haversine_Quantized::EncodedList::Release()
+{
+    if (Storage) { _mm_free(Storage); }
+    *this = {};
+}
+
+Haversine_Quantized::QuantizedList Haversine_Quantized::MakeList(const FileHeader& Header, const u8* Columns)
+{
+    Layout ListLayout = Haversine_Binary::GetLayout(Header.ColumnEncoding, Header.Count, Header.ClusterCount);
+    // Layout offsets are from the start of the file, Columns is right after the header
+    const u8* Base = Columns - sizeof(FileHeader);
+
+    QuantizedList Result = {};
+    Result.ColumnEncoding = Header.ColumnEncoding;
+    Result.Count = (int)Header.Count;
+    Result.StepX = Header.StepX;
+    Result.StepY = Header.StepY;
+    Result.ClusterCount = Header.ClusterCount;
+    for (int ColumnIdx = 0; ColumnIdx < 4; ColumnIdx++)
+    {
+        const u8* Column = Base + ListLayout.ColumnOffset + ColumnIdx * ListLayout.ColumnStride;
+        if (Header.ColumnEncoding == Encoding::Fixed32) { Result.Fixed[ColumnIdx] = (const s32*)Column; }
+        else if (Header.ColumnEncoding == Encoding::Cluster16)
+        {
+            Result.Offsets[ColumnIdx] = (const s16*)Column;
+            Result.Bases[ColumnIdx] = (const f64*)(Base + ListLayout.BaseOffset + ColumnIdx * ListLayout.BaseStride);
+        }
+    }
+    if (Header.ColumnEncoding == Encoding::Cluster16) { Result.Clusters = Base + ListLayout.ClusterOffset; }
+    return Result;
+}
+
+bool Haversine_Quantized::Encode(HList List, Encoding ColumnEncoding, EncodedList* OutList)
+{
+    TIME_FUNC_DATA((u64)List.Count * sizeof(HPair));
+
+    *OutList = {};
+    if (!CoordsInRange(List))
+    {
+        fprintf(stdout, "ERROR: Coordinates outside of +-%.0f/+-%.0f can't be quantized!\n", FixedRangeX, FixedRangeY);
+        return false;
+    }
+
+    switch (ColumnEncoding)
+    {
+        case Encoding::Fixed32: return EncodeFixed32(List, OutList);
+        case Encoding::Cluster16: return EncodeCluster16(List, OutList);
+        default:
+        {
+            fprintf(stdout, "ERROR: %s isn't a quantized encoding!\n", Haversine_Binary::GetEncodingName(ColumnEncoding));
+        } break;
+    }
+    return false;
+}
+
+HPair Haversine_Quantized::DecodePair(const QuantizedList& List, int PairIdx)
+{
+    using namespace Haversine_Math;
+
+    HPair Result = {};
+    f64* Coords = &Result.X0;
+    for (int ColumnIdx = 0; ColumnIdx < 4; ColumnIdx++)
+    {
+        f64x1 Step = f64x1::Set(IsYColumn(ColumnIdx) ? List.StepY : List.StepX);
+        Coords[ColumnIdx] = List.ColumnEncoding == Encoding::Cluster16 ?
+            DecodeCoord<f64x1, true>(List, ColumnIdx, PairIdx, Step).V :
+            DecodeCoord<f64x1, false>(List, ColumnIdx, PairIdx, Step).V;
+    }
+    return Result;
+}
+
+f64 Haversine_Quantized::GetMaxDistanceError(const QuantizedList& List)
+{
+    // Each endpoint moves at most Step/2 on both axes, the great circle distance can't change by more than that
+    f64 HalfStepX = 0.5 * List.StepX * DegreesPerRadian;
+    f64 HalfStepY = 0.5 * List.StepY * DegreesPerRadian;
+    return 2.0 * EarthRadius * sqrt(HalfStepX * HalfStepX + HalfStepY * HalfStepY);
+}
+
+f64 Haversine_Quantized::CalculateSum(const QuantizedList& List, int BeginIdx, int EndIdx)
+{
+    return List.ColumnEncoding == Encoding::Cluster16 ?
+        SumRange<true, false>(List, BeginIdx, EndIdx) :
+        SumRange<false, false>(List, BeginIdx, EndIdx);
+}
+
+void Haversine_Quantized::CalculateDistances(const QuantizedList& List, int BeginIdx, int EndIdx, f64* OutDistances)
+{
+    if (List.ColumnEncoding == Encoding::Cluster16) { StoreRange<true>(List, BeginIdx, EndIdx, OutDistances); }
+    else { StoreRange<false>(List, BeginIdx, EndIdx, OutDistances); }
+}
+
+namespace Haversine_Quantized
+{
+    // What the kernel reads: the four columns, plus the cluster index per pair and the base table for Cluster16
+    u64 GetKernelBytes(const QuantizedList& List)
+    {
+        u64 Count = List.Count > 0 ? (u64)List.Count : 0;
+        if (List.ColumnEncoding == Encoding::Cluster16)
+        {
+            return 4 * Count * sizeof(s16) + Count * sizeof(u8) + 4 * (u64)List.ClusterCount * sizeof(f64);
+        }
+        return 4 * Count * sizeof(s32);
+    }
+}
+
+f64 Haversine_Quantized::CalculateAverage(const QuantizedList& List)
+{
+    TIME_FUNC_DATA(GetKernelBytes(List));
+
+    if (List.Count <= 0) { return 0.0; }
+    return CalculateSum(List, 0, List.Count) / (f64)List.Count;
+}
+
+namespace Haversine_Quantized
+{
+    struct ThreadedSumContext
+    {
+        const QuantizedList* List;
+        f64* ChunkSums;
+    };
+
+    void ThreadedSumTask(void* Context, int ChunkIdx, int ThreadIdx)
+    {
+        (void)ThreadIdx;
+        ThreadedSumContext* SumContext = (ThreadedSumContext*)Context;
+
+        int BeginIdx = ChunkIdx * Haversine_Ref1::ChunkPairCount;
+        int EndIdx = BeginIdx + Haversine_Ref1::ChunkPairCount;
+        if (EndIdx > SumContext->List->Count) { EndIdx = SumContext->List->Count; }
+        SumContext->ChunkSums[ChunkIdx] = CalculateSum(*SumContext->List, BeginIdx, EndIdx);
+    }
+}
+
+f64 Haversine_Quantized::CalculateAverageThreaded(const QuantizedList& List, int ThreadCount)
+{
+    TIME_FUNC_DATA(GetKernelBytes(List));
+
+    if (List.Count <= 0) { return 0.0; }
+
+    int ChunkCount = (List.Count + Haversine_Ref1::ChunkPairCount - 1) / Haversine_Ref1::ChunkPairCount;
+    Haversine_Threads::WorkerPool& Pool = Haversine_Threads::AcquirePool(ThreadCount);
+    ThreadedSumContext Context = { &List, new f64[ChunkCount] };
+    Pool.Run(ChunkCount, ThreadedSumTask, &Context);
+
+    // Same pairwise tree as Haversine_Ref1::CalculateAverageThreaded
+    for (int Stride = 1; Stride < ChunkCount; Stride *= 2)
+    {
+        for (int ChunkIdx = 0; ChunkIdx + Stride < ChunkCount; ChunkIdx += 2 * Stride)
+        {
+            Context.ChunkSums[ChunkIdx] += Context.ChunkSums[ChunkIdx + Stride];
+        }
+    }
+    f64 Average = Context.ChunkSums[0] / (f64)List.Count;
+    delete[] Context.ChunkSums;
+
+    fprintf(stdout, "\tCalculateAverageThreaded: %d threads, %d chunks of %d pairs\n",
+            Pool.ThreadCount, ChunkCount, Haversine_Ref1::ChunkPairCount);
+    Pool.PrintThreadTimings();
+    return Average;
+}
+
+bool Haversine_Quantized::WriteFile(HList List, const char* FileName, Encoding ColumnEncoding)
+{
+    TIME_FUNC();
+
+    EncodedList Encoded = {};
+    if (!Encode(List, ColumnEncoding, &Encoded)) { return false; }
+
+    FILE* FileHandle = nullptr;
+    fopen_s(&FileHandle, FileName, "wb");
+    if (!FileHandle)
+    {
+        fprintf(stdout, "ERROR: Could not open file %s for write!\n", FileName);
+        Encoded.Release();
+        return false;
+    }
+
+    Haversine_Binary::Checksum Sum = Haversine_Binary::NewChecksum();
+    bool bWritten = Haversine_Binary::WriteColumn(FileHandle, &Sum, &Encoded.Header, sizeof(Encoded.Header)) &&
+        Haversine_Binary::WriteColumn(FileHandle, &Sum, Encoded.Storage, Encoded.StorageSize);
+    u64 Result = Haversine_Binary::FinishChecksum(Sum);
+    bWritten = bWritten && fwrite(&Result, sizeof(Result), 1, FileHandle) == 1;
+    fclose(FileHandle);
+    Encoded.Release();
+
+    if (!bWritten) { fprintf(stdout, "ERROR: Failed to write %s!\n", FileName); }
+    return bWritten;
+}
+
+bool Haversine_Quantized::Open(const char* FileName, Haversine_Binary::PairFile* OutFile, QuantizedList* OutList)
+{
+    if (!Haversine_Binary::OpenMapped(FileName, OutFile)) { return false; }
+    if (OutFile->Header.ColumnEncoding == Encoding::F64)
+    {
+        fprintf(stdout, "ERROR: File %s is f64 encoded, not quantized!\n", FileName);
+        OutFile->Release();
+        return false;
+    }
+    *OutList = MakeList(OutFile->Header, OutFile->File.Contents.Data + sizeof(FileHeader));
+    return true;
+}
+
+void Haversine_Quantized::Convert(const char* FileNameJSON, const char* FileNameBinary, ReadFileFuncT ReadFile, Encoding ColumnEncoding)
+{
+    TIME_FUNC();
+
+    HList PairList = ReadFile(FileNameJSON);
+    if (WriteFile(PairList, FileNameBinary, ColumnEncoding))
+    {
+        FileHeader Header = {};
+        Haversine_Binary::ReadHeader(FileNameBinary, &Header);
+        Layout FileLayout = Haversine_Binary::GetLayout(ColumnEncoding, Header.Count, Header.ClusterCount);
+        fprintf(stdout, "Wrote %s data to file %s (%d pairs, %llu bytes, %u clusters)\n",
+                Haversine_Binary::GetEncodingName(ColumnEncoding), FileNameBinary, PairList.Count,
+                FileLayout.FileSize, Header.ClusterCount);
+    }
+    TRACK_FREE(sizeof(HPair) * PairList.Count);
+    delete[] PairList.Data;
+}
+
+void Haversine_Quantized::Calc(const char* FileName, int ThreadCount)
+{
+    TIME_FUNC();
+
+    Haversine_Binary::PairFile Input = {};
+    QuantizedList List = {};
+    if (!Open(FileName, &Input, &List)) { return; }
+
+    f64 HvAvg = ThreadCount > 0 ? CalculateAverageThreaded(List, ThreadCount) : CalculateAverage(List);
+    fprintf(stdout, "\tAverage: %f\n", HvAvg);
+
+    Input.Release();
+}
+
+void Haversine_Quantized::Benchmark(const char* FileNameJSON)
+{
+    TIME_FUNC();
+
+    HList Pairs = Haversine_Schema::ReadFileAsJSON(FileNameJSON);
+    if (Pairs.Count <= 0)
+    {
+        fprintf(stdout, "ERROR: No pairs in %s!\n", FileNameJSON);
+        TRACK_FREE(sizeof(HPair) * Pairs.Count);
+        delete[] Pairs.Data;
+        return;
+    }
+
+    static constexpr int RepeatCount = 5;
+    u64 CPUFreq = Perf::EstimateCPUFreq();
+    f64 Gigabyte = 1024.0 * 1024.0 * 1024.0;
+    Haversine_Ref1::HListSoA Columns = Haversine_Ref1::ConvertToSoA(Pairs);
+
+    fprintf(stdout, "%s (%d pairs, best of %d):\n", FileNameJSON, Pairs.Count, RepeatCount);
+    for (u32 EncodingIdx = 0; EncodingIdx < (u32)Encoding::Count; EncodingIdx++)
+    {
+        Encoding ColumnEncoding = (Encoding)EncodingIdx;
+        EncodedList Encoded = {};
+        if (ColumnEncoding != Encoding::F64 && !Encode(Pairs, ColumnEncoding, &Encoded)) { continue; }
+
+        u64 DecodeBest = UINT64_MAX;
+        u64 KernelBest = UINT64_MAX;
+        f64 Checksum = 0.0;
+        f64 Average = 0.0;
+        for (int RepeatIdx = 0; RepeatIdx < RepeatCount; RepeatIdx++)
+        {
+            u64 Begin = Perf::ReadCPUTimer();
+            Checksum = ColumnEncoding == Encoding::F64 ? DecodeSum(Columns) : DecodeSum(Encoded.List);
+            u64 Elapsed = Perf::ReadCPUTimer() - Begin;
+            if (Elapsed < DecodeBest) { DecodeBest = Elapsed; }
+
+            Begin = Perf::ReadCPUTimer();
+            Average = ColumnEncoding == Encoding::F64 ?
+                Haversine_Ref1::CalculateAverage(Columns) :
+                CalculateAverage(Encoded.List);
+            Elapsed = Perf::ReadCPUTimer() - Begin;
+            if (Elapsed < KernelBest) { KernelBest = Elapsed; }
+        }
+
+        // Both sides go through the same kernel, so this is only the quantization error
+        f64 MaxError = 0.0;
+        f64 ErrorBound = 0.0;
+        if (ColumnEncoding != Encoding::F64)
+        {
+            for (int PairIdx = 0; PairIdx < Pairs.Count; PairIdx++)
+            {
+                f64 Expected = Haversine_Ref1::CalculateHaversine(Pairs.Data[PairIdx]);
+                f64 Error = fabs(Haversine_Ref1::CalculateHaversine(DecodePair(Encoded.List, PairIdx)) - Expected);
+                if (Error > MaxError) { MaxError = Error; }
+            }
+            ErrorBound = GetMaxDistanceError(Encoded.List);
+        }
+
+        u32 ClusterCount = Encoded.Header.ClusterCount;
+        Layout FileLayout = Haversine_Binary::GetLayout(ColumnEncoding, Pairs.Count, ClusterCount);
+        f64 ColumnBytes = (f64)(FileLayout.ChecksumOffset - sizeof(FileHeader));
+        fprintf(stdout, "\t%-9s %5.2f bytes/pair, decode %6.2f GB/s (%.3f cycles/pair, checksum %.3f), "
+                "kernel %6.2f cycles/pair (average %.6f), max error %.3e km (bound %.3e km)",
+                Haversine_Binary::GetEncodingName(ColumnEncoding), (f64)FileLayout.FileSize / (f64)Pairs.Count,
+                ColumnBytes / ((f64)DecodeBest / (f64)CPUFreq) / Gigabyte, (f64)DecodeBest / (f64)Pairs.Count, Checksum,
+                (f64)KernelBest / (f64)Pairs.Count, Average, MaxError, ErrorBound);
+        if (ClusterCount > 0) { fprintf(stdout, ", %u clusters", ClusterCount); }
+        fprintf(stdout, "\n");
+
+        Encoded.Release();
+    }
+
+    Columns.Release();
+    TRACK_FREE(sizeof(HPair) * Pairs.Count);
+    delete[] Pairs.Data;
+}
+
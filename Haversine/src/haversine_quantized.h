@@ -0,0 +1,82 @@
+#ifndef HAVERSINE_QUANTIZED_H
+#define HAVERSINE_QUANTIZED_H
+
+/*
+ * NOTE:
+ *      Compact encodings of the pair columns for when reading 32 bytes of f64s
+ *      per pair is the limit rather than the math (see Haversine_Binary::Encoding):
+ *          - Fixed32: every coordinate as s32 fixed point, Coord = Value * Step with
+ *            Step = 360/(2^31-1) deg for X and 180/(2^31-1) deg for Y (twice the
+ *            coordinate range, clustered data wraps past +-180/+-90)
+ *            16 bytes/pair, coordinates within Step/2 (8.4e-8 / 4.2e-8 deg), which
+ *            moves each endpoint by at most 1.05 cm, so distances are within 2.1 cm
+ *          - Cluster16: pairs grouped into <= 8 clusters (GenerateDataClustered uses 8),
+ *            every coordinate an s16 offset from its cluster's base, Coord = Base + Value * Step
+ *            ~9 bytes/pair, Step is whatever the widest cluster needs, so the error
+ *            bound depends on the data (GetMaxDistanceError, reported by quantbench)
+ *            ~40 m for generated clustered data, whose clusters are 22.5 degrees wide
+ *      Both decode inside the Haversine kernel: integer loads are widened and scaled
+ *      (plus a table permute for the cluster bases) right before the math, nothing
+ *      is expanded back to f64 columns in memory
+ */
+
+#include "haversine_common.h"
+#include "haversine_binary.h"
+
+namespace Haversine_Quantized
+{
+    using Haversine_Binary::Encoding;
+
+    // View of encoded columns, laid out like a file's columns (Haversine_Binary::GetLayout)
+    struct QuantizedList
+    {
+        Encoding ColumnEncoding;
+        int Count;
+        f64 StepX;
+        f64 StepY;
+        const s32* Fixed[4]; // Fixed32
+        const u8* Clusters; // Cluster16
+        const s16* Offsets[4];
+        const f64* Bases[4];
+        u32 ClusterCount;
+    };
+
+    // Encoded copy of an HList, Storage holds everything from the end of the file header to the checksum
+    struct EncodedList
+    {
+        Haversine_Binary::FileHeader Header;
+        QuantizedList List;
+        u8* Storage;
+        u64 StorageSize;
+
+        void Release();
+    };
+
+    // False (with the reason printed) if the list can't be encoded this way
+    bool Encode(HList List, Encoding ColumnEncoding, EncodedList* OutList);
+    QuantizedList MakeList(const Haversine_Binary::FileHeader& Header, const u8* Columns);
+
+    HPair DecodePair(const QuantizedList& List, int PairIdx);
+    // Largest change in distance quantizing any pair can cause (from the steps, not measured)
+    f64 GetMaxDistanceError(const QuantizedList& List);
+
+    f64 CalculateSum(const QuantizedList& List, int BeginIdx, int EndIdx);
+    // Distance of every pair in [BeginIdx, EndIdx) to OutDistances[0 .. EndIdx - BeginIdx), same fused decode as CalculateSum
+    void CalculateDistances(const QuantizedList& List, int BeginIdx, int EndIdx, f64* OutDistances);
+    f64 CalculateAverage(const QuantizedList& List);
+    // Haversine_Ref1::ChunkPairCount chunks on a worker pool, summed in the same fixed order for any ThreadCount
+    f64 CalculateAverageThreaded(const QuantizedList& List, int ThreadCount);
+
+    bool WriteFile(HList List, const char* FileName, Encoding ColumnEncoding);
+    // Haversine_Binary::OpenMapped for the quantized encodings, OutList points into OutFile
+    bool Open(const char* FileName, Haversine_Binary::PairFile* OutFile, QuantizedList* OutList);
+
+    void Convert(const char* FileNameJSON, const char* FileNameBinary, ReadFileFuncT ReadFile, Encoding ColumnEncoding);
+    // ThreadCount 0 => single threaded CalculateAverage
+    void Calc(const char* FileName, int ThreadCount);
+    // Bytes/pair, decode GB/s, fused kernel speed and worst distance error against the f64 columns
+    void Benchmark(const char* FileNameJSON);
+}
+
+#endif // HAVERSINE_QUANTIZED_H
+
@@ -1,13 +1,6 @@
 #include "haversine_ref0.h"
 #include "haversine_perf.h"
 
-constexpr f64 CoordXMin = -180.0;
-constexpr f64 CoordXMax = +180.0;
-constexpr double CoordYMin = -90.0;
-constexpr double CoordYMax = +90.0;
-constexpr f64 DegreesPerRadian = 0.01745329251994329577;
-constexpr f64 EarthRadius = 6372.8;
-
 namespace Haversine_Ref0_Helpers
 {
     // NOTE:
@@ -86,6 +79,7 @@ HList Haversine_Ref0::GenerateDataUniform(int Seed, int Count)
     UniformRealDistT coordy_dist(CoordYMin, CoordYMax);
 
     HList Result = {Count, new HPair[Count]};
+    TRACK_ALLOC(sizeof(HPair) * Count);
     for (int PairIdx = 0; PairIdx < Count; PairIdx++)
     {
         Result.Data[PairIdx].X0 = coordx_dist(default_rand_engine);
@@ -133,6 +127,7 @@ HList Haversine_Ref0::GenerateDataClustered(int Seed, int Count)
     UniformRealDistT clusteroffsety_dist(-MaxClusterYOffset, +MaxClusterYOffset);
 
     HList Result = {Count, new HPair[Count]};
+    TRACK_ALLOC(sizeof(HPair) * Count);
     for (int PairIdx = 0; PairIdx < Count; PairIdx++)
     {
         int ClusterIdx = clusteridx_dist(default_rand_engine);
@@ -249,12 +244,13 @@ HList Haversine_Ref0::ReadFileAsJSON(const char* FileName)
 
 void Haversine_Ref0::FileContentsT::Release()
 {
-    Size = 0;
     if (Data)
     {
+        TRACK_FREE(Size);
         delete[] Data;
         Data = nullptr;
     }
+    Size = 0;
 }
 
 void Haversine_Ref0::FileContentsT::Read(const char* FileName, bool bAppendNull)
@@ -274,6 +270,7 @@ void Haversine_Ref0::FileContentsT::Read(const char* FileName, bool bAppendNull)
             TIME_BLOCK_DATA(fread_s, FileSize);
             Size = FileSize + (bAppendNull ? 1 : 0);
             Data = new u8[Size];
+            TRACK_ALLOC(Size);
             fread_s(Data, FileSize, FileSize, 1, FileHandle);
             if (bAppendNull) { Data[Size - 1] = '\0'; }
         }
@@ -307,34 +304,6 @@ void Haversine_Ref0::FileContentsT::Write(const char* FileName)
 
 namespace Haversine_Ref0
 {
-    // Forward type decls:
-    struct JsonObject;
-
-    enum JsonType
-    {
-        JsonType_Null,
-        JsonType_NumberInt,
-        JsonType_NumberFloat,
-        JsonType_Bool,
-        JsonType_String,
-        JsonType_Object,
-        JsonType_Array,
-    };
-
-    struct JsonValue
-    {
-        using b64 = u64;
-        JsonType Type;
-        union
-        {
-            s64 NumberInt;
-            f64 NumberFloat;
-            b64 Bool;
-            char* String;
-            DynamicArray<JsonObject*>* List;
-        };
-    };
-
     enum JsonToken
     {
         Token_LeftCurly,
@@ -352,14 +321,6 @@ namespace Haversine_Ref0
         Token_End
     };
 
-    struct JsonObject
-    {
-        char* Key;
-        JsonValue Value;
-    };
-
-    void Release(JsonObject* Object, bool bRoot);
-
     struct JsonTreeStack
     {
         int Depth;
@@ -519,6 +480,7 @@ namespace Haversine_Ref0
                 if (Begin[ReadIdx] == '"')
                 {
                     *ParsedString = new char[ReadIdx];
+                    TRACK_ALLOC(ReadIdx);
                     memcpy(*ParsedString, Begin + 1, ReadIdx - 1);
                     (*ParsedString)[ReadIdx-1] = '\0';
                 }
@@ -550,10 +512,18 @@ namespace Haversine_Ref0
     void DebugPrintStep(char* JsonData, JsonToken InToken, JsonValue InValue, int BeginIdx, int EndIdx);
 
     JsonToken ParseNextToken(char* Begin, JsonValue* OutValue, char** NextTokenBegin);
-    JsonObject Parse(char* JsonData, int Size);
+}
 
-    JsonObject* Query(JsonObject* Root, const char* Key);
-    HList ParsePairsArray(JsonObject* Pairs);
+Haversine_Ref0::JsonObject* Haversine_Ref0::NewJsonObject()
+{
+    TRACK_ALLOC(sizeof(JsonObject));
+    return new JsonObject{};
+}
+
+Haversine_Ref0::DynamicArray<Haversine_Ref0::JsonObject*>* Haversine_Ref0::NewJsonList()
+{
+    TRACK_ALLOC(sizeof(DynamicArray<JsonObject*>));
+    return new DynamicArray<JsonObject*>{};
 }
 
 void Haversine_Ref0::Release(JsonObject* Object, bool bRoot)
@@ -570,6 +540,7 @@ void Haversine_Ref0::Release(JsonObject* Object, bool bRoot)
         } break;
         case JsonType_String:
         {
+            if (Object->Value.String) { TRACK_FREE(strlen(Object->Value.String) + 1); }
             delete Object->Value.String;
         } break;
         case JsonType_Object:
@@ -582,12 +553,14 @@ void Haversine_Ref0::Release(JsonObject* Object, bool bRoot)
                 {
                     Release((*List)[ItemIdx], false);
                 }
+                TRACK_FREE(sizeof(*List));
                 delete List;
             }
         } break;
     }
     if (!bRoot)
     {
+        TRACK_FREE(sizeof(*Object));
         delete Object;
     }
 }
@@ -710,7 +683,7 @@ Haversine_Ref0::JsonObject Haversine_Ref0::Parse(char* JsonData, int Size)
 {
     JsonObject Root = {};
     Root.Value.Type = JsonType_Object;
-    Root.Value.List = new DynamicArray<JsonObject*>{};
+    Root.Value.List = NewJsonList();
 
     JsonTreeStack Stack;
     bool bStackInit = false;
@@ -740,7 +713,7 @@ Haversine_Ref0::JsonObject Haversine_Ref0::Parse(char* JsonData, int Size)
                 if (!bStackInit) { Stack.Init(&Root); bStackInit = true; }
                 else if (Stack.TopType() == JsonType_Object && bAfterColon)
                 {
-                    DynamicArray<JsonObject*>* NewList = new DynamicArray<JsonObject*>{};
+                    DynamicArray<JsonObject*>* NewList = NewJsonList();
                     auto LastVal = Stack.TopList()->Last();
                     Stack.TopList()->Last()->Value.Type = JsonType_Object;
                     Stack.TopList()->Last()->Value.List = NewList;
@@ -749,10 +722,10 @@ Haversine_Ref0::JsonObject Haversine_Ref0::Parse(char* JsonData, int Size)
                 else if (Stack.TopType() == JsonType_Array && 
                         (bAfterComma || Stack.TopList()->Num == 0))
                 {
-                    Stack.TopList()->Add(new JsonObject{});
+                    Stack.TopList()->Add(NewJsonObject());
                     Stack.TopList()->Last()->Key = nullptr;
                     Stack.TopList()->Last()->Value.Type = JsonType_Object;
-                    DynamicArray<JsonObject*>* NewList = new DynamicArray<JsonObject*>{};
+                    DynamicArray<JsonObject*>* NewList = NewJsonList();
                     Stack.TopList()->Last()->Value.List = NewList;
                     Stack.Push(Stack.TopList()->Last());
                 }
@@ -771,7 +744,7 @@ Haversine_Ref0::JsonObject Haversine_Ref0::Parse(char* JsonData, int Size)
             {
                 if (Stack.TopType() == JsonType_Object && bAfterColon)
                 {
-                    DynamicArray<JsonObject*>* NewList = new DynamicArray<JsonObject*>{};
+                    DynamicArray<JsonObject*>* NewList = NewJsonList();
                     Stack.TopList()->Last()->Value.Type = JsonType_Array;
                     Stack.TopList()->Last()->Value.List = NewList;
                     Stack.Push(Stack.TopList()->Last());
@@ -779,8 +752,8 @@ Haversine_Ref0::JsonObject Haversine_Ref0::Parse(char* JsonData, int Size)
                 else if (Stack.TopType() == JsonType_Array && 
                         (bAfterComma || Stack.TopList()->Num == 0))
                 {
-                    DynamicArray<JsonObject*>* NewList = new DynamicArray<JsonObject*>{};
-                    Stack.TopList()->Add(new JsonObject{});
+                    DynamicArray<JsonObject*>* NewList = NewJsonList();
+                    Stack.TopList()->Add(NewJsonObject());
                     Stack.TopList()->Last()->Value.Type = JsonType_Array;
                     Stack.TopList()->Last()->Value.List = NewList;
                     Stack.Push(Stack.TopList()->Last());
@@ -806,7 +779,7 @@ Haversine_Ref0::JsonObject Haversine_Ref0::Parse(char* JsonData, int Size)
                 {
                     if (Stack.TopList()->Num == 0 || bAfterComma)
                     {
-                        ObjToSetValue = *Stack.TopList()->Add_RetPtr(new JsonObject{});
+                        ObjToSetValue = *Stack.TopList()->Add_RetPtr(NewJsonObject());
                     }
                     else { bError = true; }
                 }
@@ -820,7 +793,7 @@ Haversine_Ref0::JsonObject Haversine_Ref0::Parse(char* JsonData, int Size)
                             OutValue.Type == JsonType_String) &&
                             (Stack.TopList()->Num == 0 || bAfterComma))
                     {
-                        JsonObject* NewObj_Key = *Stack.TopList()->Add_RetPtr(new JsonObject{});
+                        JsonObject* NewObj_Key = *Stack.TopList()->Add_RetPtr(NewJsonObject());
                         NewObj_Key->Key = OutValue.String;
                         bKey = true;
                     }
@@ -895,7 +868,7 @@ Haversine_Ref0::JsonObject* Haversine_Ref0::Query(JsonObject* Root, const char*
     for (int RootObjIdx = 0; RootObjIdx < Root->Value.List->Num; RootObjIdx++)
     {
         JsonObject* CurrObject = (*Root->Value.List)[RootObjIdx];
-        if (strcmp(CurrObject->Key, Key) == 0)
+        if (CurrObject->Key && strcmp(CurrObject->Key, Key) == 0)
         {
             Result = CurrObject;
             break;
@@ -924,6 +897,7 @@ HList Haversine_Ref0::ParsePairsArray(JsonObject* Pairs)
     int ListSize = Pairs->Value.List->Num;
     DynamicArray<JsonObject*>* JsonPairArray = Pairs->Value.List;
     HList Result = { ListSize, new CoordPair[ListSize] };
+    TRACK_ALLOC(sizeof(CoordPair) * ListSize);
 
     int PairIdx = 0;
     bool bError = false;
@@ -952,7 +926,7 @@ HList Haversine_Ref0::ParsePairsArray(JsonObject* Pairs)
         }
     }
     if (bError) { fprintf(stdout, "ERROR encounted at Idx: %d (Size: %d) in ParsePairsArray\n",
-            PairIdx, ListSize); delete Result.Data; return HList{}; }
+            PairIdx, ListSize); TRACK_FREE(sizeof(CoordPair) * ListSize); delete[] Result.Data; return HList{}; }
     return Result;
 }
 
@@ -1011,6 +985,7 @@ void Haversine_Ref0::Gen(int Seed, int Count, bool bClustered)
 
     {
         TIME_BLOCK(Gen_Cleanup);
+        TRACK_FREE(sizeof(HPair) * PairList.Count);
         delete[] PairList.Data;
     }
 }
@@ -1033,6 +1008,7 @@ void Haversine_Ref0::Calc(int Seed, int Count, bool bClustered)
 
     {
         TIME_BLOCK(Calc_Cleanup);
+        TRACK_FREE(sizeof(HPair) * PairList.Count);
         delete[] PairList.Data;
     }
 }
@@ -1049,6 +1025,7 @@ void Haversine_Ref0::Calc(const char* FileNameJSON)
 
     {
         TIME_BLOCK(Calc_Cleanup);
+        TRACK_FREE(sizeof(HPair) * PairList.Count);
         delete[] PairList.Data;
     }
 }
@@ -11,6 +11,7 @@
  */
 
 #include "haversine_common.h"
+#include "haversine_perf.h"
 
 namespace Haversine_Ref0
 {
@@ -56,17 +57,20 @@ namespace Haversine_Ref0
             , Num(0)
             , Data(new T[DefaultCapacity])
         {
+            TRACK_ALLOC(sizeof(T) * DefaultCapacity);
         }
         DynamicArray(int InitCapacity)
             : Capacity(InitCapacity)
             , Num(0)
-            , Data(new T[DefaultCapacity])
+            , Data(new T[InitCapacity])
         {
+            TRACK_ALLOC(sizeof(T) * InitCapacity);
         }
         ~DynamicArray()
         {
             if (Data)
             {
+                TRACK_FREE(sizeof(T) * Capacity);
                 delete[] Data;
             }
         }
@@ -75,12 +79,15 @@ namespace Haversine_Ref0
             if (NewCapacity > Capacity)
             {
                 int OldCapacity = Capacity;
+                (void)OldCapacity; // Only read by TRACK_FREE, which is empty without ENABLE_PROFILER
                 T* OldData = Data;
 
                 Capacity = NewCapacity;
                 Data = new T[NewCapacity];
+                TRACK_ALLOC(sizeof(T) * NewCapacity);
                 (void)memcpy(Data, OldData, sizeof(T)*Num);
 
+                TRACK_FREE(sizeof(T) * OldCapacity);
                 delete[] OldData;
             }
 
@@ -116,6 +123,48 @@ namespace Haversine_Ref0
             else return Data[0];
         }
     };
+
+    // Forward type decls:
+    struct JsonObject;
+
+    enum JsonType
+    {
+        JsonType_Null,
+        JsonType_NumberInt,
+        JsonType_NumberFloat,
+        JsonType_Bool,
+        JsonType_String,
+        JsonType_Object,
+        JsonType_Array,
+    };
+
+    struct JsonValue
+    {
+        using b64 = u64;
+        JsonType Type;
+        union
+        {
+            s64 NumberInt;
+            f64 NumberFloat;
+            b64 Bool;
+            char* String;
+            DynamicArray<JsonObject*>* List;
+        };
+    };
+
+    struct JsonObject
+    {
+        char* Key;
+        JsonValue Value;
+    };
+
+    // Tree nodes and their child lists, counted by the profiler's allocation tracker (Release frees both)
+    JsonObject* NewJsonObject();
+    DynamicArray<JsonObject*>* NewJsonList();
+    void Release(JsonObject* Object, bool bRoot);
+    JsonObject Parse(char* JsonData, int Size);
+    JsonObject* Query(JsonObject* Root, const char* Key);
+    HList ParsePairsArray(JsonObject* Pairs);
 }
 
 #endif // HAVERSINE_REF0_H
@@ -0,0 +1,329 @@
+#include "haversine_ref1.h"
+#include "haversine_math.h"
+#include "haversine_ref0.h"
+#include "haversine_perf.h"
+#include "haversine_threads.h"
+
+// C stdlib headers:
+#include <math.h>
+#include <string.h>
+
+void Haversine_Ref1::CoordPairSoA::Init(int InCount)
+{
+    Count = InCount;
+    size_t ColumnSize = sizeof(f64) * (size_t)(Count > 0 ? Count : 1);
+    X0 = (f64*)_mm_malloc(ColumnSize, ColumnAlignment);
+    Y0 = (f64*)_mm_malloc(ColumnSize, ColumnAlignment);
+    X1 = (f64*)_mm_malloc(ColumnSize, ColumnAlignment);
+    Y1 = (f64*)_mm_malloc(ColumnSize, ColumnAlignment);
+}
+
+void Haversine_Ref1::CoordPairSoA::Release()
+{
+    if (X0) { _mm_free(X0); }
+    if (Y0) { _mm_free(Y0); }
+    if (X1) { _mm_free(X1); }
+    if (Y1) { _mm_free(Y1); }
+    *this = {};
+}
+
+Haversine_Ref1::HListSoA Haversine_Ref1::ConvertToSoA(HList List)
+{
+    TIME_FUNC_DATA((u64)List.Count * sizeof(HPair));
+
+    HListSoA Result = {};
+    Result.Init(List.Count);
+    for (int PairIdx = 0; PairIdx < List.Count; PairIdx++)
+    {
+        Result.X0[PairIdx] = List.Data[PairIdx].X0;
+        Result.Y0[PairIdx] = List.Data[PairIdx].Y0;
+        Result.X1[PairIdx] = List.Data[PairIdx].X1;
+        Result.Y1[PairIdx] = List.Data[PairIdx].Y1;
+    }
+    return Result;
+}
+
+f64 Haversine_Ref1::CalculateHaversine(HPair Pair)
+{
+    using namespace Haversine_Ref1_Helpers;
+    f64x1 Result = Haversine(f64x1{ Pair.X0 }, f64x1{ Pair.Y0 }, f64x1{ Pair.X1 }, f64x1{ Pair.Y1 });
+    return Result.V;
+}
+
+f64 Haversine_Ref1::CalculateSum(HListSoA List, int BeginIdx, int EndIdx)
+{
+    using namespace Haversine_Ref1_Helpers;
+    using WideT = WideLane;
+
+    WideT WideSum = WideT::Set(0.0);
+    int PairIdx = BeginIdx;
+    for (; PairIdx + WideT::Width <= EndIdx; PairIdx += WideT::Width)
+    {
+        WideT X0 = WideT::Load(List.X0 + PairIdx);
+        WideT Y0 = WideT::Load(List.Y0 + PairIdx);
+        WideT X1 = WideT::Load(List.X1 + PairIdx);
+        WideT Y1 = WideT::Load(List.Y1 + PairIdx);
+        WideSum = Add(WideSum, Haversine(X0, Y0, X1, Y1));
+    }
+
+    f64 Sum = HorizontalSum(WideSum);
+    for (; PairIdx < EndIdx; PairIdx++)
+    {
+        f64x1 Distance = Haversine(f64x1{ List.X0[PairIdx] }, f64x1{ List.Y0[PairIdx] },
+                f64x1{ List.X1[PairIdx] }, f64x1{ List.Y1[PairIdx] });
+        Sum += Distance.V;
+    }
+    return Sum;
+}
+
+void Haversine_Ref1::CalculateDistances(HListSoA List, int BeginIdx, int EndIdx, f64* OutDistances)
+{
+    using namespace Haversine_Ref1_Helpers;
+    using WideT = WideLane;
+
+    int PairIdx = BeginIdx;
+    for (; PairIdx + WideT::Width <= EndIdx; PairIdx += WideT::Width)
+    {
+        WideT X0 = WideT::Load(List.X0 + PairIdx);
+        WideT Y0 = WideT::Load(List.Y0 + PairIdx);
+        WideT X1 = WideT::Load(List.X1 + PairIdx);
+        WideT Y1 = WideT::Load(List.Y1 + PairIdx);
+        Haversine(X0, Y0, X1, Y1).Store(OutDistances + (PairIdx - BeginIdx));
+    }
+
+    for (; PairIdx < EndIdx; PairIdx++)
+    {
+        f64x1 Distance = Haversine(f64x1{ List.X0[PairIdx] }, f64x1{ List.Y0[PairIdx] },
+                f64x1{ List.X1[PairIdx] }, f64x1{ List.Y1[PairIdx] });
+        OutDistances[PairIdx - BeginIdx] = Distance.V;
+    }
+}
+
+f64 Haversine_Ref1::CalculateAverage(HListSoA List)
+{
+    TIME_FUNC_DATA((u64)List.Count * sizeof(HPair));
+
+    f64 Sum = CalculateSum(List, 0, List.Count);
+    f64 Average = Sum / (f64)List.Count;
+    return Average;
+}
+
+f64 Haversine_Ref1::CalculateAverage(HList List)
+{
+    HListSoA SoA = ConvertToSoA(List);
+    f64 Average = CalculateAverage(SoA);
+    SoA.Release();
+    return Average;
+}
+
+namespace Haversine_Ref1
+{
+    struct ThreadedSumContext
+    {
+        HList List;
+        HListSoA Columns; // Used instead of List when it's already in SoA form
+        f64* ChunkSums;
+        HListSoA* ThreadScratch;
+    };
+
+    void ThreadedSumTask(void* Context, int ChunkIdx, int ThreadIdx)
+    {
+        ThreadedSumContext* SumContext = (ThreadedSumContext*)Context;
+        HListSoA* Scratch = SumContext->ThreadScratch + ThreadIdx;
+
+        int BeginIdx = ChunkIdx * ChunkPairCount;
+        int EndIdx = BeginIdx + ChunkPairCount;
+        if (EndIdx > SumContext->List.Count) { EndIdx = SumContext->List.Count; }
+        TIME_FUNC_DATA((u64)(EndIdx - BeginIdx) * sizeof(HPair));
+
+        HPair* Src = SumContext->List.Data + BeginIdx;
+        int ChunkCount = EndIdx - BeginIdx;
+        for (int PairIdx = 0; PairIdx < ChunkCount; PairIdx++)
+        {
+            Scratch->X0[PairIdx] = Src[PairIdx].X0;
+            Scratch->Y0[PairIdx] = Src[PairIdx].Y0;
+            Scratch->X1[PairIdx] = Src[PairIdx].X1;
+            Scratch->Y1[PairIdx] = Src[PairIdx].Y1;
+        }
+        SumContext->ChunkSums[ChunkIdx] = CalculateSum(*Scratch, 0, ChunkCount);
+    }
+
+    void ThreadedSumTaskSoA(void* Context, int ChunkIdx, int ThreadIdx)
+    {
+        (void)ThreadIdx;
+        ThreadedSumContext* SumContext = (ThreadedSumContext*)Context;
+
+        int BeginIdx = ChunkIdx * ChunkPairCount;
+        int EndIdx = BeginIdx + ChunkPairCount;
+        if (EndIdx > SumContext->Columns.Count) { EndIdx = SumContext->Columns.Count; }
+        SumContext->ChunkSums[ChunkIdx] = CalculateSum(SumContext->Columns, BeginIdx, EndIdx);
+    }
+
+    // NOTE:
+    //      Chunk boundaries only depend on the pair count, and the per-chunk sums
+    //      are combined in a fixed pairwise tree afterwards, so the result is
+    //      bit-identical no matter how many threads ran or which chunks they got
+    f64 RunThreadedSum(ThreadedSumContext* Context, int Count, int ThreadCount, bool bSoA)
+    {
+        int ChunkCount = (Count + ChunkPairCount - 1) / ChunkPairCount;
+
+        Haversine_Threads::WorkerPool& Pool = Haversine_Threads::AcquirePool(ThreadCount);
+
+        Context->ChunkSums = new f64[ChunkCount];
+        if (!bSoA)
+        {
+            Context->ThreadScratch = new HListSoA[Pool.ThreadCount];
+            for (int ThreadIdx = 0; ThreadIdx < Pool.ThreadCount; ThreadIdx++)
+            {
+                Context->ThreadScratch[ThreadIdx].Init(ChunkPairCount);
+            }
+        }
+
+        Pool.Run(ChunkCount, bSoA ? ThreadedSumTaskSoA : ThreadedSumTask, Context);
+
+        for (int Stride = 1; Stride < ChunkCount; Stride *= 2)
+        {
+            for (int ChunkIdx = 0; ChunkIdx + Stride < ChunkCount; ChunkIdx += 2 * Stride)
+            {
+                Context->ChunkSums[ChunkIdx] += Context->ChunkSums[ChunkIdx + Stride];
+            }
+        }
+        f64 Average = Context->ChunkSums[0] / (f64)Count;
+
+        fprintf(stdout, "\tCalculateAverageThreaded: %d threads, %d chunks of %d pairs\n",
+                Pool.ThreadCount, ChunkCount, ChunkPairCount);
+        Pool.PrintThreadTimings();
+
+        if (!bSoA)
+        {
+            for (int ThreadIdx = 0; ThreadIdx < Pool.ThreadCount; ThreadIdx++)
+            {
+                Context->ThreadScratch[ThreadIdx].Release();
+            }
+            delete[] Context->ThreadScratch;
+        }
+        delete[] Context->ChunkSums;
+
+        return Average;
+    }
+}
+
+f64 Haversine_Ref1::CalculateAverageThreaded(HList List, int ThreadCount)
+{
+    TIME_FUNC_DATA((u64)List.Count * sizeof(HPair));
+
+    if (List.Count <= 0) { return 0.0; }
+
+    ThreadedSumContext Context = {};
+    Context.List = List;
+    return RunThreadedSum(&Context, List.Count, ThreadCount, false);
+}
+
+f64 Haversine_Ref1::CalculateAverageThreaded(HListSoA List, int ThreadCount)
+{
+    TIME_FUNC_DATA((u64)List.Count * sizeof(HPair));
+
+    if (List.Count <= 0) { return 0.0; }
+
+    ThreadedSumContext Context = {};
+    Context.Columns = List;
+    return RunThreadedSum(&Context, List.Count, ThreadCount, true);
+}
+
+void Haversine_Ref1::Calc(int Seed, int Count, bool bClustered, int ThreadCount, ReadFileFuncT ReadFile)
+{
+    static constexpr int FileNameMaxSize = 96;
+    char JSONFileName[FileNameMaxSize];
+    Haversine_Ref0::GetInputDataFileName(JSONFileName, FileNameMaxSize, Seed, Count, bClustered);
+
+    Calc(JSONFileName, ThreadCount, ReadFile);
+}
+
+void Haversine_Ref1::Calc(const char* FileNameJSON, int ThreadCount, ReadFileFuncT ReadFile)
+{
+    TIME_FUNC();
+
+    HList PairList = ReadFile(FileNameJSON);
+    f64 HvAvg = ThreadCount > 0 ?
+        CalculateAverageThreaded(PairList, ThreadCount) :
+        Haversine_Ref0::CalculateAverage(PairList);
+    fprintf(stdout, "\tAverage: %f\n", HvAvg);
+
+    {
+        TIME_BLOCK(Calc_Cleanup);
+        TRACK_FREE(sizeof(HPair) * PairList.Count);
+        delete[] PairList.Data;
+    }
+}
+
+void Haversine_Ref1::Compare(HList List, int ThreadCount)
+{
+    TIME_FUNC();
+
+    if (!List.Data || List.Count == 0)
+    {
+        fprintf(stdout, "ERROR: No pairs to compare!\n");
+        return;
+    }
+
+    f64 Ref0Average = 0.0;
+    u64 Ref0Cycles = 0;
+    {
+        TIME_BLOCK_DATA(Ref0_CalculateAverage, (u64)List.Count * sizeof(HPair));
+        u64 Begin = Perf::ReadCPUTimer();
+        Ref0Average = Haversine_Ref0::CalculateAverage(List);
+        Ref0Cycles = Perf::ReadCPUTimer() - Begin;
+    }
+
+    HListSoA SoA = ConvertToSoA(List);
+    f64 Ref1Average = 0.0;
+    u64 Ref1Cycles = 0;
+    {
+        u64 Begin = Perf::ReadCPUTimer();
+        Ref1Average = CalculateAverage(SoA);
+        Ref1Cycles = Perf::ReadCPUTimer() - Begin;
+    }
+    SoA.Release();
+
+    f64 MaxPairError = 0.0;
+    for (int PairIdx = 0; PairIdx < List.Count; PairIdx++)
+    {
+        f64 Expected = Haversine_Ref0::CalculateHaversine(List.Data[PairIdx]);
+        f64 Error = fabs(CalculateHaversine(List.Data[PairIdx]) - Expected);
+        if (Error > MaxPairError) { MaxPairError = Error; }
+    }
+
+    fprintf(stdout, "\tRef0 Average: %.12f (%.2f cycles/pair)\n",
+            Ref0Average, (f64)Ref0Cycles / (f64)List.Count);
+    fprintf(stdout, "\tRef1 Average: %.12f (%.2f cycles/pair, %d-wide)\n",
+            Ref1Average, (f64)Ref1Cycles / (f64)List.Count, Haversine_Math::WideLane::Width);
+    fprintf(stdout, "\tAverage difference: %.3e, max per-pair difference: %.3e\n",
+            fabs(Ref1Average - Ref0Average), MaxPairError);
+
+    if (ThreadCount > 0)
+    {
+        f64 SingleThreadAverage = CalculateAverageThreaded(List, 1);
+
+        u64 Begin = Perf::ReadCPUTimer();
+        f64 ThreadedAverage = CalculateAverageThreaded(List, ThreadCount);
+        u64 ThreadedCycles = Perf::ReadCPUTimer() - Begin;
+
+        bool bIdentical = memcmp(&SingleThreadAverage, &ThreadedAverage, sizeof(f64)) == 0;
+        fprintf(stdout, "\tThreaded Average: %.12f (%.2f cycles/pair, %d threads), %s 1-thread result\n",
+                ThreadedAverage, (f64)ThreadedCycles / (f64)List.Count, ThreadCount,
+                bIdentical ? "bit-identical to" : "MISMATCH vs");
+    }
+}
+
+void Haversine_Ref1::Compare(int Seed, int Count, bool bClustered, int ThreadCount)
+{
+    static constexpr int FileNameMaxSize = 96;
+    char JSONFileName[FileNameMaxSize];
+    Haversine_Ref0::GetInputDataFileName(JSONFileName, FileNameMaxSize, Seed, Count, bClustered);
+
+    HList PairList = Haversine_Ref0::ReadFileAsJSON(JSONFileName);
+    Compare(PairList, ThreadCount);
+    TRACK_FREE(sizeof(HPair) * PairList.Count);
+    delete[] PairList.Data;
+}
+
@@ -0,0 +1,82 @@
+#ifndef HAVERSINE_REF1_H
+#define HAVERSINE_REF1_H
+
+/*
+ * NOTE:
+ *      Second iteration of the compute stage (see haversine_ref0.h)
+ *      Pairs are stored as a structure-of-arrays (one aligned column each
+ *      for X0/Y0/X1/Y1) so the Haversine formula can be evaluated on
+ *      4 (AVX2) or 8 (AVX-512) pairs at once, using polynomial
+ *      approximations instead of the CRT sin/cos/asin
+ */
+
+#include "haversine_common.h"
+#include "haversine_math.h"
+
+namespace Haversine_Ref1
+{
+    static constexpr int ColumnAlignment = 64;
+    // Pairs per threaded work item, 128KB of AoS input plus its SoA copy stays in L2
+    static constexpr int ChunkPairCount = 4096;
+
+    struct CoordPairSoA
+    {
+        int Count;
+        f64* X0;
+        f64* Y0;
+        f64* X1;
+        f64* Y1;
+
+        void Init(int InCount);
+        void Release();
+    };
+
+    using HListSoA = CoordPairSoA;
+
+    HListSoA ConvertToSoA(HList List);
+
+    f64 CalculateHaversine(HPair Pair);
+    f64 CalculateSum(HListSoA List, int BeginIdx, int EndIdx);
+    // Distance of every pair in [BeginIdx, EndIdx) to OutDistances[0 .. EndIdx - BeginIdx), same lanes as CalculateSum
+    void CalculateDistances(HListSoA List, int BeginIdx, int EndIdx, f64* OutDistances);
+    f64 CalculateAverage(HListSoA List);
+    f64 CalculateAverage(HList List);
+    f64 CalculateAverageThreaded(HList List, int ThreadCount);
+    // Same chunks and reduction as the HList version (so the same result), without the SoA copy
+    f64 CalculateAverageThreaded(HListSoA List, int ThreadCount);
+
+    // ThreadCount 0 => single threaded Haversine_Ref0::CalculateAverage on the parsed list
+    void Calc(int Seed, int Count, bool bClustered, int ThreadCount, ReadFileFuncT ReadFile);
+    void Calc(const char* FileNameJSON, int ThreadCount, ReadFileFuncT ReadFile);
+    void Compare(HList List, int ThreadCount);
+    void Compare(int Seed, int Count, bool bClustered, int ThreadCount);
+}
+
+namespace Haversine_Ref1_Helpers
+{
+    using namespace Haversine_Math;
+
+    template <typename T>
+    T Haversine(T X0, T Y0, T X1, T Y1)
+    {
+        T RadiansPerDegree = T::Set(DegreesPerRadian);
+        T HalfRadiansPerDegree = T::Set(0.5 * DegreesPerRadian);
+
+        T HalfDLat = Mul(Sub(Y1, Y0), HalfRadiansPerDegree);
+        T HalfDLon = Mul(Sub(X1, X0), HalfRadiansPerDegree);
+        T Lat1 = Mul(Y0, RadiansPerDegree);
+        T Lat2 = Mul(Y1, RadiansPerDegree);
+
+        T SinHalfDLat = Sin(HalfDLat);
+        T SinHalfDLon = Sin(HalfDLon);
+        T CosLats = Mul(Cos(Lat1), Cos(Lat2));
+
+        T A = MulAdd(Mul(CosLats, SinHalfDLon), SinHalfDLon, Mul(SinHalfDLat, SinHalfDLat));
+        T C = Mul(T::Set(2.0), AsinSqrt(A));
+
+        return Mul(T::Set(EarthRadius), C);
+    }
+}
+
+#endif // HAVERSINE_REF1_H
+
@@ -0,0 +1,188 @@
+#include "haversine_reptest.h"
+#include "haversine_perf.h"
+#include "haversine_ref0.h"
+#include "haversine_ref1.h"
+#include "haversine_fileio.h"
+#include "haversine_jsonwriter.h"
+#include "haversine_pipeline.h"
+
+// C stdlib headers:
+#include <string.h>
+
+namespace Haversine_RepTest
+{
+    static constexpr const char* WriteFileName = "hvreptest.json";
+    static constexpr int PageSize = 4096;
+
+    struct TestParams
+    {
+        const char* FileName;
+        ReadFileFuncT ReadFile;
+        u64 FileSize;
+        HList List; // From the first parse, input of the compute and write stages
+        Haversine_Ref1::HListSoA Columns;
+        f64 Ref0Average;
+        f64 Ref1Average;
+        u64 WriteSize;
+        u64 TouchChecksum; // Keeps the page touches of the load stage from being optimized out
+    };
+
+    using TestFuncT = void(*)(Perf::RepetitionTester* Tester, TestParams* Params);
+
+    struct TestFunction
+    {
+        const char* Name;
+        TestFuncT Func;
+        u64 ByteCount; // Per run
+    };
+
+    u64 GetFileSize(const char* FileName)
+    {
+        FILE* FileHandle = nullptr;
+        fopen_s(&FileHandle, FileName, "rb");
+        if (!FileHandle) { return 0; }
+        s64 Size = Haversine_Pipeline::GetFileSize(FileHandle);
+        fclose(FileHandle);
+        return Size > 0 ? (u64)Size : 0;
+    }
+
+    void TestRead(Perf::RepetitionTester* Tester, TestParams* Params)
+    {
+        while (Tester->IsTesting())
+        {
+            Haversine_Ref0::FileContentsT Input = {};
+            Tester->BeginTime();
+            Input.Read(Params->FileName);
+            Tester->EndTime();
+
+            if (Input.Data && (u64)Input.Size == Params->FileSize) { Tester->CountBytes((u64)Input.Size); }
+            else { Tester->Error("Read failed"); }
+            Input.Release();
+        }
+    }
+
+    // A mapping costs nothing until it's touched, so one byte of every page is part of the run
+    void TestLoad(Perf::RepetitionTester* Tester, TestParams* Params)
+    {
+        u64 Checksum = 0;
+        while (Tester->IsTesting())
+        {
+            Tester->BeginTime();
+            Haversine_FileIO::MappedFile File = Haversine_FileIO::Load(Params->FileName, Haversine_FileIO::DefaultLoadMode);
+            for (int ByteIdx = 0; ByteIdx < File.Contents.Size; ByteIdx += PageSize) { Checksum += File.Contents.Data[ByteIdx]; }
+            Tester->EndTime();
+
+            if (File.Contents.Data) { Tester->CountBytes(Params->FileSize); }
+            else { Tester->Error("Load failed"); }
+            File.Release();
+        }
+        Params->TouchChecksum = Checksum;
+    }
+
+    void TestParse(Perf::RepetitionTester* Tester, TestParams* Params)
+    {
+        while (Tester->IsTesting())
+        {
+            Tester->BeginTime();
+            HList List = Params->ReadFile(Params->FileName);
+            Tester->EndTime();
+
+            if (List.Count == Params->List.Count && memcmp(List.Data, Params->List.Data, sizeof(HPair) * List.Count) == 0)
+            {
+                Tester->CountBytes(Params->FileSize);
+            }
+            else { Tester->Error("Parsed pairs differ from the first parse"); }
+            TRACK_FREE(sizeof(HPair) * List.Count);
+            delete[] List.Data;
+        }
+    }
+
+    void TestRef0Average(Perf::RepetitionTester* Tester, TestParams* Params)
+    {
+        while (Tester->IsTesting())
+        {
+            Tester->BeginTime();
+            f64 Average = Haversine_Ref0::CalculateAverage(Params->List);
+            Tester->EndTime();
+
+            if (Average == Params->Ref0Average) { Tester->CountBytes(sizeof(HPair) * Params->List.Count); }
+            else { Tester->Error("Average differs from the first run"); }
+        }
+    }
+
+    void TestRef1Average(Perf::RepetitionTester* Tester, TestParams* Params)
+    {
+        while (Tester->IsTesting())
+        {
+            Tester->BeginTime();
+            f64 Average = Haversine_Ref1::CalculateAverage(Params->Columns);
+            Tester->EndTime();
+
+            if (Average == Params->Ref1Average) { Tester->CountBytes(sizeof(HPair) * Params->List.Count); }
+            else { Tester->Error("Average differs from the first run"); }
+        }
+    }
+
+    // Same timed write as Haversine_JsonWriter::Benchmark, on all hardware threads
+    void TestWrite(Perf::RepetitionTester* Tester, TestParams* Params)
+    {
+        while (Tester->IsTesting())
+        {
+            Haversine_JsonWriter::PrepareRewrite(WriteFileName);
+            Tester->BeginTime();
+            bool bWritten = Haversine_JsonWriter::WriteDataAsJSON(Params->List, WriteFileName, 0);
+            Tester->EndTime();
+
+            if (bWritten) { Tester->CountBytes(Params->WriteSize); }
+            else { Tester->Error("Write failed"); }
+        }
+    }
+}
+
+void Haversine_RepTest::Run(const char* FileNameJSON, ReadFileFuncT ReadFile, u32 SecondsToTry)
+{
+    TestParams Params = {};
+    Params.FileName = FileNameJSON;
+    Params.ReadFile = ReadFile;
+    Params.FileSize = GetFileSize(FileNameJSON);
+    Params.List = ReadFile(FileNameJSON);
+    if (!Params.FileSize || !Params.List.Data)
+    {
+        fprintf(stdout, "ERROR: Could not read pairs from %s!\n", FileNameJSON);
+        TRACK_FREE(sizeof(HPair) * Params.List.Count);
+        delete[] Params.List.Data;
+        return;
+    }
+    Params.Columns = Haversine_Ref1::ConvertToSoA(Params.List);
+    Params.Ref0Average = Haversine_Ref0::CalculateAverage(Params.List);
+    Params.Ref1Average = Haversine_Ref1::CalculateAverage(Params.Columns);
+    Haversine_JsonWriter::PrepareRewrite(WriteFileName);
+    if (Haversine_JsonWriter::WriteDataAsJSON(Params.List, WriteFileName, 0)) { Params.WriteSize = GetFileSize(WriteFileName); }
+
+    u64 PairBytes = sizeof(HPair) * Params.List.Count;
+    TestFunction TestFunctions[] =
+    {
+        { "FileContentsT::Read", TestRead, Params.FileSize },
+        { "Haversine_FileIO::Load + touch", TestLoad, Params.FileSize },
+        { "Parse (-parser)", TestParse, Params.FileSize },
+        { "Haversine_Ref0::CalculateAverage", TestRef0Average, PairBytes },
+        { "Haversine_Ref1::CalculateAverage (SoA)", TestRef1Average, PairBytes },
+        { "Haversine_JsonWriter::WriteDataAsJSON", TestWrite, Params.WriteSize },
+    };
+
+    u64 CPUFreq = Perf::EstimateCPUFreq();
+    fprintf(stdout, "Repetition testing %s (%llu bytes, %d pairs), until %u seconds pass without a new minimum:\n",
+            FileNameJSON, Params.FileSize, Params.List.Count, SecondsToTry);
+    for (const TestFunction& Test : TestFunctions)
+    {
+        fprintf(stdout, "\n--- %s ---\n", Test.Name);
+        Perf::RepetitionTester Tester = {};
+        Tester.NewTestWave(Test.ByteCount, CPUFreq, SecondsToTry);
+        Test.Func(&Tester, &Params);
+    }
+
+    remove(WriteFileName);
+    Params.Columns.Release();
+    TRACK_FREE(sizeof(HPair) * Params.List.Count);
+    delete[] Params.List.Data;
+}
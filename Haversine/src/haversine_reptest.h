@@ -0,0 +1,23 @@
+#ifndef HAVERSINE_REPTEST_H
+#define HAVERSINE_REPTEST_H
+
+/*
+ * NOTE:
+ *      Every stage of calc (read, parse, compute) plus gen's write, each run
+ *      under Perf::RepetitionTester until SecondsToTry pass without a new fastest
+ *      run, for judging changes too small to see in one PROFILING_BEGIN/END run
+ *      Each stage gets the same input every run and is checked against the
+ *      first run's result, so a fast but wrong run stops the wave
+ */
+
+#include "haversine_common.h"
+
+namespace Haversine_RepTest
+{
+    static constexpr u32 DefaultSecondsToTry = 10;
+
+    // ReadFile parses for the parse stage, Haversine_FileIO::DefaultLoadMode loads for the load stage
+    void Run(const char* FileNameJSON, ReadFileFuncT ReadFile, u32 SecondsToTry);
+}
+
+#endif // HAVERSINE_REPTEST_H
@@ -0,0 +1,263 @@
+#include "haversine_roofline.h"
+#include "haversine_math.h"
+
+// C stdlib headers:
+#include <string.h>
+
+namespace Haversine_Roofline
+{
+    // When CPUID doesn't enumerate a level
+    static const u64 FallbackCacheSizes[] = { 32 * 1024, 1024 * 1024, 32 * 1024 * 1024 };
+    // Per trial, so even the L1 run is long enough to time
+    constexpr u64 BytesPerTrial = 1024ull * 1024 * 1024;
+    constexpr u64 FlopIterations = 1 << 24;
+
+    // Keeps the sums alive, nothing reads it
+    static volatile f64 ProbeSink = 0.0;
+    // Read again before every pass, or the compiler sums the unchanged buffer once and reuses it
+    static const f64* volatile ProbeData = nullptr;
+
+    void GetCPUName(char* OutName)
+    {
+        memset(OutName, 0, sizeof(CacheHeader::CPUName));
+        u32 Regs[4];
+        Perf::ReadCPUID(0x80000000, 0, Regs);
+        if (Regs[0] < 0x80000004) { return; }
+        for (u32 Idx = 0; Idx < 3; Idx++)
+        {
+            Perf::ReadCPUID(0x80000002 + Idx, 0, Regs);
+            memcpy(OutName + Idx * sizeof(Regs), Regs, sizeof(Regs));
+        }
+        OutName[sizeof(CacheHeader::CPUName) - 1] = '\0';
+    }
+
+    // Intel leaf 4 / AMD leaf 0x8000001D, same layout: one subleaf per cache until type 0
+    // Sizes are per instance, so a shared L3 reports the slice this core's CCX/ring sees
+    void DetectCacheSizes(u64* OutSizes)
+    {
+        static const u32 Leaves[] = { 0x4, 0x8000001D };
+        for (u32 Level = 0; Level < 3; Level++) { OutSizes[Level] = 0; }
+        for (u32 Leaf : Leaves)
+        {
+            u32 Regs[4];
+            Perf::ReadCPUID(Leaf & 0x80000000, 0, Regs);
+            if (Regs[0] < Leaf) { continue; }
+
+            bool bFound = false;
+            for (u32 SubLeaf = 0; SubLeaf < 16; SubLeaf++)
+            {
+                Perf::ReadCPUID(Leaf, SubLeaf, Regs);
+                u32 Type = Regs[0] & 0x1F; // 1 data, 2 instruction, 3 unified
+                u32 Level = (Regs[0] >> 5) & 0x7;
+                if (!Type) { break; }
+                if (Type == 2 || Level < 1 || Level > 3) { continue; }
+
+                u64 Ways = (Regs[1] >> 22) + 1;
+                u64 Partitions = ((Regs[1] >> 12) & 0x3FF) + 1;
+                u64 LineSize = (Regs[1] & 0xFFF) + 1;
+                u64 Sets = (u64)Regs[2] + 1;
+                OutSizes[Level - 1] = Ways * Partitions * LineSize * Sets;
+                bFound = true;
+            }
+            if (bFound) { break; }
+        }
+        for (u32 Level = 0; Level < 3; Level++)
+        {
+            if (!OutSizes[Level]) { OutSizes[Level] = FallbackCacheSizes[Level]; }
+        }
+    }
+
+    template <typename LaneT>
+    f64 SumAll(const f64* Data, u64 Count)
+    {
+        using namespace Haversine_Math;
+        constexpr u64 Step = 8 * LaneT::Width;
+        LaneT Sum0 = LaneT::Set(0.0), Sum1 = Sum0, Sum2 = Sum0, Sum3 = Sum0;
+        LaneT Sum4 = Sum0, Sum5 = Sum0, Sum6 = Sum0, Sum7 = Sum0;
+        for (u64 Idx = 0; Idx + Step <= Count; Idx += Step)
+        {
+            Sum0 = Add(Sum0, LaneT::Load(Data + Idx + 0 * LaneT::Width));
+            Sum1 = Add(Sum1, LaneT::Load(Data + Idx + 1 * LaneT::Width));
+            Sum2 = Add(Sum2, LaneT::Load(Data + Idx + 2 * LaneT::Width));
+            Sum3 = Add(Sum3, LaneT::Load(Data + Idx + 3 * LaneT::Width));
+            Sum4 = Add(Sum4, LaneT::Load(Data + Idx + 4 * LaneT::Width));
+            Sum5 = Add(Sum5, LaneT::Load(Data + Idx + 5 * LaneT::Width));
+            Sum6 = Add(Sum6, LaneT::Load(Data + Idx + 6 * LaneT::Width));
+            Sum7 = Add(Sum7, LaneT::Load(Data + Idx + 7 * LaneT::Width));
+        }
+        LaneT Sum = Add(Add(Add(Sum0, Sum1), Add(Sum2, Sum3)), Add(Add(Sum4, Sum5), Add(Sum6, Sum7)));
+        return HorizontalSum(Sum);
+    }
+
+    // Bytes per second reading the first Size bytes of Data over and over
+    f64 MeasureReadBandwidth(const f64* Data, u64 Size, u64 CPUFreq)
+    {
+        u64 Count = Size / sizeof(f64);
+        u64 PassCount = Size < BytesPerTrial ? BytesPerTrial / Size : 1;
+        u64 Best = ~0ull;
+        f64 Sum = 0.0;
+        ProbeData = Data;
+        // One untimed pass first, so the working set is already in the level being measured
+        Sum += SumAll<Haversine_Math::WideLane>(ProbeData, Count);
+        for (int TrialIdx = 0; TrialIdx < TrialCount; TrialIdx++)
+        {
+            u64 Begin = Perf::ReadCPUTimer();
+            for (u64 PassIdx = 0; PassIdx < PassCount; PassIdx++) { Sum += SumAll<Haversine_Math::WideLane>(ProbeData, Count); }
+            u64 Elapsed = Perf::ReadCPUTimer() - Begin;
+            if (Elapsed < Best) { Best = Elapsed; }
+        }
+        ProbeSink = Sum;
+        return (f64)(PassCount * Size) * (f64)CPUFreq / (f64)Best;
+    }
+
+    // FLOPs per second of ChainCount independent X = X * A + B chains
+    // Named rather than an array, so they stay in registers and f64x1 isn't vectorized
+    template <typename LaneT>
+    f64 MeasureFlops(u64 CPUFreq)
+    {
+        using namespace Haversine_Math;
+        // 2 FMA ports x 4-5 cycles latency, with room to spare
+        constexpr int ChainCount = 12;
+        // Converges to B / (1 - A) = 1, no overflow or denormals however long it runs
+        LaneT A = LaneT::Set(0.999999);
+        LaneT B = LaneT::Set(0.000001);
+        LaneT X0 = LaneT::Set(0.0), X1 = LaneT::Set(1.0), X2 = LaneT::Set(2.0), X3 = LaneT::Set(3.0);
+        LaneT X4 = LaneT::Set(4.0), X5 = LaneT::Set(5.0), X6 = LaneT::Set(6.0), X7 = LaneT::Set(7.0);
+        LaneT X8 = LaneT::Set(8.0), X9 = LaneT::Set(9.0), X10 = LaneT::Set(10.0), X11 = LaneT::Set(11.0);
+
+        u64 Best = ~0ull;
+        for (int TrialIdx = 0; TrialIdx < TrialCount; TrialIdx++)
+        {
+            u64 Begin = Perf::ReadCPUTimer();
+            for (u64 Iteration = 0; Iteration < FlopIterations; Iteration++)
+            {
+                X0 = MulAdd(X0, A, B); X1 = MulAdd(X1, A, B); X2 = MulAdd(X2, A, B); X3 = MulAdd(X3, A, B);
+                X4 = MulAdd(X4, A, B); X5 = MulAdd(X5, A, B); X6 = MulAdd(X6, A, B); X7 = MulAdd(X7, A, B);
+                X8 = MulAdd(X8, A, B); X9 = MulAdd(X9, A, B); X10 = MulAdd(X10, A, B); X11 = MulAdd(X11, A, B);
+            }
+            u64 Elapsed = Perf::ReadCPUTimer() - Begin;
+            if (Elapsed < Best) { Best = Elapsed; }
+        }
+
+        LaneT Sum = Add(Add(Add(X0, X1), Add(X2, X3)), Add(Add(X4, X5), Add(X6, X7)));
+        Sum = Add(Sum, Add(Add(X8, X9), Add(X10, X11)));
+        ProbeSink = HorizontalSum(Sum);
+        f64 FlopCount = 2.0 * LaneT::Width * ChainCount * (f64)FlopIterations;
+        return FlopCount * (f64)CPUFreq / (f64)Best;
+    }
+
+    bool LoadCache(const char* FileName, Perf::RooflineCeilings* OutCeilings)
+    {
+        FILE* FileHandle = nullptr;
+        fopen_s(&FileHandle, FileName, "rb");
+        if (!FileHandle) { return false; }
+
+        CacheHeader Header = {};
+        Perf::RooflineCeilings Ceilings = {};
+        bool bOk = fread(&Header, sizeof(Header), 1, FileHandle) == 1 &&
+            Header.Magic == CacheMagic && Header.Version == CacheVersion && Header.HeaderSize == sizeof(CacheHeader) &&
+            fread(&Ceilings, sizeof(Ceilings), 1, FileHandle) == 1;
+        fclose(FileHandle);
+        if (!bOk)
+        {
+            fprintf(stdout, "Roofline cache %s is unreadable, measuring again\n", FileName);
+            return false;
+        }
+
+        // Same CPU model and cache sizes, or it's another machine's
+        char CPUName[sizeof(CacheHeader::CPUName)];
+        u64 CacheSizes[3];
+        GetCPUName(CPUName);
+        DetectCacheSizes(CacheSizes);
+        if (memcmp(CPUName, Header.CPUName, sizeof(CPUName)) != 0 ||
+                memcmp(CacheSizes, Ceilings.CacheSizes, sizeof(CacheSizes)) != 0)
+        {
+            fprintf(stdout, "Roofline cache %s is from another CPU, measuring again\n", FileName);
+            return false;
+        }
+        *OutCeilings = Ceilings;
+        return true;
+    }
+
+    bool SaveCache(const char* FileName, const Perf::RooflineCeilings& Ceilings)
+    {
+        FILE* FileHandle = nullptr;
+        fopen_s(&FileHandle, FileName, "wb");
+        if (!FileHandle)
+        {
+            fprintf(stdout, "ERROR: Could not open file %s for write!\n", FileName);
+            return false;
+        }
+
+        CacheHeader Header = { CacheMagic, CacheVersion, sizeof(CacheHeader), {} };
+        GetCPUName(Header.CPUName);
+        bool bOk = fwrite(&Header, sizeof(Header), 1, FileHandle) == 1 &&
+            fwrite(&Ceilings, sizeof(Ceilings), 1, FileHandle) == 1;
+        bOk = fclose(FileHandle) == 0 && bOk;
+        if (!bOk) { fprintf(stdout, "ERROR: Failed writing to file %s!\n", FileName); }
+        return bOk;
+    }
+}
+
+void Haversine_Roofline::Measure(Perf::RooflineCeilings* OutCeilings)
+{
+    Perf::RooflineCeilings Result = {};
+    DetectCacheSizes(Result.CacheSizes);
+    u64 DRAMSize = Result.CacheSizes[(u32)Perf::MemoryLevel::L3] * 4;
+    if (DRAMSize < DRAMWorkingSetMin) { DRAMSize = DRAMWorkingSetMin; }
+
+    // One buffer for every level, each measures a prefix of it
+    u64 Count = DRAMSize / sizeof(f64);
+    f64* Data = new f64[Count];
+    for (u64 Idx = 0; Idx < Count; Idx++) { Data[Idx] = 1.0; }
+
+    fprintf(stdout, "Measuring roofline ceilings...\n");
+    u64 CPUFreq = Perf::EstimateCPUFreq();
+    for (u32 Level = 0; Level < (u32)Perf::MemoryLevel::Count; Level++)
+    {
+        // Half of a cache leaves room for everything else it holds, rounded to whole 4KB pages
+        u64 Size = Level < (u32)Perf::MemoryLevel::DRAM ? Result.CacheSizes[Level] / 2 : DRAMSize;
+        Size &= ~4095ull;
+        Result.ReadBandwidth[Level] = MeasureReadBandwidth(Data, Size, CPUFreq);
+    }
+    delete[] Data;
+
+    Result.ScalarFlops = MeasureFlops<Haversine_Math::f64x1>(CPUFreq);
+    Result.SimdFlops = MeasureFlops<Haversine_Math::WideLane>(CPUFreq);
+    Result.SimdWidth = Haversine_Math::WideLane::Width;
+
+    *OutCeilings = Result;
+}
+
+void Haversine_Roofline::Print(const Perf::RooflineCeilings& Ceilings)
+{
+    constexpr f64 Kilobyte = 1024.0;
+    constexpr f64 Gigabyte = 1024.0 * 1024.0 * 1024.0;
+    char CPUName[sizeof(CacheHeader::CPUName)];
+    GetCPUName(CPUName);
+    fprintf(stdout, "Roofline ceilings (1 core, %s):\n", CPUName[0] ? CPUName : "unknown CPU");
+    for (u32 Level = 0; Level < (u32)Perf::MemoryLevel::Count; Level++)
+    {
+        fprintf(stdout, "\t%s read: %.2fgb/s", Perf::GetMemoryLevelName((Perf::MemoryLevel)Level),
+                Ceilings.ReadBandwidth[Level] / Gigabyte);
+        if (Ceilings.CacheSizes[Level]) { fprintf(stdout, " (%.0fKB cache)", (f64)Ceilings.CacheSizes[Level] / Kilobyte); }
+        fprintf(stdout, "\n");
+    }
+    fprintf(stdout, "\tf64 multiply-add, scalar: %.2f GFLOP/s\n", Ceilings.ScalarFlops / 1.0e9);
+    fprintf(stdout, "\tf64 multiply-add, x%u SIMD: %.2f GFLOP/s\n", Ceilings.SimdWidth, Ceilings.SimdFlops / 1.0e9);
+}
+
+void Haversine_Roofline::GetCeilings(const char* FileName, Perf::RooflineCeilings* OutCeilings)
+{
+    if (LoadCache(FileName, OutCeilings)) { return; }
+    Measure(OutCeilings);
+    if (SaveCache(FileName, *OutCeilings)) { fprintf(stdout, "Wrote roofline ceilings to %s\n", FileName); }
+}
+
+void Haversine_Roofline::Run(const char* FileName)
+{
+    Perf::RooflineCeilings Ceilings = {};
+    Measure(&Ceilings);
+    Print(Ceilings);
+    if (SaveCache(FileName, Ceilings)) { fprintf(stdout, "Wrote roofline ceilings to %s\n", FileName); }
+}
@@ -0,0 +1,47 @@
+#ifndef HAVERSINE_ROOFLINE_H
+#define HAVERSINE_ROOFLINE_H
+
+/*
+ * NOTE:
+ *      Probe for the ceilings Perf::EnableRoofline compares anchors against, on one core:
+ *          - Read bandwidth over a working set of half of each cache level (sizes from
+ *            CPUID's deterministic cache leaves, per core/slice), and DRAMWorkingSetMin
+ *            or 4x L3 past it, 8 independent WideLane sums so the loads are the limit
+ *          - f64 multiply-add throughput on Haversine_Math::f64x1 and WideLane, enough
+ *            independent chains to cover the FMA latency
+ *      Every figure is the best of TrialCount runs
+ *      The results are cached in a small binary file keyed by the CPU's brand string and
+ *      cache sizes (little endian, like Haversine_Binary), so -roofline only pays for the
+ *      probe (a few seconds) the first time on a machine
+ */
+
+#include "haversine_common.h"
+#include "haversine_perf.h"
+
+namespace Haversine_Roofline
+{
+    static constexpr u32 CacheMagic = 0x31525648; // "HVR1"
+    static constexpr u16 CacheVersion = 1;
+    static constexpr const char* DefaultCacheFileName = "hvroofline.bin";
+    static constexpr u64 DRAMWorkingSetMin = 256ull * 1024 * 1024;
+    static constexpr int TrialCount = 5;
+
+    struct CacheHeader
+    {
+        u32 Magic;
+        u16 Version;
+        u16 HeaderSize; // sizeof(CacheHeader), the Perf::RooflineCeilings follow
+        char CPUName[48]; // CPUID brand string
+    };
+
+    // Allocates and reads a DRAM sized buffer, takes a few seconds
+    void Measure(Perf::RooflineCeilings* OutCeilings);
+    void Print(const Perf::RooflineCeilings& Ceilings);
+
+    // The ceilings cached in FileName if they're from this CPU, otherwise measured and written to it (-roofline)
+    void GetCeilings(const char* FileName, Perf::RooflineCeilings* OutCeilings);
+    // Measures, prints and (re)writes FileName (roofline command)
+    void Run(const char* FileName);
+}
+
+#endif // HAVERSINE_ROOFLINE_H
@@ -0,0 +1,446 @@
+#include "haversine_schema.h"
+#include "haversine_fileio.h"
+#include "haversine_float.h"
+#include "haversine_jsondom.h"
+#include "haversine_perf.h"
+
+// C stdlib headers:
+#include <string.h>
+// Intrinsics:
+#if _MSC_VER
+#include <intrin.h>
+#endif // _MSC_VER
+
+namespace Haversine_Schema
+{
+    static constexpr int StreamCount = 4;
+    // Length of {"X0":0.0,"Y0":0.0,"X1":0.0,"Y1":0.0}
+    static constexpr int MinRecordSize = 37;
+
+    struct Cursor
+    {
+        const char* At;
+        const char* End;
+    };
+
+    inline void SkipWhiteSpace(Cursor* C)
+    {
+        while (C->At < C->End && (*C->At == ' ' || *C->At == '\n' || *C->At == '\r' || *C->At == '\t'))
+        {
+            C->At++;
+        }
+    }
+
+    // Consumes Char (after any whitespace) if it's next
+    inline bool Match(Cursor* C, char Char)
+    {
+        SkipWhiteSpace(C);
+        if (C->At < C->End && *C->At == Char)
+        {
+            C->At++;
+            return true;
+        }
+        return false;
+    }
+
+    // QuotedKey includes the quotes, e.g. "\"X0\""
+    template <int KeyLength>
+    inline bool MatchKey(Cursor* C, const char (&QuotedKey)[KeyLength])
+    {
+        SkipWhiteSpace(C);
+        if (C->End - C->At < KeyLength - 1 || memcmp(C->At, QuotedKey, KeyLength - 1) != 0) { return false; }
+        C->At += KeyLength - 1;
+        return Match(C, ':');
+    }
+
+    static constexpr u64 AllZeroChars = 0x3030303030303030ull;
+    static constexpr f64 FractionScales[8] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7 };
+    static constexpr u64 FractionMultipliers[8] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000 };
+
+    inline u64 LoadU64(const char* Src)
+    {
+        u64 Result = 0;
+        memcpy(&Result, Src, sizeof(u64));
+        return Result;
+    }
+
+    // Number of leading bytes of Chars (first char in the low byte) that are '0'..'9'
+    inline int CountLeadingDigits(u64 Chars)
+    {
+        u64 NonDigit = ((Chars & 0xF0F0F0F0F0F0F0F0ull) |
+                (((Chars + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4)) ^ 0x3333333333333333ull;
+        // High bit set in every byte that isn't zero
+        u64 NonZeroBytes = (NonDigit | ((NonDigit & 0x7F7F7F7F7F7F7F7Full) + 0x7F7F7F7F7F7F7F7Full)) & 0x8080808080808080ull;
+        if (NonZeroBytes == 0) { return 8; }
+#if _MSC_VER
+        unsigned long BitIdx = 0;
+        _BitScanForward64(&BitIdx, NonZeroBytes);
+        return (int)BitIdx / 8;
+#else
+        return __builtin_ctzll(NonZeroBytes) / 8;
+#endif // _MSC_VER
+    }
+
+    // Value of the first DigitCount (1..8) digit chars, as in Lemire's parse_eight_digits_unrolled
+    inline u64 ParseDigits(u64 Chars, int DigitCount)
+    {
+        // Move the digits to the top bytes and fill the rest with leading '0's
+        int PadBits = 8 * (8 - DigitCount);
+        u64 Value = PadBits ? ((Chars << PadBits) | (AllZeroChars >> (64 - PadBits))) : Chars;
+        Value -= AllZeroChars;
+        Value = (Value * 10) + (Value >> 8);
+        Value = (((Value & 0x000000FF000000FFull) * 0x000F424000000064ull) +
+                (((Value >> 16) & 0x000000FF000000FFull) * 0x0000271000000001ull)) >> 32;
+        return Value;
+    }
+
+    // NOTE:
+    //      Coordinates as Haversine_Ref0::WriteDataAsJSON writes them (-ddd.dddddd) are parsed with
+    //      two 8-byte loads and no per-char loop, everything else goes through ParseF64
+    //      (including most of Haversine_JsonWriter's shortest round-trip output, up to 17 digits)
+    //      With at most 3 + 7 digits the mantissa is exact, so one division rounds correctly
+    inline bool MatchCoordinate(Cursor* C, f64* OutValue)
+    {
+        SkipWhiteSpace(C);
+        const char* At = C->At;
+        if (C->End - At >= 24)
+        {
+            bool bNegative = *At == '-';
+            At += bNegative ? 1 : 0;
+            int IntDigits = CountLeadingDigits(LoadU64(At));
+            if (1 <= IntDigits && IntDigits <= 3 && At[IntDigits] == '.')
+            {
+                u64 FractionChars = LoadU64(At + IntDigits + 1);
+                int FractionDigits = CountLeadingDigits(FractionChars);
+                char After = At[IntDigits + 1 + FractionDigits];
+                if (1 <= FractionDigits && FractionDigits <= 7 && After != 'e' && After != 'E')
+                {
+                    u64 Mantissa = ParseDigits(LoadU64(At), IntDigits) * FractionMultipliers[FractionDigits] +
+                        ParseDigits(FractionChars, FractionDigits);
+                    f64 Value = (f64)Mantissa / FractionScales[FractionDigits];
+                    *OutValue = bNegative ? -Value : Value;
+                    C->At = At + IntDigits + 1 + FractionDigits;
+                    return true;
+                }
+            }
+        }
+
+        bool bInteger = false;
+        const char* NumberEnd = Haversine_Float::ParseF64(C->At, C->End, OutValue, &bInteger);
+        // NOTE: Integers are NumberInt in the generic tree, which ParsePairsArray rejects
+        if (!NumberEnd || bInteger) { return false; }
+        C->At = NumberEnd;
+        return true;
+    }
+
+    // Canonical is how WriteDataAsJSON writes the separator and key, e.g. ", \"Y0\": "
+    // Any other spacing still matches through the generic path
+    template <int KeyLength>
+    inline bool MatchMember(Cursor* C, char Separator, const char (&QuotedKey)[KeyLength], const char (&Canonical)[9])
+    {
+        if (C->End - C->At >= 8 && memcmp(C->At, Canonical, 8) == 0)
+        {
+            C->At += 8;
+            return true;
+        }
+        return Match(C, Separator) && MatchKey(C, QuotedKey);
+    }
+
+    inline bool MatchPair(Cursor* C, HPair* OutPair)
+    {
+        SkipWhiteSpace(C);
+        return MatchMember(C, '{', "\"X0\"", "{ \"X0\": ") && MatchCoordinate(C, &OutPair->X0) &&
+            MatchMember(C, ',', "\"Y0\"", ", \"Y0\": ") && MatchCoordinate(C, &OutPair->Y0) &&
+            MatchMember(C, ',', "\"X1\"", ", \"X1\": ") && MatchCoordinate(C, &OutPair->X1) &&
+            MatchMember(C, ',', "\"Y1\"", ", \"Y1\": ") && MatchCoordinate(C, &OutPair->Y1) &&
+            Match(C, '}');
+    }
+
+    // Sequential read of the whole buffer, as a bandwidth reference for the parsers
+    u64 SumBytes(const u8* Data, int Size)
+    {
+        u64 Sums[4] = {};
+        int ReadIdx = 0;
+        for (; ReadIdx + 32 <= Size; ReadIdx += 32)
+        {
+            u64 Words[4];
+            memcpy(Words, Data + ReadIdx, sizeof(Words));
+            Sums[0] += Words[0];
+            Sums[1] += Words[1];
+            Sums[2] += Words[2];
+            Sums[3] += Words[3];
+        }
+        for (; ReadIdx < Size; ReadIdx++) { Sums[0] += Data[ReadIdx]; }
+        return Sums[0] + Sums[1] + Sums[2] + Sums[3];
+    }
+
+    bool ListsMatch(HList A, HList B)
+    {
+        return A.Count == B.Count && (A.Count == 0 || memcmp(A.Data, B.Data, sizeof(HPair) * A.Count) == 0);
+    }
+
+    bool CharIsTrailer(char C)
+    {
+        return C == ' ' || C == '\n' || C == '\r' || C == '\t' || C == '\0';
+    }
+
+    bool TrailerIsEmpty(Cursor C)
+    {
+        while (C.At < C.End && CharIsTrailer(*C.At)) { C.At++; }
+        return C.At == C.End;
+    }
+
+    struct PairStream
+    {
+        Cursor C; // C.End is the end of this stream's records, not of the input
+        HPair* Pairs;
+        int Count;
+        int Capacity;
+        bool bDone;
+    };
+
+    // Splits the records between [Begin, End) into StreamCount runs of whole records
+    // The shortest possible record bounds how many pairs each run can hold
+    void SplitIntoStreams(const char* Begin, const char* End, PairStream* Streams)
+    {
+        const char* StreamBegin = Begin;
+        for (int StreamIdx = 0; StreamIdx < StreamCount; StreamIdx++)
+        {
+            const char* StreamEnd = End;
+            const char* NextBegin = End;
+            if (StreamIdx < StreamCount - 1)
+            {
+                const char* Target = Begin + (End - Begin) * (StreamIdx + 1) / StreamCount;
+                if (Target < StreamBegin) { Target = StreamBegin; }
+                // Records only hold numbers, so the next '}' ends one (the stream fails if not)
+                const char* Close = (const char*)memchr(Target, '}', End - Target);
+                if (Close)
+                {
+                    Cursor AfterClose = { Close + 1, End };
+                    if (Match(&AfterClose, ','))
+                    {
+                        StreamEnd = Close + 1;
+                        NextBegin = AfterClose.At;
+                    }
+                }
+            }
+
+            PairStream* Stream = Streams + StreamIdx;
+            Stream->C = { StreamBegin, StreamEnd };
+            Stream->Capacity = (int)((StreamEnd - StreamBegin) / MinRecordSize) + 1;
+            Stream->Pairs = new HPair[Stream->Capacity];
+            Stream->bDone = StreamBegin >= StreamEnd;
+            StreamBegin = NextBegin;
+        }
+    }
+
+    // Reads one record and the ',' after it, false if the layout doesn't match
+    inline bool StepStream(PairStream* Stream)
+    {
+        Cursor* C = &Stream->C;
+        if (Stream->Count == Stream->Capacity || !MatchPair(C, Stream->Pairs + Stream->Count)) { return false; }
+        Stream->Count++;
+
+        SkipWhiteSpace(C);
+        if (C->At == C->End)
+        {
+            Stream->bDone = true;
+            return true;
+        }
+        return Match(C, ',');
+    }
+}
+
+bool Haversine_Schema::FindRecords(const char* JsonData, int Size, const char** OutBegin, const char** OutEnd)
+{
+    Cursor C = { JsonData, JsonData + Size };
+    if (!Match(&C, '{') || !MatchKey(&C, "\"pairs\"") || !Match(&C, '[')) { return false; }
+    if (Match(&C, ']'))
+    {
+        // NOTE: An empty pairs array gives an empty list like ParsePairsArray does
+        SkipWhiteSpace(&C);
+        bool bMatch = Match(&C, '}') && TrailerIsEmpty(C);
+        *OutBegin = C.At;
+        *OutEnd = C.At;
+        return bMatch;
+    }
+
+    // The document has to end with "] }" (plus whitespace / the null Read appends)
+    const char* ArrayEnd = JsonData + Size;
+    while (ArrayEnd > C.At && CharIsTrailer(ArrayEnd[-1])) { ArrayEnd--; }
+    if (ArrayEnd <= C.At || ArrayEnd[-1] != '}') { return false; }
+    ArrayEnd--;
+    while (ArrayEnd > C.At && CharIsTrailer(ArrayEnd[-1])) { ArrayEnd--; }
+    if (ArrayEnd <= C.At || ArrayEnd[-1] != ']') { return false; }
+    ArrayEnd--;
+
+    *OutBegin = C.At;
+    *OutEnd = ArrayEnd;
+    return true;
+}
+
+int Haversine_Schema::ParseRecords(const char* Begin, const char* End, HPair* OutPairs, int MaxCount)
+{
+    PairStream Stream = { { Begin, End }, OutPairs, 0, MaxCount, Begin >= End };
+    while (!Stream.bDone)
+    {
+        if (!StepStream(&Stream)) { return -1; }
+    }
+    return Stream.Count;
+}
+
+bool Haversine_Schema::TryParsePairs(const char* JsonData, int Size, HList* OutList)
+{
+    TIME_FUNC_DATA(Size);
+
+    const char* RecordsBegin = nullptr;
+    const char* RecordsEnd = nullptr;
+    if (!FindRecords(JsonData, Size, &RecordsBegin, &RecordsEnd)) { return false; }
+    if (RecordsBegin == RecordsEnd)
+    {
+        *OutList = HList{};
+        return true;
+    }
+
+    PairStream Streams[StreamCount] = {};
+    SplitIntoStreams(RecordsBegin, RecordsEnd, Streams);
+
+    // NOTE:
+    //      Every number's position depends on the length of the one before it, so a
+    //      single cursor is bound by that dependency chain, stepping a few independent
+    //      cursors in turn lets the CPU overlap them
+    bool bMatch = true;
+    int ActiveCount = StreamCount;
+    while (bMatch && ActiveCount > 0)
+    {
+        ActiveCount = 0;
+        for (int StreamIdx = 0; StreamIdx < StreamCount; StreamIdx++)
+        {
+            PairStream* Stream = Streams + StreamIdx;
+            if (Stream->bDone) { continue; }
+            bMatch = bMatch && StepStream(Stream);
+            ActiveCount += Stream->bDone ? 0 : 1;
+        }
+    }
+
+    int Count = 0;
+    for (int StreamIdx = 0; StreamIdx < StreamCount; StreamIdx++) { Count += Streams[StreamIdx].Count; }
+    if (bMatch)
+    {
+        HList Result = { Count, new HPair[Count] };
+        TRACK_ALLOC(sizeof(HPair) * Count);
+        int PairIdx = 0;
+        for (int StreamIdx = 0; StreamIdx < StreamCount; StreamIdx++)
+        {
+            memcpy(Result.Data + PairIdx, Streams[StreamIdx].Pairs, sizeof(HPair) * Streams[StreamIdx].Count);
+            PairIdx += Streams[StreamIdx].Count;
+        }
+        *OutList = Result;
+    }
+    for (int StreamIdx = 0; StreamIdx < StreamCount; StreamIdx++) { delete[] Streams[StreamIdx].Pairs; }
+    return bMatch;
+}
+
+HList Haversine_Schema::ParseJSON(Haversine_Ref0::FileContentsT& InputFile)
+{
+    HList Result = {};
+    if (nullptr == InputFile.Data) { return Result; }
+
+    if (!TryParsePairs((const char*)InputFile.Data, InputFile.Size, &Result))
+    {
+        Result = Haversine_JsonDom::ParseJSON(InputFile);
+    }
+    return Result;
+}
+
+HList Haversine_Schema::ReadFileAsJSON(const char* FileName)
+{
+    TIME_FUNC();
+
+    Haversine_FileIO::MappedFile Input = Haversine_FileIO::Load(FileName, Haversine_FileIO::DefaultLoadMode);
+    HList Result = Haversine_Schema::ParseJSON(Input.Contents);
+    Input.Release();
+
+    return Result;
+}
+
+void Haversine_Schema::Benchmark(const char* FileName)
+{
+    TIME_FUNC();
+
+    Haversine_Ref0::FileContentsT Input = {};
+    Input.Read(FileName, true);
+    if (!Input.Data) { return; }
+
+    // The generic readers parse in place, so they get a fresh copy every run
+    Haversine_Ref0::FileContentsT WorkingCopy = { Input.Size, new u8[Input.Size] };
+
+    static constexpr int RepeatCount = 5;
+    u64 ReadBest = UINT64_MAX;
+    u64 SchemaBest = UINT64_MAX;
+    u64 DomBest = UINT64_MAX;
+    u64 Ref0Best = UINT64_MAX;
+    u64 ByteSum = 0;
+    bool bSchemaMatched = false;
+    HList SchemaList = {};
+    HList DomList = {};
+    HList Ref0List = {};
+    for (int RepeatIdx = 0; RepeatIdx < RepeatCount; RepeatIdx++)
+    {
+        TRACK_FREE(sizeof(HPair) * SchemaList.Count);
+        delete[] SchemaList.Data;
+        TRACK_FREE(sizeof(HPair) * DomList.Count);
+        delete[] DomList.Data;
+        TRACK_FREE(sizeof(HPair) * Ref0List.Count);
+        delete[] Ref0List.Data;
+
+        u64 Begin = Perf::ReadCPUTimer();
+        ByteSum += SumBytes(Input.Data, Input.Size);
+        u64 Elapsed = Perf::ReadCPUTimer() - Begin;
+        if (Elapsed < ReadBest) { ReadBest = Elapsed; }
+
+        SchemaList = {};
+        Begin = Perf::ReadCPUTimer();
+        bSchemaMatched = TryParsePairs((const char*)Input.Data, Input.Size, &SchemaList);
+        Elapsed = Perf::ReadCPUTimer() - Begin;
+        if (Elapsed < SchemaBest) { SchemaBest = Elapsed; }
+
+        memcpy(WorkingCopy.Data, Input.Data, Input.Size);
+        Begin = Perf::ReadCPUTimer();
+        DomList = Haversine_JsonDom::ParseJSON(WorkingCopy);
+        Elapsed = Perf::ReadCPUTimer() - Begin;
+        if (Elapsed < DomBest) { DomBest = Elapsed; }
+
+        Begin = Perf::ReadCPUTimer();
+        Ref0List = Haversine_Ref0::ParseJSON(Input);
+        Elapsed = Perf::ReadCPUTimer() - Begin;
+        if (Elapsed < Ref0Best) { Ref0Best = Elapsed; }
+    }
+
+    f64 Bytes = (f64)Input.Size;
+    fprintf(stdout, "%s (%d bytes, %d pairs):\n", FileName, Input.Size, DomList.Count);
+    fprintf(stdout, "\tRead only:   %.2f cycles/byte (checksum %llu)\n", (f64)ReadBest / Bytes, ByteSum);
+    if (bSchemaMatched)
+    {
+        fprintf(stdout, "\tSchema:      %.2f cycles/byte (%.1f%% of read bandwidth), list %s\n",
+                (f64)SchemaBest / Bytes, 100.0 * (f64)ReadBest / (f64)SchemaBest,
+                ListsMatch(SchemaList, DomList) && ListsMatch(SchemaList, Ref0List) ? "matches" : "DOES NOT MATCH");
+    }
+    else
+    {
+        fprintf(stdout, "\tSchema:      layout not matched after %.2f cycles/byte, falls back to the DOM reader\n",
+                (f64)SchemaBest / Bytes);
+    }
+    fprintf(stdout, "\tDOM ParseJSON:  %.2f cycles/byte\n", (f64)DomBest / Bytes);
+    fprintf(stdout, "\tRef0 ParseJSON: %.2f cycles/byte\n", (f64)Ref0Best / Bytes);
+
+    TRACK_FREE(sizeof(HPair) * SchemaList.Count);
+    delete[] SchemaList.Data;
+    TRACK_FREE(sizeof(HPair) * DomList.Count);
+    delete[] DomList.Data;
+    TRACK_FREE(sizeof(HPair) * Ref0List.Count);
+    delete[] Ref0List.Data;
+    WorkingCopy.Release();
+    Input.Release();
+}
+
@@ -0,0 +1,36 @@
+#ifndef HAVERSINE_SCHEMA_H
+#define HAVERSINE_SCHEMA_H
+
+/*
+ * NOTE:
+ *      Reader specialized for the layout WriteDataAsJSON produces:
+ *          { "pairs": [ { "X0": n, "Y0": n, "X1": n, "Y1": n }, ... ] }
+ *      It walks the input once and writes the four numbers of every record
+ *      straight into the CoordPair buffer, without tokens, a tree or key lookups
+ *      Anything that doesn't match exactly (other keys, key order, extra values,
+ *      integer coordinates, ...) is handed to the generic Haversine_JsonDom
+ *      reader instead, so both always return the same list
+ */
+
+#include "haversine_common.h"
+#include "haversine_ref0.h"
+
+namespace Haversine_Schema
+{
+    // False if the input doesn't have the pairs layout, OutList is untouched then
+    bool TryParsePairs(const char* JsonData, int Size, HList* OutList);
+
+    // Finds the ',' separated records inside "pairs": [ ... ] (Begin == End for an empty array)
+    bool FindRecords(const char* JsonData, int Size, const char** OutBegin, const char** OutEnd);
+    // Parses records that fill [Begin, End) exactly into OutPairs, -1 if that isn't
+    // what's there or there are more than MaxCount of them
+    int ParseRecords(const char* Begin, const char* End, HPair* OutPairs, int MaxCount);
+
+    HList ParseJSON(Haversine_Ref0::FileContentsT& InputFile);
+    HList ReadFileAsJSON(const char* FileName);
+
+    void Benchmark(const char* FileName);
+}
+
+#endif // HAVERSINE_SCHEMA_H
+
@@ -0,0 +1,302 @@
+#include "haversine_stream.h"
+#include "haversine_ref0.h"
+#include "haversine_float.h"
+#include "haversine_pipeline.h"
+#include "haversine_perf.h"
+
+// C stdlib headers:
+#include <string.h>
+
+namespace Haversine_Stream
+{
+    static constexpr u32 PairField_X0 = 1 << 0;
+    static constexpr u32 PairField_Y0 = 1 << 1;
+    static constexpr u32 PairField_X1 = 1 << 2;
+    static constexpr u32 PairField_Y1 = 1 << 3;
+    static constexpr u32 PairField_All = PairField_X0 | PairField_Y0 | PairField_X1 | PairField_Y1;
+
+    bool CharIsNumberPart(char C)
+    {
+        return ('0' <= C && C <= '9') ||
+            C == '.' || C == '-' || C == '+' ||
+            C == 'e' || C == 'E';
+    }
+
+    bool CharIsWhiteSpace(char C)
+    {
+        return C == ' ' || C == '\n' || C == '\r' || C == '\t';
+    }
+
+    ScanFrame* Top(StreamParser* Parser)
+    {
+        return Parser->Depth > 0 ? Parser->Stack + (Parser->Depth - 1) : nullptr;
+    }
+
+    void Push(StreamParser* Parser, ScanFrame Frame)
+    {
+        if (Parser->Depth >= MaxDepth) { Parser->bError = true; return; }
+        Parser->Stack[Parser->Depth++] = Frame;
+    }
+
+    void OnNumber(StreamParser* Parser)
+    {
+        f64 Value = 0.0;
+        const char* TokenEnd = Parser->Token + Parser->TokenLength;
+        if (Haversine_Float::ParseF64(Parser->Token, TokenEnd, &Value) != TokenEnd) { Parser->bError = true; return; }
+
+        ScanFrame* Frame = Top(Parser);
+        if (Frame && Frame->bPairObject)
+        {
+            const char* Key = Parser->CurrentKey;
+            if (strcmp(Key, "X0") == 0) { Parser->Pair.X0 = Value; Parser->PairFieldMask |= PairField_X0; }
+            else if (strcmp(Key, "Y0") == 0) { Parser->Pair.Y0 = Value; Parser->PairFieldMask |= PairField_Y0; }
+            else if (strcmp(Key, "X1") == 0) { Parser->Pair.X1 = Value; Parser->PairFieldMask |= PairField_X1; }
+            else if (strcmp(Key, "Y1") == 0) { Parser->Pair.Y1 = Value; Parser->PairFieldMask |= PairField_Y1; }
+        }
+    }
+
+    void OnCloseObject(StreamParser* Parser)
+    {
+        ScanFrame* Frame = Top(Parser);
+        if (!Frame || !Frame->bObject) { Parser->bError = true; return; }
+        if (Frame->bPairObject)
+        {
+            if (Parser->PairFieldMask != PairField_All) { Parser->bError = true; return; }
+            Parser->Sum += Haversine_Ref0::CalculateHaversine(Parser->Pair);
+            Parser->PairCount++;
+        }
+        Parser->Depth--;
+        Parser->bExpectKey = false;
+    }
+}
+
+void Haversine_Stream::StreamParser::Feed(const char* Data, int Size)
+{
+    int ReadIdx = 0;
+    while (!bError && ReadIdx < Size)
+    {
+        char C = Data[ReadIdx];
+        switch (State)
+        {
+            case Scan_String:
+            {
+                if (C == '\\') { State = Scan_StringEscape; }
+                else if (C == '"')
+                {
+                    Token[TokenLength < MaxTokenLength ? TokenLength : MaxTokenLength] = '\0';
+                    ScanFrame* Frame = Top(this);
+                    if (Frame && Frame->bObject && bExpectKey)
+                    {
+                        memcpy(CurrentKey, Token, sizeof(Token));
+                    }
+                    State = Scan_Default;
+                }
+                // Overlong keys never match anything we look for, so just stop storing them
+                else if (TokenLength < MaxTokenLength) { Token[TokenLength++] = C; }
+                else { TokenLength = MaxTokenLength + 1; }
+                ReadIdx++;
+            } break;
+            case Scan_StringEscape:
+            {
+                State = Scan_String;
+                ReadIdx++;
+            } break;
+            case Scan_Number:
+            {
+                if (CharIsNumberPart(C))
+                {
+                    if (TokenLength >= MaxTokenLength) { bError = true; }
+                    else { Token[TokenLength++] = C; }
+                    ReadIdx++;
+                }
+                else
+                {
+                    // Number ended, C is re-scanned in the default state
+                    OnNumber(this);
+                    State = Scan_Default;
+                }
+            } break;
+            case Scan_Literal:
+            {
+                if ('a' <= C && C <= 'z') { ReadIdx++; }
+                else { State = Scan_Default; }
+            } break;
+            case Scan_Default:
+            {
+                ScanFrame* Frame = Top(this);
+                switch (C)
+                {
+                    case '{':
+                    {
+                        ScanFrame NewFrame = { true, false, Frame && !Frame->bObject && Frame->bPairsArray };
+                        Push(this, NewFrame);
+                        PairFieldMask = 0;
+                        bExpectKey = true;
+                    } break;
+                    case '[':
+                    {
+                        ScanFrame NewFrame = { false, Frame && Frame->bObject && strcmp(CurrentKey, "pairs") == 0, false };
+                        Push(this, NewFrame);
+                        bExpectKey = false;
+                    } break;
+                    case '}': { OnCloseObject(this); } break;
+                    case ']':
+                    {
+                        if (!Frame || Frame->bObject) { bError = true; }
+                        else { Depth--; }
+                    } break;
+                    case ':': { bExpectKey = false; } break;
+                    case ',': { bExpectKey = Frame && Frame->bObject; } break;
+                    case '"':
+                    {
+                        State = Scan_String;
+                        TokenLength = 0;
+                    } break;
+                    case 't':
+                    case 'f':
+                    case 'n': { State = Scan_Literal; } break;
+                    default:
+                    {
+                        if (CharIsWhiteSpace(C) || C == '\0') { }
+                        else if (CharIsNumberPart(C))
+                        {
+                            State = Scan_Number;
+                            Token[0] = C;
+                            TokenLength = 1;
+                        }
+                        else { bError = true; }
+                    } break;
+                }
+                ReadIdx++;
+            } break;
+        }
+    }
+    BytesConsumed += ReadIdx;
+}
+
+void Haversine_Stream::StreamParser::Finish()
+{
+    if (State == Scan_Number)
+    {
+        OnNumber(this);
+        State = Scan_Default;
+    }
+    if (State != Scan_Default || Depth != 0) { bError = true; }
+}
+
+Haversine_Stream::StreamParser Haversine_Stream::SumPairsFromFile(const char* FileName, int BlockSize, int QueueDepth)
+{
+    TIME_FUNC();
+
+    if (QueueDepth > 0) { return SumPairsFromFilePipelined(FileName, BlockSize, QueueDepth); }
+
+    StreamParser Parser = {};
+
+    FILE* FileHandle = nullptr;
+    fopen_s(&FileHandle, FileName, "rb");
+    if (!FileHandle)
+    {
+        fprintf(stdout, "ERROR: Can't open file %s for read!\n", FileName);
+        Parser.bError = true;
+        return Parser;
+    }
+
+    char* Block = new char[BlockSize];
+    for (;;)
+    {
+        size_t BytesRead = 0;
+        {
+            TIME_BLOCK(Stream_Read);
+            BytesRead = fread_s(Block, BlockSize, 1, BlockSize, FileHandle);
+        }
+        if (BytesRead == 0) { break; }
+
+        TIME_BLOCK_DATA(Stream_ParseAndSum, BytesRead);
+        Parser.Feed(Block, (int)BytesRead);
+        if (Parser.bError) { break; }
+    }
+    Parser.Finish();
+
+    delete[] Block;
+    fclose(FileHandle);
+
+    if (Parser.bError)
+    {
+        fprintf(stdout, "ERROR: Malformed pair data in %s near byte %llu!\n", FileName, Parser.BytesConsumed);
+    }
+    return Parser;
+}
+
+Haversine_Stream::StreamParser Haversine_Stream::SumPairsFromFilePipelined(const char* FileName, int ChunkSize, int QueueDepth)
+{
+    TIME_FUNC();
+
+    StreamParser Parser = {};
+
+    Haversine_Pipeline::ChunkReader Reader = {};
+    if (!Reader.Open(FileName, ChunkSize, QueueDepth))
+    {
+        Parser.bError = true;
+        return Parser;
+    }
+    Reader.Start();
+
+    Haversine_Pipeline::Chunk Chunk = {};
+    while (!Parser.bError && Reader.Acquire(&Chunk))
+    {
+        TIME_BLOCK_DATA(Stream_ParseAndSum, Chunk.Size);
+        Parser.Feed((const char*)Chunk.Data, Chunk.Size);
+        Reader.Recycle();
+    }
+    Parser.Finish();
+
+    bool bReadAll = Reader.Close();
+    if (Parser.bError)
+    {
+        fprintf(stdout, "ERROR: Malformed pair data in %s near byte %llu!\n", FileName, Parser.BytesConsumed);
+    }
+    else if (!bReadAll)
+    {
+        fprintf(stdout, "ERROR: Failed to read all of %s!\n", FileName);
+        Parser.bError = true;
+    }
+    return Parser;
+}
+
+void Haversine_Stream::Calc(const char* FileNameJSON)
+{
+    TIME_FUNC();
+
+    int BlockSize = Haversine_Pipeline::DefaultChunkSize;
+    int QueueDepth = Haversine_Pipeline::DefaultQueueDepth;
+    StreamParser Result = SumPairsFromFile(FileNameJSON, BlockSize, QueueDepth);
+    if (!Result.bError && Result.PairCount > 0)
+    {
+        f64 HvAvg = Result.Sum / (f64)Result.PairCount;
+        fprintf(stdout, "\tAverage: %f\n", HvAvg);
+        if (QueueDepth > 0)
+        {
+            fprintf(stdout, "\tStreamed %lld pairs from %llu bytes with %d background read %d byte chunks\n",
+                    Result.PairCount, Result.BytesConsumed, QueueDepth, BlockSize);
+        }
+        else
+        {
+            fprintf(stdout, "\tStreamed %lld pairs from %llu bytes with a %d byte block buffer\n",
+                    Result.PairCount, Result.BytesConsumed, BlockSize);
+        }
+    }
+    else if (!Result.bError)
+    {
+        fprintf(stdout, "\tNo pairs found in %s\n", FileNameJSON);
+    }
+}
+
+void Haversine_Stream::Calc(int Seed, int Count, bool bClustered)
+{
+    static constexpr int FileNameMaxSize = 96;
+    char JSONFileName[FileNameMaxSize];
+    Haversine_Ref0::GetInputDataFileName(JSONFileName, FileNameMaxSize, Seed, Count, bClustered);
+
+    Calc(JSONFileName);
+}
+
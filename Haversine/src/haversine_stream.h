@@ -0,0 +1,72 @@
+#ifndef HAVERSINE_STREAM_H
+#define HAVERSINE_STREAM_H
+
+/*
+ * NOTE:
+ *      Streaming alternative to Haversine_Ref0::Calc: the input is read in
+ *      fixed-size blocks and scanned by a byte-level state machine, so no
+ *      JSON tree and no HList are ever built. Every completed pair object
+ *      inside a "pairs" array goes straight into the running sum
+ *      Tokens that straddle two blocks need no special handling because the
+ *      scanner state (including a partially read number/key) persists across
+ *      calls to Feed(), memory use is one block buffer regardless of file size
+ */
+
+#include "haversine_common.h"
+
+namespace Haversine_Stream
+{
+    static constexpr int DefaultBlockSize = 256 * 1024;
+    static constexpr int MaxDepth = 64;
+    static constexpr int MaxTokenLength = 63;
+
+    enum ScanState
+    {
+        Scan_Default,
+        Scan_String,
+        Scan_StringEscape,
+        Scan_Number,
+        Scan_Literal,
+    };
+
+    struct ScanFrame
+    {
+        bool bObject;
+        bool bPairsArray; // Array stored under the "pairs" key
+        bool bPairObject; // Object that is an element of a pairs array
+    };
+
+    struct StreamParser
+    {
+        ScanState State;
+        int Depth;
+        ScanFrame Stack[MaxDepth];
+        bool bExpectKey;
+
+        int TokenLength;
+        char Token[MaxTokenLength + 1];
+        char CurrentKey[MaxTokenLength + 1];
+
+        HPair Pair;
+        u32 PairFieldMask;
+
+        f64 Sum;
+        s64 PairCount;
+        u64 BytesConsumed;
+        bool bError;
+
+        void Feed(const char* Data, int Size);
+        void Finish();
+    };
+
+    // QueueDepth > 0 reads on a background thread, see SumPairsFromFilePipelined
+    StreamParser SumPairsFromFile(const char* FileName, int BlockSize, int QueueDepth = 0);
+    // Same result, but a Haversine_Pipeline::ChunkReader keeps QueueDepth chunks read ahead
+    StreamParser SumPairsFromFilePipelined(const char* FileName, int ChunkSize, int QueueDepth);
+
+    void Calc(const char* FileNameJSON);
+    void Calc(int Seed, int Count, bool bClustered);
+}
+
+#endif // HAVERSINE_STREAM_H
+
@@ -0,0 +1,190 @@
+#include "haversine_threads.h"
+#include "haversine_perf.h"
+
+// C++ stdlib headers:
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace Haversine_Threads
+{
+    struct WorkerPoolState
+    {
+        std::thread* Threads;
+        std::mutex Mutex;
+        std::condition_variable WorkReady;
+        std::condition_variable WorkDone;
+        int SpawnedCount; // Threads[1..SpawnedCount-1] are running
+        u64 Generation;
+        int ActiveCount; // ThreadCount of the current Run()
+        int ActiveWorkers;
+        bool bQuit;
+
+        TaskFuncT Func;
+        void* Context;
+        int TaskCount;
+        std::atomic<int> NextTask;
+    };
+
+    void RunTasks(WorkerPool* Pool, int ThreadIdx)
+    {
+        WorkerPoolState* State = Pool->State;
+        PerfTiming* Timing = Pool->ThreadTimings + ThreadIdx;
+        int TasksRun = 0;
+
+        Timing->Begin = Perf::ReadCPUTimer();
+        int TaskIdx = State->NextTask.fetch_add(1);
+        while (TaskIdx < State->TaskCount)
+        {
+            State->Func(State->Context, TaskIdx, ThreadIdx);
+            TasksRun++;
+            TaskIdx = State->NextTask.fetch_add(1);
+        }
+        Timing->End = Perf::ReadCPUTimer();
+        Pool->ThreadTaskCounts[ThreadIdx] = TasksRun;
+    }
+
+    // SeenGeneration is the last Run() before the thread started, it waits for the next one
+    void WorkerThreadProc(WorkerPool* Pool, int ThreadIdx, u64 SeenGeneration)
+    {
+        WorkerPoolState* State = Pool->State;
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> Lock(State->Mutex);
+                while (!State->bQuit && State->Generation == SeenGeneration)
+                {
+                    State->WorkReady.wait(Lock);
+                }
+                if (State->bQuit) { return; }
+                SeenGeneration = State->Generation;
+                if (ThreadIdx >= State->ActiveCount) { continue; }
+            }
+
+            RunTasks(Pool, ThreadIdx);
+
+            {
+                std::lock_guard<std::mutex> Lock(State->Mutex);
+                State->ActiveWorkers--;
+                if (State->ActiveWorkers == 0) { State->WorkDone.notify_one(); }
+            }
+        }
+    }
+}
+
+int Haversine_Threads::GetHardwareThreadCount()
+{
+    int Result = (int)std::thread::hardware_concurrency();
+    return Result > 0 ? Result : 1;
+}
+
+Haversine_Threads::WorkerPool& Haversine_Threads::AcquirePool(int ThreadCount)
+{
+    // Joins the workers when the process exits
+    struct SharedPool
+    {
+        WorkerPool Pool;
+        ~SharedPool() { Pool.Release(); }
+    };
+    static SharedPool Shared = {};
+    Shared.Pool.Init(ThreadCount);
+    return Shared.Pool;
+}
+
+void Haversine_Threads::WorkerPool::Init(int InThreadCount)
+{
+    if (InThreadCount < 1) { InThreadCount = 1; }
+    if (InThreadCount > MaxThreadCount) { InThreadCount = MaxThreadCount; }
+
+    if (!State)
+    {
+        ThreadTimings = new PerfTiming[MaxThreadCount]{};
+        ThreadTaskCounts = new int[MaxThreadCount]{};
+        State = new WorkerPoolState{};
+        State->Threads = new std::thread[MaxThreadCount];
+        State->SpawnedCount = 1;
+        ThreadTimings[0].FuncName = "Main";
+    }
+
+    for (int ThreadIdx = State->SpawnedCount; ThreadIdx < InThreadCount; ThreadIdx++)
+    {
+        ThreadTimings[ThreadIdx].FuncName = "Worker";
+        State->Threads[ThreadIdx] = std::thread(WorkerThreadProc, this, ThreadIdx, State->Generation);
+    }
+    if (InThreadCount > State->SpawnedCount) { State->SpawnedCount = InThreadCount; }
+    ThreadCount = InThreadCount;
+}
+
+void Haversine_Threads::WorkerPool::Run(int TaskCount, TaskFuncT Func, void* Context)
+{
+    if (!State || TaskCount <= 0) { return; }
+
+    {
+        std::lock_guard<std::mutex> Lock(State->Mutex);
+        State->Func = Func;
+        State->Context = Context;
+        State->TaskCount = TaskCount;
+        State->NextTask = 0;
+        State->ActiveCount = ThreadCount;
+        State->ActiveWorkers = ThreadCount - 1;
+        State->Generation++;
+    }
+    State->WorkReady.notify_all();
+
+    RunTasks(this, 0);
+
+    std::unique_lock<std::mutex> Lock(State->Mutex);
+    while (State->ActiveWorkers > 0)
+    {
+        State->WorkDone.wait(Lock);
+    }
+}
+
+void Haversine_Threads::WorkerPool::PrintThreadTimings()
+{
+    if (!ThreadTimings) { return; }
+
+    u64 RunBegin = ThreadTimings[0].Begin;
+    u64 RunEnd = ThreadTimings[0].End;
+    for (int ThreadIdx = 1; ThreadIdx < ThreadCount; ThreadIdx++)
+    {
+        if (ThreadTimings[ThreadIdx].Begin < RunBegin) { RunBegin = ThreadTimings[ThreadIdx].Begin; }
+        if (ThreadTimings[ThreadIdx].End > RunEnd) { RunEnd = ThreadTimings[ThreadIdx].End; }
+    }
+    u64 RunCycles = RunEnd - RunBegin;
+
+    for (int ThreadIdx = 0; ThreadIdx < ThreadCount; ThreadIdx++)
+    {
+        PerfTiming* Timing = ThreadTimings + ThreadIdx;
+        u64 BusyCycles = Timing->End - Timing->Begin;
+        f64 Percent = RunCycles ? 100.0 * (f64)BusyCycles / (f64)RunCycles : 0.0;
+        fprintf(stdout, "\t  %s[%d]: %llu cycles (%.2f%% of run), %d tasks\n",
+                Timing->FuncName, ThreadIdx, BusyCycles, Percent, ThreadTaskCounts[ThreadIdx]);
+    }
+}
+
+void Haversine_Threads::WorkerPool::Release()
+{
+    if (State)
+    {
+        {
+            std::lock_guard<std::mutex> Lock(State->Mutex);
+            State->bQuit = true;
+        }
+        State->WorkReady.notify_all();
+        for (int ThreadIdx = 1; ThreadIdx < State->SpawnedCount; ThreadIdx++)
+        {
+            State->Threads[ThreadIdx].join();
+        }
+        delete[] State->Threads;
+        delete State;
+        State = nullptr;
+    }
+    delete[] ThreadTimings;
+    delete[] ThreadTaskCounts;
+    ThreadTimings = nullptr;
+    ThreadTaskCounts = nullptr;
+    ThreadCount = 0;
+}
+
@@ -0,0 +1,45 @@
+#ifndef HAVERSINE_THREADS_H
+#define HAVERSINE_THREADS_H
+
+#include "haversine_common.h"
+
+namespace Haversine_Threads
+{
+    static constexpr int MaxThreadCount = 256;
+
+    using TaskFuncT = void (*)(void* Context, int TaskIdx, int ThreadIdx);
+
+    struct WorkerPoolState;
+
+    // NOTE:
+    //      Pool of worker threads, Run() uses ThreadCount-1 of them and the thread
+    //      calling it participates as ThreadIdx 0. Tasks are handed out in index
+    //      order from a shared counter, so which thread runs a task is not
+    //      deterministic and callers must not depend on it for results
+    //      Workers are only ever added: Init with a smaller count leaves the extra
+    //      ones waiting for a later Run() that needs them, until Release()
+    struct WorkerPool
+    {
+        int ThreadCount;
+        WorkerPoolState* State;
+
+        // Per-thread breakdown of the most recent Run() (MaxThreadCount entries)
+        PerfTiming* ThreadTimings;
+        int* ThreadTaskCounts;
+
+        void Init(int InThreadCount);
+        void Run(int TaskCount, TaskFuncT Func, void* Context);
+        void PrintThreadTimings();
+        void Release();
+    };
+
+    // The process-wide pool, started on first use and set to ThreadCount threads,
+    // so repeated calls reuse the same workers instead of starting and joining their own
+    // Not reentrant: a task running on the pool must not acquire it
+    WorkerPool& AcquirePool(int ThreadCount);
+
+    int GetHardwareThreadCount();
+}
+
+#endif // HAVERSINE_THREADS_H
+
@@ -0,0 +1,302 @@
+#include "haversine_validate.h"
+#include "haversine_perf.h"
+#include "haversine_ref0.h"
+#include "haversine_ref1.h"
+#include "haversine_binary.h"
+#include "haversine_quantized.h"
+
+// C stdlib headers:
+#include <math.h>
+#include <string.h>
+
+namespace Haversine_Validate
+{
+    static const char* KernelNames[] = { "ref0", "ref1" };
+    static_assert(sizeof(KernelNames) / sizeof(KernelNames[0]) == (size_t)Kernel::Count, "Missing kernel name");
+
+    // Exactly one of the three is used, depending on what FileName turned out to be
+    struct PairSource
+    {
+        int Count;
+        HList List; // JSON
+        Haversine_Ref1::HListSoA Columns; // v2 f64
+        const Haversine_Quantized::QuantizedList* Quantized; // v2 fixed32/cluster16
+    };
+
+    struct ErrorStats
+    {
+        f64 MaxAbsError;
+        u64 MaxAbsIdx;
+        f64 MaxAbsExpected;
+        f64 MaxAbsComputed;
+        f64 MaxRelError;
+        u64 MaxRelIdx;
+        f64 Sum;
+    };
+
+    HPair GetPair(const PairSource& Source, int PairIdx)
+    {
+        if (Source.Quantized) { return Haversine_Quantized::DecodePair(*Source.Quantized, PairIdx); }
+        if (Source.List.Data) { return Source.List.Data[PairIdx]; }
+        return { Source.Columns.X0[PairIdx], Source.Columns.Y0[PairIdx], Source.Columns.X1[PairIdx], Source.Columns.Y1[PairIdx] };
+    }
+
+    // Scratch is a ChunkPairCount SoA for running Ref1 on JSON pairs, the same copy Haversine_Ref1's threaded sum makes
+    void CalculateChunk(const PairSource& Source, Kernel PairKernel, int BeginIdx, int EndIdx,
+            Haversine_Ref1::HListSoA* Scratch, f64* OutDistances)
+    {
+        if (PairKernel == Kernel::Ref0)
+        {
+            for (int PairIdx = BeginIdx; PairIdx < EndIdx; PairIdx++)
+            {
+                OutDistances[PairIdx - BeginIdx] = Haversine_Ref0::CalculateHaversine(GetPair(Source, PairIdx));
+            }
+        }
+        else if (Source.Quantized)
+        {
+            Haversine_Quantized::CalculateDistances(*Source.Quantized, BeginIdx, EndIdx, OutDistances);
+        }
+        else if (Source.List.Data)
+        {
+            for (int PairIdx = BeginIdx; PairIdx < EndIdx; PairIdx++)
+            {
+                const HPair& Pair = Source.List.Data[PairIdx];
+                Scratch->X0[PairIdx - BeginIdx] = Pair.X0;
+                Scratch->Y0[PairIdx - BeginIdx] = Pair.Y0;
+                Scratch->X1[PairIdx - BeginIdx] = Pair.X1;
+                Scratch->Y1[PairIdx - BeginIdx] = Pair.Y1;
+            }
+            Haversine_Ref1::CalculateDistances(*Scratch, 0, EndIdx - BeginIdx, OutDistances);
+        }
+        else
+        {
+            Haversine_Ref1::CalculateDistances(Source.Columns, BeginIdx, EndIdx, OutDistances);
+        }
+    }
+
+    // NaN (from either side) counts as an infinite error, so it can't hide behind the comparisons
+    void CompareChunk(const f64* Computed, const f64* Expected, int Count, u64 FirstPairIdx, ErrorStats* Stats)
+    {
+        for (int Idx = 0; Idx < Count; Idx++)
+        {
+            f64 AbsError = fabs(Computed[Idx] - Expected[Idx]);
+            if (AbsError != AbsError) { AbsError = INFINITY; }
+            f64 RelError = Expected[Idx] != 0.0 ? AbsError / fabs(Expected[Idx]) : (AbsError != 0.0 ? INFINITY : 0.0);
+            if (AbsError > Stats->MaxAbsError || Stats->MaxAbsIdx == UINT64_MAX)
+            {
+                Stats->MaxAbsError = AbsError;
+                Stats->MaxAbsIdx = FirstPairIdx + Idx;
+                Stats->MaxAbsExpected = Expected[Idx];
+                Stats->MaxAbsComputed = Computed[Idx];
+            }
+            if (RelError > Stats->MaxRelError || Stats->MaxRelIdx == UINT64_MAX)
+            {
+                Stats->MaxRelError = RelError;
+                Stats->MaxRelIdx = FirstPairIdx + Idx;
+            }
+            Stats->Sum += Computed[Idx];
+        }
+    }
+}
+
+const char* Haversine_Validate::GetKernelName(Kernel PairKernel)
+{
+    return (u32)PairKernel < (u32)Kernel::Count ? KernelNames[(u32)PairKernel] : "unknown";
+}
+
+bool Haversine_Validate::ParseKernel(const char* Name, Kernel* OutKernel)
+{
+    for (u32 KernelIdx = 0; KernelIdx < (u32)Kernel::Count; KernelIdx++)
+    {
+        if (strcmp(Name, KernelNames[KernelIdx]) == 0)
+        {
+            *OutKernel = (Kernel)KernelIdx;
+            return true;
+        }
+    }
+    return false;
+}
+
+void Haversine_Validate::GetAnswersFileName(char* OutFileName, int OutFileNameSize, const char* FileNameJSON)
+{
+    static constexpr char Extension[] = ".json";
+    static constexpr int ExtensionLength = sizeof(Extension) - 1;
+    int Length = (int)strlen(FileNameJSON);
+    if (Length >= ExtensionLength && strcmp(FileNameJSON + Length - ExtensionLength, Extension) == 0) { Length -= ExtensionLength; }
+    (void)sprintf_s(OutFileName, OutFileNameSize, "%.*s_answers.f64", Length, FileNameJSON);
+}
+
+FILE* Haversine_Validate::BeginAnswers(const char* FileName, u64 Count)
+{
+    FILE* FileHandle = nullptr;
+    fopen_s(&FileHandle, FileName, "wb");
+    if (!FileHandle)
+    {
+        fprintf(stdout, "ERROR: Could not open file %s for write!\n", FileName);
+        return nullptr;
+    }
+
+    // Sum stays 0 until FinishAnswers, a file cut short by a failed gen doesn't pass for a finished one
+    AnswersHeader Header = { AnswersMagic, AnswersVersion, sizeof(AnswersHeader), Count, 0.0, 0 };
+    if (fwrite(&Header, sizeof(Header), 1, FileHandle) != 1)
+    {
+        fprintf(stdout, "ERROR: Failed writing to file %s!\n", FileName);
+        fclose(FileHandle);
+        return nullptr;
+    }
+    return FileHandle;
+}
+
+bool Haversine_Validate::WriteAnswers(FILE* FileHandle, const f64* Distances, int Count)
+{
+    return fwrite(Distances, sizeof(f64), Count, FileHandle) == (size_t)Count;
+}
+
+bool Haversine_Validate::FinishAnswers(FILE* FileHandle, u64 Count, f64 Sum, bool bOk)
+{
+    AnswersHeader Header = { AnswersMagic, AnswersVersion, sizeof(AnswersHeader), Count, Sum, 0 };
+    bOk = bOk && fseek(FileHandle, 0, SEEK_SET) == 0 && fwrite(&Header, sizeof(Header), 1, FileHandle) == 1;
+    return fclose(FileHandle) == 0 && bOk;
+}
+
+bool Haversine_Validate::AnswersFile::Read(f64* OutDistances, int Count)
+{
+    return fread(OutDistances, sizeof(f64), Count, FileHandle) == (size_t)Count;
+}
+
+void Haversine_Validate::AnswersFile::Release()
+{
+    if (FileHandle) { fclose(FileHandle); }
+    *this = {};
+}
+
+bool Haversine_Validate::OpenAnswers(const char* FileName, AnswersFile* OutFile)
+{
+    AnswersFile Result = {};
+    fopen_s(&Result.FileHandle, FileName, "rb");
+    if (!Result.FileHandle)
+    {
+        fprintf(stdout, "ERROR: Could not open answers file %s!\n", FileName);
+        return false;
+    }
+
+    const char* Problem = nullptr;
+    if (fread(&Result.Header, sizeof(Result.Header), 1, Result.FileHandle) != 1 || Result.Header.Magic != AnswersMagic)
+    {
+        Problem = "not an answers file";
+    }
+    else if (Result.Header.Version != AnswersVersion) { Problem = "unsupported version"; }
+    else if (Result.Header.HeaderSize != sizeof(AnswersHeader)) { Problem = "unexpected header size"; }
+
+    if (Problem)
+    {
+        fprintf(stdout, "ERROR: %s: %s!\n", FileName, Problem);
+        Result.Release();
+        return false;
+    }
+    *OutFile = Result;
+    return true;
+}
+
+void Haversine_Validate::Validate(const char* FileName, const char* AnswersFileName, Kernel PairKernel, ReadFileFuncT ReadFile)
+{
+    TIME_FUNC();
+
+    AnswersFile Answers = {};
+    if (!OpenAnswers(AnswersFileName, &Answers)) { return; }
+
+    u64 CPUFreq = Perf::EstimateCPUFreq();
+    u64 LoadBegin = Perf::ReadCPUTimer();
+    PairSource Source = {};
+    Haversine_Binary::PairFile Input = {};
+    Haversine_Quantized::QuantizedList Quantized = {};
+    Haversine_Binary::FileHeader Header = {};
+    const char* InputKind = "JSON";
+    bool bLoaded = true;
+    if (Haversine_Binary::ReadHeader(FileName, &Header))
+    {
+        InputKind = Haversine_Binary::GetEncodingName(Header.ColumnEncoding);
+        if (Header.ColumnEncoding == Haversine_Binary::Encoding::F64)
+        {
+            bLoaded = Haversine_Binary::Open(FileName, &Input);
+            Source.Count = Input.Columns.Count;
+            Source.Columns = Input.Columns;
+        }
+        else
+        {
+            bLoaded = Haversine_Quantized::Open(FileName, &Input, &Quantized);
+            Source.Count = Quantized.Count;
+            Source.Quantized = &Quantized;
+        }
+    }
+    else
+    {
+        Source.List = ReadFile(FileName);
+        Source.Count = Source.List.Count;
+    }
+    u64 LoadElapsed = Perf::ReadCPUTimer() - LoadBegin;
+
+    if (!bLoaded) { Answers.Release(); return; }
+    if ((u64)Source.Count != Answers.Header.Count)
+    {
+        fprintf(stdout, "ERROR: %s has %d pairs, the answers in %s are for %llu!\n",
+                FileName, Source.Count, AnswersFileName, Answers.Header.Count);
+        TRACK_FREE(sizeof(HPair) * Source.List.Count);
+        delete[] Source.List.Data;
+        Input.Release();
+        Answers.Release();
+        return;
+    }
+
+    fprintf(stdout, "Validating %d pairs of %s (%s, loaded in %.2f ms) against %s with the %s kernel:\n",
+            Source.Count, FileName, InputKind, 1000.0 * (f64)LoadElapsed / (f64)CPUFreq, AnswersFileName, GetKernelName(PairKernel));
+
+    Haversine_Ref1::HListSoA Scratch = {};
+    Scratch.Init(ChunkPairCount);
+    f64* Computed = (f64*)_mm_malloc(sizeof(f64) * ChunkPairCount, Haversine_Ref1::ColumnAlignment);
+    f64* Expected = (f64*)_mm_malloc(sizeof(f64) * ChunkPairCount, Haversine_Ref1::ColumnAlignment);
+
+    ErrorStats Stats = { 0.0, UINT64_MAX, 0.0, 0.0, 0.0, UINT64_MAX, 0.0 };
+    u64 KernelElapsed = 0;
+    bool bAnswersOk = true;
+    u64 Begin = Perf::ReadCPUTimer();
+    for (int BeginIdx = 0; BeginIdx < Source.Count && bAnswersOk; BeginIdx += ChunkPairCount)
+    {
+        int EndIdx = Source.Count - BeginIdx < ChunkPairCount ? Source.Count : BeginIdx + ChunkPairCount;
+        u64 KernelBegin = Perf::ReadCPUTimer();
+        CalculateChunk(Source, PairKernel, BeginIdx, EndIdx, &Scratch, Computed);
+        KernelElapsed += Perf::ReadCPUTimer() - KernelBegin;
+
+        bAnswersOk = Answers.Read(Expected, EndIdx - BeginIdx);
+        if (bAnswersOk) { CompareChunk(Computed, Expected, EndIdx - BeginIdx, (u64)BeginIdx, &Stats); }
+        else { fprintf(stdout, "ERROR: %s ends before pair %d!\n", AnswersFileName, EndIdx); }
+    }
+    u64 Elapsed = Perf::ReadCPUTimer() - Begin;
+
+    if (bAnswersOk && Source.Count > 0)
+    {
+        f64 Megabyte = 1024.0 * 1024.0;
+        f64 Average = Stats.Sum / (f64)Source.Count;
+        f64 ExpectedAverage = Answers.Header.Sum / (f64)Answers.Header.Count;
+        fprintf(stdout, "\tMax abs error: %.3e km at pair %llu (expected %.15f, got %.15f)\n",
+                Stats.MaxAbsError, Stats.MaxAbsIdx, Stats.MaxAbsExpected, Stats.MaxAbsComputed);
+        fprintf(stdout, "\tMax rel error: %.3e at pair %llu\n", Stats.MaxRelError, Stats.MaxRelIdx);
+        if (Source.Quantized)
+        {
+            fprintf(stdout, "\t(%s coordinates alone can move a distance by up to %.3e km)\n",
+                    InputKind, Haversine_Quantized::GetMaxDistanceError(Quantized));
+        }
+        fprintf(stdout, "\tAverage: %.15f, answers %.15f, difference %.3e\n", Average, ExpectedAverage, fabs(Average - ExpectedAverage));
+        fprintf(stdout, "\tKernel: %.2f cycles/pair, %.2fM pairs/s; with answer reads and compare: %.2f cycles/pair, %.1f MB/s of answers\n",
+                (f64)KernelElapsed / (f64)Source.Count, (f64)Source.Count / ((f64)KernelElapsed / (f64)CPUFreq) / 1.0e6,
+                (f64)Elapsed / (f64)Source.Count, (f64)Source.Count * sizeof(f64) / Megabyte / ((f64)Elapsed / (f64)CPUFreq));
+    }
+
+    _mm_free(Expected);
+    _mm_free(Computed);
+    Scratch.Release();
+    TRACK_FREE(sizeof(HPair) * Source.List.Count);
+    delete[] Source.List.Data;
+    Input.Release();
+    Answers.Release();
+}
@@ -0,0 +1,75 @@
+#ifndef HAVERSINE_VALIDATE_H
+#define HAVERSINE_VALIDATE_H
+
+/*
+ * NOTE:
+ *      Reference answers written next to the JSON by gen -answers, and the
+ *      validate command that checks an implementation against them pair by pair:
+ *          AnswersHeader (32 bytes)
+ *          Count f64 distances, Haversine_Ref0::CalculateHaversine of each pair in file order
+ *      Sum is the distances summed block by block, the way gen -stream sums them,
+ *      so Sum / Count is the average it printed (plain gen sums in one pass, which
+ *      can differ in the last digits)
+ *      validate reads the answers ChunkPairCount at a time next to the
+ *      implementation's distances for the same chunk, so neither side ever needs
+ *      a Count sized array of results (the input pairs are still loaded as usual)
+ *      All fields are little endian, like Haversine_Binary
+ */
+
+#include "haversine_common.h"
+
+namespace Haversine_Validate
+{
+    static constexpr u32 AnswersMagic = 0x31415648; // "HVA1"
+    static constexpr u16 AnswersVersion = 1;
+    // 32KB of answers plus 32KB of results, both stay in L1/L2 while they're compared
+    static constexpr int ChunkPairCount = 4096;
+
+    struct AnswersHeader
+    {
+        u32 Magic;
+        u16 Version;
+        u16 HeaderSize; // sizeof(AnswersHeader), distances start right after it
+        u64 Count;
+        f64 Sum;
+        u64 Reserved;
+    };
+
+    enum struct Kernel : u32
+    {
+        Ref0, // CRT sin/cos/asin per pair (Haversine_Ref0::CalculateHaversine)
+        Ref1, // Polynomial approximations on wide lanes (Haversine_Ref1, the fused decode for quantized files)
+        Count
+    };
+
+    const char* GetKernelName(Kernel PairKernel);
+    bool ParseKernel(const char* Name, Kernel* OutKernel);
+
+    // FileNameJSON with .json replaced by _answers.f64
+    void GetAnswersFileName(char* OutFileName, int OutFileNameSize, const char* FileNameJSON);
+
+    // For writers that produce distances block by block: the header goes first with Count,
+    // WriteAnswers appends, FinishAnswers fills in Sum and closes the file
+    FILE* BeginAnswers(const char* FileName, u64 Count);
+    bool WriteAnswers(FILE* FileHandle, const f64* Distances, int Count);
+    bool FinishAnswers(FILE* FileHandle, u64 Count, f64 Sum, bool bOk);
+
+    struct AnswersFile
+    {
+        FILE* FileHandle;
+        AnswersHeader Header;
+
+        // The next Count distances
+        bool Read(f64* OutDistances, int Count);
+        void Release();
+    };
+
+    // Checks the header, prints why and returns false if it's off (a short file shows up as a failed Read)
+    bool OpenAnswers(const char* FileName, AnswersFile* OutFile);
+
+    // Runs PairKernel over the pairs of FileName (JSON read with ReadFile, or a v2 binary file of any encoding)
+    // and prints its worst absolute and relative error against the answers, and its speed
+    void Validate(const char* FileName, const char* AnswersFileName, Kernel PairKernel, ReadFileFuncT ReadFile);
+}
+
+#endif // HAVERSINE_VALIDATE_H